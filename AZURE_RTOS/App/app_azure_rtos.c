@@ -50,6 +50,11 @@ static UCHAR tx_byte_pool_buffer[TX_APP_MEM_POOL_SIZE];
 static TX_BYTE_POOL tx_app_byte_pool;
 
 /* USER CODE BEGIN FX_Pool_Buffer */
+/* The SD sector cache and I/O buffers are pool blocks: word aligned only
+   if the pool is (checked in MX_FileX_Init) */
+#if defined ( __ICCARM__ )
+#pragma data_alignment=4
+#endif
 /* USER CODE END FX_Pool_Buffer */
 static UCHAR  fx_byte_pool_buffer[FX_APP_MEM_POOL_SIZE];
 static TX_BYTE_POOL fx_app_byte_pool;
@@ -15,12 +15,36 @@
 #include "safety_stack.h"
 #include "safety_flow.h"
 #include "svc_params.h"
+#include "svc_kvstore.h"
+#include "svc_flashio.h"
+#include "svc_logger.h"
+#include "app_filex.h"
+#if FX_W25Q_BENCHMARK_ENABLED
+#include "lx_stm32_nor_custom_driver.h"
+#endif
+#include "bsp_w25qxx.h"
+#include "spi.h"
+#include "sdio.h"
 #include "SEGGER_RTT.h"
+#include "app_azure_rtos_config.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define MAIN_THREAD_NAME    "App Main"
 #define COMM_THREAD_NAME    "App Comm"
 
+/* Tx App byte pool use (App_CreateThreads): six stacks, each a pool block
+   with a two-pointer header, and the block ending the pool. The thread
+   control blocks are static */
+#define APP_POOL_BLOCK_OVERHEAD     (2U * sizeof(VOID *))
+#define APP_POOL_STACKS             6U
+#define APP_POOL_SIZE               (SAFETY_THREAD_STACK_SIZE + SVC_FLASHIO_READ_STACK_SIZE + \
+                                     SVC_FLASHIO_WRITE_STACK_SIZE + SVC_LOGGER_STACK_SIZE + \
+                                     APP_MAIN_THREAD_STACK_SIZE + APP_COMM_THREAD_STACK_SIZE + \
+                                     (APP_POOL_STACKS * APP_POOL_BLOCK_OVERHEAD) + \
+                                     sizeof(VOID *) + sizeof(ALIGN_TYPE))
+
+typedef char app_pool_size[(TX_APP_MEM_POOL_SIZE >= APP_POOL_SIZE) ? 1 : -1];
+
 /* Private variables ---------------------------------------------------------*/
 static TX_THREAD s_main_thread;
 static TX_THREAD s_comm_thread;
@@ -44,6 +68,14 @@ shared_status_t App_PreInit(void)
         Safety_ReportError(SAFETY_ERR_PARAM_INVALID, status, 0);
     }
 
+    /* Non-safety parameters from the external Flash, defaults if unavailable */
+    (void)BSP_W25QXX_Init(&hspi1);
+    status = Svc_KV_Init();
+    if (status != STATUS_OK)
+    {
+        SEGGER_RTT_printf(0, "KV store unavailable, non-safety defaults\r\n");
+    }
+
     return STATUS_OK;
 }
 
@@ -63,6 +95,30 @@ UINT App_CreateThreads(TX_BYTE_POOL *byte_pool)
         return status;
     }
 
+    /* External Flash transfers on DMA once threads run (polled until then),
+       reads served during erases by suspending them, requests queued to
+       the Flash I/O threads */
+    if (BSP_W25QXX_GetInfo()->initialized)
+    {
+        (void)BSP_W25QXX_EnableDMA();
+        (void)BSP_W25QXX_EnableSuspend();
+
+        status = Svc_FlashIO_Init(byte_pool);
+        if (status != TX_SUCCESS)
+        {
+            return status;
+        }
+    }
+
+#if FX_SD_MEDIA_ENABLED
+    /* Sensor data logger, writes to the SD card once started */
+    status = Svc_Logger_Init(byte_pool);
+    if (status != TX_SUCCESS)
+    {
+        return status;
+    }
+#endif
+
     /* === Allocate Main Thread Stack === */
     status = tx_byte_allocate(byte_pool,
                               (VOID **)&s_main_stack,
@@ -127,12 +183,103 @@ UINT App_CreateThreads(TX_BYTE_POOL *byte_pool)
 void App_MainThreadEntry(ULONG thread_input)
 {
     static uint32_t loop_count = 0;
+    uint32_t params_reader = Svc_Params_RegisterReader();
     (void)thread_input;
 
     /* RTT Test - Initial message */
     SEGGER_RTT_printf(0, "\r\n=== TKX_ThreadX App Started ===\r\n");
     SEGGER_RTT_printf(0, "SystemView Channel 1 active\r\n");
 
+#if SVC_KV_BENCHMARK_ENABLED
+    {
+        svc_kv_benchmark_t bench;
+
+        if (Svc_KV_Benchmark(&bench) == STATUS_OK)
+        {
+            SEGGER_RTT_printf(0, "KV bench (cycles): mount %u, get %u/%u, set %u/%u, gc %u\r\n",
+                              bench.mount_cycles, bench.get_avg_cycles, bench.get_max_cycles,
+                              bench.set_avg_cycles, bench.set_max_cycles, bench.gc_count);
+        }
+    }
+#endif
+
+#if W25QXX_BENCHMARK_ENABLED
+    {
+        w25qxx_benchmark_t w25_bench;
+
+        if (BSP_W25QXX_Benchmark(&w25_bench) == W25QXX_OK)
+        {
+            SEGGER_RTT_printf(0, "W25Q read bench (kB/s): read %u, stream %u, verify %u, bus %u\r\n",
+                              w25_bench.read_rate, w25_bench.stream_rate, w25_bench.verify_rate,
+                              w25_bench.bus_rate);
+        }
+    }
+#endif
+
+#if FX_W25Q_BENCHMARK_ENABLED
+    {
+        lx_nor_w25q_benchmark_t lx_bench;
+
+        if (lx_stm32_nor_custom_driver_benchmark(&lx_bench) == LX_SUCCESS)
+        {
+            SEGGER_RTT_printf(0, "LevelX bench (cycles): format %u, mount %u, seq %u (%u erases), "
+                              "rand %u (%u erases), read %u, words %u\r\n",
+                              lx_bench.format_cycles, lx_bench.mount_cycles,
+                              lx_bench.seq_write_cycles, lx_bench.seq_erases,
+                              lx_bench.rand_write_cycles, lx_bench.rand_erases,
+                              lx_bench.read_cycles, lx_bench.words_written);
+        }
+    }
+#endif
+
+#if FX_W25Q_MEDIA_ENABLED
+    if (BSP_W25QXX_GetInfo()->initialized)
+    {
+        SEGGER_RTT_printf(0, "W25Q file system: %u\r\n", MX_FileX_W25qMount());
+    }
+#endif
+
+#if FX_SD_MEDIA_ENABLED
+    if (SDIO_IsCardPresent())
+    {
+        UINT sd_status = MX_FileX_SdMount(fx_stm32_sd_cache_driver);
+
+        SEGGER_RTT_printf(0, "SD file system: %u\r\n", sd_status);
+
+#if FX_SD_BENCHMARK_ENABLED
+        if (sd_status == FX_SUCCESS)
+        {
+            fx_sd_benchmark_t sd_bench;
+
+            if (MX_FileX_SdBenchmark(&sd_bench) == FX_SUCCESS)
+            {
+                SEGGER_RTT_printf(0, "SD bench (kB/s): write %u (%u requests), read %u (%u requests)\r\n",
+                                  sd_bench.write_rate, sd_bench.write_requests,
+                                  sd_bench.read_rate, sd_bench.read_requests);
+                SEGGER_RTT_printf(0, "SD bench sector calls (kB/s): write %u, read %u\r\n",
+                                  sd_bench.small_write_rate, sd_bench.small_read_rate);
+            }
+        }
+#endif
+
+#if SVC_LOGGER_BENCHMARK_ENABLED
+        if (sd_status == FX_SUCCESS)
+        {
+            svc_logger_benchmark_t log_bench;
+
+            if (Svc_Logger_Benchmark(MX_FileX_SdMedia(), &log_bench) == STATUS_OK)
+            {
+                SEGGER_RTT_printf(0, "Logger bench: %u kB/s, push max %u ns, stall max %u us, "
+                                  "write max %u us, checkpoint max %u us, stop %u ms, %u requests\r\n",
+                                  log_bench.rate_kbs, log_bench.push_max_ns, log_bench.stall_max_us,
+                                  log_bench.write_max_us, log_bench.checkpoint_max_us,
+                                  log_bench.stop_ms, log_bench.write_requests);
+            }
+        }
+#endif
+    }
+#endif
+
     /* Wait for safety system to be ready */
     while (!Safety_IsOperational())
     {
@@ -155,8 +302,13 @@ void App_MainThreadEntry(ULONG thread_input)
 
         if (state == SAFETY_STATE_NORMAL)
         {
-            /* Normal operation */
-            /* TODO: Add application logic here */
+            /* Normal operation: one parameter set per cycle, kept across a reload */
+            const svc_params_set_t *params = Svc_Params_ReadBegin(params_reader);
+
+            /* TODO: Add application logic here (params->params, params->calibration) */
+            (void)params;
+
+            Svc_Params_ReadEnd(params_reader);
 
             /* Record flow checkpoint */
             Safety_Flow_Checkpoint(PFM_CP_APP_MAIN_LOOP);
@@ -184,6 +336,8 @@ void App_MainThreadEntry(ULONG thread_input)
 
 void App_CommThreadEntry(ULONG thread_input)
 {
+    ULONG reload_tick = tx_time_get();
+    shared_status_t reload_status = STATUS_OK;
     (void)thread_input;
 
     /* Wait for safety system to be ready */
@@ -202,6 +356,19 @@ void App_CommThreadEntry(ULONG thread_input)
         {
             /* TODO: Handle communication */
 
+            /* Pick up a calibration record written over the debug port, no reset */
+            if ((tx_time_get() - reload_tick) >= SVC_PARAMS_RELOAD_TICKS)
+            {
+                shared_status_t status = Svc_Params_Reload();
+
+                if ((status != STATUS_OK) && (status != reload_status))
+                {
+                    SEGGER_RTT_printf(0, "Parameter reload rejected: %u\r\n", (unsigned)status);
+                }
+                reload_status = status;
+                reload_tick = tx_time_get();
+            }
+
             /* Record flow checkpoint */
             Safety_Flow_Checkpoint(PFM_CP_APP_COMM_HANDLER);
 
@@ -17,6 +17,52 @@
  *   PA6 -> SPI1_MISO
  *   PA7 -> SPI1_MOSI
  *
+ * The driver reaches the device through a transport (w25qxx_transport_t:
+ * transfers, CS, delay and time). BSP_W25QXX_Init uses the HAL SPI
+ * transport (bsp_w25qxx_spi.c); BSP_W25QXX_InitTransport takes any other,
+ * such as the W25Q128 model of bsp_w25qxx_sim.h for host builds. The
+ * driver itself only depends on ThreadX for its lock.
+ *
+ * HAL SPI transport: transfers of W25QXX_DMA_THRESHOLD bytes or more run
+ * on DMA (SPI1_RX: DMA2_Stream0, SPI1_TX: DMA2_Stream5) once
+ * BSP_W25QXX_EnableDMA has been called; the calling thread is suspended on
+ * a semaphore until the DMA complete callback. Commands, status polls,
+ * transfers outside a thread (before the kernel starts) and buffers in CCM
+ * RAM (not reachable by DMA) stay on polled SPI.
+ *
+ * Erase and program completion is awaited by sleeping the calling thread
+ * for most of the expected duration, then polling the BUSY bit with an
+ * increasing interval. The expected duration starts at the datasheet
+ * typical value and follows the measured times (BSP_W25QXX_GetTiming).
+ *
+ * With W25QXX_CACHE_ENABLED, reads of up to one line are served from a RAM
+ * cache of W25QXX_CACHE_LINES lines (LRU replacement). Programs and erases
+ * through this driver update the cached lines, so the cache never holds
+ * stale data. Larger reads bypass the cache and do not evict hot lines.
+ *
+ * With BSP_W25QXX_EnableSuspend, the driver is locked per call and an
+ * erase does not hold the lock while it waits: a read from another thread
+ * suspends the erase, is served, and resumes it, so read latency is not
+ * bounded by W25QXX_TIMEOUT_SECTOR_ERASE. Reads of the range being erased,
+ * and all other commands, wait for the erase to finish.
+ *
+ * BSP_W25QXX_ReadStream reads a range of any length with one Fast Read
+ * command (CS held low) into two caller buffers in turn: while the DMA
+ * fills one segment, the consumer callback processes the other, so the
+ * bus does not stop between segments for per-call overhead.
+ *
+ * BSP_W25QXX_ReadVerify streams a range ending in a CRC32 trailer and
+ * computes the CRC as each segment arrives, so image staging, backup
+ * restore and integrity checks take one pass with no copy of the data.
+ * The CRC is the one of the STM32 CRC unit and Boot_CRC32_Calculate
+ * (BSP_W25QXX_CRC32), computed in software: the unit belongs to the
+ * safety self-test.
+ *
+ * The SCK is given by the transport (the HAL SPI transport derives it from
+ * the SPI handle at BSP_W25QXX_Init): above
+ * W25QXX_READ_DATA_MAX_HZ, BSP_W25QXX_Read also uses Fast Read. SPI1 at
+ * APB2 / 2 (42 MHz) is the fastest this MCU allows and within both limits.
+ *
  ******************************************************************************
  */
 
@@ -28,7 +74,6 @@ extern "C" {
 #endif
 
 /* Includes ------------------------------------------------------------------*/
-#include "stm32f4xx_hal.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -69,10 +114,13 @@ extern "C" {
 #define W25QXX_CMD_RELEASE_POWER_DOWN   0xABU
 #define W25QXX_CMD_READ_ID              0x90U
 #define W25QXX_CMD_JEDEC_ID             0x9FU
+#define W25QXX_CMD_SUSPEND              0x75U
+#define W25QXX_CMD_RESUME               0x7AU
 
 /* Status Register Bits */
 #define W25QXX_STATUS_BUSY              0x01U
 #define W25QXX_STATUS_WEL               0x02U
+#define W25QXX_STATUS_SUS               0x80U   /* Status register 2 */
 
 /* Timeout Values (ms) */
 #define W25QXX_TIMEOUT_DEFAULT          1000U
@@ -80,6 +128,45 @@ extern "C" {
 #define W25QXX_TIMEOUT_SECTOR_ERASE     400U
 #define W25QXX_TIMEOUT_BLOCK_ERASE      2000U
 #define W25QXX_TIMEOUT_CHIP_ERASE       200000U
+#define W25QXX_TIMEOUT_SUSPEND          2U      /* tSUS is 20us */
+
+/* Clock Limits (Hz) */
+#define W25QXX_READ_DATA_MAX_HZ         50000000U   /* Read Data (0x03) */
+#define W25QXX_FAST_READ_MAX_HZ         104000000U  /* Fast Read (0x0B) and other commands */
+
+/* Erase Suspend */
+#define W25QXX_SUSPEND_MAX              32U     /* Suspends per erase, then reads wait */
+
+/* Typical Operation Times (ms, datasheet), starting point of the estimates */
+#define W25QXX_TYPICAL_PAGE_PROGRAM     1U      /* 0.7ms */
+#define W25QXX_TYPICAL_SECTOR_ERASE     45U
+#define W25QXX_TYPICAL_BLOCK_ERASE_32K  120U
+#define W25QXX_TYPICAL_BLOCK_ERASE_64K  150U
+#define W25QXX_TYPICAL_CHIP_ERASE       40000U
+
+/* Busy Polling */
+#define W25QXX_SLEEP_PERCENT            75U     /* Initial sleep, % of the estimate */
+#define W25QXX_POLL_MAX_MS              1000U   /* Longest interval between polls */
+#define W25QXX_ESTIMATE_SHIFT           3U      /* Estimate += (measured - estimate) / 8 */
+
+/* DMA Transfers (HAL SPI transport) */
+#define W25QXX_DMA_THRESHOLD            32U     /* Smallest payload moved by DMA (bytes) */
+#define W25QXX_DMA_MAX_TRANSFER         0xFFFFU /* HAL transfer count limit, largest async receive */
+
+/* CRC32 Trailer (BSP_W25QXX_ReadVerify): last word of the range, little-endian */
+#define W25QXX_CRC32_INIT               0xFFFFFFFFUL    /* Polynomial 0x04C11DB7, as the CRC unit */
+#define W25QXX_CRC32_TRAILER_SIZE       4U
+
+/* Read Cache (RAM: W25QXX_CACHE_LINES * W25QXX_CACHE_LINE_SIZE bytes) */
+#define W25QXX_CACHE_ENABLED            1
+#define W25QXX_CACHE_LINE_SIZE          W25Q128_PAGE_SIZE   /* Page (256B) or sector (4KB) */
+#define W25QXX_CACHE_LINES              8U
+
+/* Read Benchmark (BSP_W25QXX_Benchmark, 2 * W25QXX_BENCH_SEGMENT bytes of RAM) */
+#define W25QXX_BENCHMARK_ENABLED        0
+#define W25QXX_BENCH_ADDR               0U
+#define W25QXX_BENCH_SIZE               (1024U * 1024U)         /* Bytes read per method */
+#define W25QXX_BENCH_SEGMENT            W25Q128_SECTOR_SIZE     /* Read call / stream segment */
 
 /* ============================================================================
  * Type Definitions
@@ -95,7 +182,8 @@ typedef enum {
     W25QXX_TIMEOUT              = 0x03U,    /* Operation timeout */
     W25QXX_INVALID_PARAM        = 0x04U,    /* Invalid parameter */
     W25QXX_ID_ERROR             = 0x05U,    /* Device ID mismatch */
-    W25QXX_SPI_ERROR            = 0x06U     /* SPI communication error */
+    W25QXX_SPI_ERROR            = 0x06U,    /* SPI communication error */
+    W25QXX_CRC_ERROR            = 0x07U     /* Data does not match its CRC32 trailer */
 } w25qxx_status_t;
 
 /**
@@ -109,18 +197,115 @@ typedef struct {
     uint32_t sector_size;                   /* Sector size in bytes */
     uint32_t page_size;                     /* Page size in bytes */
     bool     initialized;                   /* Initialization status */
+    uint32_t cache_hits;                    /* Cache lines served from RAM */
+    uint32_t cache_misses;                  /* Cache lines loaded from Flash */
+    uint32_t erase_suspends;                /* Erases suspended for a read */
+    uint32_t sck_hz;                        /* SPI clock */
+    uint8_t  read_command;                  /* Read Data or Fast Read, from sck_hz */
 } w25qxx_info_t;
 
+/**
+ * @brief Device access used by the driver
+ * @note  All functions get the context. receive_start may complete the
+ *        transfer before it returns (no DMA); receive_wait then returns at
+ *        once. delay sleeps the calling thread where in_thread is true.
+ */
+typedef struct {
+    void *context;
+    uint32_t sck_hz;                                                /* SPI clock */
+    void (*select)(void *context, bool selected);                   /* CS low while selected */
+    w25qxx_status_t (*transmit)(void *context, const uint8_t *pData, uint32_t size);
+    w25qxx_status_t (*receive)(void *context, uint8_t *pData, uint32_t size);
+    w25qxx_status_t (*receive_start)(void *context, uint8_t *pData, uint32_t size);
+    w25qxx_status_t (*receive_wait)(void *context);
+    void (*delay)(void *context, uint32_t ms);
+    uint32_t (*get_tick)(void *context);                            /* ms */
+    bool (*in_thread)(void *context);                               /* May sleep and lock */
+} w25qxx_transport_t;
+
+/**
+ * @brief Stream consumer: processes one segment
+ * @param context Caller context
+ * @param pData Segment data, valid until the callback returns
+ * @param size Segment bytes
+ * @retval bool true to continue, false to stop the stream
+ * @note  Called with the driver locked and CS low: must not call the driver
+ */
+typedef bool (*w25qxx_stream_callback_t)(void *context, const uint8_t *pData, uint32_t size);
+
+/**
+ * @brief Read benchmark result (kB/s, 1000 bytes per second)
+ */
+typedef struct {
+    uint32_t read_rate;                     /* BSP_W25QXX_Read, W25QXX_BENCH_SEGMENT per call */
+    uint32_t stream_rate;                   /* BSP_W25QXX_ReadStream */
+    uint32_t verify_rate;                   /* BSP_W25QXX_ReadVerify */
+    uint32_t bus_rate;                      /* SCK / 8, the limit */
+} w25qxx_benchmark_t;
+
+/**
+ * @brief Operations with a busy phase
+ */
+typedef enum {
+    W25QXX_OP_PAGE_PROGRAM      = 0x00U,
+    W25QXX_OP_SECTOR_ERASE      = 0x01U,
+    W25QXX_OP_BLOCK_ERASE_32K   = 0x02U,
+    W25QXX_OP_BLOCK_ERASE_64K   = 0x03U,
+    W25QXX_OP_CHIP_ERASE        = 0x04U,
+    W25QXX_OP_COUNT
+} w25qxx_op_t;
+
+/**
+ * @brief Measured busy times of an operation (ms, HAL tick resolution)
+ */
+typedef struct {
+    uint32_t count;                         /* Completed operations */
+    uint32_t timeouts;                      /* Operations past their timeout */
+    uint32_t last_ms;                       /* Latest duration */
+    uint32_t min_ms;                        /* Shortest duration */
+    uint32_t max_ms;                        /* Longest duration */
+    uint32_t estimate_ms;                   /* Running average, drives the sleep */
+    uint32_t polls;                         /* Status register reads */
+} w25qxx_timing_t;
+
 /* ============================================================================
  * Public Function Prototypes
  * ============================================================================*/
 
+/* HAL SPI handle (stm32f4xx_hal_spi.h), kept opaque for host builds */
+struct __SPI_HandleTypeDef;
+
 /**
- * @brief Initialize W25QXX device
+ * @brief Initialize W25QXX device on the HAL SPI transport
  * @param hspi Pointer to SPI handle
  * @retval w25qxx_status_t Operation status
+ * @note  Implemented in bsp_w25qxx_spi.c
  */
-w25qxx_status_t BSP_W25QXX_Init(SPI_HandleTypeDef *hspi);
+w25qxx_status_t BSP_W25QXX_Init(struct __SPI_HandleTypeDef *hspi);
+
+/**
+ * @brief Initialize W25QXX device on a transport
+ * @param transport Device access, must stay valid until BSP_W25QXX_DeInit
+ * @retval w25qxx_status_t Operation status
+ */
+w25qxx_status_t BSP_W25QXX_InitTransport(const w25qxx_transport_t *transport);
+
+/**
+ * @brief Enable DMA transfers with thread suspension (HAL SPI transport)
+ * @retval w25qxx_status_t Operation status
+ * @note  Creates a ThreadX semaphore: call from tx_application_define
+ *        (App_CreateThreads) or a thread, after BSP_W25QXX_Init
+ */
+w25qxx_status_t BSP_W25QXX_EnableDMA(void);
+
+/**
+ * @brief Enable erase suspend for reads from other threads
+ * @retval w25qxx_status_t Operation status
+ * @note  Creates the driver mutex: call from tx_application_define
+ *        (App_CreateThreads) or a thread, after BSP_W25QXX_Init. Do not
+ *        call the driver from ISRs afterwards.
+ */
+w25qxx_status_t BSP_W25QXX_EnableSuspend(void);
 
 /**
  * @brief Deinitialize W25QXX device
@@ -146,9 +331,52 @@ uint32_t BSP_W25QXX_ReadJEDECID(void);
  * @param addr Flash address
  * @param size Number of bytes to read
  * @retval w25qxx_status_t Operation status
+ * @note  Reads of up to W25QXX_CACHE_LINE_SIZE bytes go through the cache
  */
 w25qxx_status_t BSP_W25QXX_Read(uint8_t *pBuffer, uint32_t addr, uint32_t size);
 
+/**
+ * @brief Stream data from flash to a consumer (Fast Read, double-buffered)
+ * @param addr Flash address
+ * @param size Number of bytes to read (any length within the device)
+ * @param pBuffer Two segments of segment bytes, not in CCM RAM for DMA
+ * @param segment Segment size (1..W25QXX_DMA_MAX_TRANSFER bytes)
+ * @param callback Consumer, called once per segment in address order
+ * @param context Passed to the callback
+ * @retval w25qxx_status_t Operation status, W25QXX_ERROR if the consumer stopped
+ * @note  Holds the driver for the whole stream and waits for a pending
+ *        erase instead of suspending it. Bypasses the read cache.
+ */
+w25qxx_status_t BSP_W25QXX_ReadStream(uint32_t addr, uint32_t size, uint8_t *pBuffer,
+                                      uint32_t segment, w25qxx_stream_callback_t callback,
+                                      void *context);
+
+/**
+ * @brief Stream data from flash to a consumer and check its CRC32 trailer
+ * @param addr Flash address
+ * @param size Number of bytes to read, W25QXX_CRC32_TRAILER_SIZE of them the trailer
+ * @param pBuffer Two segments of segment bytes, not in CCM RAM for DMA
+ * @param segment Segment size (1..W25QXX_DMA_MAX_TRANSFER bytes)
+ * @param callback Consumer of the data before the trailer, NULL to only check
+ * @param context Passed to the callback
+ * @param pCrc CRC32 of the data (output, may be NULL)
+ * @retval w25qxx_status_t W25QXX_OK if the trailer matches, W25QXX_CRC_ERROR if not
+ * @note  As BSP_W25QXX_ReadStream. The consumer has seen all the data
+ *        before the result is known: it stages, the caller commits on
+ *        W25QXX_OK.
+ */
+w25qxx_status_t BSP_W25QXX_ReadVerify(uint32_t addr, uint32_t size, uint8_t *pBuffer,
+                                      uint32_t segment, w25qxx_stream_callback_t callback,
+                                      void *context, uint32_t *pCrc);
+
+/**
+ * @brief Calculate the CRC32 of a buffer (trailer for BSP_W25QXX_ReadVerify)
+ * @param pData Data
+ * @param size Number of bytes, a partial last word is padded with 0xFF
+ * @retval uint32_t CRC32, equal to Boot_CRC32_Calculate
+ */
+uint32_t BSP_W25QXX_CRC32(const uint8_t *pData, uint32_t size);
+
 /**
  * @brief Write data to flash (handles page boundaries)
  * @param pBuffer Pointer to data buffer
@@ -164,10 +392,15 @@ w25qxx_status_t BSP_W25QXX_Write(uint8_t *pBuffer, uint32_t addr, uint32_t size)
  * @param pBuffer Pointer to data buffer
  * @param addr Flash address
  * @param size Number of bytes to write
- * @note Automatically erases sectors as needed (slower but safer)
+ * @param pWork Work buffer of W25Q128_SECTOR_SIZE bytes, owned by the caller
+ * @note Sectors already holding the data are skipped, sectors where the data
+ *       only clears bits are programmed without erase, and aligned 32KB/64KB
+ *       spans needing several erases use one block erase. Only pages that
+ *       change are programmed. Bytes outside the range are preserved.
  * @retval w25qxx_status_t Operation status
  */
-w25qxx_status_t BSP_W25QXX_WriteWithErase(uint8_t *pBuffer, uint32_t addr, uint32_t size);
+w25qxx_status_t BSP_W25QXX_WriteWithErase(const uint8_t *pBuffer, uint32_t addr,
+                                          uint32_t size, uint8_t *pWork);
 
 /**
  * @brief Erase a 4KB sector
@@ -203,6 +436,14 @@ w25qxx_status_t BSP_W25QXX_EraseChip(void);
  */
 const w25qxx_info_t* BSP_W25QXX_GetInfo(void);
 
+/**
+ * @brief Get the measured busy times of an operation
+ * @param op Operation
+ * @retval const w25qxx_timing_t* Timing, NULL for an unknown operation
+ * @note  Rising times indicate wear of the device (flash health)
+ */
+const w25qxx_timing_t* BSP_W25QXX_GetTiming(w25qxx_op_t op);
+
 /**
  * @brief Check if device is busy
  * @retval bool true if busy, false if ready
@@ -228,6 +469,19 @@ w25qxx_status_t BSP_W25QXX_WakeUp(void);
  */
 uint8_t BSP_W25QXX_ReadStatusReg(uint8_t reg);
 
+#if W25QXX_BENCHMARK_ENABLED
+/**
+ * @brief Measure the read throughput of BSP_W25QXX_Read, ReadStream and ReadVerify
+ * @param result Result (output)
+ * @retval w25qxx_status_t Operation status
+ * @note  Reads W25QXX_BENCH_SIZE bytes at W25QXX_BENCH_ADDR with each method
+ *        (not modified; a CRC mismatch of ReadVerify is not an error),
+ *        timed by the transport tick. Thread context with DMA enabled; on
+ *        the W25Q128 model the rates follow its bus time.
+ */
+w25qxx_status_t BSP_W25QXX_Benchmark(w25qxx_benchmark_t *result);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
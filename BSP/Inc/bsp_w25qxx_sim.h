@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file    bsp_w25qxx_sim.h
+ * @brief   W25Q128 Device Model (transport for the W25QXX driver)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * A W25Q128 behind a w25qxx_transport_t, for running the driver, the read
+ * cache, the KV store and LevelX on a host (or on target over a RAM array)
+ * with reproducible throughput:
+ *   - Commands are decoded byte by byte as the device does: a program or
+ *     erase executes when CS goes high.
+ *   - Page Program wraps within the 256-byte page and only clears bits;
+ *     a program that would set a bit (not erased first) is counted in
+ *     stats.overwrites and leaves the bit at 0.
+ *   - Programs and erases need WEL (Write Enable) and set BUSY for the
+ *     W25QXX_SIM_* typical time. WEL reads 1 until they complete. While
+ *     BUSY, only status reads and Erase/Program Suspend are accepted;
+ *     other commands are ignored and counted in stats.rejected.
+ *   - Time is virtual: each byte takes 8 SCK periods, delays advance it by
+ *     their duration, and the transport tick follows it.
+ *
+ * The model covers the memory array given at BSP_W25QXX_Sim_Init (up to
+ * W25Q128_FLASH_SIZE); beyond it reads return 0xFF and programs are lost.
+ * Erases apply to the array when issued (reads of a suspended erase see
+ * 0xFF). A host build needs ThreadX (Linux port) for the driver lock.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __BSP_W25QXX_SIM_H
+#define __BSP_W25QXX_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_w25qxx.h"
+
+/* ============================================================================
+ * Model Timing (us, W25Q128JV datasheet typical)
+ * ============================================================================*/
+
+#define W25QXX_SIM_PAGE_PROGRAM_US      700U
+#define W25QXX_SIM_SECTOR_ERASE_US      45000U
+#define W25QXX_SIM_BLOCK_ERASE_32K_US   120000U
+#define W25QXX_SIM_BLOCK_ERASE_64K_US   150000U
+#define W25QXX_SIM_CHIP_ERASE_US        40000000U
+#define W25QXX_SIM_SUSPEND_US           20U     /* tSUS */
+
+/* ============================================================================
+ * Type Definitions
+ * ============================================================================*/
+
+/**
+ * @brief Model statistics
+ */
+typedef struct {
+    uint64_t bytes_read;                    /* Data bytes clocked out by reads */
+    uint32_t page_programs;
+    uint32_t sector_erases;
+    uint32_t block_erases;                  /* 32KB and 64KB */
+    uint32_t chip_erases;
+    uint32_t suspends;
+    uint32_t overwrites;                    /* Programmed bytes with a bit 0 -> 1 */
+    uint32_t rejected;                      /* Commands ignored (BUSY, no WEL, power down) */
+} w25qxx_sim_stats_t;
+
+/**
+ * @brief Model instance
+ */
+typedef struct {
+    w25qxx_transport_t transport;           /* Pass to BSP_W25QXX_InitTransport */
+    uint8_t *memory;                        /* Array contents */
+    uint32_t size;
+    uint64_t time_ns;                       /* Virtual time */
+    bool thread;                            /* Reported as thread context (driver sleeps) */
+
+    /* Device state */
+    bool selected;
+    bool wel;
+    bool operating;                         /* Program or erase not completed */
+    bool suspended;
+    bool power_down;
+    uint8_t command;                        /* Of the current transaction, 0 if ignored */
+    uint32_t count;                         /* Bytes since CS low */
+    uint32_t address;
+    uint64_t done_ns;                       /* End of the running operation */
+    uint64_t remaining_ns;                  /* Of the suspended operation */
+    uint64_t suspend_ns;                    /* End of the suspend transition */
+    uint8_t latch[W25Q128_PAGE_SIZE];       /* Page Program data */
+    bool latched[W25Q128_PAGE_SIZE];
+
+    w25qxx_sim_stats_t stats;
+} w25qxx_sim_t;
+
+/* ============================================================================
+ * Public Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Initialize a model
+ * @param sim Model instance
+ * @param memory Array contents, erased (0xFF) by the caller or holding an image
+ * @param size Array bytes (up to W25Q128_FLASH_SIZE)
+ * @param sck_hz Modelled SPI clock
+ * @note  Then BSP_W25QXX_InitTransport(&sim->transport)
+ */
+void BSP_W25QXX_Sim_Init(w25qxx_sim_t *sim, uint8_t *memory, uint32_t size, uint32_t sck_hz);
+
+/**
+ * @brief Get the virtual time
+ * @param sim Model instance
+ * @retval uint64_t Time since BSP_W25QXX_Sim_Init (us)
+ */
+uint64_t BSP_W25QXX_Sim_GetTimeUs(const w25qxx_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_W25QXX_SIM_H */
@@ -96,8 +96,7 @@ void BSP_SysView_EnableCycleCounter(void)
     /* Enable trace and debug block */
     SCB_DEMCR |= SCB_DEMCR_TRCENA;
 
-    /* Reset cycle counter */
-    DWT_CYCCNT = 0;
+    /* No counter reset: CYCCNT also drives the safety time base */
 
     /* Enable cycle counter */
     DWT_CTRL |= DWT_CTRL_CYCCNTENA;
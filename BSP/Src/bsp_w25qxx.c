@@ -11,72 +11,257 @@
  * Target: STM32F407VGT6
  * Flash: W25Q128 (128Mbit / 16MB)
  *
+ * All device access goes through s_transport (CS, transfers, delay, time);
+ * the HAL SPI transport in bsp_w25qxx_spi.c runs large transfers on SPI1
+ * DMA, so the CPU is free for other threads for the ~0.8ms of a 4KB read
+ * at 42 MHz SCK. Without BSP_W25QXX_EnableSuspend the driver is not
+ * locked: callers serialize access (one thread or their own mutex).
+ *
+ * Erases and page programs are awaited asleep (see W25QXX_WaitBusy), so a
+ * 45ms sector erase costs a handful of status reads instead of a spin.
+ *
+ * Every program and erase passes through W25QXX_WritePage or W25QXX_Erase,
+ * which report to the read cache (W25QXX_CacheProgram/Erase).
+ *
+ * Once BSP_W25QXX_EnableSuspend has created s_lock, public functions hold
+ * it (recursively) for their SPI transactions. An erase releases it while
+ * waiting and records itself in s_pending; a read from another thread
+ * then suspends the erase (0x75), reads, and resumes it (0x7A). Commands
+ * other than reads wait for the erase to finish (W25QXX_LockIdle).
+ *
+ * BSP_W25QXX_ReadStream keeps CS low across its segments: the device
+ * streams continuously while SCK runs, and pausing SCK between the DMA
+ * transfers is harmless, so one command covers the whole range.
+ * BSP_W25QXX_ReadVerify puts W25QXX_VerifyConsume in front of the caller's
+ * consumer: it folds each segment into the CRC (one table lookup per
+ * byte, well ahead of the 42 MHz bus) and holds back the trailer bytes.
+ *
  ******************************************************************************
  */
 
 /* Includes ------------------------------------------------------------------*/
 #include "bsp_w25qxx.h"
 #include "bsp_debug.h"
-#include "main.h"
+#include "tx_api.h"
 #include <string.h>
 
 /* ============================================================================
  * Private Defines
  * ============================================================================*/
 
-/* CS Pin Control - Uses SPI_FLASH_CS_Pin defined in main.h */
-#ifndef SPI_FLASH_CS_Pin
-#define SPI_FLASH_CS_Pin        GPIO_PIN_4
-#define SPI_FLASH_CS_GPIO_Port  GPIOA
-#endif
-
-#define W25QXX_CS_LOW()         HAL_GPIO_WritePin(SPI_FLASH_CS_GPIO_Port, SPI_FLASH_CS_Pin, GPIO_PIN_RESET)
-#define W25QXX_CS_HIGH()        HAL_GPIO_WritePin(SPI_FLASH_CS_GPIO_Port, SPI_FLASH_CS_Pin, GPIO_PIN_SET)
+/* CS Control through the transport */
+#define W25QXX_CS_LOW()         W25QXX_Select(true)
+#define W25QXX_CS_HIGH()        W25QXX_Select(false)
 
 /* Dummy byte for SPI read operations */
 #define W25QXX_DUMMY_BYTE       0xFFU
 
+/* ============================================================================
+ * Private Types
+ * ============================================================================*/
+
+/* What it takes to turn the current contents into the new data */
+typedef enum {
+    W25QXX_CHANGE_NONE,                     /* Identical */
+    W25QXX_CHANGE_PROGRAM,                  /* Only 1 -> 0 bits, no erase */
+    W25QXX_CHANGE_ERASE                     /* Some 0 -> 1 bit, erase first */
+} w25qxx_change_t;
+
+/* Erase in progress, lock released while waiting */
+typedef struct {
+    w25qxx_op_t op;                         /* W25QXX_OP_COUNT if none */
+    uint32_t addr;                          /* Erased range */
+    uint32_t size;
+    uint32_t suspends;                      /* Suspends of this erase */
+    uint32_t suspended_ms;                  /* Time spent suspended */
+    uint32_t suspend_tick;                  /* Transport tick of the current suspend */
+} w25qxx_pending_t;
+
+/* BSP_W25QXX_ReadVerify stream state */
+typedef struct {
+    w25qxx_stream_callback_t callback;      /* Caller consumer, may be NULL */
+    void *context;
+    uint32_t crc;
+    uint8_t  word[4];                       /* Bytes of a word split across segments */
+    uint32_t word_bytes;
+    uint32_t data_remaining;                /* Bytes before the trailer */
+    uint8_t  trailer[W25QXX_CRC32_TRAILER_SIZE];
+    uint32_t trailer_bytes;
+} w25qxx_verify_t;
+
+#if W25QXX_CACHE_ENABLED
+/* Read cache line tag */
+typedef struct {
+    uint32_t address;                       /* Line start in Flash */
+    uint32_t last_use;                      /* LRU stamp, smallest is evicted */
+    bool     valid;
+} w25qxx_cache_line_t;
+
+/* A line is a whole number of pages within one sector */
+typedef char w25qxx_cache_line_size[
+    ((W25QXX_CACHE_LINE_SIZE == W25Q128_PAGE_SIZE) ||
+     (W25QXX_CACHE_LINE_SIZE == W25Q128_SECTOR_SIZE)) ? 1 : -1];
+#endif
+
 /* ============================================================================
  * Private Variables
  * ============================================================================*/
 
-static SPI_HandleTypeDef *s_hspi = NULL;
+static const w25qxx_transport_t *s_transport = NULL;
 static w25qxx_info_t s_device_info = {0};
 
-/* Sector buffer for write-with-erase operation */
-static uint8_t s_sector_buffer[W25Q128_SECTOR_SIZE];
+/* Measured busy times, estimates seeded with the datasheet typical values */
+static w25qxx_timing_t s_timing[W25QXX_OP_COUNT] = {
+    { 0U, 0U, 0U, 0U, 0U, W25QXX_TYPICAL_PAGE_PROGRAM,    0U },
+    { 0U, 0U, 0U, 0U, 0U, W25QXX_TYPICAL_SECTOR_ERASE,    0U },
+    { 0U, 0U, 0U, 0U, 0U, W25QXX_TYPICAL_BLOCK_ERASE_32K, 0U },
+    { 0U, 0U, 0U, 0U, 0U, W25QXX_TYPICAL_BLOCK_ERASE_64K, 0U },
+    { 0U, 0U, 0U, 0U, 0U, W25QXX_TYPICAL_CHIP_ERASE,      0U }
+};
+
+static const uint32_t s_timeout_ms[W25QXX_OP_COUNT] = {
+    W25QXX_TIMEOUT_PAGE_PROGRAM,
+    W25QXX_TIMEOUT_SECTOR_ERASE,
+    W25QXX_TIMEOUT_BLOCK_ERASE,
+    W25QXX_TIMEOUT_BLOCK_ERASE,
+    W25QXX_TIMEOUT_CHIP_ERASE
+};
+
+/* CRC32 of each byte value shifted in MSB-first, polynomial 0x04C11DB7 */
+static const uint32_t s_crc32_table[256] = {
+    0x00000000UL, 0x04C11DB7UL, 0x09823B6EUL, 0x0D4326D9UL, 0x130476DCUL, 0x17C56B6BUL,
+    0x1A864DB2UL, 0x1E475005UL, 0x2608EDB8UL, 0x22C9F00FUL, 0x2F8AD6D6UL, 0x2B4BCB61UL,
+    0x350C9B64UL, 0x31CD86D3UL, 0x3C8EA00AUL, 0x384FBDBDUL, 0x4C11DB70UL, 0x48D0C6C7UL,
+    0x4593E01EUL, 0x4152FDA9UL, 0x5F15ADACUL, 0x5BD4B01BUL, 0x569796C2UL, 0x52568B75UL,
+    0x6A1936C8UL, 0x6ED82B7FUL, 0x639B0DA6UL, 0x675A1011UL, 0x791D4014UL, 0x7DDC5DA3UL,
+    0x709F7B7AUL, 0x745E66CDUL, 0x9823B6E0UL, 0x9CE2AB57UL, 0x91A18D8EUL, 0x95609039UL,
+    0x8B27C03CUL, 0x8FE6DD8BUL, 0x82A5FB52UL, 0x8664E6E5UL, 0xBE2B5B58UL, 0xBAEA46EFUL,
+    0xB7A96036UL, 0xB3687D81UL, 0xAD2F2D84UL, 0xA9EE3033UL, 0xA4AD16EAUL, 0xA06C0B5DUL,
+    0xD4326D90UL, 0xD0F37027UL, 0xDDB056FEUL, 0xD9714B49UL, 0xC7361B4CUL, 0xC3F706FBUL,
+    0xCEB42022UL, 0xCA753D95UL, 0xF23A8028UL, 0xF6FB9D9FUL, 0xFBB8BB46UL, 0xFF79A6F1UL,
+    0xE13EF6F4UL, 0xE5FFEB43UL, 0xE8BCCD9AUL, 0xEC7DD02DUL, 0x34867077UL, 0x30476DC0UL,
+    0x3D044B19UL, 0x39C556AEUL, 0x278206ABUL, 0x23431B1CUL, 0x2E003DC5UL, 0x2AC12072UL,
+    0x128E9DCFUL, 0x164F8078UL, 0x1B0CA6A1UL, 0x1FCDBB16UL, 0x018AEB13UL, 0x054BF6A4UL,
+    0x0808D07DUL, 0x0CC9CDCAUL, 0x7897AB07UL, 0x7C56B6B0UL, 0x71159069UL, 0x75D48DDEUL,
+    0x6B93DDDBUL, 0x6F52C06CUL, 0x6211E6B5UL, 0x66D0FB02UL, 0x5E9F46BFUL, 0x5A5E5B08UL,
+    0x571D7DD1UL, 0x53DC6066UL, 0x4D9B3063UL, 0x495A2DD4UL, 0x44190B0DUL, 0x40D816BAUL,
+    0xACA5C697UL, 0xA864DB20UL, 0xA527FDF9UL, 0xA1E6E04EUL, 0xBFA1B04BUL, 0xBB60ADFCUL,
+    0xB6238B25UL, 0xB2E29692UL, 0x8AAD2B2FUL, 0x8E6C3698UL, 0x832F1041UL, 0x87EE0DF6UL,
+    0x99A95DF3UL, 0x9D684044UL, 0x902B669DUL, 0x94EA7B2AUL, 0xE0B41DE7UL, 0xE4750050UL,
+    0xE9362689UL, 0xEDF73B3EUL, 0xF3B06B3BUL, 0xF771768CUL, 0xFA325055UL, 0xFEF34DE2UL,
+    0xC6BCF05FUL, 0xC27DEDE8UL, 0xCF3ECB31UL, 0xCBFFD686UL, 0xD5B88683UL, 0xD1799B34UL,
+    0xDC3ABDEDUL, 0xD8FBA05AUL, 0x690CE0EEUL, 0x6DCDFD59UL, 0x608EDB80UL, 0x644FC637UL,
+    0x7A089632UL, 0x7EC98B85UL, 0x738AAD5CUL, 0x774BB0EBUL, 0x4F040D56UL, 0x4BC510E1UL,
+    0x46863638UL, 0x42472B8FUL, 0x5C007B8AUL, 0x58C1663DUL, 0x558240E4UL, 0x51435D53UL,
+    0x251D3B9EUL, 0x21DC2629UL, 0x2C9F00F0UL, 0x285E1D47UL, 0x36194D42UL, 0x32D850F5UL,
+    0x3F9B762CUL, 0x3B5A6B9BUL, 0x0315D626UL, 0x07D4CB91UL, 0x0A97ED48UL, 0x0E56F0FFUL,
+    0x1011A0FAUL, 0x14D0BD4DUL, 0x19939B94UL, 0x1D528623UL, 0xF12F560EUL, 0xF5EE4BB9UL,
+    0xF8AD6D60UL, 0xFC6C70D7UL, 0xE22B20D2UL, 0xE6EA3D65UL, 0xEBA91BBCUL, 0xEF68060BUL,
+    0xD727BBB6UL, 0xD3E6A601UL, 0xDEA580D8UL, 0xDA649D6FUL, 0xC423CD6AUL, 0xC0E2D0DDUL,
+    0xCDA1F604UL, 0xC960EBB3UL, 0xBD3E8D7EUL, 0xB9FF90C9UL, 0xB4BCB610UL, 0xB07DABA7UL,
+    0xAE3AFBA2UL, 0xAAFBE615UL, 0xA7B8C0CCUL, 0xA379DD7BUL, 0x9B3660C6UL, 0x9FF77D71UL,
+    0x92B45BA8UL, 0x9675461FUL, 0x8832161AUL, 0x8CF30BADUL, 0x81B02D74UL, 0x857130C3UL,
+    0x5D8A9099UL, 0x594B8D2EUL, 0x5408ABF7UL, 0x50C9B640UL, 0x4E8EE645UL, 0x4A4FFBF2UL,
+    0x470CDD2BUL, 0x43CDC09CUL, 0x7B827D21UL, 0x7F436096UL, 0x7200464FUL, 0x76C15BF8UL,
+    0x68860BFDUL, 0x6C47164AUL, 0x61043093UL, 0x65C52D24UL, 0x119B4BE9UL, 0x155A565EUL,
+    0x18197087UL, 0x1CD86D30UL, 0x029F3D35UL, 0x065E2082UL, 0x0B1D065BUL, 0x0FDC1BECUL,
+    0x3793A651UL, 0x3352BBE6UL, 0x3E119D3FUL, 0x3AD08088UL, 0x2497D08DUL, 0x2056CD3AUL,
+    0x2D15EBE3UL, 0x29D4F654UL, 0xC5A92679UL, 0xC1683BCEUL, 0xCC2B1D17UL, 0xC8EA00A0UL,
+    0xD6AD50A5UL, 0xD26C4D12UL, 0xDF2F6BCBUL, 0xDBEE767CUL, 0xE3A1CBC1UL, 0xE760D676UL,
+    0xEA23F0AFUL, 0xEEE2ED18UL, 0xF0A5BD1DUL, 0xF464A0AAUL, 0xF9278673UL, 0xFDE69BC4UL,
+    0x89B8FD09UL, 0x8D79E0BEUL, 0x803AC667UL, 0x84FBDBD0UL, 0x9ABC8BD5UL, 0x9E7D9662UL,
+    0x933EB0BBUL, 0x97FFAD0CUL, 0xAFB010B1UL, 0xAB710D06UL, 0xA6322BDFUL, 0xA2F33668UL,
+    0xBCB4666DUL, 0xB8757BDAUL, 0xB5365D03UL, 0xB1F740B4UL
+};
+
+#if W25QXX_CACHE_ENABLED
+/* Read cache (not in CCM: lines are filled by DMA) */
+static w25qxx_cache_line_t s_cache_lines[W25QXX_CACHE_LINES];
+static uint8_t s_cache_data[W25QXX_CACHE_LINES][W25QXX_CACHE_LINE_SIZE];
+static uint32_t s_cache_clock = 0U;
+#endif
+
+/* Bus lock and the erase it was released for */
+static TX_MUTEX s_lock;
+static bool s_lock_created = false;
+static uint32_t s_lock_depth = 0U;
+static w25qxx_pending_t s_pending = { W25QXX_OP_COUNT, 0U, 0U, 0U, 0U, 0U };
+
+#if W25QXX_BENCHMARK_ENABLED
+/* Benchmark segments (not in CCM: filled by DMA) */
+static uint8_t s_bench_buffer[2U * W25QXX_BENCH_SEGMENT];
+static volatile uint32_t s_bench_sum = 0U;
+#endif
 
 /* ============================================================================
  * Private Function Prototypes
  * ============================================================================*/
 
-static w25qxx_status_t W25QXX_SPI_Transmit(uint8_t *pData, uint16_t size);
-static w25qxx_status_t W25QXX_SPI_Receive(uint8_t *pData, uint16_t size);
+static w25qxx_status_t W25QXX_ReadDirect(uint8_t *pBuffer, uint32_t addr, uint32_t size);
+static void W25QXX_Select(bool selected);
+static w25qxx_status_t W25QXX_SPI_Transmit(const uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_SPI_Receive(uint8_t *pData, uint32_t size);
+static uint32_t W25QXX_GetTick(void);
+static bool W25QXX_VerifyConsume(void *context, const uint8_t *pData, uint32_t size);
+static uint32_t W25QXX_CRC32Words(uint32_t crc, const uint8_t *pData, uint32_t words);
+static void W25QXX_ReadCommand(uint8_t *cmd, uint8_t command, uint32_t addr);
 static w25qxx_status_t W25QXX_WriteEnable(void);
-static w25qxx_status_t W25QXX_WaitBusy(uint32_t timeout_ms);
+static w25qxx_status_t W25QXX_Erase(w25qxx_op_t op, uint8_t command, uint32_t addr, uint32_t size);
+static w25qxx_status_t W25QXX_WaitBusy(w25qxx_op_t op);
+static w25qxx_status_t W25QXX_Suspend(bool *suspended);
+static w25qxx_status_t W25QXX_Resume(void);
+static void W25QXX_Lock(void);
+static void W25QXX_LockIdle(void);
+static void W25QXX_Unlock(void);
+static void W25QXX_SleepUnlocked(uint32_t ms);
+static void W25QXX_RecordTime(w25qxx_timing_t *timing, uint32_t elapsed_ms);
+static bool W25QXX_InThread(void);
+static void W25QXX_CacheProgram(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                w25qxx_status_t status);
+static void W25QXX_CacheErase(uint32_t addr, uint32_t size, w25qxx_status_t status);
+#if W25QXX_CACHE_ENABLED
+static w25qxx_status_t W25QXX_CacheRead(uint8_t *pBuffer, uint32_t addr, uint32_t size);
+#endif
+static void W25QXX_Sleep(uint32_t ms);
 static w25qxx_status_t W25QXX_WritePage(uint8_t *pBuffer, uint32_t addr, uint16_t size);
+static w25qxx_status_t W25QXX_WriteBlock(const uint8_t *pBuffer, uint32_t addr, uint32_t span,
+                                         uint8_t *pWork, bool *written);
+static w25qxx_status_t W25QXX_WriteSector(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                          uint8_t *pWork);
+static w25qxx_status_t W25QXX_ProgramChanged(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                             const uint8_t *pCurrent);
+static w25qxx_change_t W25QXX_Classify(const uint8_t *pCurrent, const uint8_t *pBuffer, uint32_t size);
+#if W25QXX_BENCHMARK_ENABLED
+static bool W25QXX_BenchConsume(void *context, const uint8_t *pData, uint32_t size);
+static uint32_t W25QXX_BenchRate(uint32_t bytes, uint32_t ms);
+#endif
 
 /* ============================================================================
  * Public Functions
  * ============================================================================*/
 
 /**
- * @brief Initialize W25QXX device
+ * @brief Initialize W25QXX device on a transport
  */
-w25qxx_status_t BSP_W25QXX_Init(SPI_HandleTypeDef *hspi)
+w25qxx_status_t BSP_W25QXX_InitTransport(const w25qxx_transport_t *transport)
 {
     uint32_t jedec_id;
 
-    if (hspi == NULL)
+    if (transport == NULL)
     {
         return W25QXX_INVALID_PARAM;
     }
 
-    s_hspi = hspi;
+    s_transport = transport;
+
+    /* Clock profile: Read Data (0x03) is limited to W25QXX_READ_DATA_MAX_HZ */
+    s_device_info.sck_hz = transport->sck_hz;
+    s_device_info.read_command = (s_device_info.sck_hz > W25QXX_READ_DATA_MAX_HZ) ?
+                                 W25QXX_CMD_FAST_READ : W25QXX_CMD_READ_DATA;
 
     /* Ensure CS is high (deselected) */
     W25QXX_CS_HIGH();
-    HAL_Delay(1);
+    W25QXX_Sleep(1U);
 
     /* Read JEDEC ID to verify communication */
     jedec_id = BSP_W25QXX_ReadJEDECID();
@@ -103,6 +288,25 @@ w25qxx_status_t BSP_W25QXX_Init(SPI_HandleTypeDef *hspi)
 
     DEBUG_INFO("W25QXX: W25Q128 initialized successfully");
     DEBUG_INFO("W25QXX: Flash size = %lu MB", s_device_info.flash_size / (1024 * 1024));
+    DEBUG_INFO("W25QXX: SCK = %lu Hz, read command 0x%02X",
+               s_device_info.sck_hz, (unsigned int)s_device_info.read_command);
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Enable erase suspend for reads from other threads
+ */
+w25qxx_status_t BSP_W25QXX_EnableSuspend(void)
+{
+    if (!s_lock_created)
+    {
+        if (tx_mutex_create(&s_lock, "W25QXX", TX_INHERIT) != TX_SUCCESS)
+        {
+            return W25QXX_ERROR;
+        }
+        s_lock_created = true;
+    }
 
     return W25QXX_OK;
 }
@@ -112,8 +316,11 @@ w25qxx_status_t BSP_W25QXX_Init(SPI_HandleTypeDef *hspi)
  */
 w25qxx_status_t BSP_W25QXX_DeInit(void)
 {
-    s_hspi = NULL;
+    s_transport = NULL;
     memset(&s_device_info, 0, sizeof(s_device_info));
+#if W25QXX_CACHE_ENABLED
+    memset(s_cache_lines, 0, sizeof(s_cache_lines));
+#endif
     return W25QXX_OK;
 }
 
@@ -125,10 +332,12 @@ uint16_t BSP_W25QXX_ReadID(void)
     uint8_t cmd[4] = {W25QXX_CMD_READ_ID, 0x00, 0x00, 0x00};
     uint8_t id[2] = {0};
 
+    W25QXX_LockIdle();
     W25QXX_CS_LOW();
     W25QXX_SPI_Transmit(cmd, 4);
     W25QXX_SPI_Receive(id, 2);
     W25QXX_CS_HIGH();
+    W25QXX_Unlock();
 
     return ((uint16_t)id[0] << 8) | id[1];
 }
@@ -141,10 +350,12 @@ uint32_t BSP_W25QXX_ReadJEDECID(void)
     uint8_t cmd = W25QXX_CMD_JEDEC_ID;
     uint8_t id[3] = {0};
 
+    W25QXX_LockIdle();
     W25QXX_CS_LOW();
     W25QXX_SPI_Transmit(&cmd, 1);
     W25QXX_SPI_Receive(id, 3);
     W25QXX_CS_HIGH();
+    W25QXX_Unlock();
 
     return ((uint32_t)id[0] << 16) | ((uint32_t)id[1] << 8) | id[2];
 }
@@ -154,7 +365,6 @@ uint32_t BSP_W25QXX_ReadJEDECID(void)
  */
 w25qxx_status_t BSP_W25QXX_Read(uint8_t *pBuffer, uint32_t addr, uint32_t size)
 {
-    uint8_t cmd[4];
     w25qxx_status_t status;
 
     if (pBuffer == NULL || size == 0)
@@ -167,22 +377,189 @@ w25qxx_status_t BSP_W25QXX_Read(uint8_t *pBuffer, uint32_t addr, uint32_t size)
         return W25QXX_INVALID_PARAM;
     }
 
-    cmd[0] = W25QXX_CMD_READ_DATA;
-    cmd[1] = (addr >> 16) & 0xFF;
-    cmd[2] = (addr >> 8) & 0xFF;
-    cmd[3] = addr & 0xFF;
+    W25QXX_Lock();
+
+#if W25QXX_CACHE_ENABLED
+    if (size <= W25QXX_CACHE_LINE_SIZE)
+    {
+        status = W25QXX_CacheRead(pBuffer, addr, size);
+    }
+    else
+#endif
+    {
+        status = W25QXX_ReadDirect(pBuffer, addr, size);
+    }
+
+    W25QXX_Unlock();
+
+    return status;
+}
+
+/**
+ * @brief Stream data from flash to a consumer (Fast Read, double-buffered)
+ */
+w25qxx_status_t BSP_W25QXX_ReadStream(uint32_t addr, uint32_t size, uint8_t *pBuffer,
+                                      uint32_t segment, w25qxx_stream_callback_t callback,
+                                      void *context)
+{
+    uint8_t cmd[5];
+    uint8_t *pSegment[2];
+    uint32_t remaining = size;
+    uint32_t length;
+    uint32_t ready;
+    uint32_t current = 0U;
+    w25qxx_status_t status;
+
+    if ((pBuffer == NULL) || (callback == NULL) || (size == 0U) ||
+        (segment == 0U) || (segment > W25QXX_DMA_MAX_TRANSFER))
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    if ((addr >= W25Q128_FLASH_SIZE) || (size > (W25Q128_FLASH_SIZE - addr)))
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    pSegment[0] = pBuffer;
+    pSegment[1] = &pBuffer[segment];
+
+    /* A long stream would hold an erase suspended: let it finish first */
+    W25QXX_LockIdle();
+
+    length = (remaining > segment) ? segment : remaining;
+
+    W25QXX_ReadCommand(cmd, W25QXX_CMD_FAST_READ, addr);
 
     W25QXX_CS_LOW();
-    status = W25QXX_SPI_Transmit(cmd, 4);
+    status = W25QXX_SPI_Transmit(cmd, sizeof(cmd));
     if (status == W25QXX_OK)
     {
-        status = W25QXX_SPI_Receive(pBuffer, size);
+        status = s_transport->receive_start(s_transport->context, pSegment[0], length);
+    }
+
+    while (status == W25QXX_OK)
+    {
+        status = s_transport->receive_wait(s_transport->context);
+        if (status != W25QXX_OK)
+        {
+            break;
+        }
+
+        /* Start the next segment into the other buffer, then hand this one over */
+        remaining -= length;
+        ready = length;
+        length = (remaining > segment) ? segment : remaining;
+
+        if (length > 0U)
+        {
+            status = s_transport->receive_start(s_transport->context, pSegment[current ^ 1U], length);
+            if (status != W25QXX_OK)
+            {
+                break;
+            }
+        }
+
+        if (!callback(context, pSegment[current], ready))
+        {
+            if (length > 0U)
+            {
+                (void)s_transport->receive_wait(s_transport->context);
+            }
+            status = W25QXX_ERROR;
+            break;
+        }
+
+        if (length == 0U)
+        {
+            break;
+        }
+
+        current ^= 1U;
     }
     W25QXX_CS_HIGH();
 
+    W25QXX_Unlock();
+
     return status;
 }
 
+/**
+ * @brief Stream data from flash to a consumer and check its CRC32 trailer
+ */
+w25qxx_status_t BSP_W25QXX_ReadVerify(uint32_t addr, uint32_t size, uint8_t *pBuffer,
+                                      uint32_t segment, w25qxx_stream_callback_t callback,
+                                      void *context, uint32_t *pCrc)
+{
+    w25qxx_verify_t verify;
+    uint32_t stored;
+    w25qxx_status_t status;
+
+    if (size <= W25QXX_CRC32_TRAILER_SIZE)
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    verify.callback = callback;
+    verify.context = context;
+    verify.crc = W25QXX_CRC32_INIT;
+    verify.word_bytes = 0U;
+    verify.data_remaining = size - W25QXX_CRC32_TRAILER_SIZE;
+    verify.trailer_bytes = 0U;
+
+    status = BSP_W25QXX_ReadStream(addr, size, pBuffer, segment, W25QXX_VerifyConsume, &verify);
+    if (status != W25QXX_OK)
+    {
+        return status;
+    }
+
+    /* Partial last word padded as erased Flash, as Boot_CRC32_Calculate */
+    if (verify.word_bytes > 0U)
+    {
+        memset(&verify.word[verify.word_bytes], 0xFF, sizeof(verify.word) - verify.word_bytes);
+        verify.crc = W25QXX_CRC32Words(verify.crc, verify.word, 1U);
+    }
+
+    if (pCrc != NULL)
+    {
+        *pCrc = verify.crc;
+    }
+
+    stored = (uint32_t)verify.trailer[0] |
+             ((uint32_t)verify.trailer[1] << 8) |
+             ((uint32_t)verify.trailer[2] << 16) |
+             ((uint32_t)verify.trailer[3] << 24);
+
+    return (stored == verify.crc) ? W25QXX_OK : W25QXX_CRC_ERROR;
+}
+
+/**
+ * @brief Calculate the CRC32 of a buffer (trailer for BSP_W25QXX_ReadVerify)
+ */
+uint32_t BSP_W25QXX_CRC32(const uint8_t *pData, uint32_t size)
+{
+    uint8_t last[4];
+    uint32_t words = size / 4U;
+    uint32_t remaining = size % 4U;
+    uint32_t crc;
+
+    if (pData == NULL)
+    {
+        return 0U;
+    }
+
+    crc = W25QXX_CRC32Words(W25QXX_CRC32_INIT, pData, words);
+
+    if (remaining > 0U)
+    {
+        memset(last, 0xFF, sizeof(last));
+        memcpy(last, &pData[words * 4U], remaining);
+        crc = W25QXX_CRC32Words(crc, last, 1U);
+    }
+
+    return crc;
+}
+
 /**
  * @brief Write data to flash (handles page boundaries)
  */
@@ -203,6 +580,8 @@ w25qxx_status_t BSP_W25QXX_Write(uint8_t *pBuffer, uint32_t addr, uint32_t size)
         return W25QXX_INVALID_PARAM;
     }
 
+    W25QXX_LockIdle();
+
     /* Calculate offset within first page */
     page_offset = addr % W25Q128_PAGE_SIZE;
     page_remain = W25Q128_PAGE_SIZE - page_offset;
@@ -213,15 +592,12 @@ w25qxx_status_t BSP_W25QXX_Write(uint8_t *pBuffer, uint32_t addr, uint32_t size)
         page_remain = size;
     }
 
-    while (size > 0)
+    status = W25QXX_OK;
+    while ((size > 0) && (status == W25QXX_OK))
     {
         bytes_to_write = (size < page_remain) ? size : page_remain;
 
         status = W25QXX_WritePage(pBuffer, addr, bytes_to_write);
-        if (status != W25QXX_OK)
-        {
-            return status;
-        }
 
         addr += bytes_to_write;
         pBuffer += bytes_to_write;
@@ -229,23 +605,34 @@ w25qxx_status_t BSP_W25QXX_Write(uint8_t *pBuffer, uint32_t addr, uint32_t size)
 
         /* After first page, always start at page boundary */
         page_remain = W25Q128_PAGE_SIZE;
+
+        /* Hand the lock to a waiting reader between pages. Only here: the
+           pages of a sector rewrite (WriteWithErase) are not yielded, as
+           the erased bytes would be visible */
+        if ((size > 0U) && (status == W25QXX_OK))
+        {
+            W25QXX_SleepUnlocked(0U);
+        }
     }
 
-    return W25QXX_OK;
+    W25QXX_Unlock();
+
+    return status;
 }
 
 /**
  * @brief Write data with automatic erase
  */
-w25qxx_status_t BSP_W25QXX_WriteWithErase(uint8_t *pBuffer, uint32_t addr, uint32_t size)
+w25qxx_status_t BSP_W25QXX_WriteWithErase(const uint8_t *pBuffer, uint32_t addr,
+                                          uint32_t size, uint8_t *pWork)
 {
     w25qxx_status_t status;
-    uint32_t sector_addr;
-    uint32_t sector_offset;
+    uint32_t span;
     uint32_t sector_remain;
     uint32_t bytes_to_write;
+    bool written;
 
-    if (pBuffer == NULL || size == 0)
+    if (pBuffer == NULL || pWork == NULL || size == 0)
     {
         return W25QXX_INVALID_PARAM;
     }
@@ -255,45 +642,53 @@ w25qxx_status_t BSP_W25QXX_WriteWithErase(uint8_t *pBuffer, uint32_t addr, uint3
         return W25QXX_INVALID_PARAM;
     }
 
-    while (size > 0)
-    {
-        /* Calculate sector address and offset */
-        sector_addr = addr & ~(W25Q128_SECTOR_SIZE - 1);
-        sector_offset = addr - sector_addr;
-        sector_remain = W25Q128_SECTOR_SIZE - sector_offset;
-
-        bytes_to_write = (size < sector_remain) ? size : sector_remain;
+    W25QXX_LockIdle();
 
-        /* Read existing sector data */
-        status = BSP_W25QXX_Read(s_sector_buffer, sector_addr, W25Q128_SECTOR_SIZE);
-        if (status != W25QXX_OK)
+    status = W25QXX_OK;
+    while ((size > 0) && (status == W25QXX_OK))
+    {
+        /* Whole 64KB or 32KB block covered by the data */
+        span = 0U;
+        if (((addr % W25Q128_BLOCK_SIZE_64K) == 0U) && (size >= W25Q128_BLOCK_SIZE_64K))
         {
-            return status;
+            span = W25Q128_BLOCK_SIZE_64K;
         }
-
-        /* Erase sector */
-        status = BSP_W25QXX_EraseSector(sector_addr);
-        if (status != W25QXX_OK)
+        else if (((addr % W25Q128_BLOCK_SIZE_32K) == 0U) && (size >= W25Q128_BLOCK_SIZE_32K))
         {
-            return status;
+            span = W25Q128_BLOCK_SIZE_32K;
         }
 
-        /* Merge new data into sector buffer */
-        memcpy(&s_sector_buffer[sector_offset], pBuffer, bytes_to_write);
-
-        /* Write back entire sector */
-        status = BSP_W25QXX_Write(s_sector_buffer, sector_addr, W25Q128_SECTOR_SIZE);
-        if (status != W25QXX_OK)
+        if (span != 0U)
         {
-            return status;
+            status = W25QXX_WriteBlock(pBuffer, addr, span, pWork, &written);
+            if (status != W25QXX_OK)
+            {
+                break;
+            }
+
+            if (written)
+            {
+                addr += span;
+                pBuffer += span;
+                size -= span;
+                continue;
+            }
         }
 
+        /* Sector by sector */
+        sector_remain = W25Q128_SECTOR_SIZE - (addr % W25Q128_SECTOR_SIZE);
+        bytes_to_write = (size < sector_remain) ? size : sector_remain;
+
+        status = W25QXX_WriteSector(pBuffer, addr, bytes_to_write, pWork);
+
         addr += bytes_to_write;
         pBuffer += bytes_to_write;
         size -= bytes_to_write;
     }
 
-    return W25QXX_OK;
+    W25QXX_Unlock();
+
+    return status;
 }
 
 /**
@@ -301,9 +696,6 @@ w25qxx_status_t BSP_W25QXX_WriteWithErase(uint8_t *pBuffer, uint32_t addr, uint3
  */
 w25qxx_status_t BSP_W25QXX_EraseSector(uint32_t sectorAddr)
 {
-    uint8_t cmd[4];
-    w25qxx_status_t status;
-
     /* Align to sector boundary */
     sectorAddr &= ~(W25Q128_SECTOR_SIZE - 1);
 
@@ -312,27 +704,8 @@ w25qxx_status_t BSP_W25QXX_EraseSector(uint32_t sectorAddr)
         return W25QXX_INVALID_PARAM;
     }
 
-    status = W25QXX_WriteEnable();
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    cmd[0] = W25QXX_CMD_SECTOR_ERASE_4K;
-    cmd[1] = (sectorAddr >> 16) & 0xFF;
-    cmd[2] = (sectorAddr >> 8) & 0xFF;
-    cmd[3] = sectorAddr & 0xFF;
-
-    W25QXX_CS_LOW();
-    status = W25QXX_SPI_Transmit(cmd, 4);
-    W25QXX_CS_HIGH();
-
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    return W25QXX_WaitBusy(W25QXX_TIMEOUT_SECTOR_ERASE);
+    return W25QXX_Erase(W25QXX_OP_SECTOR_ERASE, W25QXX_CMD_SECTOR_ERASE_4K,
+                        sectorAddr, W25Q128_SECTOR_SIZE);
 }
 
 /**
@@ -340,9 +713,6 @@ w25qxx_status_t BSP_W25QXX_EraseSector(uint32_t sectorAddr)
  */
 w25qxx_status_t BSP_W25QXX_EraseBlock32K(uint32_t blockAddr)
 {
-    uint8_t cmd[4];
-    w25qxx_status_t status;
-
     /* Align to 32KB block boundary */
     blockAddr &= ~(W25Q128_BLOCK_SIZE_32K - 1);
 
@@ -351,27 +721,8 @@ w25qxx_status_t BSP_W25QXX_EraseBlock32K(uint32_t blockAddr)
         return W25QXX_INVALID_PARAM;
     }
 
-    status = W25QXX_WriteEnable();
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    cmd[0] = W25QXX_CMD_BLOCK_ERASE_32K;
-    cmd[1] = (blockAddr >> 16) & 0xFF;
-    cmd[2] = (blockAddr >> 8) & 0xFF;
-    cmd[3] = blockAddr & 0xFF;
-
-    W25QXX_CS_LOW();
-    status = W25QXX_SPI_Transmit(cmd, 4);
-    W25QXX_CS_HIGH();
-
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    return W25QXX_WaitBusy(W25QXX_TIMEOUT_BLOCK_ERASE);
+    return W25QXX_Erase(W25QXX_OP_BLOCK_ERASE_32K, W25QXX_CMD_BLOCK_ERASE_32K,
+                        blockAddr, W25Q128_BLOCK_SIZE_32K);
 }
 
 /**
@@ -379,9 +730,6 @@ w25qxx_status_t BSP_W25QXX_EraseBlock32K(uint32_t blockAddr)
  */
 w25qxx_status_t BSP_W25QXX_EraseBlock64K(uint32_t blockAddr)
 {
-    uint8_t cmd[4];
-    w25qxx_status_t status;
-
     /* Align to 64KB block boundary */
     blockAddr &= ~(W25Q128_BLOCK_SIZE_64K - 1);
 
@@ -390,27 +738,8 @@ w25qxx_status_t BSP_W25QXX_EraseBlock64K(uint32_t blockAddr)
         return W25QXX_INVALID_PARAM;
     }
 
-    status = W25QXX_WriteEnable();
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    cmd[0] = W25QXX_CMD_BLOCK_ERASE_64K;
-    cmd[1] = (blockAddr >> 16) & 0xFF;
-    cmd[2] = (blockAddr >> 8) & 0xFF;
-    cmd[3] = blockAddr & 0xFF;
-
-    W25QXX_CS_LOW();
-    status = W25QXX_SPI_Transmit(cmd, 4);
-    W25QXX_CS_HIGH();
-
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    return W25QXX_WaitBusy(W25QXX_TIMEOUT_BLOCK_ERASE);
+    return W25QXX_Erase(W25QXX_OP_BLOCK_ERASE_64K, W25QXX_CMD_BLOCK_ERASE_64K,
+                        blockAddr, W25Q128_BLOCK_SIZE_64K);
 }
 
 /**
@@ -418,29 +747,9 @@ w25qxx_status_t BSP_W25QXX_EraseBlock64K(uint32_t blockAddr)
  */
 w25qxx_status_t BSP_W25QXX_EraseChip(void)
 {
-    uint8_t cmd;
-    w25qxx_status_t status;
-
     DEBUG_WARN("W25QXX: Chip erase started - this may take a while...");
 
-    status = W25QXX_WriteEnable();
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    cmd = W25QXX_CMD_CHIP_ERASE;
-
-    W25QXX_CS_LOW();
-    status = W25QXX_SPI_Transmit(&cmd, 1);
-    W25QXX_CS_HIGH();
-
-    if (status != W25QXX_OK)
-    {
-        return status;
-    }
-
-    return W25QXX_WaitBusy(W25QXX_TIMEOUT_CHIP_ERASE);
+    return W25QXX_Erase(W25QXX_OP_CHIP_ERASE, W25QXX_CMD_CHIP_ERASE, 0U, W25Q128_FLASH_SIZE);
 }
 
 /**
@@ -451,6 +760,19 @@ const w25qxx_info_t* BSP_W25QXX_GetInfo(void)
     return &s_device_info;
 }
 
+/**
+ * @brief Get the measured busy times of an operation
+ */
+const w25qxx_timing_t* BSP_W25QXX_GetTiming(w25qxx_op_t op)
+{
+    if (op >= W25QXX_OP_COUNT)
+    {
+        return NULL;
+    }
+
+    return &s_timing[op];
+}
+
 /**
  * @brief Check if device is busy
  */
@@ -467,12 +789,14 @@ w25qxx_status_t BSP_W25QXX_PowerDown(void)
     uint8_t cmd = W25QXX_CMD_POWER_DOWN;
     w25qxx_status_t status;
 
+    W25QXX_LockIdle();
     W25QXX_CS_LOW();
     status = W25QXX_SPI_Transmit(&cmd, 1);
     W25QXX_CS_HIGH();
+    W25QXX_Unlock();
 
     /* Wait for power down (3us typical) */
-    HAL_Delay(1);
+    W25QXX_Sleep(1U);
 
     return status;
 }
@@ -485,12 +809,14 @@ w25qxx_status_t BSP_W25QXX_WakeUp(void)
     uint8_t cmd = W25QXX_CMD_RELEASE_POWER_DOWN;
     w25qxx_status_t status;
 
+    W25QXX_LockIdle();
     W25QXX_CS_LOW();
     status = W25QXX_SPI_Transmit(&cmd, 1);
     W25QXX_CS_HIGH();
+    W25QXX_Unlock();
 
     /* Wait for wake up (3us typical) */
-    HAL_Delay(1);
+    W25QXX_Sleep(1U);
 
     return status;
 }
@@ -512,52 +838,167 @@ uint8_t BSP_W25QXX_ReadStatusReg(uint8_t reg)
         cmd = W25QXX_CMD_READ_STATUS_R2;
     }
 
+    W25QXX_Lock();
     W25QXX_CS_LOW();
     W25QXX_SPI_Transmit(&cmd, 1);
     W25QXX_SPI_Receive(&status, 1);
     W25QXX_CS_HIGH();
+    W25QXX_Unlock();
 
     return status;
 }
 
-/* ============================================================================
- * Private Functions
- * ============================================================================*/
-
+#if W25QXX_BENCHMARK_ENABLED
 /**
- * @brief SPI transmit wrapper
+ * @brief Measure the read throughput of BSP_W25QXX_Read and BSP_W25QXX_ReadStream
  */
-static w25qxx_status_t W25QXX_SPI_Transmit(uint8_t *pData, uint16_t size)
+w25qxx_status_t BSP_W25QXX_Benchmark(w25qxx_benchmark_t *result)
 {
-    if (s_hspi == NULL)
+    w25qxx_status_t status = W25QXX_OK;
+    uint32_t start;
+
+    if (result == NULL)
     {
-        return W25QXX_ERROR;
+        return W25QXX_INVALID_PARAM;
     }
 
-    if (HAL_SPI_Transmit(s_hspi, pData, size, W25QXX_TIMEOUT_DEFAULT) != HAL_OK)
+    start = W25QXX_GetTick();
+    for (uint32_t offset = 0U; (offset < W25QXX_BENCH_SIZE) && (status == W25QXX_OK);
+         offset += W25QXX_BENCH_SEGMENT)
     {
-        return W25QXX_SPI_ERROR;
+        status = BSP_W25QXX_Read(s_bench_buffer, W25QXX_BENCH_ADDR + offset, W25QXX_BENCH_SEGMENT);
+        (void)W25QXX_BenchConsume(NULL, s_bench_buffer, W25QXX_BENCH_SEGMENT);
     }
+    result->read_rate = W25QXX_BenchRate(W25QXX_BENCH_SIZE, W25QXX_GetTick() - start);
 
-    return W25QXX_OK;
-}
-
-/**
- * @brief SPI receive wrapper
- */
-static w25qxx_status_t W25QXX_SPI_Receive(uint8_t *pData, uint16_t size)
-{
-    if (s_hspi == NULL)
+    if (status == W25QXX_OK)
     {
-        return W25QXX_ERROR;
+        start = W25QXX_GetTick();
+        status = BSP_W25QXX_ReadStream(W25QXX_BENCH_ADDR, W25QXX_BENCH_SIZE, s_bench_buffer,
+                                       W25QXX_BENCH_SEGMENT, W25QXX_BenchConsume, NULL);
+        result->stream_rate = W25QXX_BenchRate(W25QXX_BENCH_SIZE, W25QXX_GetTick() - start);
     }
 
-    if (HAL_SPI_Receive(s_hspi, pData, size, W25QXX_TIMEOUT_DEFAULT) != HAL_OK)
+    if (status == W25QXX_OK)
     {
-        return W25QXX_SPI_ERROR;
+        start = W25QXX_GetTick();
+        status = BSP_W25QXX_ReadVerify(W25QXX_BENCH_ADDR, W25QXX_BENCH_SIZE, s_bench_buffer,
+                                       W25QXX_BENCH_SEGMENT, NULL, NULL, NULL);
+        result->verify_rate = W25QXX_BenchRate(W25QXX_BENCH_SIZE, W25QXX_GetTick() - start);
+        if (status == W25QXX_CRC_ERROR)
+        {
+            status = W25QXX_OK;
+        }
     }
 
-    return W25QXX_OK;
+    result->bus_rate = s_device_info.sck_hz / 8000U;
+
+    return status;
+}
+#endif
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+/**
+ * @brief Read data from the device (no cache), suspending a pending erase
+ * @note  Waits instead for an erase of the range being read (undefined
+ *        data while suspended) or one suspended W25QXX_SUSPEND_MAX times
+ *        (keeps the erase progressing)
+ */
+static w25qxx_status_t W25QXX_ReadDirect(uint8_t *pBuffer, uint32_t addr, uint32_t size)
+{
+    uint8_t cmd[5];
+    w25qxx_status_t status;
+    w25qxx_status_t resume_status;
+    bool suspended = false;
+
+    while ((s_pending.op != W25QXX_OP_COUNT) &&
+           ((s_pending.suspends >= W25QXX_SUSPEND_MAX) ||
+            ((addr < (s_pending.addr + s_pending.size)) && ((addr + size) > s_pending.addr))))
+    {
+        W25QXX_SleepUnlocked(1U);
+    }
+
+    if (s_pending.op != W25QXX_OP_COUNT)
+    {
+        status = W25QXX_Suspend(&suspended);
+        if (status != W25QXX_OK)
+        {
+            return status;
+        }
+    }
+
+    W25QXX_ReadCommand(cmd, s_device_info.read_command, addr);
+
+    W25QXX_CS_LOW();
+    status = W25QXX_SPI_Transmit(cmd, (s_device_info.read_command == W25QXX_CMD_FAST_READ) ? 5U : 4U);
+    if (status == W25QXX_OK)
+    {
+        status = W25QXX_SPI_Receive(pBuffer, size);
+    }
+    W25QXX_CS_HIGH();
+
+    if (suspended)
+    {
+        resume_status = W25QXX_Resume();
+        if (status == W25QXX_OK)
+        {
+            status = resume_status;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Drive CS through the transport
+ */
+static void W25QXX_Select(bool selected)
+{
+    if (s_transport != NULL)
+    {
+        s_transport->select(s_transport->context, selected);
+    }
+}
+
+/**
+ * @brief Transmit through the transport
+ */
+static w25qxx_status_t W25QXX_SPI_Transmit(const uint8_t *pData, uint32_t size)
+{
+    if (s_transport == NULL)
+    {
+        return W25QXX_ERROR;
+    }
+
+    return s_transport->transmit(s_transport->context, pData, size);
+}
+
+/**
+ * @brief Receive through the transport
+ */
+static w25qxx_status_t W25QXX_SPI_Receive(uint8_t *pData, uint32_t size)
+{
+    if (s_transport == NULL)
+    {
+        return W25QXX_ERROR;
+    }
+
+    return s_transport->receive(s_transport->context, pData, size);
+}
+
+/**
+ * @brief Build a read command: opcode, 24-bit address, dummy byte for Fast Read
+ */
+static void W25QXX_ReadCommand(uint8_t *cmd, uint8_t command, uint32_t addr)
+{
+    cmd[0] = command;
+    cmd[1] = (addr >> 16) & 0xFF;
+    cmd[2] = (addr >> 8) & 0xFF;
+    cmd[3] = addr & 0xFF;
+    cmd[4] = W25QXX_DUMMY_BYTE;
 }
 
 /**
@@ -578,10 +1019,10 @@ static w25qxx_status_t W25QXX_WriteEnable(void)
     }
 
     /* Wait for WEL bit to be set */
-    uint32_t start = HAL_GetTick();
+    uint32_t start = W25QXX_GetTick();
     while ((BSP_W25QXX_ReadStatusReg(1) & W25QXX_STATUS_WEL) == 0)
     {
-        if ((HAL_GetTick() - start) > 100)
+        if ((W25QXX_GetTick() - start) > 100)
         {
             return W25QXX_TIMEOUT;
         }
@@ -590,25 +1031,682 @@ static w25qxx_status_t W25QXX_WriteEnable(void)
     return W25QXX_OK;
 }
 
+/**
+ * @brief Issue an erase and wait for it, lock released while waiting
+ */
+static w25qxx_status_t W25QXX_Erase(w25qxx_op_t op, uint8_t command, uint32_t addr, uint32_t size)
+{
+    uint8_t cmd[4];
+    w25qxx_status_t status;
+
+    W25QXX_LockIdle();
+
+    status = W25QXX_WriteEnable();
+    if (status == W25QXX_OK)
+    {
+        cmd[0] = command;
+        cmd[1] = (addr >> 16) & 0xFF;
+        cmd[2] = (addr >> 8) & 0xFF;
+        cmd[3] = addr & 0xFF;
+
+        /* Chip erase has no address */
+        W25QXX_CS_LOW();
+        status = W25QXX_SPI_Transmit(cmd, (op == W25QXX_OP_CHIP_ERASE) ? 1U : 4U);
+        W25QXX_CS_HIGH();
+    }
+
+    if (status == W25QXX_OK)
+    {
+        if (s_lock_created && W25QXX_InThread())
+        {
+            s_pending.addr = addr;
+            s_pending.size = size;
+            s_pending.suspends = 0U;
+            s_pending.suspended_ms = 0U;
+            s_pending.op = op;
+        }
+
+        status = W25QXX_WaitBusy(op);
+        s_pending.op = W25QXX_OP_COUNT;
+    }
+
+    W25QXX_CacheErase(addr, size, status);
+    W25QXX_Unlock();
+
+    return status;
+}
+
 /**
  * @brief Wait for busy flag to clear
+ * @note  In a thread: sleep for W25QXX_SLEEP_PERCENT of the estimate, then
+ *        poll, sleeping 1, 2, 4... ms (up to 1/8 of the estimate) between
+ *        polls. Polls within the first tick are back to back, so a page
+ *        program is not stretched to a whole tick. Outside a thread the
+ *        flag is polled continuously. For a pending erase the lock is
+ *        released while asleep and suspended time does not count.
  */
-static w25qxx_status_t W25QXX_WaitBusy(uint32_t timeout_ms)
+static w25qxx_status_t W25QXX_WaitBusy(w25qxx_op_t op)
 {
-    uint32_t start = HAL_GetTick();
+    w25qxx_timing_t *timing = &s_timing[op];
+    uint32_t start = W25QXX_GetTick();
+    uint32_t elapsed;
+    uint32_t interval = 1U;
+    uint32_t interval_max;
+    bool in_thread = W25QXX_InThread();
+    bool pending = (s_pending.op == op);
+
+    interval_max = timing->estimate_ms >> W25QXX_ESTIMATE_SHIFT;
+    if (interval_max < 1U)
+    {
+        interval_max = 1U;
+    }
+    else if (interval_max > W25QXX_POLL_MAX_MS)
+    {
+        interval_max = W25QXX_POLL_MAX_MS;
+    }
 
-    while (BSP_W25QXX_IsBusy())
+    if (pending)
+    {
+        W25QXX_SleepUnlocked((timing->estimate_ms * W25QXX_SLEEP_PERCENT) / 100U);
+    }
+    else if (in_thread)
     {
-        if ((HAL_GetTick() - start) > timeout_ms)
+        W25QXX_Sleep((timing->estimate_ms * W25QXX_SLEEP_PERCENT) / 100U);
+    }
+
+    for (;;)
+    {
+        timing->polls++;
+        if (!BSP_W25QXX_IsBusy())
+        {
+            /* Left suspended by a reader whose resume failed */
+            if (!pending || ((BSP_W25QXX_ReadStatusReg(2) & W25QXX_STATUS_SUS) == 0U) ||
+                (W25QXX_Resume() != W25QXX_OK))
+            {
+                break;
+            }
+            continue;
+        }
+
+        elapsed = W25QXX_GetTick() - start - (pending ? s_pending.suspended_ms : 0U);
+        if (elapsed > s_timeout_ms[op])
         {
+            timing->timeouts++;
             DEBUG_ERROR("W25QXX: Wait busy timeout");
             return W25QXX_TIMEOUT;
         }
+
+        if (in_thread && (elapsed > 0U))
+        {
+            if (pending)
+            {
+                W25QXX_SleepUnlocked(interval);
+            }
+            else
+            {
+                W25QXX_Sleep(interval);
+            }
+            interval = ((interval * 2U) < interval_max) ? (interval * 2U) : interval_max;
+        }
+    }
+
+    W25QXX_RecordTime(timing, W25QXX_GetTick() - start - (pending ? s_pending.suspended_ms : 0U));
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Suspend the pending erase
+ * @param suspended Set if the erase was suspended (clear if it had finished)
+ */
+static w25qxx_status_t W25QXX_Suspend(bool *suspended)
+{
+    uint8_t cmd = W25QXX_CMD_SUSPEND;
+    uint32_t start;
+    w25qxx_status_t status;
+
+    *suspended = false;
+
+    W25QXX_CS_LOW();
+    status = W25QXX_SPI_Transmit(&cmd, 1);
+    W25QXX_CS_HIGH();
+
+    if (status != W25QXX_OK)
+    {
+        return status;
+    }
+
+    /* BUSY clears within tSUS (20us) */
+    start = W25QXX_GetTick();
+    while (BSP_W25QXX_IsBusy())
+    {
+        if ((W25QXX_GetTick() - start) > W25QXX_TIMEOUT_SUSPEND)
+        {
+            return W25QXX_TIMEOUT;
+        }
+    }
+
+    *suspended = ((BSP_W25QXX_ReadStatusReg(2) & W25QXX_STATUS_SUS) != 0U);
+    if (*suspended)
+    {
+        s_pending.suspends++;
+        s_pending.suspend_tick = W25QXX_GetTick();
+        s_device_info.erase_suspends++;
+    }
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Resume the suspended erase
+ */
+static w25qxx_status_t W25QXX_Resume(void)
+{
+    uint8_t cmd = W25QXX_CMD_RESUME;
+    w25qxx_status_t status;
+
+    W25QXX_CS_LOW();
+    status = W25QXX_SPI_Transmit(&cmd, 1);
+    W25QXX_CS_HIGH();
+
+    s_pending.suspended_ms += W25QXX_GetTick() - s_pending.suspend_tick;
+    s_pending.suspend_tick = W25QXX_GetTick();
+
+    return status;
+}
+
+/**
+ * @brief Take the bus lock (recursive, thread context only)
+ */
+static void W25QXX_Lock(void)
+{
+    if (s_lock_created && W25QXX_InThread())
+    {
+        (void)tx_mutex_get(&s_lock, TX_WAIT_FOREVER);
+        s_lock_depth++;
+    }
+}
+
+/**
+ * @brief Take the bus lock with no erase pending
+ */
+static void W25QXX_LockIdle(void)
+{
+    W25QXX_Lock();
+
+    while (s_pending.op != W25QXX_OP_COUNT)
+    {
+        W25QXX_SleepUnlocked(1U);
+    }
+}
+
+/**
+ * @brief Release the bus lock
+ */
+static void W25QXX_Unlock(void)
+{
+    if (s_lock_created && W25QXX_InThread())
+    {
+        s_lock_depth--;
+        (void)tx_mutex_put(&s_lock);
+    }
+}
+
+/**
+ * @brief Sleep with the bus lock fully released, then take it back
+ */
+static void W25QXX_SleepUnlocked(uint32_t ms)
+{
+    uint32_t depth = s_lock_depth;
+
+    for (uint32_t i = 0U; i < depth; i++)
+    {
+        W25QXX_Unlock();
+    }
+
+    W25QXX_Sleep(ms);
+
+    for (uint32_t i = 0U; i < depth; i++)
+    {
+        W25QXX_Lock();
+    }
+}
+
+/**
+ * @brief Record a busy time and move the estimate towards it
+ */
+static void W25QXX_RecordTime(w25qxx_timing_t *timing, uint32_t elapsed_ms)
+{
+    if ((timing->count == 0U) || (elapsed_ms < timing->min_ms))
+    {
+        timing->min_ms = elapsed_ms;
+    }
+    if (elapsed_ms > timing->max_ms)
+    {
+        timing->max_ms = elapsed_ms;
+    }
+    timing->last_ms = elapsed_ms;
+    timing->count++;
+
+    if (elapsed_ms > timing->estimate_ms)
+    {
+        timing->estimate_ms += (elapsed_ms - timing->estimate_ms) >> W25QXX_ESTIMATE_SHIFT;
+    }
+    else
+    {
+        timing->estimate_ms -= (timing->estimate_ms - elapsed_ms) >> W25QXX_ESTIMATE_SHIFT;
+    }
+}
+
+/**
+ * @brief Write a whole block with one block erase, if cheaper than sector erases
+ * @param written Set if the block was written, clear to fall back to sectors
+ * @note  The block is scanned first: identical and 1 -> 0 sectors need no
+ *        erase, but are reprogrammed after a block erase. The cost is
+ *        compared on the measured estimates (BSP_W25QXX_GetTiming).
+ */
+static w25qxx_status_t W25QXX_WriteBlock(const uint8_t *pBuffer, uint32_t addr, uint32_t span,
+                                         uint8_t *pWork, bool *written)
+{
+    w25qxx_status_t status;
+    w25qxx_op_t op = (span == W25Q128_BLOCK_SIZE_64K) ? W25QXX_OP_BLOCK_ERASE_64K :
+                                                        W25QXX_OP_BLOCK_ERASE_32K;
+    uint32_t sectors = span / W25Q128_SECTOR_SIZE;
+    uint32_t erase_sectors = 0U;
+    uint32_t block_cost;
+    uint32_t sector_cost;
+
+    *written = false;
+
+    for (uint32_t offset = 0U; offset < span; offset += W25Q128_SECTOR_SIZE)
+    {
+        status = W25QXX_ReadDirect(pWork, addr + offset, W25Q128_SECTOR_SIZE);
+        if (status != W25QXX_OK)
+        {
+            return status;
+        }
+
+        if (W25QXX_Classify(pWork, &pBuffer[offset], W25Q128_SECTOR_SIZE) == W25QXX_CHANGE_ERASE)
+        {
+            erase_sectors++;
+        }
+    }
+
+    block_cost = s_timing[op].estimate_ms +
+                 ((sectors - erase_sectors) * (W25Q128_SECTOR_SIZE / W25Q128_PAGE_SIZE) *
+                  s_timing[W25QXX_OP_PAGE_PROGRAM].estimate_ms);
+    sector_cost = erase_sectors * s_timing[W25QXX_OP_SECTOR_ERASE].estimate_ms;
+
+    if ((erase_sectors == 0U) || (sector_cost < block_cost))
+    {
+        return W25QXX_OK;
+    }
+
+    status = (op == W25QXX_OP_BLOCK_ERASE_64K) ? BSP_W25QXX_EraseBlock64K(addr) :
+                                                 BSP_W25QXX_EraseBlock32K(addr);
+    if (status != W25QXX_OK)
+    {
+        return status;
+    }
+
+    *written = true;
+
+    return W25QXX_ProgramChanged(pBuffer, addr, span, NULL);
+}
+
+/**
+ * @brief Write within one sector, erasing only if a bit must go 0 -> 1
+ */
+static w25qxx_status_t W25QXX_WriteSector(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                          uint8_t *pWork)
+{
+    w25qxx_status_t status;
+    uint32_t sector_addr = addr & ~(W25Q128_SECTOR_SIZE - 1U);
+    uint32_t sector_offset = addr - sector_addr;
+
+    status = W25QXX_ReadDirect(pWork, sector_addr, W25Q128_SECTOR_SIZE);
+    if (status != W25QXX_OK)
+    {
+        return status;
+    }
+
+    switch (W25QXX_Classify(&pWork[sector_offset], pBuffer, size))
+    {
+        case W25QXX_CHANGE_NONE:
+            return W25QXX_OK;
+
+        case W25QXX_CHANGE_PROGRAM:
+            return W25QXX_ProgramChanged(pBuffer, addr, size, &pWork[sector_offset]);
+
+        default:
+            break;
+    }
+
+    /* Merge, erase, program back the pages that are not blank */
+    memcpy(&pWork[sector_offset], pBuffer, size);
+
+    status = BSP_W25QXX_EraseSector(sector_addr);
+    if (status != W25QXX_OK)
+    {
+        return status;
+    }
+
+    return W25QXX_ProgramChanged(pWork, sector_addr, W25Q128_SECTOR_SIZE, NULL);
+}
+
+/**
+ * @brief Program the pages whose data differs from the current contents
+ * @param pCurrent Current contents, NULL for erased (all 0xFF)
+ */
+static w25qxx_status_t W25QXX_ProgramChanged(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                             const uint8_t *pCurrent)
+{
+    w25qxx_status_t status;
+    uint32_t page_remain;
+    uint32_t bytes_to_write;
+    bool changed;
+
+    while (size > 0U)
+    {
+        page_remain = W25Q128_PAGE_SIZE - (addr % W25Q128_PAGE_SIZE);
+        bytes_to_write = (size < page_remain) ? size : page_remain;
+
+        if (pCurrent != NULL)
+        {
+            changed = (memcmp(pBuffer, pCurrent, bytes_to_write) != 0);
+            pCurrent += bytes_to_write;
+        }
+        else
+        {
+            changed = false;
+            for (uint32_t i = 0U; (i < bytes_to_write) && !changed; i++)
+            {
+                changed = (pBuffer[i] != 0xFFU);
+            }
+        }
+
+        if (changed)
+        {
+            status = W25QXX_WritePage((uint8_t *)pBuffer, addr, (uint16_t)bytes_to_write);
+            if (status != W25QXX_OK)
+            {
+                return status;
+            }
+        }
+
+        addr += bytes_to_write;
+        pBuffer += bytes_to_write;
+        size -= bytes_to_write;
     }
 
     return W25QXX_OK;
 }
 
+/**
+ * @brief Classify the change from the current contents to the new data
+ */
+static w25qxx_change_t W25QXX_Classify(const uint8_t *pCurrent, const uint8_t *pBuffer, uint32_t size)
+{
+    w25qxx_change_t change = W25QXX_CHANGE_NONE;
+
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        if ((pBuffer[i] & (uint8_t)~pCurrent[i]) != 0U)
+        {
+            return W25QXX_CHANGE_ERASE;
+        }
+
+        if (pBuffer[i] != pCurrent[i])
+        {
+            change = W25QXX_CHANGE_PROGRAM;
+        }
+    }
+
+    return change;
+}
+
+/**
+ * @brief Check for thread context (not before the kernel starts, not in an ISR)
+ */
+static bool W25QXX_InThread(void)
+{
+    return (s_transport != NULL) && s_transport->in_thread(s_transport->context);
+}
+
+/**
+ * @brief Wait through the transport (sleeps the calling thread)
+ */
+static void W25QXX_Sleep(uint32_t ms)
+{
+    if ((ms > 0U) && (s_transport != NULL))
+    {
+        s_transport->delay(s_transport->context, ms);
+    }
+}
+
+/**
+ * @brief Transport time (ms)
+ */
+static uint32_t W25QXX_GetTick(void)
+{
+    return (s_transport != NULL) ? s_transport->get_tick(s_transport->context) : 0U;
+}
+
+/**
+ * @brief ReadVerify consumer: CRC of the data, trailer held back
+ * @note  Words split across segments wait in verify->word
+ */
+static bool W25QXX_VerifyConsume(void *context, const uint8_t *pData, uint32_t size)
+{
+    w25qxx_verify_t *verify = (w25qxx_verify_t *)context;
+    uint32_t data = (size > verify->data_remaining) ? verify->data_remaining : size;
+    uint32_t used = 0U;
+    uint32_t words;
+
+    if (data > 0U)
+    {
+        if ((verify->callback != NULL) && !verify->callback(verify->context, pData, data))
+        {
+            return false;
+        }
+
+        verify->data_remaining -= data;
+
+        while ((verify->word_bytes > 0U) && (used < data))
+        {
+            verify->word[verify->word_bytes] = pData[used];
+            verify->word_bytes++;
+            used++;
+
+            if (verify->word_bytes == sizeof(verify->word))
+            {
+                verify->crc = W25QXX_CRC32Words(verify->crc, verify->word, 1U);
+                verify->word_bytes = 0U;
+            }
+        }
+
+        words = (data - used) / 4U;
+        verify->crc = W25QXX_CRC32Words(verify->crc, &pData[used], words);
+        used += words * 4U;
+
+        while (used < data)
+        {
+            verify->word[verify->word_bytes] = pData[used];
+            verify->word_bytes++;
+            used++;
+        }
+    }
+
+    while ((used < size) && (verify->trailer_bytes < W25QXX_CRC32_TRAILER_SIZE))
+    {
+        verify->trailer[verify->trailer_bytes] = pData[used];
+        verify->trailer_bytes++;
+        used++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Fold whole words into a CRC32, as the STM32 CRC unit
+ * @note  Each word is loaded little-endian and shifted in MSB-first
+ */
+static uint32_t W25QXX_CRC32Words(uint32_t crc, const uint8_t *pData, uint32_t words)
+{
+    uint32_t word;
+
+    for (uint32_t i = 0U; i < words; i++)
+    {
+        memcpy(&word, &pData[i * 4U], sizeof(word));
+        crc ^= word;
+        crc = (crc << 8) ^ s_crc32_table[crc >> 24];
+        crc = (crc << 8) ^ s_crc32_table[crc >> 24];
+        crc = (crc << 8) ^ s_crc32_table[crc >> 24];
+        crc = (crc << 8) ^ s_crc32_table[crc >> 24];
+    }
+
+    return crc;
+}
+
+#if W25QXX_CACHE_ENABLED
+/**
+ * @brief Read through the cache (line by line, LRU replacement)
+ */
+static w25qxx_status_t W25QXX_CacheRead(uint8_t *pBuffer, uint32_t addr, uint32_t size)
+{
+    w25qxx_status_t status;
+    uint32_t line_addr;
+    uint32_t line_offset;
+    uint32_t bytes_to_copy;
+    uint32_t line;
+    uint32_t victim;
+
+    while (size > 0U)
+    {
+        line_addr = addr & ~(W25QXX_CACHE_LINE_SIZE - 1U);
+        line_offset = addr - line_addr;
+        bytes_to_copy = W25QXX_CACHE_LINE_SIZE - line_offset;
+        bytes_to_copy = (size < bytes_to_copy) ? size : bytes_to_copy;
+
+        /* Hit, or the least recently used line (empty lines first) */
+        victim = 0U;
+        for (line = 0U; line < W25QXX_CACHE_LINES; line++)
+        {
+            if (s_cache_lines[line].valid && (s_cache_lines[line].address == line_addr))
+            {
+                break;
+            }
+
+            if (!s_cache_lines[line].valid ||
+                (s_cache_lines[victim].valid &&
+                 (s_cache_lines[line].last_use < s_cache_lines[victim].last_use)))
+            {
+                victim = line;
+            }
+        }
+
+        if (line < W25QXX_CACHE_LINES)
+        {
+            s_device_info.cache_hits++;
+        }
+        else
+        {
+            line = victim;
+            s_cache_lines[line].valid = false;
+
+            status = W25QXX_ReadDirect(s_cache_data[line], line_addr, W25QXX_CACHE_LINE_SIZE);
+            if (status != W25QXX_OK)
+            {
+                return status;
+            }
+
+            s_cache_lines[line].address = line_addr;
+            s_cache_lines[line].valid = true;
+            s_device_info.cache_misses++;
+        }
+
+        s_cache_lines[line].last_use = ++s_cache_clock;
+        memcpy(pBuffer, &s_cache_data[line][line_offset], bytes_to_copy);
+
+        addr += bytes_to_copy;
+        pBuffer += bytes_to_copy;
+        size -= bytes_to_copy;
+    }
+
+    return W25QXX_OK;
+}
+#endif
+
+/**
+ * @brief Apply a page program to the cached lines (NOR: bits only clear)
+ * @note  After a failed program the device contents are unknown: the
+ *        lines are dropped
+ */
+static void W25QXX_CacheProgram(const uint8_t *pBuffer, uint32_t addr, uint32_t size,
+                                w25qxx_status_t status)
+{
+#if W25QXX_CACHE_ENABLED
+    for (uint32_t line = 0U; line < W25QXX_CACHE_LINES; line++)
+    {
+        uint32_t start = s_cache_lines[line].address;
+        uint32_t end = start + W25QXX_CACHE_LINE_SIZE;
+
+        if (!s_cache_lines[line].valid || (addr >= end) || ((addr + size) <= start))
+        {
+            continue;
+        }
+
+        if (status != W25QXX_OK)
+        {
+            s_cache_lines[line].valid = false;
+            continue;
+        }
+
+        for (uint32_t a = (addr > start) ? addr : start; (a < end) && (a < (addr + size)); a++)
+        {
+            s_cache_data[line][a - start] &= pBuffer[a - addr];
+        }
+    }
+#else
+    (void)pBuffer;
+    (void)addr;
+    (void)size;
+    (void)status;
+#endif
+}
+
+/**
+ * @brief Apply an erase to the cached lines (0xFF, dropped on failure)
+ */
+static void W25QXX_CacheErase(uint32_t addr, uint32_t size, w25qxx_status_t status)
+{
+#if W25QXX_CACHE_ENABLED
+    for (uint32_t line = 0U; line < W25QXX_CACHE_LINES; line++)
+    {
+        uint32_t start = s_cache_lines[line].address;
+
+        /* Lines never straddle an erase unit */
+        if (!s_cache_lines[line].valid || (start < addr) || (start >= (addr + size)))
+        {
+            continue;
+        }
+
+        if (status != W25QXX_OK)
+        {
+            s_cache_lines[line].valid = false;
+        }
+        else
+        {
+            memset(s_cache_data[line], 0xFF, W25QXX_CACHE_LINE_SIZE);
+        }
+    }
+#else
+    (void)addr;
+    (void)size;
+    (void)status;
+#endif
+}
+
 /**
  * @brief Write a single page (up to 256 bytes)
  */
@@ -641,10 +1739,40 @@ static w25qxx_status_t W25QXX_WritePage(uint8_t *pBuffer, uint32_t addr, uint16_
     }
     W25QXX_CS_HIGH();
 
-    if (status != W25QXX_OK)
+    if (status == W25QXX_OK)
     {
-        return status;
+        status = W25QXX_WaitBusy(W25QXX_OP_PAGE_PROGRAM);
     }
 
-    return W25QXX_WaitBusy(W25QXX_TIMEOUT_PAGE_PROGRAM);
+    W25QXX_CacheProgram(pBuffer, addr, size, status);
+
+    return status;
 }
+
+#if W25QXX_BENCHMARK_ENABLED
+/**
+ * @brief Benchmark consumer: touches every word like a checksum would
+ */
+static bool W25QXX_BenchConsume(void *context, const uint8_t *pData, uint32_t size)
+{
+    uint32_t sum = s_bench_sum;
+
+    (void)context;
+
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        sum += pData[i];
+    }
+    s_bench_sum = sum;
+
+    return true;
+}
+
+/**
+ * @brief Convert bytes moved in ms to kB/s
+ */
+static uint32_t W25QXX_BenchRate(uint32_t bytes, uint32_t ms)
+{
+    return (ms > 0U) ? (bytes / ms) : 0U;
+}
+#endif
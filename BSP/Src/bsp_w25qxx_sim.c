@@ -0,0 +1,479 @@
+/**
+ ******************************************************************************
+ * @file    bsp_w25qxx_sim.c
+ * @brief   W25Q128 Device Model Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Each byte of a transaction goes through W25QXX_Sim_Byte, which returns
+ * what the device would drive on MISO. Programs and erases complete at
+ * done_ns; BUSY and the end of WEL are evaluated lazily against time_ns
+ * (W25QXX_Sim_Busy).
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_w25qxx_sim.h"
+#include <string.h>
+
+/* ============================================================================
+ * Private Defines
+ * ============================================================================*/
+
+#define W25QXX_SIM_ADDR_MASK        (W25Q128_FLASH_SIZE - 1U)
+#define W25QXX_SIM_DEVICE_ID        0x17U   /* Read ID (0x90) device byte */
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+
+static void W25QXX_Sim_Select(void *context, bool selected);
+static w25qxx_status_t W25QXX_Sim_Transmit(void *context, const uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_Sim_Receive(void *context, uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_Sim_ReceiveWait(void *context);
+static void W25QXX_Sim_Delay(void *context, uint32_t ms);
+static uint32_t W25QXX_Sim_GetTick(void *context);
+static bool W25QXX_Sim_InThread(void *context);
+static void W25QXX_Sim_Clock(w25qxx_sim_t *sim, uint32_t bytes);
+static uint8_t W25QXX_Sim_Byte(w25qxx_sim_t *sim, uint8_t in);
+static bool W25QXX_Sim_Accept(w25qxx_sim_t *sim, uint8_t command);
+static void W25QXX_Sim_Execute(w25qxx_sim_t *sim);
+static bool W25QXX_Sim_Busy(w25qxx_sim_t *sim);
+static void W25QXX_Sim_Start(w25qxx_sim_t *sim, uint32_t duration_us);
+static void W25QXX_Sim_Program(w25qxx_sim_t *sim);
+static void W25QXX_Sim_Erase(w25qxx_sim_t *sim, uint32_t size, uint32_t duration_us);
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================*/
+
+/**
+ * @brief Initialize a model
+ */
+void BSP_W25QXX_Sim_Init(w25qxx_sim_t *sim, uint8_t *memory, uint32_t size, uint32_t sck_hz)
+{
+    memset(sim, 0, sizeof(*sim));
+
+    sim->memory = memory;
+    sim->size = (size > W25Q128_FLASH_SIZE) ? W25Q128_FLASH_SIZE : size;
+    sim->thread = true;
+
+    sim->transport.context = sim;
+    sim->transport.sck_hz = sck_hz;
+    sim->transport.select = W25QXX_Sim_Select;
+    sim->transport.transmit = W25QXX_Sim_Transmit;
+    sim->transport.receive = W25QXX_Sim_Receive;
+    sim->transport.receive_start = W25QXX_Sim_Receive;
+    sim->transport.receive_wait = W25QXX_Sim_ReceiveWait;
+    sim->transport.delay = W25QXX_Sim_Delay;
+    sim->transport.get_tick = W25QXX_Sim_GetTick;
+    sim->transport.in_thread = W25QXX_Sim_InThread;
+}
+
+/**
+ * @brief Get the virtual time
+ */
+uint64_t BSP_W25QXX_Sim_GetTimeUs(const w25qxx_sim_t *sim)
+{
+    return sim->time_ns / 1000U;
+}
+
+/* ============================================================================
+ * Transport Functions
+ * ============================================================================*/
+
+/**
+ * @brief CS: a falling edge starts a transaction, a rising edge executes it
+ */
+static void W25QXX_Sim_Select(void *context, bool selected)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    if (selected && !sim->selected)
+    {
+        sim->count = 0U;
+        sim->address = 0U;
+        sim->command = 0U;
+    }
+    else if (!selected && sim->selected)
+    {
+        W25QXX_Sim_Execute(sim);
+    }
+
+    sim->selected = selected;
+}
+
+/**
+ * @brief Clock bytes in, ignore MISO
+ */
+static w25qxx_status_t W25QXX_Sim_Transmit(void *context, const uint8_t *pData, uint32_t size)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        (void)W25QXX_Sim_Byte(sim, pData[i]);
+    }
+    W25QXX_Sim_Clock(sim, size);
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Clock dummy bytes out, return MISO
+ */
+static w25qxx_status_t W25QXX_Sim_Receive(void *context, uint8_t *pData, uint32_t size)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        pData[i] = W25QXX_Sim_Byte(sim, 0xFFU);
+    }
+    W25QXX_Sim_Clock(sim, size);
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Receives complete in W25QXX_Sim_Receive
+ */
+static w25qxx_status_t W25QXX_Sim_ReceiveWait(void *context)
+{
+    (void)context;
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Advance the virtual time
+ */
+static void W25QXX_Sim_Delay(void *context, uint32_t ms)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    sim->time_ns += (uint64_t)ms * 1000000U;
+}
+
+/**
+ * @brief Virtual time (ms)
+ */
+static uint32_t W25QXX_Sim_GetTick(void *context)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    return (uint32_t)(sim->time_ns / 1000000U);
+}
+
+/**
+ * @brief Thread context as configured (sim->thread)
+ */
+static bool W25QXX_Sim_InThread(void *context)
+{
+    w25qxx_sim_t *sim = (w25qxx_sim_t *)context;
+
+    return sim->thread;
+}
+
+/* ============================================================================
+ * Device Model
+ * ============================================================================*/
+
+/**
+ * @brief Advance the virtual time by the bus time of some bytes
+ */
+static void W25QXX_Sim_Clock(w25qxx_sim_t *sim, uint32_t bytes)
+{
+    if (sim->transport.sck_hz > 0U)
+    {
+        sim->time_ns += ((uint64_t)bytes * 8000000000ULL) / sim->transport.sck_hz;
+    }
+}
+
+/**
+ * @brief One byte of a transaction
+ * @param in Byte on MOSI
+ * @retval uint8_t Byte on MISO
+ */
+static uint8_t W25QXX_Sim_Byte(w25qxx_sim_t *sim, uint8_t in)
+{
+    static const uint8_t jedec_id[3] = {
+        W25Q128_MANUFACTURER_ID, (uint8_t)(W25Q128_DEVICE_ID >> 8), (uint8_t)W25Q128_DEVICE_ID
+    };
+    uint32_t index = sim->count;
+    uint8_t out = 0xFFU;
+
+    if (!sim->selected)
+    {
+        return out;
+    }
+
+    sim->count++;
+
+    if (index == 0U)
+    {
+        sim->command = W25QXX_Sim_Accept(sim, in) ? in : 0U;
+        memset(sim->latched, 0, sizeof(sim->latched));
+        return out;
+    }
+
+    /* 24-bit address after the command byte */
+    if ((index <= 3U) && (sim->command != W25QXX_CMD_JEDEC_ID) &&
+        (sim->command != W25QXX_CMD_READ_STATUS_R1) && (sim->command != W25QXX_CMD_READ_STATUS_R2))
+    {
+        sim->address = ((sim->address << 8) | in) & W25QXX_SIM_ADDR_MASK;
+        return out;
+    }
+
+    switch (sim->command)
+    {
+        case W25QXX_CMD_READ_STATUS_R1:
+            out = (W25QXX_Sim_Busy(sim) ? W25QXX_STATUS_BUSY : 0U) |
+                  (sim->wel ? W25QXX_STATUS_WEL : 0U);
+            break;
+
+        case W25QXX_CMD_READ_STATUS_R2:
+            out = sim->suspended ? W25QXX_STATUS_SUS : 0U;
+            break;
+
+        case W25QXX_CMD_JEDEC_ID:
+            out = jedec_id[(index - 1U) % 3U];
+            break;
+
+        case W25QXX_CMD_READ_ID:
+            out = (((index - 4U) & 1U) == 0U) ? W25Q128_MANUFACTURER_ID : W25QXX_SIM_DEVICE_ID;
+            break;
+
+        case W25QXX_CMD_FAST_READ:
+        case W25QXX_CMD_READ_DATA:
+            /* Fast Read: one dummy byte before the data */
+            if ((sim->command == W25QXX_CMD_FAST_READ) && (index == 4U))
+            {
+                break;
+            }
+            out = (sim->address < sim->size) ? sim->memory[sim->address] : 0xFFU;
+            sim->address = (sim->address + 1U) & W25QXX_SIM_ADDR_MASK;
+            sim->stats.bytes_read++;
+            break;
+
+        case W25QXX_CMD_PAGE_PROGRAM:
+            /* Wraps within the page, a later byte replaces an earlier one */
+            {
+                uint32_t offset = (sim->address + index - 4U) % W25Q128_PAGE_SIZE;
+
+                sim->latch[offset] = in;
+                sim->latched[offset] = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return out;
+}
+
+/**
+ * @brief Check if the device accepts a command in its current state
+ */
+static bool W25QXX_Sim_Accept(w25qxx_sim_t *sim, uint8_t command)
+{
+    bool accept;
+
+    if (sim->power_down)
+    {
+        accept = (command == W25QXX_CMD_RELEASE_POWER_DOWN);
+    }
+    else if (W25QXX_Sim_Busy(sim))
+    {
+        accept = (command == W25QXX_CMD_READ_STATUS_R1) ||
+                 (command == W25QXX_CMD_READ_STATUS_R2) ||
+                 (command == W25QXX_CMD_SUSPEND);
+    }
+    else
+    {
+        accept = true;
+    }
+
+    if (!accept)
+    {
+        sim->stats.rejected++;
+    }
+
+    return accept;
+}
+
+/**
+ * @brief Execute the transaction at the CS rising edge
+ */
+static void W25QXX_Sim_Execute(w25qxx_sim_t *sim)
+{
+    bool needs_wel = false;
+    bool complete;
+
+    switch (sim->command)
+    {
+        case W25QXX_CMD_PAGE_PROGRAM:
+        case W25QXX_CMD_SECTOR_ERASE_4K:
+        case W25QXX_CMD_BLOCK_ERASE_32K:
+        case W25QXX_CMD_BLOCK_ERASE_64K:
+            needs_wel = true;
+            complete = (sim->count >= ((sim->command == W25QXX_CMD_PAGE_PROGRAM) ? 5U : 4U));
+            break;
+
+        case W25QXX_CMD_CHIP_ERASE:
+            needs_wel = true;
+            complete = true;
+            break;
+
+        default:
+            complete = true;
+            break;
+    }
+
+    /* No second program or erase while one is suspended */
+    if (needs_wel && (!complete || !sim->wel || sim->operating))
+    {
+        sim->stats.rejected++;
+        return;
+    }
+
+    switch (sim->command)
+    {
+        case W25QXX_CMD_WRITE_ENABLE:
+            sim->wel = true;
+            break;
+
+        case W25QXX_CMD_WRITE_DISABLE:
+            sim->wel = false;
+            break;
+
+        case W25QXX_CMD_PAGE_PROGRAM:
+            W25QXX_Sim_Program(sim);
+            break;
+
+        case W25QXX_CMD_SECTOR_ERASE_4K:
+            W25QXX_Sim_Erase(sim, W25Q128_SECTOR_SIZE, W25QXX_SIM_SECTOR_ERASE_US);
+            sim->stats.sector_erases++;
+            break;
+
+        case W25QXX_CMD_BLOCK_ERASE_32K:
+            W25QXX_Sim_Erase(sim, W25Q128_BLOCK_SIZE_32K, W25QXX_SIM_BLOCK_ERASE_32K_US);
+            sim->stats.block_erases++;
+            break;
+
+        case W25QXX_CMD_BLOCK_ERASE_64K:
+            W25QXX_Sim_Erase(sim, W25Q128_BLOCK_SIZE_64K, W25QXX_SIM_BLOCK_ERASE_64K_US);
+            sim->stats.block_erases++;
+            break;
+
+        case W25QXX_CMD_CHIP_ERASE:
+            sim->address = 0U;
+            W25QXX_Sim_Erase(sim, W25Q128_FLASH_SIZE, W25QXX_SIM_CHIP_ERASE_US);
+            sim->stats.chip_erases++;
+            break;
+
+        case W25QXX_CMD_POWER_DOWN:
+            sim->power_down = true;
+            break;
+
+        case W25QXX_CMD_RELEASE_POWER_DOWN:
+            sim->power_down = false;
+            break;
+
+        case W25QXX_CMD_SUSPEND:
+            if (sim->operating && !sim->suspended && (sim->time_ns < sim->done_ns))
+            {
+                sim->remaining_ns = sim->done_ns - sim->time_ns;
+                sim->suspend_ns = sim->time_ns + ((uint64_t)W25QXX_SIM_SUSPEND_US * 1000U);
+                sim->suspended = true;
+                sim->stats.suspends++;
+            }
+            break;
+
+        case W25QXX_CMD_RESUME:
+            if (sim->suspended)
+            {
+                sim->done_ns = sim->time_ns + sim->remaining_ns;
+                sim->suspended = false;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief BUSY bit, completes a finished program or erase (clears WEL)
+ */
+static bool W25QXX_Sim_Busy(w25qxx_sim_t *sim)
+{
+    if (sim->suspended)
+    {
+        return (sim->time_ns < sim->suspend_ns);
+    }
+
+    if (sim->operating && (sim->time_ns >= sim->done_ns))
+    {
+        sim->operating = false;
+        sim->wel = false;
+    }
+
+    return sim->operating;
+}
+
+/**
+ * @brief Start a program or erase of the given duration
+ */
+static void W25QXX_Sim_Start(w25qxx_sim_t *sim, uint32_t duration_us)
+{
+    sim->operating = true;
+    sim->done_ns = sim->time_ns + ((uint64_t)duration_us * 1000U);
+}
+
+/**
+ * @brief Program the latched bytes into the page (bits only cleared)
+ */
+static void W25QXX_Sim_Program(w25qxx_sim_t *sim)
+{
+    uint32_t page = sim->address & ~(W25Q128_PAGE_SIZE - 1U);
+    uint8_t *pCell;
+
+    for (uint32_t i = 0U; i < W25Q128_PAGE_SIZE; i++)
+    {
+        if (!sim->latched[i] || ((page + i) >= sim->size))
+        {
+            continue;
+        }
+
+        pCell = &sim->memory[page + i];
+        if ((sim->latch[i] & (uint8_t)~*pCell) != 0U)
+        {
+            sim->stats.overwrites++;
+        }
+        *pCell &= sim->latch[i];
+    }
+
+    sim->stats.page_programs++;
+    W25QXX_Sim_Start(sim, W25QXX_SIM_PAGE_PROGRAM_US);
+}
+
+/**
+ * @brief Erase the aligned area holding the address
+ */
+static void W25QXX_Sim_Erase(w25qxx_sim_t *sim, uint32_t size, uint32_t duration_us)
+{
+    uint32_t start = sim->address & ~(size - 1U);
+
+    if (start < sim->size)
+    {
+        memset(&sim->memory[start], 0xFF,
+               ((sim->size - start) < size) ? (sim->size - start) : size);
+    }
+
+    W25QXX_Sim_Start(sim, duration_us);
+}
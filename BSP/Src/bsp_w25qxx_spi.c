@@ -0,0 +1,421 @@
+/**
+ ******************************************************************************
+ * @file    bsp_w25qxx_spi.c
+ * @brief   W25Q Series SPI Flash Driver - HAL SPI Transport
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Board transport of the W25QXX driver: HAL SPI (polled or DMA), the CS
+ * GPIO, HAL/ThreadX delays and the HAL tick.
+ * Target: STM32F407VGT6
+ *
+ * Large transfers run on SPI1 DMA while the calling thread waits on
+ * s_dma_semaphore. A receive started by W25QXX_Hal_ReceiveStart runs while
+ * the caller works (BSP_W25QXX_ReadStream hands the previous segment to
+ * its consumer) and is completed by W25QXX_Hal_ReceiveWait.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_w25qxx.h"
+#include "bsp_debug.h"
+#include "main.h"
+#include "tx_api.h"
+
+/* ============================================================================
+ * Private Defines
+ * ============================================================================*/
+
+/* CS Pin Control - Uses SPI_FLASH_CS_Pin defined in main.h */
+#ifndef SPI_FLASH_CS_Pin
+#define SPI_FLASH_CS_Pin        GPIO_PIN_4
+#define SPI_FLASH_CS_GPIO_Port  GPIOA
+#endif
+
+/* DMA completion timeout (ticks) */
+#define W25QXX_DMA_TIMEOUT_TICKS    ((W25QXX_TIMEOUT_DEFAULT * TX_TIMER_TICKS_PER_SECOND) / 1000U)
+
+/* CCM RAM is on the D-bus only, DMA cannot reach it */
+#define W25QXX_IS_CCM(p)        (((uint32_t)(p) >= CCMDATARAM_BASE) && ((uint32_t)(p) <= CCMDATARAM_END))
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+
+static void W25QXX_Hal_Select(void *context, bool selected);
+static w25qxx_status_t W25QXX_Hal_Transmit(void *context, const uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_Hal_Receive(void *context, uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_Hal_ReceiveStart(void *context, uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_Hal_ReceiveWait(void *context);
+static void W25QXX_Hal_Delay(void *context, uint32_t ms);
+static uint32_t W25QXX_Hal_GetTick(void *context);
+static bool W25QXX_Hal_InThread(void *context);
+static bool W25QXX_DMA_Usable(const uint8_t *pData, uint32_t size);
+static w25qxx_status_t W25QXX_DMA_Transfer(uint8_t *pData, uint16_t size, bool receive);
+static w25qxx_status_t W25QXX_DMA_Start(uint8_t *pData, uint16_t size, bool receive);
+static w25qxx_status_t W25QXX_DMA_Wait(void);
+
+/* ============================================================================
+ * Private Variables
+ * ============================================================================*/
+
+static SPI_HandleTypeDef *s_hspi = NULL;
+
+static w25qxx_transport_t s_transport = {
+    NULL,
+    0U,
+    W25QXX_Hal_Select,
+    W25QXX_Hal_Transmit,
+    W25QXX_Hal_Receive,
+    W25QXX_Hal_ReceiveStart,
+    W25QXX_Hal_ReceiveWait,
+    W25QXX_Hal_Delay,
+    W25QXX_Hal_GetTick,
+    W25QXX_Hal_InThread
+};
+
+/* DMA completion, given by the HAL SPI callbacks */
+static TX_SEMAPHORE s_dma_semaphore;
+static bool s_dma_created = false;
+static bool s_dma_enabled = false;
+static volatile bool s_dma_error = false;
+
+/* Receive started on DMA, completed by W25QXX_Hal_ReceiveWait */
+static bool s_dma_started = false;
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================*/
+
+/**
+ * @brief Initialize W25QXX device on the HAL SPI transport
+ */
+w25qxx_status_t BSP_W25QXX_Init(SPI_HandleTypeDef *hspi)
+{
+    uint32_t pclk;
+    uint32_t shift;
+
+    if (hspi == NULL)
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    s_hspi = hspi;
+    s_dma_enabled = false;
+
+    /* SPI1 is on APB2, SPI2/3 on APB1; BR = n divides by 2^(n + 1) */
+    pclk = (hspi->Instance == SPI1) ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    shift = ((hspi->Init.BaudRatePrescaler & SPI_CR1_BR) >> SPI_CR1_BR_Pos) + 1U;
+    s_transport.sck_hz = pclk >> shift;
+
+    return BSP_W25QXX_InitTransport(&s_transport);
+}
+
+/**
+ * @brief Enable DMA transfers with thread suspension
+ */
+w25qxx_status_t BSP_W25QXX_EnableDMA(void)
+{
+    if ((s_hspi == NULL) || (s_hspi->hdmatx == NULL) || (s_hspi->hdmarx == NULL))
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    if (!s_dma_created)
+    {
+        if (tx_semaphore_create(&s_dma_semaphore, "W25QXX DMA", 0U) != TX_SUCCESS)
+        {
+            return W25QXX_ERROR;
+        }
+        s_dma_created = true;
+    }
+
+    s_dma_enabled = true;
+
+    DEBUG_INFO("W25QXX: DMA transfers enabled (>= %u bytes)", (unsigned int)W25QXX_DMA_THRESHOLD);
+
+    return W25QXX_OK;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+/**
+ * @brief Drive the CS pin (low while selected)
+ */
+static void W25QXX_Hal_Select(void *context, bool selected)
+{
+    (void)context;
+
+    HAL_GPIO_WritePin(SPI_FLASH_CS_GPIO_Port, SPI_FLASH_CS_Pin,
+                      selected ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+/**
+ * @brief SPI transmit (split into HAL-sized transfers)
+ */
+static w25qxx_status_t W25QXX_Hal_Transmit(void *context, const uint8_t *pData, uint32_t size)
+{
+    /* HAL takes a non-const buffer, it is only read */
+    uint8_t *pTx = (uint8_t *)pData;
+    w25qxx_status_t status;
+    uint16_t chunk;
+
+    (void)context;
+
+    if (s_hspi == NULL)
+    {
+        return W25QXX_ERROR;
+    }
+
+    while (size > 0U)
+    {
+        chunk = (size > W25QXX_DMA_MAX_TRANSFER) ? W25QXX_DMA_MAX_TRANSFER : (uint16_t)size;
+
+        if (W25QXX_DMA_Usable(pTx, chunk))
+        {
+            status = W25QXX_DMA_Transfer(pTx, chunk, false);
+            if (status != W25QXX_OK)
+            {
+                return status;
+            }
+        }
+        else if (HAL_SPI_Transmit(s_hspi, pTx, chunk, W25QXX_TIMEOUT_DEFAULT) != HAL_OK)
+        {
+            return W25QXX_SPI_ERROR;
+        }
+
+        pTx += chunk;
+        size -= chunk;
+    }
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief SPI receive (split into HAL-sized transfers)
+ */
+static w25qxx_status_t W25QXX_Hal_Receive(void *context, uint8_t *pData, uint32_t size)
+{
+    w25qxx_status_t status;
+    uint16_t chunk;
+
+    (void)context;
+
+    if (s_hspi == NULL)
+    {
+        return W25QXX_ERROR;
+    }
+
+    while (size > 0U)
+    {
+        chunk = (size > W25QXX_DMA_MAX_TRANSFER) ? W25QXX_DMA_MAX_TRANSFER : (uint16_t)size;
+
+        if (W25QXX_DMA_Usable(pData, chunk))
+        {
+            status = W25QXX_DMA_Transfer(pData, chunk, true);
+            if (status != W25QXX_OK)
+            {
+                return status;
+            }
+        }
+        else if (HAL_SPI_Receive(s_hspi, pData, chunk, W25QXX_TIMEOUT_DEFAULT) != HAL_OK)
+        {
+            return W25QXX_SPI_ERROR;
+        }
+
+        pData += chunk;
+        size -= chunk;
+    }
+
+    return W25QXX_OK;
+}
+
+/**
+ * @brief Start a receive of up to W25QXX_DMA_MAX_TRANSFER bytes
+ * @note  Polled (complete on return) where DMA is not usable
+ */
+static w25qxx_status_t W25QXX_Hal_ReceiveStart(void *context, uint8_t *pData, uint32_t size)
+{
+    w25qxx_status_t status;
+
+    if ((s_hspi == NULL) || (size > W25QXX_DMA_MAX_TRANSFER))
+    {
+        return W25QXX_INVALID_PARAM;
+    }
+
+    if (!W25QXX_DMA_Usable(pData, size))
+    {
+        return W25QXX_Hal_Receive(context, pData, size);
+    }
+
+    status = W25QXX_DMA_Start(pData, (uint16_t)size, true);
+    s_dma_started = (status == W25QXX_OK);
+
+    return status;
+}
+
+/**
+ * @brief Complete the receive started by W25QXX_Hal_ReceiveStart
+ */
+static w25qxx_status_t W25QXX_Hal_ReceiveWait(void *context)
+{
+    (void)context;
+
+    if (!s_dma_started)
+    {
+        return W25QXX_OK;
+    }
+
+    s_dma_started = false;
+
+    return W25QXX_DMA_Wait();
+}
+
+/**
+ * @brief Sleep the calling thread, busy wait outside a thread
+ */
+static void W25QXX_Hal_Delay(void *context, uint32_t ms)
+{
+    ULONG ticks = (ULONG)((ms * TX_TIMER_TICKS_PER_SECOND) / 1000U);
+
+    if (!W25QXX_Hal_InThread(context))
+    {
+        HAL_Delay(ms);
+    }
+    else if (ticks > 0U)
+    {
+        (void)tx_thread_sleep(ticks);
+    }
+}
+
+/**
+ * @brief HAL tick (ms)
+ */
+static uint32_t W25QXX_Hal_GetTick(void *context)
+{
+    (void)context;
+
+    return HAL_GetTick();
+}
+
+/**
+ * @brief Check for thread context (not before the kernel starts, not in an ISR)
+ */
+static bool W25QXX_Hal_InThread(void *context)
+{
+    (void)context;
+
+    return (__get_IPSR() == 0U) && (tx_thread_identify() != TX_NULL);
+}
+
+/**
+ * @brief Check if a transfer can run on DMA
+ * @note  Needs a thread to suspend
+ */
+static bool W25QXX_DMA_Usable(const uint8_t *pData, uint32_t size)
+{
+    return s_dma_enabled &&
+           (size >= W25QXX_DMA_THRESHOLD) &&
+           !W25QXX_IS_CCM(pData) &&
+           W25QXX_Hal_InThread(NULL);
+}
+
+/**
+ * @brief Run one DMA transfer and suspend until it completes
+ */
+static w25qxx_status_t W25QXX_DMA_Transfer(uint8_t *pData, uint16_t size, bool receive)
+{
+    w25qxx_status_t status;
+
+    status = W25QXX_DMA_Start(pData, size, receive);
+    if (status == W25QXX_OK)
+    {
+        status = W25QXX_DMA_Wait();
+    }
+
+    return status;
+}
+
+/**
+ * @brief Start one DMA transfer (complete with W25QXX_DMA_Wait)
+ */
+static w25qxx_status_t W25QXX_DMA_Start(uint8_t *pData, uint16_t size, bool receive)
+{
+    HAL_StatusTypeDef hal_status;
+
+    /* Drop a completion left over from an aborted transfer */
+    while (tx_semaphore_get(&s_dma_semaphore, TX_NO_WAIT) == TX_SUCCESS)
+    {
+    }
+    s_dma_error = false;
+
+    if (receive)
+    {
+        /* Full-duplex master: HAL clocks the buffer out as dummy bytes */
+        hal_status = HAL_SPI_Receive_DMA(s_hspi, pData, size);
+    }
+    else
+    {
+        hal_status = HAL_SPI_Transmit_DMA(s_hspi, pData, size);
+    }
+
+    return (hal_status == HAL_OK) ? W25QXX_OK : W25QXX_SPI_ERROR;
+}
+
+/**
+ * @brief Suspend until the started DMA transfer completes
+ */
+static w25qxx_status_t W25QXX_DMA_Wait(void)
+{
+    if (tx_semaphore_get(&s_dma_semaphore, W25QXX_DMA_TIMEOUT_TICKS) != TX_SUCCESS)
+    {
+        (void)HAL_SPI_Abort(s_hspi);
+        DEBUG_ERROR("W25QXX: DMA transfer timeout");
+        return W25QXX_TIMEOUT;
+    }
+
+    return s_dma_error ? W25QXX_SPI_ERROR : W25QXX_OK;
+}
+
+/* ============================================================================
+ * HAL SPI Callbacks
+ * ============================================================================*/
+
+/**
+ * @brief SPI DMA transmit complete (bus idle)
+ */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if ((hspi == s_hspi) && s_dma_created)
+    {
+        (void)tx_semaphore_put(&s_dma_semaphore);
+    }
+}
+
+/**
+ * @brief SPI DMA receive complete
+ */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if ((hspi == s_hspi) && s_dma_created)
+    {
+        (void)tx_semaphore_put(&s_dma_semaphore);
+    }
+}
+
+/**
+ * @brief SPI DMA error (overrun, DMA transfer error)
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if ((hspi == s_hspi) && s_dma_created)
+    {
+        s_dma_error = true;
+        (void)tx_semaphore_put(&s_dma_semaphore);
+    }
+}
@@ -35,11 +35,17 @@ extern "C" {
 #define BOOT_FLASH_SIZE         0x0000C000UL    /* 48KB */
 #define BOOT_CRC_ADDR           0x0800BFFCUL    /* Last 4 bytes for CRC */
 
-/* Config/Calibration Region (16KB, Sector 3) */
+/* Config/Calibration Region (16KB, Sector 3: journal area A) */
 #define CONFIG_FLASH_START      0x0800C000UL
 #define CONFIG_FLASH_END        0x0800FFFFUL
 #define CONFIG_FLASH_SIZE       0x00004000UL    /* 16KB */
-#define CONFIG_FLASH_SECTOR     3U
+#define CONFIG_AREA_SIZE        0x00004000UL    /* 16KB per journal area */
+#define CONFIG_AREA_A_START     CONFIG_FLASH_START
+#define CONFIG_AREA_A_SECTOR    3U
+
+/* Journal area B: first 16KB of Sector 8 (128KB, parameter region) */
+#define CONFIG_AREA_B_START     0x08080000UL
+#define CONFIG_AREA_B_SECTOR    8U
 
 /* Application Region (448KB, Sectors 4-7) */
 #define APP_FLASH_START         0x08010000UL
@@ -125,6 +131,7 @@ typedef struct __attribute__((packed)) {
     uint32_t crc;               /* Structure CRC32 */
 } boot_config_t;
 
+/* Fixed-layout addresses (pre-journal, area A), records: Config_Journal_Find() */
 #define BOOT_CONFIG_ADDR        (CONFIG_FLASH_START)
 
 /* ============================================================================
@@ -156,7 +163,7 @@ typedef struct __attribute__((packed)) {
     uint32_t crc32;             /* CRC32 of entire structure */
 } safety_params_t;
 
-#define SAFETY_PARAMS_ADDR      (CONFIG_FLASH_START + sizeof(boot_config_t))
+#define SAFETY_PARAMS_ADDR      (BOOT_CONFIG_ADDR + sizeof(boot_config_t))
 
 /* ============================================================================
  * Non-Safety Parameters Structure (stored in EEPROM or Flash)
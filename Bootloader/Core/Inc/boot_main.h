@@ -38,6 +38,17 @@ typedef enum {
     BOOT_STATE_ERROR            = 0xFFU
 } boot_state_t;
 
+/* ============================================================================
+ * Parameter Migration Statistics
+ * ============================================================================*/
+typedef struct {
+    uint16_t from_version;          /* Version of the upgraded image, 0 if none */
+    uint8_t  result;                /* param_migrate_t */
+    uint8_t  written;               /* 1 once written back to the journal */
+    uint32_t upgrade_cycles;        /* RAM upgrade (CPU cycles, 168MHz) */
+    uint32_t write_cycles;          /* Journal write-back (CPU cycles) */
+} boot_migration_stats_t;
+
 /* ============================================================================
  * Function Prototypes
  * ============================================================================*/
@@ -74,6 +85,12 @@ void Boot_EnterSafeState(boot_status_t error);
  */
 boot_status_t Boot_ValidateSafetyParams(safety_params_t *params);
 
+/**
+ * @brief  Get statistics of the parameter migration in this boot
+ * @retval Pointer to migration statistics (from_version 0 if none ran)
+ */
+const boot_migration_stats_t* Boot_GetMigrationStats(void);
+
 /**
  * @brief  Load non-safety parameters from EEPROM/Flash
  * @param  params: Pointer to non-safety params structure to fill
@@ -88,6 +88,13 @@ test_result_t Boot_Clock_Test(void);
  */
 test_result_t Boot_Watchdog_Init(void);
 
+/**
+ * @brief  Stretch the watchdog timeout for a flash sector erase
+ * @note   Restore the normal timeout with Boot_Watchdog_Init()
+ * @retval TEST_PASS or TEST_FAIL
+ */
+test_result_t Boot_Watchdog_Extend(void);
+
 /**
  * @brief  Refresh watchdog
  */
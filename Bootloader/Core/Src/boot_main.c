@@ -13,7 +13,7 @@
  * Boot Flow:
  * 1. Initialize hardware (minimal)
  * 2. Run functional safety self-tests
- * 3. Validate safety parameters (Flash)
+ * 3. Validate safety parameters (Flash), upgrading an older layout
  * 4. Load non-safety parameters (EEPROM)
  * 5. Check factory mode flag
  * 6. Verify Application CRC
@@ -27,19 +27,31 @@
 #include "boot_jump.h"
 #include "boot_crc.h"
 #include "boot_selftest.h"
+#include "params_schema.h"
+#include "params_migrate.h"
+#include "config_journal.h"
+#include "storage_flash.h"
 #include "stm32f4xx_hal.h"
 #include <string.h>
 
+/* Private defines -----------------------------------------------------------*/
+/* Boots not yet stored in boot_config (RTC backup register, kept across reset) */
+#define BOOT_COUNT_PENDING      (RTC->BKP0R)
+
 /* Private variables ---------------------------------------------------------*/
 static boot_state_t s_boot_state = BOOT_STATE_INIT;
 static boot_status_t s_last_error = BOOT_OK;
 static uint32_t s_flow_signature = PFM_SIGNATURE_INIT;
+static boot_migration_stats_t s_migration_stats = {0};
 
 /* Private function prototypes -----------------------------------------------*/
 static void Boot_SystemInit(void);
 static void Boot_SystemClock_Config(void);
 static void Boot_FlowMonitor_Update(pfm_checkpoint_t checkpoint);
 static bool Boot_FlowMonitor_Verify(uint32_t expected);
+static void Boot_RecordLastError(boot_status_t error);
+static boot_status_t Boot_MigrateSafetyParams(const void *image, uint32_t size,
+                                              safety_params_t *params);
 
 /* ============================================================================
  * Public Functions
@@ -112,7 +124,12 @@ void Boot_Main(void)
     s_boot_state = BOOT_STATE_CHECK_CONFIG;
     Boot_FlowMonitor_Update(PFM_CP_CONFIG_CHECK);
 
+    /* Count boots without a journal write: Boot_WriteConfig() adds them */
+    HAL_PWR_EnableBkUpAccess();
+    BOOT_COUNT_PENDING++;
+
     status = Boot_ReadConfig(&config);
+
     if (status == BOOT_OK && config.factory_mode != 0)
     {
         /* Factory mode requested - enter factory mode */
@@ -196,6 +213,9 @@ void Boot_EnterSafeState(boot_status_t error)
     s_boot_state = BOOT_STATE_SAFE;
     s_last_error = error;
 
+    /* Keep the error for diagnostics after the watchdog reset */
+    Boot_RecordLastError(error);
+
     /* Disable all interrupts */
     __disable_irq();
 
@@ -222,18 +242,39 @@ void Boot_EnterSafeState(boot_status_t error)
 boot_status_t Boot_ValidateSafetyParams(safety_params_t *params)
 {
     uint32_t calc_crc;
-    int i;
+    uint32_t record_size = 0;
+    param_check_t check;
+    boot_status_t status;
 
     if (params == NULL)
     {
         return BOOT_ERROR;
     }
 
-    /* 1. Read from Flash */
-    memcpy(params, (void *)SAFETY_PARAMS_ADDR, sizeof(safety_params_t));
+    /* 1. Read latest record from the config journal, whatever its layout */
+    const void *record = Config_Journal_FindLatest(JOURNAL_TYPE_SAFETY_PARAMS, &record_size);
+    if (record == NULL)
+    {
+        return BOOT_ERROR_MAGIC;
+    }
+
+    if ((record_size == sizeof(safety_params_t)) &&
+        (((const safety_params_t *)record)->version == SAFETY_PARAMS_VERSION))
+    {
+        memcpy(params, record, sizeof(safety_params_t));
+    }
+    else
+    {
+        /* Older layout: upgrade in RAM, write back once */
+        status = Boot_MigrateSafetyParams(record, record_size, params);
+        if (status != BOOT_OK)
+        {
+            return status;
+        }
+    }
 
-    /* 2. Verify magic number */
-    if (params->magic != SAFETY_PARAMS_MAGIC_VAL)
+    /* 2. Verify magic number, version and size */
+    if (Params_Schema_CheckHeader(params) != PARAM_CHECK_OK)
     {
         return BOOT_ERROR_MAGIC;
     }
@@ -246,32 +287,28 @@ boot_status_t Boot_ValidateSafetyParams(safety_params_t *params)
         return BOOT_ERROR_CRC;
     }
 
-    /* 4. Verify redundancy (inverted copies) */
-    for (i = 0; i < 3; i++)
+    /* 4. Verify ranges and redundancy (inverted copies) */
+    check = Params_Schema_CheckFields(params, PARAMS_CHECK_ALL, NULL);
+    if (check == PARAM_CHECK_REDUNDANCY)
     {
-        /* Check HALL offset redundancy */
-        uint32_t *offset = (uint32_t *)&params->hall_offset[i];
-        uint32_t *offset_inv = (uint32_t *)&params->hall_offset_inv[i];
-        if (*offset != ~(*offset_inv))
-        {
-            return BOOT_ERROR_REDUNDANCY;
-        }
-
-        /* Check HALL gain redundancy */
-        uint32_t *gain = (uint32_t *)&params->hall_gain[i];
-        uint32_t *gain_inv = (uint32_t *)&params->hall_gain_inv[i];
-        if (*gain != ~(*gain_inv))
-        {
-            return BOOT_ERROR_REDUNDANCY;
-        }
+        return BOOT_ERROR_REDUNDANCY;
+    }
+    if (check != PARAM_CHECK_OK)
+    {
+        return BOOT_ERROR_RANGE;
     }
-
-    /* 5. Range check (application specific) */
-    /* TODO: Add range checks based on actual parameter requirements */
 
     return BOOT_OK;
 }
 
+/**
+ * @brief  Get statistics of the parameter migration in this boot
+ */
+const boot_migration_stats_t* Boot_GetMigrationStats(void)
+{
+    return &s_migration_stats;
+}
+
 /**
  * @brief  Load non-safety parameters
  */
@@ -284,8 +321,11 @@ boot_status_t Boot_LoadNonSafetyParams(nonsafety_params_t *params)
         return BOOT_ERROR;
     }
 
-    /* TODO: Read from EEPROM or Flash backup area */
-    /* For now, use defaults */
+    /*
+     * Stored by the application in the W25Q128 key-value store
+     * (svc_kvstore.c). The bootloader has no SPI Flash driver and only
+     * needs the defaults.
+     */
     Boot_LoadDefaultParams(params);
 
     /* Verify magic */
@@ -337,11 +377,15 @@ boot_status_t Boot_ReadConfig(boot_config_t *config)
         return BOOT_ERROR;
     }
 
-    /* Read from Flash */
-    memcpy(config, (void *)BOOT_CONFIG_ADDR, sizeof(boot_config_t));
+    /* Read latest record from the config journal */
+    const void *record = Config_Journal_Find(JOURNAL_TYPE_BOOT_CONFIG);
+    if (record != NULL)
+    {
+        memcpy(config, record, sizeof(boot_config_t));
+    }
 
     /* Verify magic */
-    if (config->magic != BOOT_CONFIG_MAGIC)
+    if ((record == NULL) || (config->magic != BOOT_CONFIG_MAGIC))
     {
         /* First boot or corrupted - initialize with defaults */
         memset(config, 0, sizeof(boot_config_t));
@@ -362,14 +406,30 @@ boot_status_t Boot_ReadConfig(boot_config_t *config)
 
 /**
  * @brief  Write boot configuration to Flash
+ * @note   Boots counted since the last write are added to boot_count.
+ *         Without VBAT they are lost on power-down.
  */
 boot_status_t Boot_WriteConfig(const boot_config_t *config)
 {
-    /* TODO: Implement Flash write with proper erase/program sequence */
-    /* This requires HAL_FLASH_Unlock, sector erase, and program */
+    boot_config_t record;
+    uint32_t pending;
 
-    (void)config;  /* Suppress unused parameter warning */
+    if (config == NULL)
+    {
+        return BOOT_ERROR;
+    }
+
+    pending = BOOT_COUNT_PENDING;
+    record = *config;
+    record.boot_count += pending;
+
+    /* Appended to the config journal (sets magic and CRC) */
+    if (Storage_WriteConfig(&record) != STORAGE_OK)
+    {
+        return BOOT_ERROR;
+    }
 
+    BOOT_COUNT_PENDING = 0U;
     return BOOT_OK;
 }
 
@@ -388,6 +448,10 @@ static void Boot_SystemInit(void)
     /* Configure system clock to 168MHz */
     Boot_SystemClock_Config();
 
+    /* Cycle counter for timing measurements (never reset, shared with the app) */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     /* Enable required peripheral clocks */
     __HAL_RCC_CRC_CLK_ENABLE();
     __HAL_RCC_PWR_CLK_ENABLE();
@@ -499,3 +563,89 @@ static bool Boot_FlowMonitor_Verify(uint32_t expected)
 
     return (s_flow_signature == calculated);
 }
+
+/**
+ * @brief  Store error code in the boot configuration
+ * @note   Only when the record fits without a sector erase: the safe state
+ *         must not wait for a compaction. Repeated errors are not stored.
+ */
+static void Boot_RecordLastError(boot_status_t error)
+{
+    boot_config_t config;
+
+    if (Storage_Journal_HasRoom(sizeof(boot_config_t)) == 0U)
+    {
+        return;
+    }
+
+    if ((Boot_ReadConfig(&config) == BOOT_ERROR_CRC) ||
+        (config.last_error == (uint32_t)error))
+    {
+        return;
+    }
+
+    config.last_error = (uint32_t)error;
+    (void)Boot_WriteConfig(&config);
+}
+
+/**
+ * @brief  Upgrade safety parameters stored with an older layout
+ * @note   The image CRC is checked first, the upgraded set is range checked
+ *         before it is appended to the journal. Both steps are timed.
+ */
+static boot_status_t Boot_MigrateSafetyParams(const void *image, uint32_t size,
+                                              safety_params_t *params)
+{
+    const params_layout_t *layout;
+    const uint8_t *src = (const uint8_t *)image;
+    uint32_t stored_crc;
+    uint32_t start;
+    storage_status_t storage_status;
+
+    s_migration_stats.from_version = ((const safety_params_t *)image)->version;
+
+    /* crc32 is the last word of every layout */
+    layout = Params_Migrate_FindLayout(s_migration_stats.from_version);
+    if ((layout == NULL) || (layout->size > size))
+    {
+        s_migration_stats.result = (uint8_t)PARAM_MIGRATE_UNKNOWN;
+        return BOOT_ERROR_MAGIC;
+    }
+
+    memcpy(&stored_crc, src + layout->size - sizeof(uint32_t), sizeof(uint32_t));
+    if (Boot_CRC32_Calculate(src, layout->size - sizeof(uint32_t)) != stored_crc)
+    {
+        return BOOT_ERROR_CRC;
+    }
+
+    start = DWT->CYCCNT;
+    s_migration_stats.result = (uint8_t)Params_Migrate_Upgrade(image, size, params);
+    s_migration_stats.upgrade_cycles = DWT->CYCCNT - start;
+
+    if (s_migration_stats.result != (uint8_t)PARAM_MIGRATE_OK)
+    {
+        return BOOT_ERROR_MAGIC;
+    }
+
+    if (Params_Schema_CheckFields(params, PARAMS_CHECK_ALL, NULL) != PARAM_CHECK_OK)
+    {
+        return BOOT_ERROR_RANGE;
+    }
+
+    /* One journal append, the old record stays until the next compaction */
+    start = DWT->CYCCNT;
+    storage_status = Storage_WriteSafetyParams(params);
+    s_migration_stats.write_cycles = DWT->CYCCNT - start;
+
+    if (storage_status != STORAGE_OK)
+    {
+        return BOOT_ERROR;
+    }
+    s_migration_stats.written = 1U;
+
+    /* Same CRC as the written record, checked by the caller */
+    params->crc32 = Boot_CRC32_Calculate((uint8_t *)params,
+                                         sizeof(safety_params_t) - sizeof(uint32_t));
+
+    return BOOT_OK;
+}
@@ -324,6 +324,28 @@ test_result_t Boot_Watchdog_Init(void)
     return TEST_PASS;
 }
 
+/**
+ * @brief  Stretch the IWDG timeout for a flash sector erase
+ * @note   Code and vectors are fetched from the bank being erased, so
+ *         nothing can refresh the watchdog until the erase ends. A 128KB
+ *         sector takes up to 2 s; prescaler 256 with reload 4095 gives at
+ *         least 22 s even at the fastest LSI (47 kHz).
+ *         Boot_Watchdog_Init() restores the 1 s timeout.
+ */
+test_result_t Boot_Watchdog_Extend(void)
+{
+    hiwdg.Instance = IWDG;
+    hiwdg.Init.Prescaler = IWDG_PRESCALER_256;
+    hiwdg.Init.Reload = 4095;
+
+    if (HAL_IWDG_Init(&hiwdg) != HAL_OK)
+    {
+        return TEST_FAIL;
+    }
+
+    return TEST_PASS;
+}
+
 /**
  * @brief  Refresh watchdog
  */
@@ -26,29 +26,7 @@ extern "C" {
 #include "boot_config.h"
 #include "factory_mode.h"
 
-/* ============================================================================
- * Calibration Parameter Limits
- * ============================================================================*/
-
-/* HALL sensor offset limits (in ADC counts or normalized units) */
-#define HALL_OFFSET_MIN         (-1000.0f)
-#define HALL_OFFSET_MAX         (1000.0f)
-
-/* HALL sensor gain limits */
-#define HALL_GAIN_MIN           (0.5f)
-#define HALL_GAIN_MAX           (2.0f)
-
-/* ADC gain limits */
-#define ADC_GAIN_MIN            (0.8f)
-#define ADC_GAIN_MAX            (1.2f)
-
-/* ADC offset limits */
-#define ADC_OFFSET_MIN          (-500.0f)
-#define ADC_OFFSET_MAX          (500.0f)
-
-/* Safety threshold limits */
-#define SAFETY_THRESHOLD_MIN    (0.0f)
-#define SAFETY_THRESHOLD_MAX    (10000.0f)
+/* Calibration parameter limits: boot_config.h, applied via params_schema.h */
 
 /* ============================================================================
  * Function Prototypes
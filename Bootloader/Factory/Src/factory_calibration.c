@@ -16,12 +16,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "factory_calibration.h"
+#include "params_schema.h"
 #include <string.h>
-#include <math.h>
-
-/* Private function prototypes -----------------------------------------------*/
-static int Factory_IsFloatValid(float value);
-static void Factory_StoreWithInverse(float value, float *primary, float *inverse);
 
 /* ============================================================================
  * Initialization
@@ -45,81 +41,15 @@ factory_status_t Factory_Calibration_Init(void)
  */
 factory_status_t Factory_Calibration_Validate(const safety_params_t *params)
 {
-    uint32_t i;
-
     if (params == NULL)
     {
         return FACTORY_ERROR;
     }
 
-    /* Validate HALL offsets */
-    for (i = 0; i < 3; i++)
-    {
-        if (!Factory_IsFloatValid(params->hall_offset[i]))
-        {
-            return FACTORY_CAL_INVALID;
-        }
-        if (params->hall_offset[i] < HALL_OFFSET_MIN ||
-            params->hall_offset[i] > HALL_OFFSET_MAX)
-        {
-            return FACTORY_CAL_INVALID;
-        }
-    }
-
-    /* Validate HALL gains */
-    for (i = 0; i < 3; i++)
-    {
-        if (!Factory_IsFloatValid(params->hall_gain[i]))
-        {
-            return FACTORY_CAL_INVALID;
-        }
-        if (params->hall_gain[i] < HALL_GAIN_MIN ||
-            params->hall_gain[i] > HALL_GAIN_MAX)
-        {
-            return FACTORY_CAL_INVALID;
-        }
-    }
-
-    /* Validate ADC gains */
-    for (i = 0; i < 8; i++)
-    {
-        if (!Factory_IsFloatValid(params->adc_gain[i]))
-        {
-            return FACTORY_CAL_INVALID;
-        }
-        if (params->adc_gain[i] < ADC_GAIN_MIN ||
-            params->adc_gain[i] > ADC_GAIN_MAX)
-        {
-            return FACTORY_CAL_INVALID;
-        }
-    }
-
-    /* Validate ADC offsets */
-    for (i = 0; i < 8; i++)
+    /* Ranges only: redundancy fields are prepared after validation */
+    if (Params_Schema_CheckFields(params, PARAMS_CHECK_RANGE, NULL) != PARAM_CHECK_OK)
     {
-        if (!Factory_IsFloatValid(params->adc_offset[i]))
-        {
-            return FACTORY_CAL_INVALID;
-        }
-        if (params->adc_offset[i] < ADC_OFFSET_MIN ||
-            params->adc_offset[i] > ADC_OFFSET_MAX)
-        {
-            return FACTORY_CAL_INVALID;
-        }
-    }
-
-    /* Validate safety thresholds */
-    for (i = 0; i < 4; i++)
-    {
-        if (!Factory_IsFloatValid(params->safety_threshold[i]))
-        {
-            return FACTORY_CAL_INVALID;
-        }
-        if (params->safety_threshold[i] < SAFETY_THRESHOLD_MIN ||
-            params->safety_threshold[i] > SAFETY_THRESHOLD_MAX)
-        {
-            return FACTORY_CAL_INVALID;
-        }
+        return FACTORY_CAL_INVALID;
     }
 
     return FACTORY_OK;
@@ -130,28 +60,12 @@ factory_status_t Factory_Calibration_Validate(const safety_params_t *params)
  */
 void Factory_Calibration_PrepareRedundancy(safety_params_t *params)
 {
-    uint32_t i;
-
     if (params == NULL)
     {
         return;
     }
 
-    /* Prepare HALL offset redundancy */
-    for (i = 0; i < 3; i++)
-    {
-        Factory_StoreWithInverse(params->hall_offset[i],
-                                  &params->hall_offset[i],
-                                  &params->hall_offset_inv[i]);
-    }
-
-    /* Prepare HALL gain redundancy */
-    for (i = 0; i < 3; i++)
-    {
-        Factory_StoreWithInverse(params->hall_gain[i],
-                                  &params->hall_gain[i],
-                                  &params->hall_gain_inv[i]);
-    }
+    Params_Schema_PrepareRedundancy(params);
 }
 
 /**
@@ -398,47 +312,3 @@ factory_status_t Factory_Calibration_SetThreshold(safety_params_t *params,
     params->safety_threshold[index] = threshold;
     return FACTORY_OK;
 }
-
-/* ============================================================================
- * Private Functions
- * ============================================================================*/
-
-/**
- * @brief  Check if float value is valid (not NaN or Inf)
- */
-static int Factory_IsFloatValid(float value)
-{
-    /* Check for NaN */
-    if (value != value)
-    {
-        return 0;
-    }
-
-    /* Check for infinity */
-    if (value > 3.4e38f || value < -3.4e38f)
-    {
-        return 0;
-    }
-
-    return 1;
-}
-
-/**
- * @brief  Store value with its bitwise inverse
- */
-static void Factory_StoreWithInverse(float value, float *primary, float *inverse)
-{
-    uint32_t val_bits;
-    uint32_t inv_bits;
-
-    *primary = value;
-
-    /* Get bit representation */
-    memcpy(&val_bits, &value, sizeof(uint32_t));
-
-    /* Create inverse */
-    inv_bits = ~val_bits;
-
-    /* Store inverse */
-    memcpy(inverse, &inv_bits, sizeof(uint32_t));
-}
@@ -8,7 +8,8 @@
  * @attention
  *
  * Flash storage operations for bootloader configuration and safety parameters.
- * Uses STM32F4 internal Flash Sector 3 (0x0800C000-0x0800FFFF, 16KB).
+ * Uses STM32F4 internal Flash Sector 3 (0x0800C000-0x0800FFFF, 16KB) and the
+ * first 16KB of Sector 8 (0x08080000), one config journal area each.
  *
  * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
  *
@@ -24,6 +25,7 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 #include "boot_config.h"
+#include "config_journal.h"
 
 /* ============================================================================
  * Flash Storage Status Codes
@@ -45,7 +47,8 @@ typedef enum {
  * Flash Sector Definitions (STM32F407)
  * ============================================================================*/
 
-#define FLASH_SECTOR_CONFIG     FLASH_SECTOR_3
+#define FLASH_SECTOR_CONFIG_A   FLASH_SECTOR_3         /* Journal area A */
+#define FLASH_SECTOR_CONFIG_B   FLASH_SECTOR_8         /* Journal area B */
 #define FLASH_VOLTAGE_RANGE     FLASH_VOLTAGE_RANGE_3  /* 2.7V - 3.6V */
 
 /* Flash operation timeout (milliseconds) */
@@ -114,15 +117,39 @@ storage_status_t Storage_ValidateSafetyParams(const safety_params_t *params);
  */
 storage_status_t Storage_CheckSafetyParamsExist(void);
 
+/* ============================================================================
+ * Function Prototypes - Config Journal
+ * ============================================================================*/
+
+/**
+ * @brief  Append a record to the config journal
+ * @note   Programs one record (microseconds per word) into the active area.
+ *         When the record does not fit, the other area is erased, receives
+ *         the live records and the new one, and becomes active.
+ * @param  type: Record type
+ * @param  data: Payload (word aligned)
+ * @param  size: Payload size, must match the record type
+ * @retval STORAGE_OK on success, error code otherwise
+ */
+storage_status_t Storage_Journal_Append(journal_type_t type, const void *data, uint32_t size);
+
+/**
+ * @brief  Check if a record fits without compaction
+ * @param  size: Payload size in bytes
+ * @retval 1 if it fits, 0 if appending would compact into the other area
+ */
+uint32_t Storage_Journal_HasRoom(uint32_t size);
+
 /* ============================================================================
  * Function Prototypes - Flash Operations
  * ============================================================================*/
 
 /**
- * @brief  Erase Config sector (Sector 3)
+ * @brief  Erase one config journal area (Sector 3 or 8)
+ * @param  area: Area index (0 = A, 1 = B)
  * @retval STORAGE_OK on success, error code otherwise
  */
-storage_status_t Storage_EraseSector(void);
+storage_status_t Storage_EraseSector(uint32_t area);
 
 /**
  * @brief  Program Flash with data
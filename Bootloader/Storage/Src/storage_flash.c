@@ -10,6 +10,12 @@
  * Flash storage operations for bootloader configuration and safety parameters.
  * Implements read/write/erase operations with CRC verification.
  *
+ * Boot configuration and safety parameters are records in the config
+ * journal (config_journal.h). Updates are appended to the active area.
+ * When it is full, the live records are written to the other area, whose
+ * header (next generation) is programmed last. A power loss at any point
+ * leaves the previous area active with a complete parameter set.
+ *
  * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
  *
  ******************************************************************************
@@ -18,12 +24,23 @@
 /* Includes ------------------------------------------------------------------*/
 #include "storage_flash.h"
 #include "boot_crc.h"
+#include "params_schema.h"
+#include "boot_selftest.h"
 #include "stm32f4xx_hal.h"
 #include <string.h>
 
 /* Private variables ---------------------------------------------------------*/
 static uint8_t storage_initialized = 0;
 
+/* Live records kept across a compaction */
+static uint32_t s_compact_buffer[JOURNAL_TYPE_COUNT][JOURNAL_MAX_PAYLOAD / 4U];
+
+/* Private function prototypes -----------------------------------------------*/
+static storage_status_t Storage_Journal_Program(uint32_t address, journal_type_t type,
+                                                const void *data, uint32_t size);
+static storage_status_t Storage_Journal_Compact(journal_type_t type,
+                                                const void *data, uint32_t size);
+
 /* ============================================================================
  * Initialization
  * ============================================================================*/
@@ -55,8 +72,15 @@ storage_status_t Storage_ReadConfig(boot_config_t *config)
         return STORAGE_ERROR;
     }
 
-    /* Read directly from Flash */
-    memcpy(config, (void *)CONFIG_FLASH_START, sizeof(boot_config_t));
+    /* Latest record in the config journal */
+    const void *record = Config_Journal_Find(JOURNAL_TYPE_BOOT_CONFIG);
+    if (record == NULL)
+    {
+        memset(config, 0, sizeof(boot_config_t));
+        return STORAGE_MAGIC_ERROR;
+    }
+
+    memcpy(config, record, sizeof(boot_config_t));
 
     /* Verify magic number */
     if (config->magic != CONFIG_MAGIC)
@@ -73,7 +97,6 @@ storage_status_t Storage_ReadConfig(boot_config_t *config)
  */
 storage_status_t Storage_WriteConfig(const boot_config_t *config)
 {
-    storage_status_t status;
     boot_config_t config_with_crc;
 
     if (config == NULL)
@@ -87,28 +110,9 @@ storage_status_t Storage_WriteConfig(const boot_config_t *config)
     config_with_crc.crc = Boot_CRC32_Calculate((uint8_t *)&config_with_crc,
                                                 sizeof(boot_config_t) - sizeof(uint32_t));
 
-    /* Erase sector first */
-    status = Storage_EraseSector();
-    if (status != STORAGE_OK)
-    {
-        return status;
-    }
-
-    /* Program Flash */
-    status = Storage_ProgramFlash(CONFIG_FLASH_START,
-                                   (uint8_t *)&config_with_crc,
-                                   sizeof(boot_config_t));
-    if (status != STORAGE_OK)
-    {
-        return status;
-    }
-
-    /* Verify write */
-    status = Storage_VerifyFlash(CONFIG_FLASH_START,
-                                  (uint8_t *)&config_with_crc,
-                                  sizeof(boot_config_t));
-
-    return status;
+    /* Append to the config journal */
+    return Storage_Journal_Append(JOURNAL_TYPE_BOOT_CONFIG,
+                                  &config_with_crc, sizeof(boot_config_t));
 }
 
 /**
@@ -149,8 +153,15 @@ storage_status_t Storage_ReadSafetyParams(safety_params_t *params)
         return STORAGE_ERROR;
     }
 
-    /* Read directly from Flash */
-    memcpy(params, (void *)SAFETY_PARAMS_ADDR, sizeof(safety_params_t));
+    /* Latest record in the config journal */
+    const void *record = Config_Journal_Find(JOURNAL_TYPE_SAFETY_PARAMS);
+    if (record == NULL)
+    {
+        memset(params, 0, sizeof(safety_params_t));
+        return STORAGE_MAGIC_ERROR;
+    }
+
+    memcpy(params, record, sizeof(safety_params_t));
 
     /* Verify magic number */
     if (params->magic != SAFETY_PARAMS_MAGIC)
@@ -176,18 +187,6 @@ storage_status_t Storage_WriteSafetyParams(const safety_params_t *params)
         return STORAGE_ERROR;
     }
 
-    /* Read existing config to preserve it */
-    status = Storage_ReadConfig(&config);
-    if (status != STORAGE_OK && status != STORAGE_MAGIC_ERROR && status != STORAGE_CRC_ERROR)
-    {
-        /* Initialize default config if not present */
-        memset(&config, 0, sizeof(boot_config_t));
-        config.magic = CONFIG_MAGIC;
-        config.factory_mode = 0;
-        config.cal_valid = 0;
-        config.app_crc = 0;
-    }
-
     /* Copy params and set magic */
     memcpy(&params_with_crc, params, sizeof(safety_params_t));
     params_with_crc.magic = SAFETY_PARAMS_MAGIC;
@@ -198,71 +197,48 @@ storage_status_t Storage_WriteSafetyParams(const safety_params_t *params)
     params_with_crc.crc32 = Boot_CRC32_Calculate((uint8_t *)&params_with_crc,
                                                   sizeof(safety_params_t) - sizeof(uint32_t));
 
-    /* Erase sector (this also erases config) */
-    status = Storage_EraseSector();
-    if (status != STORAGE_OK)
-    {
-        return status;
-    }
-
-    /* Write config first */
-    config.cal_valid = 1;  /* Mark calibration as valid */
-    config.crc = Boot_CRC32_Calculate((uint8_t *)&config,
-                                       sizeof(boot_config_t) - sizeof(uint32_t));
-
-    status = Storage_ProgramFlash(CONFIG_FLASH_START,
-                                   (uint8_t *)&config,
-                                   sizeof(boot_config_t));
+    /* Append parameters first, the config record marks them valid */
+    status = Storage_Journal_Append(JOURNAL_TYPE_SAFETY_PARAMS,
+                                    &params_with_crc, sizeof(safety_params_t));
     if (status != STORAGE_OK)
     {
         return status;
     }
 
-    /* Write safety params */
-    status = Storage_ProgramFlash(SAFETY_PARAMS_ADDR,
-                                   (uint8_t *)&params_with_crc,
-                                   sizeof(safety_params_t));
+    /* Read existing config to preserve it */
+    status = Storage_ReadConfig(&config);
     if (status != STORAGE_OK)
     {
-        return status;
+        /* Initialize default config if not present */
+        memset(&config, 0, sizeof(boot_config_t));
+        config.magic = CONFIG_MAGIC;
     }
 
-    /* Verify write */
-    status = Storage_VerifyFlash(SAFETY_PARAMS_ADDR,
-                                  (uint8_t *)&params_with_crc,
-                                  sizeof(safety_params_t));
+    config.cal_valid = 1;  /* Mark calibration as valid */
 
-    return status;
+    return Storage_WriteConfig(&config);
 }
 
 /**
- * @brief  Validate safety parameters (CRC + redundancy)
+ * @brief  Validate safety parameters (header, CRC, ranges and redundancy)
  */
 storage_status_t Storage_ValidateSafetyParams(const safety_params_t *params)
 {
     uint32_t calc_crc;
-    uint32_t i;
-    uint32_t val, inv;
+    param_check_t check;
 
     if (params == NULL)
     {
         return STORAGE_ERROR;
     }
 
-    /* Check magic */
-    if (params->magic != SAFETY_PARAMS_MAGIC)
+    /* Check magic, version and size */
+    check = Params_Schema_CheckHeader(params);
+    if (check == PARAM_CHECK_MAGIC)
     {
         return STORAGE_MAGIC_ERROR;
     }
-
-    /* Check version */
-    if (params->version != SAFETY_PARAMS_VERSION)
-    {
-        return STORAGE_ERROR;
-    }
-
-    /* Check size */
-    if (params->size != sizeof(safety_params_t))
+    if (check != PARAM_CHECK_OK)
     {
         return STORAGE_ERROR;
     }
@@ -275,23 +251,15 @@ storage_status_t Storage_ValidateSafetyParams(const safety_params_t *params)
         return STORAGE_CRC_ERROR;
     }
 
-    /* Verify redundancy: hall_offset[i] == ~hall_offset_inv[i] */
-    for (i = 0; i < 3; i++)
+    /* Verify ranges and redundancy (hall_offset[i] == ~hall_offset_inv[i], ...) */
+    check = Params_Schema_CheckFields(params, PARAMS_CHECK_ALL, NULL);
+    if (check == PARAM_CHECK_REDUNDANCY)
     {
-        /* Compare as uint32_t bit patterns */
-        memcpy(&val, &params->hall_offset[i], sizeof(uint32_t));
-        memcpy(&inv, &params->hall_offset_inv[i], sizeof(uint32_t));
-        if (val != ~inv)
-        {
-            return STORAGE_VERIFY_ERROR;
-        }
-
-        memcpy(&val, &params->hall_gain[i], sizeof(uint32_t));
-        memcpy(&inv, &params->hall_gain_inv[i], sizeof(uint32_t));
-        if (val != ~inv)
-        {
-            return STORAGE_VERIFY_ERROR;
-        }
+        return STORAGE_VERIFY_ERROR;
+    }
+    if (check != PARAM_CHECK_OK)
+    {
+        return STORAGE_ERROR;
     }
 
     return STORAGE_OK;
@@ -308,18 +276,186 @@ storage_status_t Storage_CheckSafetyParamsExist(void)
     return Storage_ReadSafetyParams(&params);
 }
 
+/* ============================================================================
+ * Config Journal Operations
+ * ============================================================================*/
+
+/**
+ * @brief  Append a record to the config journal
+ */
+storage_status_t Storage_Journal_Append(journal_type_t type, const void *data, uint32_t size)
+{
+    uint32_t offset;
+
+    if ((data == NULL) || (size != Config_Journal_GetPayloadSize(type)))
+    {
+        return STORAGE_ERROR;
+    }
+
+    /* Compact when the record does not fit (or no area is a journal yet) */
+    offset = Config_Journal_GetFreeOffset();
+    if ((offset + JOURNAL_RECORD_SIZE(size)) > JOURNAL_AREA_SIZE)
+    {
+        return Storage_Journal_Compact(type, data, size);
+    }
+
+    return Storage_Journal_Program(JOURNAL_AREA_START(Config_Journal_GetActiveArea()) + offset,
+                                   type, data, size);
+}
+
+/**
+ * @brief  Check if a record fits without compaction
+ */
+uint32_t Storage_Journal_HasRoom(uint32_t size)
+{
+    return ((Config_Journal_GetFreeOffset() + JOURNAL_RECORD_SIZE(size)) <= JOURNAL_AREA_SIZE) ? 1 : 0;
+}
+
+/**
+ * @brief  Program one record at a free journal address
+ */
+static storage_status_t Storage_Journal_Program(uint32_t address, journal_type_t type,
+                                                const void *data, uint32_t size)
+{
+    storage_status_t status;
+    uint32_t header = Config_Journal_MakeHeader(type, size);
+    uint32_t crc = Config_Journal_CalculateCRC(header, data, size);
+
+    /* Header first: a torn record keeps its length and fails its CRC */
+    status = Storage_ProgramFlash(address, (const uint8_t *)&header, sizeof(header));
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    status = Storage_ProgramFlash(address + sizeof(header), (const uint8_t *)data, size);
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    status = Storage_ProgramFlash(address + sizeof(header) + size,
+                                   (const uint8_t *)&crc, sizeof(crc));
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    /* Verify the whole record: header, payload and CRC */
+    status = Storage_VerifyFlash(address, (const uint8_t *)&header, sizeof(header));
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    status = Storage_VerifyFlash(address + sizeof(header), (const uint8_t *)data, size);
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    return Storage_VerifyFlash(address + sizeof(header) + size,
+                               (const uint8_t *)&crc, sizeof(crc));
+}
+
+/**
+ * @brief  Write the live records plus a new one to the inactive area
+ * @note   The area header is programmed last: until then the active area
+ *         stays selected, so a power loss never leaves no valid records.
+ */
+static storage_status_t Storage_Journal_Compact(journal_type_t type,
+                                                const void *data, uint32_t size)
+{
+    storage_status_t status;
+    uint32_t live_size[JOURNAL_TYPE_COUNT];
+    uint32_t active = Config_Journal_GetActiveArea();
+    uint32_t target;
+    uint32_t generation;
+    uint32_t offset = JOURNAL_FIRST_RECORD;
+    journal_area_header_t area_header;
+
+    /* Legacy data lives in area A, so the first compaction goes to area B */
+    target = (active == 1U) ? 0U : 1U;
+    generation = (active == JOURNAL_AREA_NONE) ? 1U : (Config_Journal_GetGeneration(active) + 1U);
+
+    /* Collect the latest record of every other type (legacy layout included) */
+    for (uint32_t i = 0; i < JOURNAL_TYPE_COUNT; i++)
+    {
+        journal_type_t live_type = (journal_type_t)(i + 1U);
+        const void *record = Config_Journal_Find(live_type);
+
+        live_size[i] = 0;
+        if ((live_type != type) && (record != NULL))
+        {
+            live_size[i] = Config_Journal_GetPayloadSize(live_type);
+            memcpy(s_compact_buffer[i], record, live_size[i]);
+        }
+    }
+
+    status = Storage_EraseSector(target);
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    for (uint32_t i = 0; i < JOURNAL_TYPE_COUNT; i++)
+    {
+        if (live_size[i] == 0U)
+        {
+            continue;
+        }
+
+        status = Storage_Journal_Program(JOURNAL_AREA_START(target) + offset,
+                                         (journal_type_t)(i + 1U),
+                                         s_compact_buffer[i], live_size[i]);
+        if (status != STORAGE_OK)
+        {
+            return status;
+        }
+        offset += JOURNAL_RECORD_SIZE(live_size[i]);
+    }
+
+    status = Storage_Journal_Program(JOURNAL_AREA_START(target) + offset, type, data, size);
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    /* Commit: the target area becomes active */
+    Config_Journal_MakeAreaHeader(generation, &area_header);
+    status = Storage_ProgramFlash(JOURNAL_AREA_START(target),
+                                  (const uint8_t *)&area_header, sizeof(area_header));
+    if (status != STORAGE_OK)
+    {
+        return status;
+    }
+
+    return Storage_VerifyFlash(JOURNAL_AREA_START(target),
+                               (const uint8_t *)&area_header, sizeof(area_header));
+}
+
 /* ============================================================================
  * Flash Operations
  * ============================================================================*/
 
 /**
- * @brief  Erase Config sector (Sector 3)
+ * @brief  Erase one config journal area (Sector 3 or 8)
+ * @note   The F407 has a single flash bank: every fetch stalls until the
+ *         erase ends, so the watchdog cannot be refreshed meanwhile.
+ *         Sector 8 is a 128KB sector (up to 2 s), longer than the 1 s IWDG
+ *         timeout, so the IWDG timeout is stretched for the erase and
+ *         restored afterwards.
  */
-storage_status_t Storage_EraseSector(void)
+storage_status_t Storage_EraseSector(uint32_t area)
 {
-    FLASH_EraseInitTypeDef erase_init = {0};
-    uint32_t sector_error = 0;
     HAL_StatusTypeDef hal_status;
+    uint32_t start_tick;
+    uint32_t errors;
+
+    if (area >= JOURNAL_AREA_COUNT)
+    {
+        return STORAGE_ERROR;
+    }
 
     /* Unlock Flash */
     hal_status = HAL_FLASH_Unlock();
@@ -328,25 +464,50 @@ storage_status_t Storage_EraseSector(void)
         return STORAGE_ERROR;
     }
 
-    /* Configure erase */
-    erase_init.TypeErase = FLASH_TYPEERASE_SECTORS;
-    erase_init.Banks = FLASH_BANK_1;
-    erase_init.Sector = FLASH_SECTOR_CONFIG;
-    erase_init.NbSectors = 1;
-    erase_init.VoltageRange = FLASH_VOLTAGE_RANGE;
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
 
-    /* Perform erase */
-    hal_status = HAL_FLASHEx_Erase(&erase_init, &sector_error);
+    /* Stretch the watchdog: nothing runs from flash until the erase ends */
+    if (Boot_Watchdog_Extend() != TEST_PASS)
+    {
+        HAL_FLASH_Lock();
+        return STORAGE_ERROR;
+    }
 
-    /* Lock Flash */
-    HAL_FLASH_Lock();
+    /* Start the sector erase and wait for it */
+    FLASH_Erase_Sector((area == 0U) ? FLASH_SECTOR_CONFIG_A : FLASH_SECTOR_CONFIG_B,
+                       FLASH_VOLTAGE_RANGE);
 
-    if (hal_status != HAL_OK)
+    start_tick = HAL_GetTick();
+    while (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) != RESET)
     {
-        return STORAGE_ERASE_ERROR;
+        if ((HAL_GetTick() - start_tick) > FLASH_TIMEOUT_MS)
+        {
+            (void)Boot_Watchdog_Init();
+            HAL_FLASH_Lock();
+            return STORAGE_TIMEOUT;
+        }
+    }
+
+    /* Back to the 1 s timeout */
+    if (Boot_Watchdog_Init() != TEST_PASS)
+    {
+        CLEAR_BIT(FLASH->CR, (FLASH_CR_SER | FLASH_CR_SNB));
+        HAL_FLASH_Lock();
+        return STORAGE_ERROR;
     }
 
-    if (sector_error != 0xFFFFFFFF)
+    errors = FLASH->SR & (FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                          FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+    /* Clear the sector erase request and drop stale cache lines */
+    CLEAR_BIT(FLASH->CR, (FLASH_CR_SER | FLASH_CR_SNB));
+    FLASH_FlushCaches();
+
+    /* Lock Flash */
+    HAL_FLASH_Lock();
+
+    if (errors != 0U)
     {
         return STORAGE_ERASE_ERROR;
     }
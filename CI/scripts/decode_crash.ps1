@@ -0,0 +1,215 @@
+#==============================================================================
+# decode_crash.ps1 - 崩溃记录解码脚本 / Crash Record Decoder
+#==============================================================================
+<#
+.SYNOPSIS
+    Decode a crash record (safety_crash_record_t) against the application ELF.
+
+.DESCRIPTION
+    Reads a binary dump of the crash record at CRASH_RECORD_START (0x1000FC00),
+    checks magic and CRC32, decodes the fault status registers and resolves PC,
+    LR and code addresses in the stack snapshot with addr2line.
+
+    Dump the record with J-Link Commander before the next fault overwrites it:
+        savebin crash.bin 0x1000FC00 0xF0
+
+.PARAMETER DumpFile
+    Binary dump of the crash record
+
+.PARAMETER ElfFile
+    Application ELF (.out) built from the same sources as the crashing image
+
+.PARAMETER Addr2Line
+    addr2line executable used to resolve addresses
+
+.EXAMPLE
+    .\decode_crash.ps1 -DumpFile crash.bin
+    .\decode_crash.ps1 -DumpFile crash.bin -ElfFile ..\..\EWARM\TKX_ThreadX\Exe\TKX_ThreadX.out
+#>
+
+param(
+    [Parameter(Mandatory = $true)]
+    [string]$DumpFile,
+    [string]$ElfFile = "",
+    [string]$Addr2Line = "arm-none-eabi-addr2line"
+)
+
+$ErrorActionPreference = "Stop"
+
+$Script:SCRIPT_DIR = $PSScriptRoot
+$Script:PROJECT_ROOT = (Get-Item "$Script:SCRIPT_DIR\..\..").FullName
+
+# 默认 ELF 路径 / Default ELF path
+if (-not $ElfFile) {
+    $ElfFile = Join-Path $Script:PROJECT_ROOT "EWARM\TKX_ThreadX\Exe\TKX_ThreadX.out"
+}
+
+#------------------------------------------------------------------------------
+# 记录布局 / Record Layout (keep in sync with safety_crash.h)
+#------------------------------------------------------------------------------
+$Script:CRASH_RECORD_MAGIC = [uint32]"0xC0A5DEAD"
+$Script:CRC32_POLYNOMIAL   = [uint32]"0x04C11DB7"
+$Script:STACK_WORDS_MAX    = 32
+$Script:RECORD_SIZE        = 0xF0
+$Script:APP_FLASH_START    = [uint32]"0x08010000"
+$Script:APP_FLASH_END      = [uint32]"0x0807FFFF"
+
+$errorNames = @{
+    0x0A = "MPU_FAULT"; 0x0B = "HARDFAULT"; 0x0C = "BUSFAULT"
+    0x0D = "USAGEFAULT"; 0x0E = "NMI"
+}
+
+$cfsrBits = [ordered]@{
+    0  = "IACCVIOL (instruction access violation)"
+    1  = "DACCVIOL (data access violation)"
+    3  = "MUNSTKERR (MemManage on unstacking)"
+    4  = "MSTKERR (MemManage on stacking)"
+    5  = "MLSPERR (MemManage on FP lazy state)"
+    7  = "MMARVALID (MMFAR valid)"
+    8  = "IBUSERR (instruction bus error)"
+    9  = "PRECISERR (precise data bus error)"
+    10 = "IMPRECISERR (imprecise data bus error)"
+    11 = "UNSTKERR (bus fault on unstacking)"
+    12 = "STKERR (bus fault on stacking)"
+    13 = "LSPERR (bus fault on FP lazy state)"
+    15 = "BFARVALID (BFAR valid)"
+    16 = "UNDEFINSTR (undefined instruction)"
+    17 = "INVSTATE (invalid EPSR state)"
+    18 = "INVPC (invalid EXC_RETURN)"
+    19 = "NOCP (no coprocessor)"
+    24 = "UNALIGNED (unaligned access)"
+    25 = "DIVBYZERO (divide by zero)"
+}
+
+$hfsrBits = [ordered]@{
+    1  = "VECTTBL (vector table read fault)"
+    30 = "FORCED (escalated configurable fault)"
+    31 = "DEBUGEVT (debug event)"
+}
+
+#------------------------------------------------------------------------------
+# 辅助函数 / Helper Functions
+#------------------------------------------------------------------------------
+function Get-Word([byte[]]$Data, [int]$Offset) {
+    return [BitConverter]::ToUInt32($Data, $Offset)
+}
+
+function Get-Crc32([byte[]]$Data, [int]$Words) {
+    # 与 STM32 硬件 CRC 相同 / Same as STM32 hardware CRC (MSB first, word-wise)
+    [uint32]$crc = [uint32]"0xFFFFFFFF"
+    for ($i = 0; $i -lt $Words; $i++) {
+        $crc = $crc -bxor (Get-Word $Data ($i * 4))
+        for ($bit = 0; $bit -lt 32; $bit++) {
+            if ($crc -band [uint32]"0x80000000") {
+                $crc = [uint32](([uint64]$crc -shl 1) -band 0xFFFFFFFF) -bxor $Script:CRC32_POLYNOMIAL
+            }
+            else {
+                $crc = [uint32](([uint64]$crc -shl 1) -band 0xFFFFFFFF)
+            }
+        }
+    }
+    return $crc
+}
+
+function Resolve-Address([uint32]$Address) {
+    if (-not $Script:CanResolve) {
+        return ""
+    }
+    $addr = "0x{0:X8}" -f ($Address -band [uint32]"0xFFFFFFFE")
+    $out = & $Addr2Line -f -C -e $ElfFile $addr 2>$null
+    if ($out -and $out.Count -ge 2) {
+        return "$($out[0]) ($($out[1]))"
+    }
+    return ""
+}
+
+function Test-CodeAddress([uint32]$Address) {
+    return ($Address -ge $Script:APP_FLASH_START) -and ($Address -le $Script:APP_FLASH_END)
+}
+
+function Write-Bits([string]$Name, [uint32]$Value, $Bits) {
+    Write-Host ("{0,-6} 0x{1:X8}" -f $Name, $Value)
+    foreach ($bit in $Bits.Keys) {
+        if ($Value -band ([uint32]1 -shl $bit)) {
+            Write-Host "         - $($Bits[$bit])"
+        }
+    }
+}
+
+#------------------------------------------------------------------------------
+# 读取记录 / Read Record
+#------------------------------------------------------------------------------
+if (-not (Test-Path $DumpFile)) {
+    Write-Error "转储文件不存在 / Dump file not found: $DumpFile"
+    exit 1
+}
+
+[byte[]]$data = [System.IO.File]::ReadAllBytes((Resolve-Path $DumpFile).Path)
+if ($data.Length -lt $Script:RECORD_SIZE) {
+    Write-Error "转储文件过短 / Dump too short: $($data.Length) < $Script:RECORD_SIZE bytes"
+    exit 1
+}
+
+$magic = Get-Word $data 0x00
+$crcStored = Get-Word $data 0xEC
+$crcCalc = Get-Crc32 $data (($Script:RECORD_SIZE / 4) - 1)
+
+if ($magic -ne $Script:CRASH_RECORD_MAGIC) {
+    Write-Error ("无有效崩溃记录 / No crash record (magic 0x{0:X8})" -f $magic)
+    exit 1
+}
+if ($crcStored -ne $crcCalc) {
+    Write-Warning ("CRC 不匹配 / CRC mismatch: stored 0x{0:X8}, calc 0x{1:X8}" -f $crcStored, $crcCalc)
+}
+
+$Script:CanResolve = (Test-Path $ElfFile) -and (Get-Command $Addr2Line -ErrorAction SilentlyContinue)
+if (-not $Script:CanResolve) {
+    Write-Warning "未找到 ELF 或 addr2line, 仅输出地址 / ELF or addr2line not found, addresses only"
+}
+
+#------------------------------------------------------------------------------
+# 输出 / Output
+#------------------------------------------------------------------------------
+$errorCode = Get-Word $data 0x04
+$errorName = if ($errorNames.ContainsKey([int]$errorCode)) { $errorNames[[int]$errorCode] } else { "UNKNOWN" }
+$regNames = @("R0", "R1", "R2", "R3", "R12", "LR", "PC", "xPSR")
+
+Write-Host "========== Crash Record =========="
+Write-Host ("Error       : 0x{0:X2} {1}" -f $errorCode, $errorName)
+Write-Host ("Time        : {0} ms" -f (Get-Word $data 0x08))
+Write-Host ("Crash count : {0} (reported: {1})" -f (Get-Word $data 0xE4), (Get-Word $data 0xE8))
+Write-Host ("EXC_RETURN  : 0x{0:X8}  MSP 0x{1:X8}  PSP 0x{2:X8}" -f `
+    (Get-Word $data 0x0C), (Get-Word $data 0x30), (Get-Word $data 0x34))
+
+$threadName = [System.Text.Encoding]::ASCII.GetString($data, 0x4C, 16).TrimEnd([char]0)
+Write-Host ("Thread      : {0} (0x{1:X8})" -f $(if ($threadName) { $threadName } else { "-" }), (Get-Word $data 0x48))
+
+Write-Host "--- Stacked Frame ---"
+for ($i = 0; $i -lt 8; $i++) {
+    $value = Get-Word $data (0x10 + ($i * 4))
+    $line = "{0,-6} 0x{1:X8}" -f $regNames[$i], $value
+    if (($regNames[$i] -eq "PC" -or $regNames[$i] -eq "LR") -and (Test-CodeAddress $value)) {
+        $line += "  " + (Resolve-Address $value)
+    }
+    Write-Host $line
+}
+
+Write-Host "--- Fault Status ---"
+Write-Bits "CFSR" (Get-Word $data 0x38) $cfsrBits
+Write-Bits "HFSR" (Get-Word $data 0x3C) $hfsrBits
+Write-Host ("MMFAR  0x{0:X8}" -f (Get-Word $data 0x40))
+Write-Host ("BFAR   0x{0:X8}" -f (Get-Word $data 0x44))
+
+$stackBase = Get-Word $data 0x5C
+$stackWords = [Math]::Min([int](Get-Word $data 0x60), $Script:STACK_WORDS_MAX)
+Write-Host "--- Stack Snapshot ($stackWords words) ---"
+for ($i = 0; $i -lt $stackWords; $i++) {
+    $value = Get-Word $data (0x64 + ($i * 4))
+    $line = "0x{0:X8}: 0x{1:X8}" -f ($stackBase + ($i * 4)), $value
+    # 可能的返回地址 / Possible return address (Thumb bit set)
+    if ((Test-CodeAddress $value) -and ($value -band 1)) {
+        $line += "  " + (Resolve-Address $value)
+    }
+    Write-Host $line
+}
+Write-Host "=================================="
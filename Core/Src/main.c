@@ -33,6 +33,7 @@
 #include "app_main.h"
 #include "safety_core.h"
 #include "safety_mpu.h"
+#include "safety_time.h"
 #include "SEGGER_RTT.h"
 /* USER CODE END Includes */
 
@@ -215,7 +216,10 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
     HAL_IncTick();
   }
   /* USER CODE BEGIN Callback 1 */
-
+  if (htim->Instance == TIM6) {
+    /* Keep the safety time base tracking CYCCNT wraps */
+    Safety_Time_Update();
+  }
   /* USER CODE END Callback 1 */
 }
 
@@ -24,6 +24,8 @@
 /* USER CODE BEGIN Includes */
 #include "wwdg.h"
 #include "safety_watchdog.h"
+#include "safety_core.h"
+#include "safety_crash.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -78,7 +80,12 @@ extern TIM_HandleTypeDef htim6;
 void NMI_Handler(void)
 {
   /* USER CODE BEGIN NonMaskableInt_IRQn 0 */
-
+#if CRASH_CAPTURE_ENABLED
+  /* Capture crash record and reset (must stay the first statement) */
+  SAFETY_CRASH_NMI_ENTRY();
+#else
+  Safety_NMIHandler();
+#endif
   /* USER CODE END NonMaskableInt_IRQn 0 */
   /* USER CODE BEGIN NonMaskableInt_IRQn 1 */
    while (1)
@@ -93,7 +100,12 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+#if CRASH_CAPTURE_ENABLED
+  /* Capture crash record and reset (must stay the first statement) */
+  SAFETY_CRASH_HARDFAULT_ENTRY();
+#else
+  Safety_HardFaultHandler();
+#endif
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -108,7 +120,12 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+#if CRASH_CAPTURE_ENABLED
+  /* Capture crash record and reset (must stay the first statement) */
+  SAFETY_CRASH_MPU_FAULT_ENTRY();
+#else
+  Safety_MemManageHandler();
+#endif
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -123,7 +140,12 @@ void MemManage_Handler(void)
 void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+#if CRASH_CAPTURE_ENABLED
+  /* Capture crash record and reset (must stay the first statement) */
+  SAFETY_CRASH_BUSFAULT_ENTRY();
+#else
+  Safety_BusFaultHandler();
+#endif
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
   {
@@ -138,7 +160,12 @@ void BusFault_Handler(void)
 void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+#if CRASH_CAPTURE_ENABLED
+  /* Capture crash record and reset (must stay the first statement) */
+  SAFETY_CRASH_USAGEFAULT_ENTRY();
+#else
+  Safety_UsageFaultHandler();
+#endif
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
   {
@@ -23,7 +23,10 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "app_azure_rtos_config.h"
+#if FX_W25Q_MEDIA_ENABLED || FX_W25Q_BENCHMARK_ENABLED
+#include "fx_stm32_levelx_nor_driver.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -33,7 +36,13 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#if FX_SD_MEDIA_ENABLED
+/* The FileX pool holds the SD cache and I/O buffers */
+typedef char fx_sd_pool_size[(FX_APP_MEM_POOL_SIZE >= FX_SD_POOL_SIZE) ? 1 : -1];
 
+/* An I/O unit read is not copied into the cache */
+typedef char fx_sd_io_sectors[(FX_SD_IO_SECTORS >= (FX_SD_CACHE_SECTORS / 4U)) ? 1 : -1];
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -43,12 +52,26 @@
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN PV */
+#if FX_W25Q_MEDIA_ENABLED
+static FX_MEDIA w25q_media;
+static ULONG w25q_media_memory[FX_W25Q_SECTOR_SIZE / sizeof(ULONG)];
+#endif
 
+#if FX_SD_MEDIA_ENABLED
+static FX_MEDIA sd_media;
+static TX_BYTE_POOL *fx_byte_pool = TX_NULL;
+static UCHAR *sd_media_memory = FX_NULL;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
-
+#if FX_SD_MEDIA_ENABLED && FX_SD_BENCHMARK_ENABLED
+static UINT fx_sd_bench_file(UCHAR *buffer, ULONG unit, ULONG size,
+                             ULONG *write_rate, ULONG *read_rate,
+                             ULONG *write_requests, ULONG *read_requests);
+static ULONG fx_sd_rate(ULONG bytes, ULONG ticks);
+#endif
 /* USER CODE END PFP */
 
 /**
@@ -62,15 +85,272 @@ UINT MX_FileX_Init(VOID *memory_ptr)
   TX_BYTE_POOL *byte_pool = (TX_BYTE_POOL*)memory_ptr;
 
   /* USER CODE BEGIN MX_FileX_MEM_POOL */
+#if FX_SD_MEDIA_ENABLED
+  /* SD sector cache: the pool is in SRAM (the SDIO DMA cannot reach CCM)
+     and its blocks are word aligned */
+  fx_byte_pool = byte_pool;
+  if (tx_byte_allocate(byte_pool, (VOID **)&sd_media_memory, FX_SD_CACHE_SIZE, TX_NO_WAIT) != TX_SUCCESS)
+  {
+    return TX_POOL_ERROR;
+  }
+
+  /* A misaligned pool buffer would send every sector through the driver's
+     scratch copy */
+  if (((ALIGN_TYPE)sd_media_memory & 3U) != 0U)
+  {
+    (void)tx_byte_release(sd_media_memory);
+    sd_media_memory = FX_NULL;
+    return TX_POOL_ERROR;
+  }
+#else
   (void)byte_pool;
+#endif
   /* USER CODE END MX_FileX_MEM_POOL */
 
   /* USER CODE BEGIN MX_FileX_Init */
-
+  fx_system_initialize();
+#if FX_W25Q_MEDIA_ENABLED || FX_W25Q_BENCHMARK_ENABLED
+  lx_nor_flash_initialize();
+#endif
   /* USER CODE END MX_FileX_Init */
   return ret;
 }
 
 /* USER CODE BEGIN 1 */
+#if FX_W25Q_MEDIA_ENABLED
+/**
+  * @brief  Open the W25Q128 media, formatting it on first use.
+  * @retval FX_SUCCESS or the FileX error
+  */
+UINT MX_FileX_W25qMount(void)
+{
+  UINT status;
+  UINT blank;
+
+  /* Before the open: LevelX then writes the erase count of every block */
+  blank = lx_stm32_nor_custom_driver_check_blank();
+
+  status = fx_media_open(&w25q_media, FX_W25Q_MEDIA_NAME, fx_stm32_levelx_nor_driver,
+                         (VOID *)LX_NOR_W25Q_DRIVER_ID, w25q_media_memory,
+                         sizeof(w25q_media_memory));
+
+  /* No FAT yet: an invalid boot record, or no boot record on a device
+     LevelX had never used. FX_BOOT_ERROR is also a driver I/O error, so
+     on a used device it is returned and the volume is left alone */
+  if ((status == FX_MEDIA_INVALID) || ((status == FX_BOOT_ERROR) && (blank == LX_SUCCESS)))
+  {
+    status = fx_media_format(&w25q_media, fx_stm32_levelx_nor_driver,
+                             (VOID *)LX_NOR_W25Q_DRIVER_ID,
+                             (UCHAR *)w25q_media_memory, sizeof(w25q_media_memory),
+                             FX_W25Q_MEDIA_NAME, 1, FX_W25Q_DIRECTORY_ENTRIES, 0,
+                             LX_NOR_W25Q_LOGICAL_SECTORS, FX_W25Q_SECTOR_SIZE, 1, 1, 1);
+    if (status == FX_SUCCESS)
+    {
+      status = fx_media_open(&w25q_media, FX_W25Q_MEDIA_NAME, fx_stm32_levelx_nor_driver,
+                             (VOID *)LX_NOR_W25Q_DRIVER_ID, w25q_media_memory,
+                             sizeof(w25q_media_memory));
+    }
+  }
+
+  return status;
+}
+
+/**
+  * @brief  Get the W25Q128 media.
+  * @retval FX_MEDIA* Media
+  */
+FX_MEDIA* MX_FileX_W25qMedia(void)
+{
+  return &w25q_media;
+}
+#endif
+
+#if FX_SD_MEDIA_ENABLED
+/**
+  * @brief  Open the SD card media with the pool sector cache.
+  * @param  driver FileX driver
+  * @retval FX_SUCCESS or the FileX error
+  */
+UINT MX_FileX_SdMount(VOID (*driver)(FX_MEDIA *media_ptr))
+{
+  if ((driver == FX_NULL) || (sd_media_memory == FX_NULL))
+  {
+    return FX_PTR_ERROR;
+  }
+
+  /* Not formatted here: the card may hold data of another host */
+  return fx_media_open(&sd_media, FX_SD_MEDIA_NAME, driver, FX_NULL,
+                       sd_media_memory, FX_SD_CACHE_SIZE);
+}
+
+/**
+  * @brief  Get the SD card media.
+  * @retval FX_MEDIA* Media
+  */
+FX_MEDIA* MX_FileX_SdMedia(void)
+{
+  return &sd_media;
+}
+
+/**
+  * @brief  Allocate a DMA-capable I/O buffer from the FileX byte pool.
+  * @param  size Bytes
+  * @retval VOID* Buffer, NULL if the pool is exhausted
+  */
+VOID* MX_FileX_SdAllocate(ULONG size)
+{
+  VOID *buffer = FX_NULL;
+
+  if ((fx_byte_pool == TX_NULL) || (size == 0U))
+  {
+    return FX_NULL;
+  }
 
+  if (tx_byte_allocate(fx_byte_pool, &buffer, size, TX_NO_WAIT) != TX_SUCCESS)
+  {
+    return FX_NULL;
+  }
+
+  return buffer;
+}
+
+#if FX_SD_BENCHMARK_ENABLED
+/**
+  * @brief  Measure sustained sequential write and read of a file, then the
+  *         same with one sector per call.
+  * @param  result Result (output)
+  * @retval FX_SUCCESS or the first FileX error
+  */
+UINT MX_FileX_SdBenchmark(fx_sd_benchmark_t *result)
+{
+  UCHAR *buffer;
+  ULONG write_requests;
+  ULONG read_requests;
+  UINT status;
+
+  if (result == FX_NULL)
+  {
+    return FX_PTR_ERROR;
+  }
+
+  buffer = (UCHAR *)MX_FileX_SdAllocate(FX_SD_IO_SIZE);
+  if (buffer == FX_NULL)
+  {
+    return FX_PTR_ERROR;
+  }
+
+  for (ULONG i = 0U; i < FX_SD_IO_SIZE; i++)
+  {
+    buffer[i] = (UCHAR)i;
+  }
+
+  status = fx_sd_bench_file(buffer, FX_SD_IO_SIZE, FX_SD_BENCH_SIZE,
+                            &result->write_rate, &result->read_rate,
+                            &result->write_requests, &result->read_requests);
+  if (status == FX_SUCCESS)
+  {
+    status = fx_sd_bench_file(buffer, FX_SD_SECTOR_SIZE, FX_SD_BENCH_SMALL_SIZE,
+                              &result->small_write_rate, &result->small_read_rate,
+                              &write_requests, &read_requests);
+  }
+
+  (void)tx_byte_release(buffer);
+
+  return status;
+}
+
+/**
+  * @brief  Write FX_SD_BENCH_FILE in units, read it back, then delete it.
+  */
+static UINT fx_sd_bench_file(UCHAR *buffer, ULONG unit, ULONG size,
+                             ULONG *write_rate, ULONG *read_rate,
+                             ULONG *write_requests, ULONG *read_requests)
+{
+  FX_FILE file;
+  ULONG start;
+  ULONG requests;
+  ULONG actual;
+  UINT status;
+  UINT close_status;
+
+  (void)fx_file_delete(&sd_media, FX_SD_BENCH_FILE);
+  status = fx_file_create(&sd_media, FX_SD_BENCH_FILE);
+  if (status == FX_SUCCESS)
+  {
+    status = fx_file_open(&sd_media, &file, FX_SD_BENCH_FILE, FX_OPEN_FOR_WRITE);
+  }
+
+  /* Write: clusters allocated at once (with FX_FAULT_TOLERANT, an append
+     that allocates writes the FAT at once too), then whole units */
+  if (status == FX_SUCCESS)
+  {
+    requests = sd_media.fx_media_driver_write_requests;
+    start = tx_time_get();
+    status = fx_file_allocate(&file, size);
+    for (ULONG offset = 0U; (offset < size) && (status == FX_SUCCESS); offset += unit)
+    {
+      status = fx_file_write(&file, buffer, unit);
+    }
+    if (status == FX_SUCCESS)
+    {
+      status = fx_media_flush(&sd_media);
+    }
+    *write_rate = fx_sd_rate(size, tx_time_get() - start);
+    *write_requests = sd_media.fx_media_driver_write_requests - requests;
+
+    close_status = fx_file_close(&file);
+    if (status == FX_SUCCESS)
+    {
+      status = close_status;
+    }
+  }
+
+  /* Read back the same units */
+  if (status == FX_SUCCESS)
+  {
+    status = fx_file_open(&sd_media, &file, FX_SD_BENCH_FILE, FX_OPEN_FOR_READ);
+  }
+
+  if (status == FX_SUCCESS)
+  {
+    requests = sd_media.fx_media_driver_read_requests;
+    start = tx_time_get();
+    for (ULONG offset = 0U; (offset < size) && (status == FX_SUCCESS); offset += unit)
+    {
+      status = fx_file_read(&file, buffer, unit, &actual);
+      if ((status == FX_SUCCESS) && (actual != unit))
+      {
+        status = FX_END_OF_FILE;
+      }
+    }
+    *read_rate = fx_sd_rate(size, tx_time_get() - start);
+    *read_requests = sd_media.fx_media_driver_read_requests - requests;
+
+    close_status = fx_file_close(&file);
+    if (status == FX_SUCCESS)
+    {
+      status = close_status;
+    }
+  }
+
+  (void)fx_file_delete(&sd_media, FX_SD_BENCH_FILE);
+  (void)fx_media_flush(&sd_media);
+
+  return status;
+}
+
+/**
+  * @brief  Convert bytes moved in ThreadX ticks to kB/s.
+  */
+static ULONG fx_sd_rate(ULONG bytes, ULONG ticks)
+{
+  if (ticks == 0U)
+  {
+    return 0U;
+  }
+
+  return (ULONG)(((ULONG64)bytes * TX_TIMER_TICKS_PER_SECOND) / ((ULONG64)ticks * 1000U));
+}
+#endif
+#endif
 /* USER CODE END 1 */
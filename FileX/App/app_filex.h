@@ -37,11 +37,62 @@ extern "C" {
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
 
+/**
+  * @brief  SD media benchmark result
+  */
+typedef struct
+{
+  ULONG write_rate;             /* kB/s, fx_file_allocate then FX_SD_IO_SIZE per fx_file_write */
+  ULONG read_rate;              /* kB/s, FX_SD_IO_SIZE per fx_file_read */
+  ULONG write_requests;         /* Driver write requests for the file data */
+  ULONG read_requests;          /* Driver read requests for the file data */
+  ULONG small_write_rate;       /* kB/s, FX_SD_SECTOR_SIZE per fx_file_write */
+  ULONG small_read_rate;        /* kB/s, FX_SD_SECTOR_SIZE per fx_file_read */
+} fx_sd_benchmark_t;
+
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
 
+/* File system on the W25Q128 through LevelX (lx_stm32_nor_custom_driver),
+   needs the LevelX component and fx_stm32_levelx_nor_driver.c in the build */
+#define FX_W25Q_MEDIA_ENABLED           0
+#ifndef FX_W25Q_BENCHMARK_ENABLED
+#define FX_W25Q_BENCHMARK_ENABLED       0   /* LevelX on a RAM-simulated NOR */
+#endif
+
+#define FX_W25Q_MEDIA_NAME              "W25Q"
+#define FX_W25Q_SECTOR_SIZE             512U
+#define FX_W25Q_DIRECTORY_ENTRIES       64U
+
+/* File system on the SD card (fx_stm32_sd_driver, SDIO DMA). The sector
+   cache and the I/O buffers come from the FileX byte pool (SRAM, word
+   aligned), so the driver never falls back to its one-sector scratch copy */
+#define FX_SD_MEDIA_ENABLED             1
+#define FX_SD_BENCHMARK_ENABLED         0   /* Sequential file write/read at start-up */
+
+#define FX_SD_MEDIA_NAME                "SD"
+#define FX_SD_SECTOR_SIZE               512U
+#define FX_SD_CACHE_SECTORS             16U     /* Power of 2, >= 16: hashed lookup */
+#define FX_SD_CACHE_SIZE                (FX_SD_CACHE_SECTORS * FX_SD_SECTOR_SIZE)
+
+/* Sequential I/O unit: whole sectors at a sector-aligned file offset are
+   transferred by the DMA straight to or from the caller's buffer, and from
+   FX_SD_CACHE_SECTORS / 4 sectors on a read is not copied into the cache */
+#define FX_SD_IO_SECTORS                8U
+#define FX_SD_IO_SIZE                   (FX_SD_IO_SECTORS * FX_SD_SECTOR_SIZE)
+#define FX_SD_IO_BUFFERS                2U      /* Room in the pool for MX_FileX_SdAllocate */
+
+/* FileX byte pool use (tx_byte_allocate adds two pointers per block) */
+#define FX_SD_POOL_BLOCK_OVERHEAD       (2U * sizeof(VOID *))
+#define FX_SD_POOL_SIZE                 (FX_SD_CACHE_SIZE + FX_SD_POOL_BLOCK_OVERHEAD + \
+                                         (FX_SD_IO_BUFFERS * (FX_SD_IO_SIZE + FX_SD_POOL_BLOCK_OVERHEAD)))
+
+#define FX_SD_BENCH_FILE                "SDBENCH.BIN"
+#define FX_SD_BENCH_SIZE                (1024U * 1024U)     /* Bytes written, then read */
+#define FX_SD_BENCH_SMALL_SIZE          (128U * 1024U)      /* Same, one sector per call */
+
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
@@ -53,7 +104,63 @@ extern "C" {
 UINT MX_FileX_Init(VOID *memory_ptr);
 
 /* USER CODE BEGIN EFP */
+#if FX_W25Q_MEDIA_ENABLED
+/**
+  * @brief  Open the W25Q128 media, formatting it on first use.
+  * @retval FX_SUCCESS or the FileX error
+  * @note   Thread context, after BSP_W25QXX_Init. Formats only on
+  *         FX_MEDIA_INVALID, or on FX_BOOT_ERROR when LevelX had never
+  *         used the device; any other FX_BOOT_ERROR is returned
+  */
+UINT MX_FileX_W25qMount(void);
+
+/**
+  * @brief  Get the W25Q128 media.
+  * @retval FX_MEDIA* Media, open after MX_FileX_W25qMount succeeded
+  */
+FX_MEDIA* MX_FileX_W25qMedia(void);
+#endif
 
+#if FX_SD_MEDIA_ENABLED
+/**
+  * @brief  Open the SD card media with the pool sector cache.
+  * @param  driver FileX driver: fx_stm32_sd_driver, or a block device
+  *         file on a host
+  * @retval FX_SUCCESS or the FileX error (the card is not formatted)
+  * @note   Thread context, after MX_FileX_Init
+  */
+UINT MX_FileX_SdMount(VOID (*driver)(FX_MEDIA *media_ptr));
+
+/**
+  * @brief  Get the SD card media.
+  * @retval FX_MEDIA* Media, open after MX_FileX_SdMount succeeded
+  */
+FX_MEDIA* MX_FileX_SdMedia(void);
+
+/**
+  * @brief  Allocate a DMA-capable I/O buffer from the FileX byte pool.
+  * @param  size Bytes, a multiple of FX_SD_SECTOR_SIZE for direct transfers
+  * @retval VOID* Word-aligned buffer, NULL if the pool is exhausted
+  * @note   Released with tx_byte_release; the pool holds FX_SD_IO_BUFFERS
+  *         of FX_SD_IO_SIZE
+  */
+VOID* MX_FileX_SdAllocate(ULONG size);
+
+#if FX_SD_BENCHMARK_ENABLED
+/**
+  * @brief  Measure sustained sequential write and read of a file.
+  * @param  result Result (output)
+  * @retval FX_SUCCESS or the first FileX error
+  * @note   Writes FX_SD_BENCH_SIZE bytes to FX_SD_BENCH_FILE in
+  *         FX_SD_IO_SIZE blocks (preallocated, as a sequential writer
+  *         should), reads them back, then deletes the file. Then the same
+  *         with FX_SD_BENCH_SMALL_SIZE bytes in FX_SD_SECTOR_SIZE calls
+  *         (served by the block cache of the SD glue).
+  *         Timed by the ThreadX tick.
+  */
+UINT MX_FileX_SdBenchmark(fx_sd_benchmark_t *result);
+#endif
+#endif
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
@@ -0,0 +1,54 @@
+/**************************************************************************/
+/*                                                                        */
+/*       Copyright (c) Microsoft Corporation. All rights reserved.        */
+/*                                                                        */
+/*       This software is licensed under the Microsoft Software License   */
+/*       Terms for Microsoft Azure RTOS. Full text of the license can be  */
+/*       found in the LICENSE file at https://aka.ms/AzureRTOS_EULA       */
+/*       and in the root directory of this software.                      */
+/*                                                                        */
+/**************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FX_STM32_LEVELX_NOR_DRIVER_H
+#define FX_STM32_LEVELX_NOR_DRIVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "fx_api.h"
+#include "lx_api.h"
+
+/* USER CODE BEGIN Includes */
+#include "lx_stm32_nor_custom_driver.h"
+/* USER CODE END Includes */
+
+/* Exported constants --------------------------------------------------------*/
+
+/* The W25Q128 is the only NOR device: one custom driver, selected by the
+   driver info passed to fx_media_open/fx_media_format */
+#define LX_NOR_CUSTOM_DRIVER
+
+/* USER CODE BEGIN EC */
+#define LX_NOR_W25Q_DRIVER_ID                            0x01U
+#define LX_NOR_W25Q_DRIVER_NAME                          "W25Q128 NOR"
+/* USER CODE END EC */
+
+#define LX_NOR_CUSTOM_DRIVERS                            { .name = LX_NOR_W25Q_DRIVER_NAME, \
+                                                           .id = LX_NOR_W25Q_DRIVER_ID, \
+                                                           .nor_driver_initialize = lx_stm32_nor_custom_driver_initialize }
+
+#define NOR_DEFAULT_DRIVER                               LX_NOR_W25Q_DRIVER_ID
+#define MAX_LX_NOR_DRIVERS                               1
+#define UNKNOWN_DRIVER_ID                                0xFFFFFFFFUL
+
+/* Exported functions prototypes ---------------------------------------------*/
+VOID fx_stm32_levelx_nor_driver(FX_MEDIA *media_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FX_STM32_LEVELX_NOR_DRIVER_H */
@@ -28,6 +28,21 @@ extern "C" {
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
 
+/**
+ * @brief Block cache statistics (requests from the driver, SD commands issued)
+ */
+typedef struct
+{
+  ULONG read_hits;              /* Reads served from the read-ahead window */
+  ULONG read_prefetches;        /* Window loads (one multi-block read each) */
+  ULONG read_direct;            /* Reads transferred to the caller's buffer */
+  ULONG write_merged;           /* Writes appended to the write-behind run */
+  ULONG write_runs;             /* Runs written (one multi-block write each) */
+  ULONG write_direct;           /* Writes of FX_STM32_SD_WRITE_BEHIND_BLOCKS or more */
+  ULONG flushes;                /* FX_DRIVER_FLUSH requests */
+  ULONG errors;                 /* Failed transfers, write-behind ones included */
+} fx_stm32_sd_cache_stats_t;
+
 /* USER CODE END ET */
 
 extern TX_SEMAPHORE transfer_semaphore;
@@ -51,6 +66,17 @@ extern TX_SEMAPHORE transfer_semaphore;
 
 /* USER CODE BEGIN EC */
 
+/* Block cache in the glue: sequential small reads are served from a
+   read-ahead window, small writes are merged into a write-behind run that
+   is written asynchronously. Open the media with fx_stm32_sd_cache_driver,
+   which writes the run out on FX_DRIVER_FLUSH (fx_media_flush/close) */
+#ifndef FX_STM32_SD_BLOCK_CACHE
+#define FX_STM32_SD_BLOCK_CACHE                          1
+#endif
+
+#define FX_STM32_SD_READ_AHEAD_BLOCKS                    16U     /* Window, loaded on the 2nd sequential read */
+#define FX_STM32_SD_WRITE_BEHIND_BLOCKS                  8U      /* Run, two buffers (one in flight) */
+
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
@@ -189,6 +215,32 @@ VOID fx_stm32_sd_driver(FX_MEDIA *media_ptr);
 
 /* USER CODE BEGIN EFP */
 
+/**
+ * @brief FileX driver entry for the SD card through the block cache
+ * @param media_ptr FileX media
+ * @note  Flushes the write-behind run on FX_DRIVER_FLUSH and
+ *        FX_DRIVER_UNINIT, drops the cache on FX_DRIVER_INIT and
+ *        FX_DRIVER_ABORT, then calls fx_stm32_sd_driver. Without
+ *        FX_STM32_SD_BLOCK_CACHE it only calls fx_stm32_sd_driver.
+ */
+VOID fx_stm32_sd_cache_driver(FX_MEDIA *media_ptr);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+/**
+ * @brief Write the write-behind run out and wait for it
+ * @param instance SD instance
+ * @retval 0 on success (all writes so far are on the card), 1 otherwise
+ * @note  Reports a failure of an earlier asynchronous write once
+ */
+INT fx_stm32_sd_flush(UINT instance);
+
+/**
+ * @brief Get the block cache statistics
+ * @retval const fx_stm32_sd_cache_stats_t* Statistics since start-up
+ */
+const fx_stm32_sd_cache_stats_t *fx_stm32_sd_cache_get_stats(VOID);
+#endif
+
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
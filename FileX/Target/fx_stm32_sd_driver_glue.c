@@ -17,7 +17,50 @@ extern SD_HandleTypeDef hsd;
 extern void MX_SDIO_SD_Init(void);
 
 /* USER CODE BEGIN 0 */
-
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+#include <string.h>
+
+/*
+ * Block cache between fx_stm32_sd_driver and the HAL. Each request still
+ * completes before the glue returns (transfer_semaphore is put here), but:
+ *   - a read following the previous one loads FX_STM32_SD_READ_AHEAD_BLOCKS
+ *     with one command, and the next reads are copied from that window;
+ *   - writes appended to the previous one are merged into a run of up to
+ *     FX_STM32_SD_WRITE_BEHIND_BLOCKS, written with one command while the
+ *     next run fills the other buffer.
+ * Any other write sends the run first, so the card always holds a prefix
+ * of the writes issued (what FX_FAULT_TOLERANT relies on); they are all on
+ * the card after FX_DRIVER_FLUSH. The HAL callbacks put dma_semaphore.
+ * fx_stm32_sd_get_status reports ready while a run is in flight.
+ */
+
+#define SD_BLOCK_WORDS          (FX_STM32_SD_DEFAULT_SECTOR_SIZE / sizeof(ULONG))
+
+/* Window and runs, word aligned for the DMA (not in CCM) */
+static ULONG read_ahead[FX_STM32_SD_READ_AHEAD_BLOCKS * SD_BLOCK_WORDS];
+static UINT read_ahead_start = 0U;
+static UINT read_ahead_count = 0U;          /* 0 when empty */
+static UINT read_next = 0U;                 /* Block after the previous read */
+
+static ULONG write_behind[2][FX_STM32_SD_WRITE_BEHIND_BLOCKS * SD_BLOCK_WORDS];
+static UINT write_fill = 0U;                /* Buffer of the run being merged */
+static UINT write_start = 0U;
+static UINT write_count = 0U;               /* 0 when no run */
+static UINT write_busy = 0U;                /* The other buffer is being written */
+static UINT write_error = 0U;               /* An asynchronous write failed, not reported yet */
+
+static TX_SEMAPHORE dma_semaphore;
+static UINT dma_semaphore_created = 0U;
+static fx_stm32_sd_cache_stats_t cache_stats;
+
+static INT sd_cache_read(UINT *buffer, UINT start_block, UINT total_blocks);
+static INT sd_cache_write(UINT *buffer, UINT start_block, UINT total_blocks);
+static INT sd_cache_transfer(UINT write, UINT *buffer, UINT start_block, UINT total_blocks);
+static VOID sd_cache_issue_run(VOID);
+static VOID sd_cache_wait_write(VOID);
+static INT sd_cache_wait_ready(VOID);
+static VOID sd_cache_drop(VOID);
+#endif
 /* USER CODE END 0 */
 
 /**
@@ -31,6 +74,17 @@ INT fx_stm32_sd_init(UINT instance)
 
   /* USER CODE BEGIN PRE_FX_SD_INIT */
   UNUSED(instance);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  if (dma_semaphore_created == 0U)
+  {
+    if (tx_semaphore_create(&dma_semaphore, "sd dma semaphore", 0) != TX_SUCCESS)
+    {
+      return 1;
+    }
+    dma_semaphore_created = 1U;
+  }
+#endif
   /* USER CODE END PRE_FX_SD_INIT */
 
 #if (FX_STM32_SD_INIT == 1)
@@ -55,6 +109,10 @@ INT fx_stm32_sd_deinit(UINT instance)
 
   /* USER CODE BEGIN PRE_FX_SD_DEINIT */
   UNUSED(instance);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  sd_cache_wait_write();
+#endif
   /* USER CODE END PRE_FX_SD_DEINIT */
 
   if(HAL_SD_DeInit(&hsd) != HAL_OK)
@@ -80,6 +138,16 @@ INT fx_stm32_sd_get_status(UINT instance)
 
   /* USER CODE BEGIN PRE_GET_STATUS */
   UNUSED(instance);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  /* No CMD13 while a run is on the bus, and no wait either: the request
+     may be served by the cache while the run completes. The glue waits
+     for the run and for the card before its next command */
+  if (write_busy != 0U)
+  {
+    return ret;
+  }
+#endif
   /* USER CODE END PRE_GET_STATUS */
 
   if(HAL_SD_GetCardState(&hsd) != HAL_SD_CARD_TRANSFER)
@@ -108,6 +176,10 @@ INT fx_stm32_sd_read_blocks(UINT instance, UINT *buffer, UINT start_block, UINT
 
   /* USER CODE BEGIN PRE_READ_BLOCKS */
   UNUSED(instance);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  return sd_cache_read(buffer, start_block, total_blocks);
+#endif
   /* USER CODE END PRE_READ_BLOCKS */
 
   if(HAL_SD_ReadBlocks_DMA(&hsd, (uint8_t *)buffer, start_block, total_blocks) != HAL_OK)
@@ -136,6 +208,10 @@ INT fx_stm32_sd_write_blocks(UINT instance, UINT *buffer, UINT start_block, UINT
 
   /* USER CODE BEGIN PRE_WRITE_BLOCKS */
   UNUSED(instance);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  return sd_cache_write(buffer, start_block, total_blocks);
+#endif
   /* USER CODE END PRE_WRITE_BLOCKS */
 
   if(HAL_SD_WriteBlocks_DMA(&hsd, (uint8_t *)buffer, start_block, total_blocks) != HAL_OK)
@@ -158,7 +234,11 @@ INT fx_stm32_sd_write_blocks(UINT instance, UINT *buffer, UINT start_block, UINT
 void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd)
 {
   /* USER CODE BEGIN PRE_TX_CMPLT */
-
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  /* The glue waits for its transfers and completes the request itself */
+  tx_semaphore_put(&dma_semaphore);
+  return;
+#endif
   /* USER CODE END PRE_TX_CMPLT */
 
   tx_semaphore_put(&transfer_semaphore);
@@ -176,7 +256,10 @@ void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd)
 void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd)
 {
   /* USER CODE BEGIN PRE_RX_CMPLT */
-
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  tx_semaphore_put(&dma_semaphore);
+  return;
+#endif
   /* USER CODE END PRE_RX_CMPLT */
 
   tx_semaphore_put(&transfer_semaphore);
@@ -188,4 +271,363 @@ void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd)
 
 /* USER CODE BEGIN 1 */
 
+/**
+* @brief FileX driver entry for the SD card through the block cache
+* @param FX_MEDIA *media_ptr FileX media
+* @retval None
+*/
+VOID fx_stm32_sd_cache_driver(FX_MEDIA *media_ptr)
+{
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+  UINT flush_failed = 0U;
+
+  switch (media_ptr->fx_media_driver_request)
+  {
+    case FX_DRIVER_INIT:
+    case FX_DRIVER_ABORT:
+      sd_cache_drop();
+      break;
+
+    case FX_DRIVER_FLUSH:
+    case FX_DRIVER_UNINIT:
+      flush_failed = (fx_stm32_sd_flush(FX_STM32_SD_INSTANCE) != 0) ? 1U : 0U;
+      break;
+
+    default:
+      break;
+  }
+
+  fx_stm32_sd_driver(media_ptr);
+
+  if (flush_failed != 0U)
+  {
+    media_ptr->fx_media_driver_status = FX_IO_ERROR;
+  }
+#else
+  fx_stm32_sd_driver(media_ptr);
+#endif
+}
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+/**
+* @brief Write the write-behind run out and wait for it
+* @param UINT instance SD instance
+* @retval 0 on success error value otherwise
+*/
+INT fx_stm32_sd_flush(UINT instance)
+{
+  UNUSED(instance);
+
+  cache_stats.flushes++;
+
+  sd_cache_issue_run();
+  sd_cache_wait_write();
+
+  /* Programmed once the card is back in transfer state */
+  if ((write_error == 0U) && (sd_cache_wait_ready() != 0))
+  {
+    cache_stats.errors++;
+    write_error = 1U;
+  }
+
+  if (write_error != 0U)
+  {
+    write_error = 0U;
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+* @brief Get the block cache statistics
+* @retval const fx_stm32_sd_cache_stats_t* Statistics since start-up
+*/
+const fx_stm32_sd_cache_stats_t *fx_stm32_sd_cache_get_stats(VOID)
+{
+  return &cache_stats;
+}
+
+/**
+* @brief Error callback: ends the wait of the transfer in progress
+* @param SD_HandleTypeDef *hsd
+* @retval None
+*/
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd)
+{
+  UNUSED(hsd);
+
+  tx_semaphore_put(&dma_semaphore);
+}
+
+/**
+* @brief Read through the read-ahead window
+* @param UINT *buffer destination buffer (word aligned)
+* @param UINT start_block first block to read
+* @param UINT total_blocks blocks to read
+* @retval 0 on success error value otherwise
+*/
+static INT sd_cache_read(UINT *buffer, UINT start_block, UINT total_blocks)
+{
+  INT ret = 0;
+  UINT load_start = start_block;
+  UINT load_count = total_blocks;
+  UINT sequential = (start_block == read_next) ? 1U : 0U;
+
+  read_next = start_block + total_blocks;
+
+  if ((read_ahead_count > 0U) && (start_block >= read_ahead_start) &&
+      (start_block + total_blocks <= read_ahead_start + read_ahead_count))
+  {
+    memcpy(buffer, &read_ahead[(start_block - read_ahead_start) * SD_BLOCK_WORDS],
+           total_blocks * FX_STM32_SD_DEFAULT_SECTOR_SIZE);
+    cache_stats.read_hits++;
+    tx_semaphore_put(&transfer_semaphore);
+    return 0;
+  }
+
+  /* Sequential small reads load the window from the requested block */
+  if ((sequential != 0U) && (total_blocks < FX_STM32_SD_READ_AHEAD_BLOCKS))
+  {
+    load_count = FX_STM32_SD_READ_AHEAD_BLOCKS;
+    if (load_start + load_count > hsd.SdCard.LogBlockNbr)
+    {
+      load_count = hsd.SdCard.LogBlockNbr - load_start;
+    }
+  }
+
+  /* The card must hold the merged writes of the blocks loaded */
+  if ((write_count > 0U) && (load_start < write_start + write_count) &&
+      (load_start + load_count > write_start))
+  {
+    sd_cache_issue_run();
+  }
+
+  if (load_count > total_blocks)
+  {
+    read_ahead_count = 0U;
+    ret = sd_cache_transfer(0U, (UINT *)read_ahead, load_start, load_count);
+    if (ret == 0)
+    {
+      read_ahead_start = load_start;
+      read_ahead_count = load_count;
+      memcpy(buffer, read_ahead, total_blocks * FX_STM32_SD_DEFAULT_SECTOR_SIZE);
+    }
+    cache_stats.read_prefetches++;
+  }
+  else
+  {
+    ret = sd_cache_transfer(0U, buffer, start_block, total_blocks);
+    cache_stats.read_direct++;
+  }
+
+  if (ret == 0)
+  {
+    tx_semaphore_put(&transfer_semaphore);
+  }
+
+  return ret;
+}
+
+/**
+* @brief Write through the write-behind run
+* @param UINT *buffer source buffer (word aligned)
+* @param UINT start_block first block to write
+* @param UINT total_blocks blocks to write
+* @retval 0 on success error value otherwise (a failed asynchronous write is
+*         reported with the next write)
+*/
+static INT sd_cache_write(UINT *buffer, UINT start_block, UINT total_blocks)
+{
+  INT ret = 0;
+
+  if ((read_ahead_count > 0U) && (start_block < read_ahead_start + read_ahead_count) &&
+      (start_block + total_blocks > read_ahead_start))
+  {
+    read_ahead_count = 0U;
+  }
+
+  if (total_blocks >= FX_STM32_SD_WRITE_BEHIND_BLOCKS)
+  {
+    sd_cache_issue_run();
+    ret = sd_cache_transfer(1U, buffer, start_block, total_blocks);
+    cache_stats.write_direct++;
+  }
+  else
+  {
+    /* Only appends are merged: no block of the run is rewritten in place */
+    if ((write_count > 0U) && ((start_block != write_start + write_count) ||
+        (write_count + total_blocks > FX_STM32_SD_WRITE_BEHIND_BLOCKS)))
+    {
+      sd_cache_issue_run();
+    }
+
+    if (write_count == 0U)
+    {
+      write_start = start_block;
+    }
+
+    memcpy(&write_behind[write_fill][write_count * SD_BLOCK_WORDS], buffer,
+           total_blocks * FX_STM32_SD_DEFAULT_SECTOR_SIZE);
+    write_count += total_blocks;
+    cache_stats.write_merged++;
+
+    if (write_count == FX_STM32_SD_WRITE_BEHIND_BLOCKS)
+    {
+      sd_cache_issue_run();
+    }
+  }
+
+  if (write_error != 0U)
+  {
+    write_error = 0U;
+    ret = 1;
+  }
+
+  if (ret == 0)
+  {
+    tx_semaphore_put(&transfer_semaphore);
+  }
+
+  return ret;
+}
+
+/**
+* @brief Transfer blocks with DMA and wait for the completion
+* @param UINT write 1 to write, 0 to read
+* @param UINT *buffer data buffer (word aligned)
+* @param UINT start_block first block
+* @param UINT total_blocks blocks to transfer
+* @retval 0 on success error value otherwise
+*/
+static INT sd_cache_transfer(UINT write, UINT *buffer, UINT start_block, UINT total_blocks)
+{
+  HAL_StatusTypeDef hal_status;
+
+  sd_cache_wait_write();
+
+  if (sd_cache_wait_ready() != 0)
+  {
+    cache_stats.errors++;
+    return 1;
+  }
+
+  if (write != 0U)
+  {
+    hal_status = HAL_SD_WriteBlocks_DMA(&hsd, (uint8_t *)buffer, start_block, total_blocks);
+  }
+  else
+  {
+    hal_status = HAL_SD_ReadBlocks_DMA(&hsd, (uint8_t *)buffer, start_block, total_blocks);
+  }
+
+  if (hal_status != HAL_OK)
+  {
+    cache_stats.errors++;
+    return 1;
+  }
+
+  if ((tx_semaphore_get(&dma_semaphore, FX_STM32_SD_DEFAULT_TIMEOUT) != TX_SUCCESS) ||
+      (hsd.ErrorCode != HAL_SD_ERROR_NONE))
+  {
+    (void)HAL_SD_Abort(&hsd);
+    while (tx_semaphore_get(&dma_semaphore, TX_NO_WAIT) == TX_SUCCESS)
+    {
+    }
+    cache_stats.errors++;
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+* @brief Start writing the run and switch to the other buffer
+* @retval None
+*/
+static VOID sd_cache_issue_run(VOID)
+{
+  if (write_count == 0U)
+  {
+    return;
+  }
+
+  /* The other buffer is free once its write completed */
+  sd_cache_wait_write();
+
+  if ((sd_cache_wait_ready() == 0) &&
+      (HAL_SD_WriteBlocks_DMA(&hsd, (uint8_t *)write_behind[write_fill], write_start, write_count) == HAL_OK))
+  {
+    write_busy = 1U;
+  }
+  else
+  {
+    cache_stats.errors++;
+    write_error = 1U;
+  }
+
+  cache_stats.write_runs++;
+  write_fill ^= 1U;
+  write_count = 0U;
+}
+
+/**
+* @brief Wait for the run in flight, if any
+* @retval None
+*/
+static VOID sd_cache_wait_write(VOID)
+{
+  if (write_busy == 0U)
+  {
+    return;
+  }
+
+  write_busy = 0U;
+
+  if ((tx_semaphore_get(&dma_semaphore, FX_STM32_SD_DEFAULT_TIMEOUT) != TX_SUCCESS) ||
+      (hsd.ErrorCode != HAL_SD_ERROR_NONE))
+  {
+    (void)HAL_SD_Abort(&hsd);
+    while (tx_semaphore_get(&dma_semaphore, TX_NO_WAIT) == TX_SUCCESS)
+    {
+    }
+    cache_stats.errors++;
+    write_error = 1U;
+  }
+}
+
+/**
+* @brief Wait for the card to be ready for data (transfer state)
+* @retval 0 when ready, 1 on timeout
+*/
+static INT sd_cache_wait_ready(VOID)
+{
+  ULONG start = FX_STM32_SD_CURRENT_TIME();
+
+  while (HAL_SD_GetCardState(&hsd) != HAL_SD_CARD_TRANSFER)
+  {
+    if ((FX_STM32_SD_CURRENT_TIME() - start) >= FX_STM32_SD_DEFAULT_TIMEOUT)
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+* @brief Forget the window and the run (media opened or removed)
+* @retval None
+*/
+static VOID sd_cache_drop(VOID)
+{
+  sd_cache_wait_write();
+
+  read_ahead_count = 0U;
+  read_next = 0U;
+  write_count = 0U;
+  write_error = 0U;
+}
+#endif
+
 /* USER CODE END 1 */
@@ -0,0 +1,426 @@
+/**************************************************************************/
+/*                                                                        */
+/*       Copyright (c) Microsoft Corporation. All rights reserved.        */
+/*                                                                        */
+/*       This software is licensed under the Microsoft Software License   */
+/*       Terms for Microsoft Azure RTOS. Full text of the license can be  */
+/*       found in the LICENSE file at https://aka.ms/AzureRTOS_EULA       */
+/*       and in the root directory of this software.                      */
+/*                                                                        */
+/**************************************************************************/
+
+#include "lx_stm32_nor_custom_driver.h"
+
+/* USER CODE BEGIN Includes */
+#include "app_filex.h"
+#include "safety_time.h"
+#include <string.h>
+/* USER CODE END Includes */
+
+/* Private define ------------------------------------------------------------*/
+/* USER CODE BEGIN PD */
+
+/* The W25Q128 is not memory mapped: LevelX addresses are Flash offsets */
+#define LX_NOR_W25Q_OFFSET(address)     ((uint32_t)(address))
+
+/* Erased check in chunks the size of the driver read cache line */
+#define LX_NOR_W25Q_VERIFY_CHUNK        W25Q128_PAGE_SIZE
+
+/* USER CODE END PD */
+
+/* Private variables ---------------------------------------------------------*/
+/* USER CODE BEGIN PV */
+
+#ifndef LX_DIRECT_READ
+static ULONG nor_sector_memory[LX_NOR_SECTOR_SIZE];
+#endif
+
+static UCHAR verify_buffer[LX_NOR_W25Q_VERIFY_CHUNK];
+
+/* Last LevelX system error, for diagnostics */
+static UINT system_errors = 0U;
+static UINT last_system_error = LX_SUCCESS;
+
+#if FX_W25Q_BENCHMARK_ENABLED
+static ULONG sim_memory[(LX_NOR_W25Q_SIM_BLOCKS * LX_NOR_W25Q_BLOCK_SIZE) / sizeof(ULONG)];
+static LX_NOR_FLASH sim_flash;
+static ULONG sim_erases = 0U;
+static ULONG sim_words_written = 0U;
+#endif
+
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+static UINT lx_nor_driver_read(ULONG *flash_address, ULONG *destination, ULONG words);
+static UINT lx_nor_driver_write(ULONG *flash_address, ULONG *source, ULONG words);
+static UINT lx_nor_driver_block_erase(ULONG block, ULONG erase_count);
+static UINT lx_nor_driver_block_erased_verify(ULONG block);
+static UINT lx_nor_driver_system_error(UINT error_code);
+
+/* USER CODE BEGIN PFP */
+#if FX_W25Q_BENCHMARK_ENABLED
+static UINT lx_nor_sim_read(ULONG *flash_address, ULONG *destination, ULONG words);
+static UINT lx_nor_sim_write(ULONG *flash_address, ULONG *source, ULONG words);
+static UINT lx_nor_sim_block_erase(ULONG block, ULONG erase_count);
+static UINT lx_nor_sim_block_erased_verify(ULONG block);
+#endif
+/* USER CODE END PFP */
+
+/* W25Q128 blocks must fit the device below the KV store */
+typedef char lx_nor_w25q_area_fits[
+  (((LX_NOR_W25Q_BASE % LX_NOR_W25Q_BLOCK_SIZE) == 0U) &&
+   ((LX_NOR_W25Q_BASE + LX_NOR_W25Q_SIZE) <= SVC_KV_W25Q_BASE) &&
+   (LX_NOR_W25Q_BLOCKS > 2U)) ? 1 : -1];
+
+/**
+* @brief Initializes the LevelX NOR instance on the W25Q128
+* @param LX_NOR_FLASH *nor_flash LevelX instance
+* @retval LX_SUCCESS, LX_ERROR if the W25Q128 is not initialized
+*/
+UINT lx_stm32_nor_custom_driver_initialize(LX_NOR_FLASH *nor_flash)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN Init_Section_0 */
+  if (!BSP_W25QXX_GetInfo()->initialized)
+  {
+    return LX_ERROR;
+  }
+  /* USER CODE END Init_Section_0 */
+
+  nor_flash->lx_nor_flash_base_address = (ULONG *)LX_NOR_W25Q_BASE;
+  nor_flash->lx_nor_flash_total_blocks = LX_NOR_W25Q_BLOCKS;
+  nor_flash->lx_nor_flash_words_per_block = LX_NOR_W25Q_BLOCK_SIZE / sizeof(ULONG);
+
+  nor_flash->lx_nor_flash_driver_read = lx_nor_driver_read;
+  nor_flash->lx_nor_flash_driver_write = lx_nor_driver_write;
+  nor_flash->lx_nor_flash_driver_block_erase = lx_nor_driver_block_erase;
+  nor_flash->lx_nor_flash_driver_block_erased_verify = lx_nor_driver_block_erased_verify;
+  nor_flash->lx_nor_flash_driver_system_error = lx_nor_driver_system_error;
+
+#ifndef LX_DIRECT_READ
+  nor_flash->lx_nor_flash_sector_buffer = &nor_sector_memory[0];
+#endif
+
+  /* USER CODE BEGIN Init_Section_1 */
+
+  /* USER CODE END Init_Section_1 */
+
+  return ret;
+}
+
+/* USER CODE BEGIN 0 */
+
+/**
+* @brief Get the LevelX system errors reported by the driver
+* @param UINT *last_error Last error code (output, may be NULL)
+* @retval Errors since start-up
+*/
+UINT lx_stm32_nor_custom_driver_get_errors(UINT *last_error)
+{
+  if (last_error != NULL)
+  {
+    *last_error = last_system_error;
+  }
+
+  return system_errors;
+}
+
+/**
+* @brief Checks that LevelX never used the W25Q128 area
+* @retval LX_SUCCESS if no block holds an erase count, LX_ERROR otherwise
+*         or on a driver error
+* @note  Stops at the first used block: one read once LevelX has opened
+*        the area, as it writes the erase count of every block
+*/
+UINT lx_stm32_nor_custom_driver_check_blank(VOID)
+{
+  ULONG erase_count;
+
+  for (ULONG block = 0U; block < LX_NOR_W25Q_BLOCKS; block++)
+  {
+    if ((BSP_W25QXX_Read((uint8_t *)&erase_count, LX_NOR_W25Q_BASE + (block * LX_NOR_W25Q_BLOCK_SIZE),
+                         sizeof(erase_count)) != W25QXX_OK) ||
+        (erase_count != 0xFFFFFFFFUL))
+    {
+      return LX_ERROR;
+    }
+  }
+
+  return LX_SUCCESS;
+}
+
+#if FX_W25Q_BENCHMARK_ENABLED
+/**
+* @brief Initializes the LevelX NOR instance on the RAM-simulated device
+* @param LX_NOR_FLASH *nor_flash LevelX instance
+* @retval LX_SUCCESS
+*/
+UINT lx_stm32_nor_simulator_initialize(LX_NOR_FLASH *nor_flash)
+{
+  nor_flash->lx_nor_flash_base_address = &sim_memory[0];
+  nor_flash->lx_nor_flash_total_blocks = LX_NOR_W25Q_SIM_BLOCKS;
+  nor_flash->lx_nor_flash_words_per_block = LX_NOR_W25Q_BLOCK_SIZE / sizeof(ULONG);
+
+  nor_flash->lx_nor_flash_driver_read = lx_nor_sim_read;
+  nor_flash->lx_nor_flash_driver_write = lx_nor_sim_write;
+  nor_flash->lx_nor_flash_driver_block_erase = lx_nor_sim_block_erase;
+  nor_flash->lx_nor_flash_driver_block_erased_verify = lx_nor_sim_block_erased_verify;
+  nor_flash->lx_nor_flash_driver_system_error = lx_nor_driver_system_error;
+
+#ifndef LX_DIRECT_READ
+  nor_flash->lx_nor_flash_sector_buffer = &nor_sector_memory[0];
+#endif
+
+  return LX_SUCCESS;
+}
+
+/**
+* @brief Benchmark format, mount, and sequential/random sector writes
+* @param lx_nor_w25q_benchmark_t *result Result (output)
+* @retval LX_SUCCESS or the first LevelX error
+*/
+UINT lx_stm32_nor_custom_driver_benchmark(lx_nor_w25q_benchmark_t *result)
+{
+  static ULONG sector[LX_NOR_SECTOR_SIZE];
+  UINT status;
+  uint64_t start;
+  ULONG erases;
+  ULONG seed = 0x12345678UL;
+
+  if (result == NULL)
+  {
+    return LX_ERROR;
+  }
+
+  memset(result, 0, sizeof(*result));
+  memset(sim_memory, 0xFF, sizeof(sim_memory));
+  sim_erases = 0U;
+  sim_words_written = 0U;
+
+  /* Erased device: the first open formats it */
+  start = Safety_Time_GetCycles();
+  status = lx_nor_flash_open(&sim_flash, "W25Q SIM", lx_stm32_nor_simulator_initialize);
+  result->format_cycles = (ULONG)(Safety_Time_GetCycles() - start);
+
+  /* Sequential writes over the sectors in use, each rewritten several times */
+  erases = sim_erases;
+  start = Safety_Time_GetCycles();
+  for (ULONG i = 0U; (i < LX_NOR_W25Q_BENCH_WRITES) && (status == LX_SUCCESS); i++)
+  {
+    memset(sector, (int)i, sizeof(sector));
+    status = lx_nor_flash_sector_write(&sim_flash, i % LX_NOR_W25Q_BENCH_SECTORS, sector);
+  }
+  result->seq_write_cycles = (ULONG)(Safety_Time_GetCycles() - start);
+  result->seq_erases = sim_erases - erases;
+
+  /* Random writes over the same sectors */
+  erases = sim_erases;
+  start = Safety_Time_GetCycles();
+  for (ULONG i = 0U; (i < LX_NOR_W25Q_BENCH_WRITES) && (status == LX_SUCCESS); i++)
+  {
+    seed = (seed * 1103515245UL) + 12345UL;
+    memset(sector, (int)i, sizeof(sector));
+    status = lx_nor_flash_sector_write(&sim_flash, (seed >> 16) % LX_NOR_W25Q_BENCH_SECTORS, sector);
+  }
+  result->rand_write_cycles = (ULONG)(Safety_Time_GetCycles() - start);
+  result->rand_erases = sim_erases - erases;
+  result->words_written = sim_words_written;
+
+  start = Safety_Time_GetCycles();
+  for (ULONG i = 0U; (i < LX_NOR_W25Q_BENCH_WRITES) && (status == LX_SUCCESS); i++)
+  {
+    status = lx_nor_flash_sector_read(&sim_flash, i % LX_NOR_W25Q_BENCH_SECTORS, sector);
+  }
+  result->read_cycles = (ULONG)(Safety_Time_GetCycles() - start);
+
+  if (status == LX_SUCCESS)
+  {
+    status = lx_nor_flash_close(&sim_flash);
+  }
+
+  /* Device holding data: mount scans every block */
+  if (status == LX_SUCCESS)
+  {
+    start = Safety_Time_GetCycles();
+    status = lx_nor_flash_open(&sim_flash, "W25Q SIM", lx_stm32_nor_simulator_initialize);
+    result->mount_cycles = (ULONG)(Safety_Time_GetCycles() - start);
+    (void)lx_nor_flash_close(&sim_flash);
+  }
+
+  result->cycles_per_us = Safety_Time_GetCyclesPerUs();
+
+  return status;
+}
+#endif
+
+/* USER CODE END 0 */
+
+/**
+* @brief Reads words from the W25Q128
+* @param ULONG *flash_address Flash offset
+* @param ULONG *destination Destination
+* @param ULONG words Words to read
+* @retval LX_SUCCESS, LX_ERROR on a driver error
+*/
+static UINT lx_nor_driver_read(ULONG *flash_address, ULONG *destination, ULONG words)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN NOR_READ */
+  if (BSP_W25QXX_Read((uint8_t *)destination, LX_NOR_W25Q_OFFSET(flash_address),
+                      words * sizeof(ULONG)) != W25QXX_OK)
+  {
+    ret = LX_ERROR;
+  }
+  /* USER CODE END NOR_READ */
+
+  return ret;
+}
+
+/**
+* @brief Programs words to the W25Q128 (bits are only cleared)
+* @param ULONG *flash_address Flash offset
+* @param ULONG *source Data
+* @param ULONG words Words to write
+* @retval LX_SUCCESS, LX_ERROR on a driver error
+*/
+static UINT lx_nor_driver_write(ULONG *flash_address, ULONG *source, ULONG words)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN NOR_WRITE */
+  if (BSP_W25QXX_Write((uint8_t *)source, LX_NOR_W25Q_OFFSET(flash_address),
+                       words * sizeof(ULONG)) != W25QXX_OK)
+  {
+    ret = LX_ERROR;
+  }
+  /* USER CODE END NOR_WRITE */
+
+  return ret;
+}
+
+/**
+* @brief Erases a block (one 4KB sector) of the W25Q128
+* @param ULONG block Block index in the LevelX area
+* @param ULONG erase_count Erase count (written by LevelX afterwards)
+* @retval LX_SUCCESS, LX_ERROR on a driver error
+*/
+static UINT lx_nor_driver_block_erase(ULONG block, ULONG erase_count)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN NOR_BLOCK_ERASE */
+  (void)erase_count;
+
+  if (BSP_W25QXX_EraseSector(LX_NOR_W25Q_BASE + (block * LX_NOR_W25Q_BLOCK_SIZE)) != W25QXX_OK)
+  {
+    ret = LX_ERROR;
+  }
+  /* USER CODE END NOR_BLOCK_ERASE */
+
+  return ret;
+}
+
+/**
+* @brief Checks that a block of the W25Q128 is erased
+* @param ULONG block Block index in the LevelX area
+* @retval LX_SUCCESS if erased, LX_ERROR otherwise
+*/
+static UINT lx_nor_driver_block_erased_verify(ULONG block)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN NOR_BLOCK_ERASED_VERIFY */
+  uint32_t address = LX_NOR_W25Q_BASE + (block * LX_NOR_W25Q_BLOCK_SIZE);
+
+  for (uint32_t offset = 0U; (offset < LX_NOR_W25Q_BLOCK_SIZE) && (ret == LX_SUCCESS);
+       offset += LX_NOR_W25Q_VERIFY_CHUNK)
+  {
+    if (BSP_W25QXX_Read(verify_buffer, address + offset, LX_NOR_W25Q_VERIFY_CHUNK) != W25QXX_OK)
+    {
+      ret = LX_ERROR;
+      break;
+    }
+
+    for (uint32_t i = 0U; i < LX_NOR_W25Q_VERIFY_CHUNK; i++)
+    {
+      if (verify_buffer[i] != 0xFFU)
+      {
+        ret = LX_ERROR;
+        break;
+      }
+    }
+  }
+  /* USER CODE END NOR_BLOCK_ERASED_VERIFY */
+
+  return ret;
+}
+
+/**
+* @brief Records a LevelX system error
+* @param UINT error_code LevelX error
+* @retval LX_SUCCESS
+*/
+static UINT lx_nor_driver_system_error(UINT error_code)
+{
+  UINT ret = LX_SUCCESS;
+
+  /* USER CODE BEGIN NOR_SYSTEM_ERROR */
+  system_errors++;
+  last_system_error = error_code;
+  /* USER CODE END NOR_SYSTEM_ERROR */
+
+  return ret;
+}
+
+/* USER CODE BEGIN 1 */
+
+#if FX_W25Q_BENCHMARK_ENABLED
+static UINT lx_nor_sim_read(ULONG *flash_address, ULONG *destination, ULONG words)
+{
+  memcpy(destination, flash_address, words * sizeof(ULONG));
+
+  return LX_SUCCESS;
+}
+
+static UINT lx_nor_sim_write(ULONG *flash_address, ULONG *source, ULONG words)
+{
+  /* NOR programming: bits are only cleared */
+  for (ULONG i = 0U; i < words; i++)
+  {
+    flash_address[i] &= source[i];
+  }
+  sim_words_written += words;
+
+  return LX_SUCCESS;
+}
+
+static UINT lx_nor_sim_block_erase(ULONG block, ULONG erase_count)
+{
+  (void)erase_count;
+
+  memset(&sim_memory[(block * LX_NOR_W25Q_BLOCK_SIZE) / sizeof(ULONG)], 0xFF,
+         LX_NOR_W25Q_BLOCK_SIZE);
+  sim_erases++;
+
+  return LX_SUCCESS;
+}
+
+static UINT lx_nor_sim_block_erased_verify(ULONG block)
+{
+  const ULONG *word = &sim_memory[(block * LX_NOR_W25Q_BLOCK_SIZE) / sizeof(ULONG)];
+
+  for (ULONG i = 0U; i < (LX_NOR_W25Q_BLOCK_SIZE / sizeof(ULONG)); i++)
+  {
+    if (word[i] != 0xFFFFFFFFUL)
+    {
+      return LX_ERROR;
+    }
+  }
+
+  return LX_SUCCESS;
+}
+#endif
+
+/* USER CODE END 1 */
@@ -0,0 +1,115 @@
+/**************************************************************************/
+/*                                                                        */
+/*       Copyright (c) Microsoft Corporation. All rights reserved.        */
+/*                                                                        */
+/*       This software is licensed under the Microsoft Software License   */
+/*       Terms for Microsoft Azure RTOS. Full text of the license can be  */
+/*       found in the LICENSE file at https://aka.ms/AzureRTOS_EULA       */
+/*       and in the root directory of this software.                      */
+/*                                                                        */
+/**************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LX_STM32_NOR_CUSTOM_DRIVER_H
+#define LX_STM32_NOR_CUSTOM_DRIVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "lx_api.h"
+
+/* USER CODE BEGIN Includes */
+#include "bsp_w25qxx.h"
+#include "svc_kvstore.h"
+/* USER CODE END Includes */
+
+/* Exported types ------------------------------------------------------------*/
+/* USER CODE BEGIN ET */
+
+/**
+ * @brief Benchmark result (CPU cycles, device operations)
+ * @note  Runs on a RAM-simulated NOR: the cycles are the LevelX overhead,
+ *        the device time follows from the operation counts
+ *        (erases x W25QXX_TYPICAL_SECTOR_ERASE, words written / 64 pages
+ *        x W25QXX_TYPICAL_PAGE_PROGRAM)
+ */
+typedef struct {
+  ULONG format_cycles;          /* Open of an erased device (formats it) */
+  ULONG mount_cycles;           /* Open of the device holding data */
+  ULONG seq_write_cycles;       /* LX_NOR_W25Q_BENCH_WRITES sector writes, in order */
+  ULONG rand_write_cycles;      /* Same count, random sectors */
+  ULONG read_cycles;            /* Same count, in order */
+  ULONG seq_erases;             /* Block erases during the sequential writes */
+  ULONG rand_erases;            /* Block erases during the random writes */
+  ULONG words_written;          /* Words programmed by all writes */
+  ULONG cycles_per_us;          /* For conversion to time */
+} lx_nor_w25q_benchmark_t;
+
+/* USER CODE END ET */
+
+/* Exported constants --------------------------------------------------------*/
+/* USER CODE BEGIN EC */
+
+/* LevelX area: the W25Q128 below the KV store, one block per 4KB sector
+   (fast reclaim; 7 of the 8 512-byte sectors of a block hold data) */
+#define LX_NOR_W25Q_BASE                                 0U
+#define LX_NOR_W25Q_SIZE                                 SVC_KV_W25Q_BASE
+#define LX_NOR_W25Q_BLOCK_SIZE                           W25Q128_SECTOR_SIZE
+#define LX_NOR_W25Q_BLOCKS                               (LX_NOR_W25Q_SIZE / LX_NOR_W25Q_BLOCK_SIZE)
+
+/* Logical sectors offered to FileX: one free block for reclaim, one spare */
+#define LX_NOR_W25Q_SECTORS_PER_BLOCK                    ((LX_NOR_W25Q_BLOCK_SIZE / (LX_NOR_SECTOR_SIZE * sizeof(ULONG))) - 1U)
+#define LX_NOR_W25Q_LOGICAL_SECTORS                      ((LX_NOR_W25Q_BLOCKS - 2U) * LX_NOR_W25Q_SECTORS_PER_BLOCK)
+
+/* Benchmark on a RAM-simulated NOR (FX_W25Q_BENCHMARK_ENABLED) */
+#define LX_NOR_W25Q_SIM_BLOCKS                           6U      /* 24KB of RAM when enabled */
+#define LX_NOR_W25Q_BENCH_SECTORS                        16U     /* Logical sectors in use */
+#define LX_NOR_W25Q_BENCH_WRITES                         256U    /* Enough to reclaim every block */
+
+/* USER CODE END EC */
+
+/* Exported functions prototypes ---------------------------------------------*/
+UINT lx_stm32_nor_custom_driver_initialize(LX_NOR_FLASH *nor_flash);
+
+/* USER CODE BEGIN EFP */
+
+/**
+ * @brief Get the LevelX system errors reported by the driver
+ * @param last_error Last error code (output, may be NULL)
+ * @retval UINT Errors since start-up
+ */
+UINT lx_stm32_nor_custom_driver_get_errors(UINT *last_error);
+
+/**
+ * @brief Check that LevelX never used the W25Q128 area (first use)
+ * @retval UINT LX_SUCCESS if every block is erased at its erase count,
+ *         LX_ERROR otherwise or on a driver error
+ * @note  Call before the first lx_nor_flash_open, which writes the counts
+ */
+UINT lx_stm32_nor_custom_driver_check_blank(VOID);
+
+/**
+ * @brief LevelX driver initialization for the RAM-simulated NOR
+ * @param nor_flash LevelX instance
+ * @retval UINT LX_SUCCESS
+ * @note  Only with FX_W25Q_BENCHMARK_ENABLED
+ */
+UINT lx_stm32_nor_simulator_initialize(LX_NOR_FLASH *nor_flash);
+
+/**
+ * @brief Benchmark format, mount, and sequential/random sector writes
+ * @param result Result (output)
+ * @retval UINT LX_SUCCESS or the first LevelX error
+ * @note  Only with FX_W25Q_BENCHMARK_ENABLED, after lx_nor_flash_initialize
+ */
+UINT lx_stm32_nor_custom_driver_benchmark(lx_nor_w25q_benchmark_t *result);
+
+/* USER CODE END EFP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LX_STM32_NOR_CUSTOM_DRIVER_H */
@@ -97,6 +97,16 @@ typedef enum {
 #define FLOW_VERIFY_INTERVAL_MS     1000U       /* Verify every 1 second */
 #define FLOW_SIGNATURE_SEED         0x5A5A5A5AUL
 
+/* ============================================================================
+ * Parameter Shadow Configuration
+ * ============================================================================*/
+/*
+ * Shadow words verified per monitor cycle. safety_params_t is 42 words, so a
+ * corrupted word is found within ceil(42 / 4) * SAFETY_MONITOR_PERIOD_MS
+ * = 1.1 s.
+ */
+#define PARAMS_SHADOW_CHECK_WORDS   4U
+
 /* ============================================================================
  * MPU Configuration
  * ============================================================================*/
@@ -104,9 +114,10 @@ typedef enum {
 #define MPU_REGION_RAM              1U          /* Main RAM */
 #define MPU_REGION_CCM              2U          /* CCM RAM (stacks) */
 #define MPU_REGION_PERIPH           3U          /* Peripheral region */
-#define MPU_REGION_CONFIG           4U          /* Config Flash (RO) */
+#define MPU_REGION_CONFIG           4U          /* Config Flash, journal area A (RO) */
 #define MPU_REGION_BOOT             5U          /* Bootloader (no access) */
-#define MPU_REGION_COUNT            6U
+#define MPU_REGION_CONFIG_B         6U          /* Config journal area B (RO) */
+#define MPU_REGION_COUNT            7U
 
 /* MPU Access Permissions */
 #define MPU_AP_NO_ACCESS            0x00U
@@ -127,6 +138,20 @@ typedef enum {
 /* Safe output states (for GPIO outputs) */
 #define SAFE_OUTPUT_DEFAULT         0           /* Default safe state */
 
+/*
+ * Safe output table: X(pin, port, level, arg)
+ *   pin   - Pin name from main.h without the _Pin suffix
+ *   port  - GPIO port letter (must match <pin>_GPIO_Port)
+ *   level - SET or RESET in safe state
+ * Folded at build time into one BSRR mask per GPIO port (safety_core.c).
+ * Motor enables, relays and PWM outputs are added here as they appear.
+ */
+#define SAFE_OUTPUT_TABLE(X, arg)                                           \
+    X(LED_G,        B, SET,   arg)  /* Status LED on: error indication */   \
+    X(LCD_BLK,      C, RESET, arg)  /* LCD backlight off */                 \
+    X(SPI_FLASH_CS, A, SET,   arg)  /* SPI flash deselected */              \
+    X(LCD_CS,       B, SET,   arg)  /* LCD deselected */
+
 /* ============================================================================
  * Error Logging Configuration
  * ============================================================================*/
@@ -135,12 +160,28 @@ typedef enum {
 
 /* Error log entry structure */
 typedef struct {
-    uint32_t timestamp;         /* System tick when error occurred */
+    uint64_t timestamp;         /* Safety time base (us) when error occurred */
     uint32_t error_code;        /* Error code */
     uint32_t param1;            /* Additional parameter 1 */
     uint32_t param2;            /* Additional parameter 2 */
 } safety_error_log_t;
 
+/* ============================================================================
+ * Fault Reaction Time Measurement
+ * ============================================================================*/
+#define REACTION_MEASURE_ENABLED    1           /* DWT timing of error reactions */
+#define REACTION_BUDGET_US          1000U       /* Detection to reaction budget */
+#define REACTION_HIST_BINS          8U          /* Histogram bins (last: overflow) */
+
+/* ============================================================================
+ * Crash Capture Configuration
+ * ============================================================================*/
+#define CRASH_CAPTURE_ENABLED       1           /* Capture crash record and reset */
+#define CRASH_STACK_SNAPSHOT_WORDS  32U         /* Stack words saved after frame */
+#define CRASH_THREAD_NAME_LEN       16U         /* Thread name bytes saved */
+#define CRASH_MAX_CONSECUTIVE       3U          /* Crash resets before staying safe */
+#define CRASH_STABLE_TIME_MS        10000U      /* Normal run time clearing count */
+
 /* ============================================================================
  * Diagnostic Interface Configuration
  * ============================================================================*/
@@ -81,6 +81,28 @@ typedef void (*safety_error_callback_t)(safety_error_t error);
 typedef void (*safety_state_callback_t)(safety_state_t old_state,
                                         safety_state_t new_state);
 
+/* ============================================================================
+ * Fault Reaction Statistics
+ * ============================================================================*/
+
+/* One slot per error code 0x00..0x0E, last slot for SAFETY_ERR_INTERNAL */
+#define SAFETY_REACTION_SLOTS       16U
+
+/**
+ * @brief Fault reaction time statistics for one error code
+ * @note  All times in DWT cycles, measured from Safety_ReportError entry
+ *        (or Safety_EnterSafeState entry when called directly)
+ */
+typedef struct {
+    uint32_t count;                         /* Reactions measured */
+    uint32_t transition_min;                /* Detection to state transition */
+    uint32_t transition_max;
+    uint32_t outputs_min;                   /* Detection to safe outputs applied */
+    uint32_t outputs_max;
+    uint32_t over_budget;                   /* Reactions above REACTION_BUDGET_US */
+    uint32_t hist[REACTION_HIST_BINS];      /* Full reaction time histogram */
+} safety_reaction_stats_t;
+
 /* ============================================================================
  * Safety Context Structure
  * ============================================================================*/
@@ -92,12 +114,14 @@ typedef struct {
     safety_state_t state;               /* Current safety state */
     safety_error_t last_error;          /* Last error code */
     uint32_t error_count;               /* Total error count */
-    uint32_t startup_time;              /* Startup timestamp */
-    uint32_t degraded_enter_time;       /* Degraded mode entry time */
+    uint64_t startup_time;              /* Startup timestamp (us) */
+    uint64_t degraded_enter_time;       /* Degraded mode entry time (us) */
     bool startup_test_passed;           /* Startup test result */
     bool params_valid;                  /* Parameters validated */
     bool mpu_enabled;                   /* MPU protection enabled */
     bool watchdog_active;               /* Watchdog active */
+    uint32_t safe_reaction_cycles;      /* EnterSafeState to outputs safe (DWT cycles) */
+    safety_reaction_stats_t reaction[SAFETY_REACTION_SLOTS]; /* Per error code */
     safety_error_callback_t error_cb;   /* Error callback */
     safety_state_callback_t state_cb;   /* State change callback */
 } safety_context_t;
@@ -177,6 +201,13 @@ safety_status_t Safety_EnterDegraded(safety_error_t error);
  */
 void Safety_EnterSafeState(safety_error_t error);
 
+/**
+ * @brief Drive all safety-critical outputs to their safe levels
+ * @note  One BSRR store per GPIO port from a build-time table, no HAL or
+ *        RTOS calls: callable from any exception level
+ */
+void Safety_ApplySafeOutputs(void);
+
 /**
  * @brief Check if system is in safe operational state
  * @retval bool true if NORMAL or DEGRADED
@@ -260,10 +291,30 @@ uint32_t Safety_GetUptime(void);
  */
 void Safety_PrintDiagnostics(void);
 
+/**
+ * @brief Get fault reaction statistics for an error code
+ * @param error Error code
+ * @retval const safety_reaction_stats_t* Statistics
+ */
+const safety_reaction_stats_t* Safety_GetReactionStats(safety_error_t error);
+
+/**
+ * @brief Export fault reaction statistics
+ * @note  One CSV line per measured error code over RTT:
+ *        RT,code,count,trans_min,trans_max,out_min,out_max,over_budget,hist[0..n]
+ */
+void Safety_ExportReactionStats(void);
+
 /* ============================================================================
  * Fault Handlers (called from stm32f4xx_it.c)
  * ============================================================================*/
 
+/*
+ * With CRASH_CAPTURE_ENABLED, stm32f4xx_it.c enters Safety_Crash_Capture
+ * directly (SAFETY_CRASH_xxx_ENTRY) so the stacked frame is available.
+ * These hooks remain for callers without a frame and also capture and reset.
+ */
+
 /**
  * @brief Hard fault handler hook
  */
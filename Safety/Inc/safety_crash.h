@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    safety_crash.h
+ * @brief   Post-Mortem Crash Capture Interface
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Fault handlers capture the stacked exception frame, fault status registers,
+ * the current ThreadX thread and a short stack snapshot into a no-init crash
+ * record, then reset immediately. The next boot reports the record.
+ * Host decoding: CI/scripts/decode_crash.ps1
+ *
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SAFETY_CRASH_H
+#define __SAFETY_CRASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "safety_config.h"
+
+/* ============================================================================
+ * Crash Record Definitions
+ * ============================================================================*/
+
+#define CRASH_RECORD_MAGIC          0xC0A5DEADUL    /* Valid record marker */
+
+/**
+ * @brief Hardware stacked exception frame (basic frame, 8 words)
+ */
+typedef struct {
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;                /* Return address of faulting function */
+    uint32_t pc;                /* Faulting instruction */
+    uint32_t xpsr;
+} crash_exception_frame_t;
+
+/**
+ * @brief Crash record (placed in section .crash_record, not initialized)
+ * @note  Layout (0xF0 bytes with the default configuration) is decoded by
+ *        CI/scripts/decode_crash.ps1, keep in sync
+ */
+typedef struct {
+    uint32_t magic;                         /* 0x00: CRASH_RECORD_MAGIC */
+    uint32_t error_code;                    /* 0x04: safety_error_t */
+    uint32_t timestamp;                     /* 0x08: Safety time base (ms) at fault */
+    uint32_t exc_return;                    /* 0x0C: EXC_RETURN value */
+    crash_exception_frame_t frame;          /* 0x10: Stacked frame */
+    uint32_t msp;                           /* 0x30: MSP at capture */
+    uint32_t psp;                           /* 0x34: PSP at capture */
+    uint32_t cfsr;                          /* 0x38: Configurable fault status */
+    uint32_t hfsr;                          /* 0x3C: Hard fault status */
+    uint32_t mmfar;                         /* 0x40: MemManage fault address */
+    uint32_t bfar;                          /* 0x44: Bus fault address */
+    uint32_t thread_ptr;                    /* 0x48: TX_THREAD running at fault */
+    char thread_name[CRASH_THREAD_NAME_LEN];/* 0x4C: Thread name (truncated) */
+    uint32_t stack_base;                    /* 0x5C: Address of stack[0] */
+    uint32_t stack_words;                   /* 0x60: Valid words in stack[] */
+    uint32_t stack[CRASH_STACK_SNAPSHOT_WORDS]; /* 0x64: Stack above frame */
+    uint32_t crash_count;                   /* 0xE4: Consecutive crash resets */
+    uint32_t reported;                      /* 0xE8: Set once reported on boot */
+    uint32_t crc32;                         /* 0xEC: CRC32 of all fields above */
+} safety_crash_record_t;
+
+/* ============================================================================
+ * Fault Entry
+ * ============================================================================*/
+
+/**
+ * @brief Branch from a fault handler into Safety_Crash_Capture
+ * @note  Must be the first statement of the exception handler, before any
+ *        function call, so the handler is still a leaf without a stack frame
+ *        and MSP/PSP point at the hardware stacked frame.
+ * @param code Numeric literal of the safety_error_t to record
+ */
+#define SAFETY_CRASH_FAULT_ENTRY(code)                              \
+    __ASM volatile ("TST    LR, #4                  \n"             \
+                    "ITE    EQ                      \n"             \
+                    "MRSEQ  R0, MSP                 \n"             \
+                    "MRSNE  R0, PSP                 \n"             \
+                    "MOV    R1, LR                  \n"             \
+                    "MOVS   R2, #" #code "          \n"             \
+                    "B      Safety_Crash_Capture    \n")
+
+#define SAFETY_CRASH_MPU_FAULT_ENTRY()      SAFETY_CRASH_FAULT_ENTRY(0x0A)
+#define SAFETY_CRASH_HARDFAULT_ENTRY()      SAFETY_CRASH_FAULT_ENTRY(0x0B)
+#define SAFETY_CRASH_BUSFAULT_ENTRY()       SAFETY_CRASH_FAULT_ENTRY(0x0C)
+#define SAFETY_CRASH_USAGEFAULT_ENTRY()     SAFETY_CRASH_FAULT_ENTRY(0x0D)
+#define SAFETY_CRASH_NMI_ENTRY()            SAFETY_CRASH_FAULT_ENTRY(0x0E)
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Check crash record left by the previous run
+ * @note  Called from Safety_EarlyInit, before HAL_Init
+ * @retval bool true if an unreported crash record was found
+ */
+bool Safety_Crash_Init(void);
+
+/**
+ * @brief Capture crash record and reset
+ * @param frame Stacked exception frame (NULL if unknown)
+ * @param exc_return EXC_RETURN value of the faulting exception
+ * @param error safety_error_t that caused the fault
+ * @note  Does not return
+ */
+void Safety_Crash_Capture(const uint32_t *frame, uint32_t exc_return, uint32_t error);
+
+/**
+ * @brief Get crash record found at boot
+ * @retval const safety_crash_record_t* Record, NULL if none
+ */
+const safety_crash_record_t* Safety_Crash_GetLast(void);
+
+/**
+ * @brief Print crash record found at boot
+ */
+void Safety_Crash_Report(void);
+
+/**
+ * @brief Get consecutive crash reset count
+ * @retval uint32_t Count
+ */
+uint32_t Safety_Crash_GetCount(void);
+
+/**
+ * @brief Clear consecutive crash count after stable operation
+ */
+void Safety_Crash_ClearCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAFETY_CRASH_H */
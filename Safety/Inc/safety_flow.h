@@ -48,7 +48,7 @@ typedef struct {
     uint32_t expected_signature;    /* Expected signature after sequence */
     uint32_t checkpoint_count;      /* Number of checkpoints hit */
     uint32_t last_checkpoint;       /* Last checkpoint value */
-    uint32_t last_checkpoint_time;  /* Timestamp of last checkpoint */
+    uint64_t last_checkpoint_time;  /* Timestamp of last checkpoint (us) */
     bool     sequence_complete;     /* Expected sequence completed */
     bool     error_detected;        /* Flow error detected */
 } flow_context_t;
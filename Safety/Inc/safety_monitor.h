@@ -31,7 +31,7 @@ extern "C" {
 
 typedef struct {
     uint32_t run_count;             /* Number of monitor cycles */
-    uint32_t last_run_time;         /* Last run timestamp */
+    uint64_t last_run_time;         /* Last run timestamp (us) */
     uint32_t wdg_feeds;             /* Watchdog feed count */
     uint32_t selftest_runs;         /* Runtime selftest runs */
     uint32_t stack_checks;          /* Stack check runs */
@@ -43,7 +43,8 @@ typedef enum {
     PARAMS_ERR_THRESHOLD    = 0x07U,    /* Threshold out of range */
     PARAMS_ERR_REDUNDANCY   = 0x08U,    /* Redundancy check failed */
     PARAMS_ERR_NULL_PTR     = 0x09U,    /* Null pointer */
-    PARAMS_ERR_FLASH_READ   = 0x0AU     /* Flash read error */
+    PARAMS_ERR_FLASH_READ   = 0x0AU,    /* Flash read error */
+    PARAMS_ERR_SHADOW       = 0x0BU     /* RAM shadow complement mismatch */
 } params_result_t;
 
 /* ============================================================================
@@ -59,7 +60,8 @@ typedef struct {
     uint32_t fail_count;                /* Failed validations */
     params_result_t last_result;        /* Last validation result */
     uint32_t last_fail_index;           /* Index of last failed parameter */
-    uint32_t last_validation_time;      /* Timestamp of last validation */
+    uint64_t last_validation_time;      /* Timestamp of last validation (us) */
+    uint32_t shadow_passes;             /* Complete periodic shadow passes */
 } params_stats_t;
 
 /* ============================================================================
@@ -99,6 +101,14 @@ params_result_t Safety_Params_ValidateBootConfig(const boot_config_t *config);
  */
 const safety_params_t* Safety_Params_Get(void);
 
+/**
+ * @brief Get RAM shadow of the safety parameters
+ * @note Never NULL and lock-free. Holds the validated parameters, or neutral
+ *       defaults (zero offsets, unity gains) while they are not valid.
+ * @retval const safety_params_t* Pointer to shadow
+ */
+const safety_params_t* Safety_Params_GetShadow(void);
+
 /**
  * @brief Check if parameters are valid
  * @retval bool true if valid
@@ -113,7 +123,9 @@ const params_stats_t* Safety_Params_GetStats(void);
 
 /**
  * @brief Run periodic parameter integrity check
- * @note Called from safety monitor thread
+ * @note Called from safety monitor thread every cycle. Verifies the next
+ *       PARAMS_SHADOW_CHECK_WORDS shadow words against their complement and
+ *       the validated image; falls back to defaults on mismatch.
  * @retval params_result_t Validation result
  */
 params_result_t Safety_Params_PeriodicCheck(void);
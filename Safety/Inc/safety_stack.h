@@ -41,6 +41,17 @@ typedef struct {
     bool        critical;           /* Critical threshold reached */
 } stack_info_t;
 
+/**
+ * @brief Stack check statistics
+ */
+typedef struct {
+    uint32_t check_count;           /* Safety_Stack_CheckAll runs */
+    uint64_t last_check_time;       /* Start of last check (us) */
+    uint32_t last_duration_us;      /* Duration of last check */
+    uint32_t max_duration_us;       /* Longest check */
+    uint8_t  peak_usage_percent;    /* Highest usage seen on any thread */
+} stack_stats_t;
+
 /* Maximum number of monitored threads */
 #define MAX_MONITORED_THREADS   8
 
@@ -96,6 +107,12 @@ uint32_t Safety_Stack_GetMonitoredCount(void);
  */
 safety_status_t Safety_Stack_GetInfoByIndex(uint32_t index, stack_info_t *info);
 
+/**
+ * @brief Get stack check statistics
+ * @retval const stack_stats_t* Statistics
+ */
+const stack_stats_t* Safety_Stack_GetStats(void);
+
 /**
  * @brief ThreadX stack error callback
  * @param thread_ptr Thread with stack error
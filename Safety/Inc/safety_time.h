@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * @file    safety_time.h
+ * @brief   Monotonic Safety Time Base Interface
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * 64-bit monotonic time base built on the DWT cycle counter. CYCCNT is
+ * extended with a wrap counter, so timestamps never wrap during operation
+ * (HAL tick: 49 days, CYCCNT alone: 25.6 s at 168 MHz).
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SAFETY_TIME_H
+#define __SAFETY_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "safety_config.h"
+
+/* ============================================================================
+ * Time Conversion Macros
+ * ============================================================================*/
+
+#define SAFETY_TIME_MS_TO_US(ms)    ((uint64_t)(ms) * 1000ULL)
+#define SAFETY_TIME_US_TO_MS(us)    ((uint64_t)(us) / 1000ULL)
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Initialize time base and enable the DWT cycle counter
+ * @note  Called from Safety_EarlyInit, time starts at zero
+ */
+void Safety_Time_Init(void);
+
+/**
+ * @brief Re-read SystemCoreClock after a clock change
+ * @note  Time elapsed so far is kept, later cycles use the new rate.
+ *        Called from Safety_PostClockInit.
+ */
+void Safety_Time_Calibrate(void);
+
+/**
+ * @brief Track CYCCNT wraps
+ * @note  Must run at least once per CYCCNT period (25.6 s at 168 MHz).
+ *        Called from the 1 ms HAL time base interrupt.
+ */
+void Safety_Time_Update(void);
+
+/**
+ * @brief Get extended 64-bit cycle count
+ * @retval uint64_t CPU cycles (CYCCNT extended to 64 bits)
+ * @note  Safe from any context, including fault handlers
+ */
+uint64_t Safety_Time_GetCycles(void);
+
+/**
+ * @brief Get monotonic time in microseconds
+ * @retval uint64_t Microseconds since Safety_Time_Init
+ */
+uint64_t Safety_Time_GetUs(void);
+
+/**
+ * @brief Get monotonic time in milliseconds
+ * @retval uint64_t Milliseconds since Safety_Time_Init
+ */
+uint64_t Safety_Time_GetMs(void);
+
+/**
+ * @brief Convert a cycle delta to microseconds at the current clock
+ * @param cycles CPU cycles
+ * @retval uint64_t Microseconds
+ */
+uint64_t Safety_Time_CyclesToUs(uint64_t cycles);
+
+/**
+ * @brief Get CPU cycles per microsecond used for conversion
+ * @retval uint32_t Cycles per microsecond
+ */
+uint32_t Safety_Time_GetCyclesPerUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAFETY_TIME_H */
@@ -56,7 +56,7 @@ typedef uint8_t wdg_token_t;
  * ============================================================================*/
 
 typedef struct {
-    uint32_t last_feed_time;        /* Last IWDG feed time */
+    uint64_t last_feed_time;        /* Last IWDG feed time (us) */
     uint32_t feed_count;            /* Total feed count */
     uint8_t  tokens_received;       /* Tokens received this cycle */
     uint8_t  tokens_required;       /* Required tokens mask */
@@ -64,7 +64,7 @@ typedef struct {
     bool     degraded_mode;         /* In degraded mode */
 #if WWDG_ENABLED
     uint32_t wwdg_feed_count;       /* WWDG feed count */
-    uint32_t wwdg_last_feed;        /* Last WWDG feed time */
+    uint64_t wwdg_last_feed;        /* Last WWDG feed time (us) */
     bool     wwdg_enabled;          /* WWDG enabled flag */
 #endif
 } wdg_status_t;
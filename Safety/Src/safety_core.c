@@ -16,6 +16,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "safety_core.h"
+#include "safety_crash.h"
+#include "safety_time.h"
 #include "stm32f4xx_hal.h"
 #include "main.h"
 #include <string.h>
@@ -27,11 +29,66 @@
 /* Private defines -----------------------------------------------------------*/
 #define ERROR_LOG_SIZE      ERROR_LOG_MAX_ENTRIES
 
+/* Safe output folding (see SAFE_OUTPUT_TABLE in safety_config.h) */
+#define SAFE_PORT_A         0U
+#define SAFE_PORT_B         1U
+#define SAFE_PORT_C         2U
+#define SAFE_PORT_D         3U
+#define SAFE_PORT_E         4U
+
+#define SAFE_BSRR_SET(pin)      ((uint32_t)(pin))
+#define SAFE_BSRR_RESET(pin)    ((uint32_t)(pin) << 16U)
+
+/* BSRR bits contributed by one table entry to port 'target' */
+#define SAFE_OUTPUT_BITS(name, port, level, target)                         \
+    | (((SAFE_PORT_##port) == (SAFE_PORT_##target)) ? SAFE_BSRR_##level(name##_Pin) : 0U)
+
+#define SAFE_OUTPUT_PORT_BSRR(target)   (0U SAFE_OUTPUT_TABLE(SAFE_OUTPUT_BITS, target))
+
+/* Port letter in the table must match the port defined in main.h */
+#define SAFE_OUTPUT_PORT_MATCH(name, port, level, arg)                      \
+    && ((GPIO##port) == (name##_GPIO_Port))
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    GPIO_TypeDef *port;         /* GPIO port */
+    uint32_t bsrr;              /* BSRR value: set bits [15:0], reset [31:16] */
+} safe_output_port_t;
+
+typedef struct {
+    uint32_t detect;            /* DWT cycles at detection */
+    uint32_t transition;        /* DWT cycles at state transition */
+    uint32_t outputs;           /* DWT cycles at safe outputs applied */
+    bool has_transition;
+    bool has_outputs;
+    bool active;                /* Measurement in progress */
+} reaction_trace_t;
+
 /* Private variables ---------------------------------------------------------*/
 static safety_context_t s_safety_ctx;
 static safety_error_log_t s_error_log[ERROR_LOG_SIZE];
 static uint32_t s_error_log_index = 0;
-static uint32_t s_startup_tick = 0;
+
+/* Safe-state levels for all outputs, one BSRR store per port */
+static const safe_output_port_t s_safe_output_ports[] = {
+    { GPIOA, SAFE_OUTPUT_PORT_BSRR(A) },
+    { GPIOB, SAFE_OUTPUT_PORT_BSRR(B) },
+    { GPIOC, SAFE_OUTPUT_PORT_BSRR(C) },
+    { GPIOD, SAFE_OUTPUT_PORT_BSRR(D) },
+    { GPIOE, SAFE_OUTPUT_PORT_BSRR(E) }
+};
+
+#define SAFE_OUTPUT_PORT_COUNT  (sizeof(s_safe_output_ports) / sizeof(s_safe_output_ports[0]))
+
+/* Reaction currently being measured (one at a time, nested reports skipped) */
+static reaction_trace_t s_reaction_trace;
+
+#if REACTION_MEASURE_ENABLED
+/* Histogram bin upper limits (us), last bin collects the rest */
+static const uint32_t s_reaction_bin_us[REACTION_HIST_BINS - 1U] = {
+    1U, 2U, 5U, 10U, 50U, 100U, 1000U
+};
+#endif
 
 /* ============================================================================
  * Private Function Prototypes
@@ -39,7 +96,11 @@ static uint32_t s_startup_tick = 0;
 static void Safety_LogError(safety_error_t error, uint32_t param1, uint32_t param2);
 static void Safety_CallErrorCallback(safety_error_t error);
 static void Safety_CallStateCallback(safety_state_t old_state, safety_state_t new_state);
-static void Safety_SetSafeOutputs(void);
+static uint32_t Safety_ReactionSlot(safety_error_t error);
+static bool Safety_ReactionBegin(uint32_t detect_cycles);
+static void Safety_ReactionMarkTransition(void);
+static void Safety_ReactionMarkOutputs(void);
+static void Safety_ReactionEnd(safety_error_t error);
 
 /* ============================================================================
  * Initialization Functions
@@ -60,17 +121,25 @@ safety_status_t Safety_EarlyInit(void)
     s_safety_ctx.mpu_enabled = false;
     s_safety_ctx.watchdog_active = false;
 
-    /* Record startup time (will be set properly after HAL_Init) */
-    s_startup_tick = 0;
+    /* Start the time base first: error log entries are timestamped with it */
+    Safety_Time_Init();
+
+    /* Report crash record left by the previous run */
+    if (Safety_Crash_Init())
+    {
+        const safety_crash_record_t *crash = Safety_Crash_GetLast();
+        Safety_LogError((safety_error_t)crash->error_code, crash->frame.pc, crash->cfsr);
+        Safety_Crash_Report();
+    }
 
     return SAFETY_OK;
 }
 
 safety_status_t Safety_PostClockInit(void)
 {
-    /* Record actual startup tick */
-    s_startup_tick = HAL_GetTick();
-    s_safety_ctx.startup_time = s_startup_tick;
+    /* Time base continues at the new core clock */
+    Safety_Time_Calibrate();
+    s_safety_ctx.startup_time = Safety_Time_GetUs();
 
     /* Verify clock configuration */
     /* Note: Divide first to avoid uint32_t overflow (168MHz * 105 > UINT32_MAX) */
@@ -89,6 +158,13 @@ safety_status_t Safety_PostClockInit(void)
 
 safety_status_t Safety_PeripheralInit(void)
 {
+    /* Safe output table must address the ports configured in main.h */
+    if (!(true SAFE_OUTPUT_TABLE(SAFE_OUTPUT_PORT_MATCH, 0)))
+    {
+        Safety_ReportError(SAFETY_ERR_INTERNAL, 0, 0);
+        return SAFETY_ERROR;
+    }
+
     /* Transition to startup test state */
     s_safety_ctx.state = SAFETY_STATE_STARTUP_TEST;
 
@@ -186,6 +262,7 @@ safety_status_t Safety_SetState(safety_state_t state)
     }
 
     s_safety_ctx.state = state;
+    Safety_ReactionMarkTransition();
     Safety_CallStateCallback(old_state, state);
 
     return SAFETY_OK;
@@ -208,7 +285,8 @@ safety_status_t Safety_EnterDegraded(safety_error_t error)
     if (old_state == SAFETY_STATE_NORMAL || old_state == SAFETY_STATE_STARTUP_TEST)
     {
         s_safety_ctx.state = SAFETY_STATE_DEGRADED;
-        s_safety_ctx.degraded_enter_time = HAL_GetTick();
+        Safety_ReactionMarkTransition();
+        s_safety_ctx.degraded_enter_time = Safety_Time_GetUs();
         s_safety_ctx.last_error = error;
 
         Safety_CallStateCallback(old_state, SAFETY_STATE_DEGRADED);
@@ -226,16 +304,24 @@ safety_status_t Safety_EnterDegraded(safety_error_t error)
 
 void Safety_EnterSafeState(safety_error_t error)
 {
+    uint32_t start_cycles = DWT->CYCCNT;
     safety_state_t old_state = s_safety_ctx.state;
+    bool measure = Safety_ReactionBegin(start_cycles);
+
+    /* Set safe outputs and state first, before any logging */
+    Safety_ApplySafeOutputs();
+    s_safety_ctx.safe_reaction_cycles = DWT->CYCCNT - start_cycles;
+    Safety_ReactionMarkOutputs();
+    s_safety_ctx.state = SAFETY_STATE_SAFE;
+    Safety_ReactionMarkTransition();
 
     /* Log the error */
     Safety_LogError(error, 0, 0);
 
-    /* Set safe outputs */
-    Safety_SetSafeOutputs();
+#if DIAG_RTT_ENABLED
+    DEBUG_ERROR("Outputs SAFE in %lu cycles", s_safety_ctx.safe_reaction_cycles);
+#endif
 
-    /* Update state */
-    s_safety_ctx.state = SAFETY_STATE_SAFE;
     s_safety_ctx.last_error = error;
     s_safety_ctx.error_count++;
 
@@ -243,6 +329,11 @@ void Safety_EnterSafeState(safety_error_t error)
     Safety_CallStateCallback(old_state, SAFETY_STATE_SAFE);
     Safety_CallErrorCallback(error);
 
+    if (measure)
+    {
+        Safety_ReactionEnd(error);
+    }
+
 #if !DEGRADED_MODE_WDG_FEED
     /* If not feeding watchdog in safe state, system will reset */
     __disable_irq();
@@ -259,12 +350,35 @@ bool Safety_IsOperational(void)
             s_safety_ctx.state == SAFETY_STATE_DEGRADED);
 }
 
+void Safety_ApplySafeOutputs(void)
+{
+    /*
+     * Safe State Definition (SAFE_OUTPUT_TABLE):
+     * - All motor/actuator outputs: OFF (low)
+     * - Status LED: ON (indicate error state)
+     * - SPI Flash / LCD: CS high (deselected)
+     *
+     * BSRR writes are atomic, no HAL or RTOS calls: safe from any
+     * exception level, including fault handlers.
+     */
+    for (uint32_t i = 0; i < SAFE_OUTPUT_PORT_COUNT; i++)
+    {
+        if (s_safe_output_ports[i].bsrr != 0U)
+        {
+            s_safe_output_ports[i].port->BSRR = s_safe_output_ports[i].bsrr;
+        }
+    }
+}
+
 /* ============================================================================
  * Error Handling Functions
  * ============================================================================*/
 
 void Safety_ReportError(safety_error_t error, uint32_t param1, uint32_t param2)
 {
+    /* Detection timestamp */
+    bool measure = Safety_ReactionBegin(DWT->CYCCNT);
+
     /* Log the error */
     Safety_LogError(error, param1, param2);
 
@@ -312,6 +426,11 @@ void Safety_ReportError(safety_error_t error, uint32_t param1, uint32_t param2)
             Safety_CallErrorCallback(error);
             break;
     }
+
+    if (measure)
+    {
+        Safety_ReactionEnd(error);
+    }
 }
 
 safety_error_t Safety_GetLastError(void)
@@ -371,7 +490,7 @@ const safety_context_t* Safety_GetContext(void)
 
 uint32_t Safety_GetUptime(void)
 {
-    return HAL_GetTick() - s_startup_tick;
+    return (uint32_t)SAFETY_TIME_US_TO_MS(Safety_Time_GetUs() - s_safety_ctx.startup_time);
 }
 
 void Safety_PrintDiagnostics(void)
@@ -403,6 +522,7 @@ void Safety_PrintDiagnostics(void)
     DEBUG_INFO("Params OK:   %s", s_safety_ctx.params_valid ? "Yes" : "No");
     DEBUG_INFO("MPU Active:  %s", s_safety_ctx.mpu_enabled ? "Yes" : "No");
     DEBUG_INFO("WDG Active:  %s", s_safety_ctx.watchdog_active ? "Yes" : "No");
+    DEBUG_INFO("Safe React:  %lu cycles", s_safety_ctx.safe_reaction_cycles);
 
     /* Print recent error log entries */
     DEBUG_INFO("--- Error Log (last 4) ---");
@@ -415,7 +535,7 @@ void Safety_PrintDiagnostics(void)
                                s_error_log[idx].error_code : 0;
             DEBUG_INFO("[%lu] %s @%lu P1=%lX P2=%lX",
                        i, error_names[err_idx],
-                       s_error_log[idx].timestamp,
+                       (uint32_t)SAFETY_TIME_US_TO_MS(s_error_log[idx].timestamp),
                        s_error_log[idx].param1,
                        s_error_log[idx].param2);
         }
@@ -430,6 +550,35 @@ void Safety_PrintDiagnostics(void)
 #endif
 }
 
+const safety_reaction_stats_t* Safety_GetReactionStats(safety_error_t error)
+{
+    return &s_safety_ctx.reaction[Safety_ReactionSlot(error)];
+}
+
+void Safety_ExportReactionStats(void)
+{
+#if DIAG_RTT_ENABLED && REACTION_MEASURE_ENABLED
+    DEBUG_INFO("RT,code,count,trans_min,trans_max,out_min,out_max,over_budget,hist (cycles, "
+               "budget %lu us, %lu Hz)", REACTION_BUDGET_US, SystemCoreClock);
+
+    for (uint32_t i = 0; i < SAFETY_REACTION_SLOTS; i++)
+    {
+        const safety_reaction_stats_t *rs = &s_safety_ctx.reaction[i];
+        if (rs->count == 0U)
+        {
+            continue;
+        }
+
+        DEBUG_INFO("RT,0x%02lX,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+                   (i < (SAFETY_REACTION_SLOTS - 1U)) ? i : (uint32_t)SAFETY_ERR_INTERNAL,
+                   rs->count, rs->transition_min, rs->transition_max,
+                   rs->outputs_min, rs->outputs_max, rs->over_budget,
+                   rs->hist[0], rs->hist[1], rs->hist[2], rs->hist[3],
+                   rs->hist[4], rs->hist[5], rs->hist[6], rs->hist[7]);
+    }
+#endif
+}
+
 /* ============================================================================
  * Fault Handlers
  * ============================================================================*/
@@ -437,6 +586,9 @@ void Safety_PrintDiagnostics(void)
 void Safety_HardFaultHandler(void)
 {
     Safety_LogError(SAFETY_ERR_HARDFAULT, __get_MSP(), __get_PSP());
+#if CRASH_CAPTURE_ENABLED
+    Safety_Crash_Capture(NULL, 0U, SAFETY_ERR_HARDFAULT);
+#endif
     Safety_EnterSafeState(SAFETY_ERR_HARDFAULT);
 }
 
@@ -445,6 +597,9 @@ void Safety_MemManageHandler(void)
     uint32_t mmfar = SCB->MMFAR;
     uint32_t cfsr = SCB->CFSR;
     Safety_LogError(SAFETY_ERR_MPU_FAULT, mmfar, cfsr);
+#if CRASH_CAPTURE_ENABLED
+    Safety_Crash_Capture(NULL, 0U, SAFETY_ERR_MPU_FAULT);
+#endif
     Safety_EnterSafeState(SAFETY_ERR_MPU_FAULT);
 }
 
@@ -453,18 +608,27 @@ void Safety_BusFaultHandler(void)
     uint32_t bfar = SCB->BFAR;
     uint32_t cfsr = SCB->CFSR;
     Safety_LogError(SAFETY_ERR_BUSFAULT, bfar, cfsr);
+#if CRASH_CAPTURE_ENABLED
+    Safety_Crash_Capture(NULL, 0U, SAFETY_ERR_BUSFAULT);
+#endif
     Safety_EnterSafeState(SAFETY_ERR_BUSFAULT);
 }
 
 void Safety_UsageFaultHandler(void)
 {
     Safety_LogError(SAFETY_ERR_USAGEFAULT, 0, SCB->CFSR);
+#if CRASH_CAPTURE_ENABLED
+    Safety_Crash_Capture(NULL, 0U, SAFETY_ERR_USAGEFAULT);
+#endif
     Safety_EnterSafeState(SAFETY_ERR_USAGEFAULT);
 }
 
 void Safety_NMIHandler(void)
 {
     Safety_LogError(SAFETY_ERR_NMI, 0, 0);
+#if CRASH_CAPTURE_ENABLED
+    Safety_Crash_Capture(NULL, 0U, SAFETY_ERR_NMI);
+#endif
     Safety_EnterSafeState(SAFETY_ERR_NMI);
 }
 
@@ -476,7 +640,7 @@ static void Safety_LogError(safety_error_t error, uint32_t param1, uint32_t para
 {
     safety_error_log_t *entry = &s_error_log[s_error_log_index];
 
-    entry->timestamp = HAL_GetTick();
+    entry->timestamp = Safety_Time_GetUs();
     entry->error_code = (uint32_t)error;
     entry->param1 = param1;
     entry->param2 = param2;
@@ -534,48 +698,103 @@ static void Safety_CallStateCallback(safety_state_t old_state, safety_state_t ne
     }
 }
 
-static void Safety_SetSafeOutputs(void)
+static uint32_t Safety_ReactionSlot(safety_error_t error)
 {
-    /*
-     * Set all safety-critical outputs to safe state
-     * Called when entering SAFE state after critical error
-     *
-     * Safe State Definition:
-     * - All motor/actuator outputs: OFF (low)
-     * - Status LED: ON (indicate error state)
-     * - Communication interfaces: Disabled
-     * - SPI Flash: CS high (deselected)
-     */
+    return (error <= SAFETY_ERR_NMI) ? (uint32_t)error : (SAFETY_REACTION_SLOTS - 1U);
+}
 
-#if DIAG_RTT_ENABLED
-    DEBUG_ERROR("Setting outputs to SAFE state");
-#endif
+static bool Safety_ReactionBegin(uint32_t detect_cycles)
+{
+#if REACTION_MEASURE_ENABLED
+    bool owner;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-    /* 1. Status LED - Turn ON to indicate error */
-#ifdef LED_G_Pin
-    HAL_GPIO_WritePin(LED_G_GPIO_Port, LED_G_Pin, GPIO_PIN_SET);
-#endif
+    /* A report nested in another one (e.g. from an ISR) is not measured */
+    owner = !s_reaction_trace.active;
+    if (owner)
+    {
+        s_reaction_trace.detect = detect_cycles;
+        s_reaction_trace.has_transition = false;
+        s_reaction_trace.has_outputs = false;
+        s_reaction_trace.active = true;
+    }
 
-    /* 2. LCD Backlight - Turn OFF */
-#ifdef LCD_BLK_Pin
-    HAL_GPIO_WritePin(LCD_BLK_GPIO_Port, LCD_BLK_Pin, GPIO_PIN_RESET);
+    __set_PRIMASK(primask);
+    return owner;
+#else
+    (void)detect_cycles;
+    return false;
 #endif
+}
 
-    /* 3. SPI Flash - Deselect (CS high) */
-#ifdef SPI_FLASH_CS_Pin
-    HAL_GPIO_WritePin(SPI_FLASH_CS_GPIO_Port, SPI_FLASH_CS_Pin, GPIO_PIN_SET);
+static void Safety_ReactionMarkTransition(void)
+{
+#if REACTION_MEASURE_ENABLED
+    if (s_reaction_trace.active && !s_reaction_trace.has_transition)
+    {
+        s_reaction_trace.transition = DWT->CYCCNT;
+        s_reaction_trace.has_transition = true;
+    }
 #endif
+}
 
-    /* 4. LCD - Deselect (CS high) */
-#ifdef LCD_CS_Pin
-    HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
+static void Safety_ReactionMarkOutputs(void)
+{
+#if REACTION_MEASURE_ENABLED
+    if (s_reaction_trace.active && !s_reaction_trace.has_outputs)
+    {
+        s_reaction_trace.outputs = DWT->CYCCNT;
+        s_reaction_trace.has_outputs = true;
+    }
 #endif
+}
 
-    /*
-     * Application-specific safe outputs should be added here:
-     * - Motor enable pins -> LOW
-     * - Relay controls -> Safe position
-     * - Analog outputs -> Zero/safe value
-     * - PWM outputs -> Disabled
-     */
+static void Safety_ReactionEnd(safety_error_t error)
+{
+#if REACTION_MEASURE_ENABLED
+    safety_reaction_stats_t *rs = &s_safety_ctx.reaction[Safety_ReactionSlot(error)];
+    reaction_trace_t *tr = &s_reaction_trace;
+    uint32_t end = DWT->CYCCNT;
+    uint32_t total = end - tr->detect;
+
+    if (tr->has_transition)
+    {
+        uint32_t t = tr->transition - tr->detect;
+        rs->transition_min = ((rs->transition_max == 0U) || (t < rs->transition_min)) ?
+                             t : rs->transition_min;
+        rs->transition_max = (t > rs->transition_max) ? t : rs->transition_max;
+        total = t;
+    }
+
+    if (tr->has_outputs)
+    {
+        uint32_t o = tr->outputs - tr->detect;
+        rs->outputs_min = ((rs->outputs_max == 0U) || (o < rs->outputs_min)) ?
+                          o : rs->outputs_min;
+        rs->outputs_max = (o > rs->outputs_max) ? o : rs->outputs_max;
+        total = (o > total) ? o : total;
+    }
+
+    /* Full reaction: last of transition / outputs, or handling if neither */
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    uint32_t total_us = (cycles_per_us != 0U) ? (total / cycles_per_us) : 0U;
+    uint32_t bin = 0;
+
+    while ((bin < (REACTION_HIST_BINS - 1U)) && (total_us >= s_reaction_bin_us[bin]))
+    {
+        bin++;
+    }
+
+    rs->hist[bin]++;
+    rs->count++;
+    if (total_us > REACTION_BUDGET_US)
+    {
+        rs->over_budget++;
+    }
+
+    tr->active = false;
+#else
+    (void)error;
+#endif
 }
@@ -0,0 +1,272 @@
+/**
+ ******************************************************************************
+ * @file    safety_crash.c
+ * @brief   Post-Mortem Crash Capture Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * The crash record lives in the .crash_record section at the top of CCM RAM
+ * (CRASH_RECORD_START). It is not initialized by the application startup and
+ * is outside the CCM area used by the bootloader, so it survives the reset.
+ *
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "safety_crash.h"
+#include "safety_core.h"
+#include "safety_time.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+#if DIAG_RTT_ENABLED
+#include "bsp_debug.h"
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define CRASH_FRAME_WORDS           8U      /* Basic stacked frame */
+#define CRASH_FRAME_FPU_WORDS       26U     /* Extended frame with FPU state */
+#define CRASH_EXC_RETURN_FTYPE      (1UL << 4)
+
+/* Number of words covered by the record CRC */
+#define CRASH_CRC_WORDS             ((sizeof(safety_crash_record_t) / 4U) - 1U)
+
+/* Private variables ---------------------------------------------------------*/
+#pragma location = ".crash_record"
+__no_init static safety_crash_record_t s_crash_record;
+
+static safety_crash_record_t s_last_crash;
+static bool s_has_last_crash = false;
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static uint32_t Crash_CalculateCRC(const safety_crash_record_t *record);
+static bool Crash_IsRecordValid(const safety_crash_record_t *record);
+static bool Crash_IsReadable(uint32_t addr, uint32_t length);
+static void Crash_CopyWords(uint32_t *dst, const uint32_t *src, uint32_t words);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+bool Safety_Crash_Init(void)
+{
+    s_has_last_crash = false;
+
+    if (!Crash_IsRecordValid(&s_crash_record))
+    {
+        /* Power-on or corrupted record: start a fresh count */
+        memset(&s_crash_record, 0, sizeof(s_crash_record));
+        return false;
+    }
+
+    if (s_crash_record.reported != 0U)
+    {
+        return false;
+    }
+
+    s_last_crash = s_crash_record;
+    s_has_last_crash = true;
+
+    /* Keep the record (and its count) but report it only once */
+    s_crash_record.reported = 1U;
+    s_crash_record.crc32 = Crash_CalculateCRC(&s_crash_record);
+
+    return true;
+}
+
+void Safety_Crash_Capture(const uint32_t *frame, uint32_t exc_return, uint32_t error)
+{
+    safety_crash_record_t *rec = &s_crash_record;
+    uint32_t count;
+
+    __disable_irq();
+
+    /* Outputs safe before anything else */
+    Safety_ApplySafeOutputs();
+
+    count = Crash_IsRecordValid(rec) ? rec->crash_count : 0U;
+
+    memset(rec, 0, sizeof(safety_crash_record_t));
+
+    rec->error_code = error;
+    rec->timestamp = (uint32_t)Safety_Time_GetMs();
+    rec->exc_return = exc_return;
+    rec->msp = __get_MSP();
+    rec->psp = __get_PSP();
+    rec->cfsr = SCB->CFSR;
+    rec->hfsr = SCB->HFSR;
+    rec->mmfar = SCB->MMFAR;
+    rec->bfar = SCB->BFAR;
+
+    /* Stacked frame and the stack above it (caller frames) */
+    if ((frame != NULL) && (((uint32_t)frame & 0x03U) == 0U) &&
+        Crash_IsReadable((uint32_t)frame, CRASH_FRAME_WORDS * 4U))
+    {
+        Crash_CopyWords((uint32_t *)&rec->frame, frame, CRASH_FRAME_WORDS);
+
+        uint32_t skip = ((exc_return & CRASH_EXC_RETURN_FTYPE) != 0U) ?
+                        CRASH_FRAME_WORDS : CRASH_FRAME_FPU_WORDS;
+        uint32_t base = (uint32_t)(frame + skip);
+        uint32_t words = CRASH_STACK_SNAPSHOT_WORDS;
+
+        while ((words > 0U) && !Crash_IsReadable(base, words * 4U))
+        {
+            words--;
+        }
+
+        rec->stack_base = base;
+        rec->stack_words = words;
+        Crash_CopyWords(rec->stack, (const uint32_t *)base, words);
+    }
+
+    /* Thread running at the time of the fault */
+    TX_THREAD *thread = tx_thread_identify();
+    rec->thread_ptr = (uint32_t)thread;
+    if ((thread != NULL) && Crash_IsReadable((uint32_t)thread, sizeof(TX_THREAD)))
+    {
+        const CHAR *name = thread->tx_thread_name;
+        if ((name != NULL) && Crash_IsReadable((uint32_t)name, CRASH_THREAD_NAME_LEN))
+        {
+            for (uint32_t i = 0; (i < (CRASH_THREAD_NAME_LEN - 1U)) && (name[i] != '\0'); i++)
+            {
+                rec->thread_name[i] = name[i];
+            }
+        }
+    }
+
+    rec->crash_count = count + 1U;
+    rec->reported = 0U;
+    rec->magic = CRASH_RECORD_MAGIC;
+    rec->crc32 = Crash_CalculateCRC(rec);
+
+    __DSB();
+
+    if (rec->crash_count > CRASH_MAX_CONSECUTIVE)
+    {
+        /* Reset loop: stop rebooting fast and hold the safe state instead */
+        Safety_EnterSafeState((safety_error_t)error);
+        while (1)
+        {
+            /* Wait for watchdog reset */
+        }
+    }
+
+    NVIC_SystemReset();
+}
+
+const safety_crash_record_t* Safety_Crash_GetLast(void)
+{
+    return s_has_last_crash ? &s_last_crash : NULL;
+}
+
+void Safety_Crash_Report(void)
+{
+#if DIAG_RTT_ENABLED
+    const safety_crash_record_t *rec = &s_last_crash;
+
+    if (!s_has_last_crash)
+    {
+        return;
+    }
+
+    DEBUG_ERROR("========== Crash Record ==========");
+    DEBUG_ERROR("Error: 0x%02lX  Count: %lu  Time: %lu ms",
+                rec->error_code, rec->crash_count, rec->timestamp);
+    DEBUG_ERROR("PC=0x%08lX LR=0x%08lX xPSR=0x%08lX",
+                rec->frame.pc, rec->frame.lr, rec->frame.xpsr);
+    DEBUG_ERROR("R0=0x%08lX R1=0x%08lX R2=0x%08lX R3=0x%08lX R12=0x%08lX",
+                rec->frame.r0, rec->frame.r1, rec->frame.r2,
+                rec->frame.r3, rec->frame.r12);
+    DEBUG_ERROR("CFSR=0x%08lX HFSR=0x%08lX MMFAR=0x%08lX BFAR=0x%08lX",
+                rec->cfsr, rec->hfsr, rec->mmfar, rec->bfar);
+    DEBUG_ERROR("EXC_RETURN=0x%08lX MSP=0x%08lX PSP=0x%08lX",
+                rec->exc_return, rec->msp, rec->psp);
+    DEBUG_ERROR("Thread: %s (0x%08lX)",
+                (rec->thread_name[0] != '\0') ? rec->thread_name : "-",
+                rec->thread_ptr);
+    for (uint32_t i = 0; i < rec->stack_words; i += 4U)
+    {
+        DEBUG_ERROR("  %08lX: %08lX %08lX %08lX %08lX",
+                    rec->stack_base + (i * 4U),
+                    rec->stack[i], rec->stack[i + 1U],
+                    rec->stack[i + 2U], rec->stack[i + 3U]);
+    }
+    DEBUG_ERROR("==================================");
+#endif
+}
+
+uint32_t Safety_Crash_GetCount(void)
+{
+    return Crash_IsRecordValid(&s_crash_record) ? s_crash_record.crash_count : 0U;
+}
+
+void Safety_Crash_ClearCount(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (Crash_IsRecordValid(&s_crash_record))
+    {
+        s_crash_record.crash_count = 0U;
+        s_crash_record.crc32 = Crash_CalculateCRC(&s_crash_record);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static uint32_t Crash_CalculateCRC(const safety_crash_record_t *record)
+{
+    /*
+     * Software CRC32 (same polynomial and word order as the STM32 CRC unit).
+     * The hardware unit is not used: it may be uninitialized at boot or in
+     * use by an interrupted calculation at the time of the fault.
+     */
+    const uint32_t *data = (const uint32_t *)record;
+    uint32_t crc = CRC32_INIT_VALUE;
+
+    for (uint32_t i = 0; i < CRASH_CRC_WORDS; i++)
+    {
+        crc ^= data[i];
+        for (uint32_t bit = 0; bit < 32U; bit++)
+        {
+            crc = ((crc & 0x80000000UL) != 0U) ? ((crc << 1) ^ CRC32_POLYNOMIAL) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static bool Crash_IsRecordValid(const safety_crash_record_t *record)
+{
+    return ((record->magic == CRASH_RECORD_MAGIC) &&
+            (record->crc32 == Crash_CalculateCRC(record)));
+}
+
+static bool Crash_IsReadable(uint32_t addr, uint32_t length)
+{
+    /* Only RAM, CCM RAM and application flash are dereferenced */
+    uint32_t last = addr + length - 1U;
+
+    return (((addr >= RAM_START) && (last <= RAM_END) && (last >= addr)) ||
+            ((addr >= CCMRAM_START) && (last <= CCMRAM_END) && (last >= addr)) ||
+            ((addr >= APP_FLASH_START) && (last <= APP_FLASH_END) && (last >= addr)));
+}
+
+static void Crash_CopyWords(uint32_t *dst, const uint32_t *src, uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++)
+    {
+        dst[i] = src[i];
+    }
+}
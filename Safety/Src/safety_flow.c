@@ -9,6 +9,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "safety_flow.h"
+#include "safety_time.h"
 #include "stm32f4xx_hal.h"
 
 /* Private defines -----------------------------------------------------------*/
@@ -41,7 +42,7 @@ void Safety_Flow_Checkpoint(uint8_t checkpoint)
 
     /* Record checkpoint info */
     s_flow_ctx.last_checkpoint = checkpoint;
-    s_flow_ctx.last_checkpoint_time = HAL_GetTick();
+    s_flow_ctx.last_checkpoint_time = Safety_Time_GetUs();
     s_flow_ctx.checkpoint_count++;
 
     /* Check if expected signature matches (if set) */
@@ -110,8 +111,7 @@ bool Safety_Flow_CheckpointRecent(uint8_t checkpoint, uint32_t timeout_ms)
         return false;
     }
 
-    uint32_t current_time = HAL_GetTick();
-    uint32_t elapsed = current_time - s_flow_ctx.last_checkpoint_time;
+    uint64_t elapsed = Safety_Time_GetUs() - s_flow_ctx.last_checkpoint_time;
 
-    return (elapsed <= timeout_ms);
+    return (elapsed <= SAFETY_TIME_MS_TO_US(timeout_ms));
 }
@@ -15,6 +15,9 @@
 #include "safety_stack.h"
 #include "safety_flow.h"
 #include "safety_mpu.h"
+#include "safety_crash.h"
+#include "safety_params.h"
+#include "safety_time.h"
 #include "safety_config.h"
 
 #if WWDG_ENABLED
@@ -169,7 +172,7 @@ void Safety_Monitor_ThreadEntry(ULONG thread_input)
 
         /* Update statistics */
         s_monitor_stats.run_count++;
-        s_monitor_stats.last_run_time = tx_time_get();
+        s_monitor_stats.last_run_time = Safety_Time_GetUs();
 
         /* === 1. Report watchdog token === */
         Safety_Watchdog_ReportToken(WDG_TOKEN_SAFETY_THREAD);
@@ -242,9 +245,9 @@ void Safety_Monitor_ThreadEntry(ULONG thread_input)
         if (Safety_GetState() == SAFETY_STATE_DEGRADED)
         {
             const safety_context_t *ctx = Safety_GetContext();
-            uint32_t elapsed = tx_time_get() - ctx->degraded_enter_time;
+            uint64_t elapsed = Safety_Time_GetUs() - ctx->degraded_enter_time;
 
-            if (elapsed > DEGRADED_MODE_TIMEOUT_MS)
+            if (elapsed > SAFETY_TIME_MS_TO_US(DEGRADED_MODE_TIMEOUT_MS))
             {
                 /* Timeout in degraded mode - go to safe state */
                 Safety_EnterSafeState(SAFETY_ERR_INTERNAL);
@@ -252,6 +255,22 @@ void Safety_Monitor_ThreadEntry(ULONG thread_input)
         }
 #endif
 
+        /* === 7. Parameter shadow check (a few words per cycle) === */
+        if (Safety_Params_PeriodicCheck() != PARAMS_VALID)
+        {
+            s_monitor_stats.errors_detected++;
+            /* Error already reported by Safety_Params_PeriodicCheck */
+        }
+
+#if CRASH_CAPTURE_ENABLED
+        /* === 8. Clear crash reset count after stable operation === */
+        if ((s_monitor_stats.run_count == (CRASH_STABLE_TIME_MS / SAFETY_MONITOR_PERIOD_MS)) &&
+            (Safety_GetState() == SAFETY_STATE_NORMAL))
+        {
+            Safety_Crash_ClearCount();
+        }
+#endif
+
         /* Sleep until next period */
         tx_thread_sleep(SAFETY_MONITOR_PERIOD_MS);
     }
@@ -102,7 +102,7 @@ static const mpu_region_config_t s_default_regions[] = {
         .enable = 1
     },
 
-    /* Region 4: Config Flash (16KB, RO, No Execute) */
+    /* Region 4: Config Flash (16KB, journal area A, RO, No Execute) */
     {
         .base_address = CONFIG_FLASH_START,
         .region_number = MPU_REGION_CONFIG,
@@ -130,6 +130,21 @@ static const mpu_region_config_t s_default_regions[] = {
         .tex = MPU_TEX_NORMAL_WTNA,
         .subregion_disable = 0xC0,          /* Disable upper subregions */
         .enable = 1
+    },
+
+    /* Region 6: Config Flash (16KB, journal area B, RO, No Execute) */
+    {
+        .base_address = CONFIG_AREA_B_START,
+        .region_number = MPU_REGION_CONFIG_B,
+        .size = MPU_REGION_SIZE_16KB,
+        .access_permission = MPU_AP_RO,
+        .execute_never = MPU_XN_ENABLE,
+        .shareable = 0,
+        .cacheable = 1,
+        .bufferable = 0,
+        .tex = MPU_TEX_NORMAL_WTNA,
+        .subregion_disable = 0,
+        .enable = 1
     }
 };
 
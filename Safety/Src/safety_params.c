@@ -8,6 +8,13 @@
  * @attention
  *
  * Parameter validation for functional safety
+ *
+ * Validated parameters are held in a RAM shadow together with their
+ * bit-inverted complement. Until a validation passes (or after it fails) the
+ * shadow holds neutral defaults, so readers never need a validity branch.
+ * Safety_Params_PeriodicCheck verifies PARAMS_SHADOW_CHECK_WORDS words per
+ * call against the complement and against the validated source image.
+ *
  * Target: STM32F407VGT6
  * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
  *
@@ -17,9 +24,11 @@
 /* Includes ------------------------------------------------------------------*/
 #include "safety_params.h"
 #include "safety_core.h"
+#include "safety_time.h"
+#include "params_schema.h"
+#include "config_journal.h"
 #include "stm32f4xx_hal.h"
 #include <string.h>
-#include <math.h>
 
 #if DIAG_RTT_ENABLED
 #include "bsp_debug.h"
@@ -29,7 +38,17 @@
  * Private Defines
  * ============================================================================*/
 
-#define FLOAT_TOLERANCE         0.0001f     /* Float comparison tolerance */
+#define PARAMS_SHADOW_WORDS     (sizeof(safety_params_t) / sizeof(uint32_t))
+
+/* Shadow is verified word by word */
+typedef char params_shadow_word_aligned[
+    ((sizeof(safety_params_t) % sizeof(uint32_t)) == 0U) ? 1 : -1];
+
+/* Word-aligned view of the packed parameter structure */
+typedef union {
+    safety_params_t params;
+    uint32_t words[PARAMS_SHADOW_WORDS];
+} params_image_t;
 
 /* ============================================================================
  * Private Variables
@@ -37,20 +56,22 @@
 
 static params_stats_t s_params_stats;
 static bool s_params_valid = false;
-static safety_params_t s_cached_params;
+
+/* RAM shadow: value image and bit-inverted complement */
+static params_image_t s_shadow;
+static uint32_t s_shadow_inv[PARAMS_SHADOW_WORDS];
+static const uint32_t *s_shadow_source = NULL;  /* Validated image, NULL if defaults */
+static uint32_t s_shadow_cursor = 0;            /* Next word to verify */
 
 /* ============================================================================
  * Private Function Prototypes
  * ============================================================================*/
 
 static params_result_t Params_ValidateHeader(const safety_params_t *params);
-static params_result_t Params_ValidateHallParams(const safety_params_t *params);
-static params_result_t Params_ValidateAdcParams(const safety_params_t *params);
-static params_result_t Params_ValidateThresholds(const safety_params_t *params);
-static params_result_t Params_ValidateRedundancy(const safety_params_t *params);
+static params_result_t Params_ValidateFields(const safety_params_t *params);
 static params_result_t Params_ValidateCRC(const safety_params_t *params);
-static bool Params_FloatInRange(float value, float min, float max);
-static bool Params_CheckFloatInverted(float val, float inv);
+static void Params_LoadShadow(const void *image, bool track_source);
+static void Params_LoadDefaults(void);
 
 /* ============================================================================
  * Public Functions
@@ -60,8 +81,8 @@ safety_status_t Safety_Params_Init(void)
 {
     /* Clear statistics */
     memset(&s_params_stats, 0, sizeof(params_stats_t));
-    memset(&s_cached_params, 0, sizeof(safety_params_t));
     s_params_valid = false;
+    Params_LoadDefaults();
 
 #if DIAG_RTT_ENABLED
     DEBUG_INFO("Safety Params: Module initialized");
@@ -74,16 +95,16 @@ params_result_t Safety_Params_Validate(const safety_params_t *params)
 {
     params_result_t result;
 
+    s_params_stats.validation_count++;
+    s_params_stats.last_validation_time = Safety_Time_GetUs();
+
+    /* Step 0: Parameters present */
     if (params == NULL)
     {
-        s_params_stats.fail_count++;
-        s_params_stats.last_result = PARAMS_ERR_NULL_PTR;
-        return PARAMS_ERR_NULL_PTR;
+        result = PARAMS_ERR_NULL_PTR;
+        goto validation_failed;
     }
 
-    s_params_stats.validation_count++;
-    s_params_stats.last_validation_time = HAL_GetTick();
-
     /* Step 1: Validate header (magic, version, size) */
     result = Params_ValidateHeader(params);
     if (result != PARAMS_VALID)
@@ -98,29 +119,8 @@ params_result_t Safety_Params_Validate(const safety_params_t *params)
         goto validation_failed;
     }
 
-    /* Step 3: Validate HALL parameters */
-    result = Params_ValidateHallParams(params);
-    if (result != PARAMS_VALID)
-    {
-        goto validation_failed;
-    }
-
-    /* Step 4: Validate ADC parameters */
-    result = Params_ValidateAdcParams(params);
-    if (result != PARAMS_VALID)
-    {
-        goto validation_failed;
-    }
-
-    /* Step 5: Validate thresholds */
-    result = Params_ValidateThresholds(params);
-    if (result != PARAMS_VALID)
-    {
-        goto validation_failed;
-    }
-
-    /* Step 6: Validate redundancy (inverted copies) */
-    result = Params_ValidateRedundancy(params);
+    /* Step 3: Validate ranges and redundancy (one pass over the schema) */
+    result = Params_ValidateFields(params);
     if (result != PARAMS_VALID)
     {
         goto validation_failed;
@@ -131,8 +131,8 @@ params_result_t Safety_Params_Validate(const safety_params_t *params)
     s_params_stats.last_result = PARAMS_VALID;
     s_params_valid = true;
 
-    /* Cache valid parameters */
-    memcpy(&s_cached_params, params, sizeof(safety_params_t));
+    /* Shadow valid parameters, later compared against the validated image */
+    Params_LoadShadow(params, true);
 
 #if DIAG_RTT_ENABLED
     DEBUG_INFO("Safety Params: Validation PASSED");
@@ -144,6 +144,7 @@ validation_failed:
     s_params_stats.fail_count++;
     s_params_stats.last_result = result;
     s_params_valid = false;
+    Params_LoadDefaults();
 
 #if DIAG_RTT_ENABLED
     DEBUG_ERROR("Safety Params: Validation FAILED (result=%d)", result);
@@ -157,10 +158,12 @@ validation_failed:
 
 params_result_t Safety_Params_ValidateFlash(void)
 {
-    const safety_params_t *flash_params = (const safety_params_t *)SAFETY_PARAMS_ADDR;
+    /* Latest record in the config journal, NULL if none */
+    const safety_params_t *flash_params =
+        (const safety_params_t *)Config_Journal_Find(JOURNAL_TYPE_SAFETY_PARAMS);
 
 #if DIAG_RTT_ENABLED
-    DEBUG_INFO("Safety Params: Validating Flash @ 0x%08lX", SAFETY_PARAMS_ADDR);
+    DEBUG_INFO("Safety Params: Validating Flash @ 0x%08lX", (uint32_t)flash_params);
 #endif
 
     return Safety_Params_Validate(flash_params);
@@ -204,7 +207,12 @@ params_result_t Safety_Params_ValidateBootConfig(const boot_config_t *config)
 
 const safety_params_t* Safety_Params_Get(void)
 {
-    return s_params_valid ? &s_cached_params : NULL;
+    return s_params_valid ? &s_shadow.params : NULL;
+}
+
+const safety_params_t* Safety_Params_GetShadow(void)
+{
+    return &s_shadow.params;
 }
 
 bool Safety_Params_IsValid(void)
@@ -219,37 +227,64 @@ const params_stats_t* Safety_Params_GetStats(void)
 
 params_result_t Safety_Params_PeriodicCheck(void)
 {
-    if (!s_params_valid)
+    const uint32_t *source = s_shadow_source;
+    uint32_t index = s_shadow_cursor;
+    params_result_t result = PARAMS_VALID;
+
+    for (uint32_t n = 0; n < PARAMS_SHADOW_CHECK_WORDS; n++)
     {
-        return PARAMS_ERR_NULL_PTR;
+        uint32_t word = s_shadow.words[index];
+
+        if (word != ~s_shadow_inv[index])
+        {
+            result = PARAMS_ERR_SHADOW;
+            break;
+        }
+
+        if ((source != NULL) && (word != source[index]))
+        {
+            result = PARAMS_ERR_CRC;
+            break;
+        }
+
+        index++;
+        if (index >= PARAMS_SHADOW_WORDS)
+        {
+            index = 0U;
+            s_params_stats.shadow_passes++;
+        }
     }
 
-    /* Re-validate cached parameters */
-    const safety_params_t *flash_params = (const safety_params_t *)SAFETY_PARAMS_ADDR;
+    s_shadow_cursor = index;
 
-    /* Quick CRC check */
-    params_result_t result = Params_ValidateCRC(flash_params);
     if (result != PARAMS_VALID)
     {
 #if DIAG_RTT_ENABLED
-        DEBUG_ERROR("Safety Params: Periodic check FAILED");
+        DEBUG_ERROR("Safety Params: Periodic check FAILED (result=%d, word=%lu)",
+                    result, index);
 #endif
+        s_params_stats.fail_count++;
+        s_params_stats.last_result = result;
+        s_params_stats.last_fail_index = index;
         s_params_valid = false;
-        Safety_ReportError(SAFETY_ERR_PARAM_INVALID, (uint32_t)result, 1);
-        return result;
+        Params_LoadDefaults();
+        Safety_ReportError(SAFETY_ERR_PARAM_INVALID, (uint32_t)result, index);
     }
 
-    return PARAMS_VALID;
+    return result;
 }
 
 uint32_t Safety_Params_CalculateCRC(const void *data, uint32_t size)
 {
-    /* Use hardware CRC unit */
-    CRC_HandleTypeDef hcrc;
-    hcrc.Instance = CRC;
+    /* Use hardware CRC unit, initialized on first use */
+    static CRC_HandleTypeDef hcrc;
 
-    __HAL_RCC_CRC_CLK_ENABLE();
-    HAL_CRC_Init(&hcrc);
+    if (hcrc.Instance == NULL)
+    {
+        hcrc.Instance = CRC;
+        __HAL_RCC_CRC_CLK_ENABLE();
+        HAL_CRC_Init(&hcrc);
+    }
 
     /* Reset CRC calculation unit */
     __HAL_CRC_DR_RESET(&hcrc);
@@ -282,34 +317,19 @@ uint32_t Safety_Params_CalculateCRC(const void *data, uint32_t size)
 
 static params_result_t Params_ValidateHeader(const safety_params_t *params)
 {
-    /* Check magic number */
-    if (params->magic != SAFETY_PARAMS_MAGIC)
-    {
-#if DIAG_RTT_ENABLED
-        DEBUG_ERROR("Params: Invalid magic 0x%08lX (expected 0x%08lX)",
-                    params->magic, SAFETY_PARAMS_MAGIC);
-#endif
-        return PARAMS_ERR_MAGIC;
-    }
+    static const params_result_t header_results[] = {
+        PARAMS_VALID, PARAMS_ERR_MAGIC, PARAMS_ERR_VERSION, PARAMS_ERR_SIZE
+    };
 
-    /* Check version */
-    if (params->version != SAFETY_PARAMS_VERSION)
-    {
-#if DIAG_RTT_ENABLED
-        DEBUG_WARN("Params: Version mismatch 0x%04X (expected 0x%04X)",
-                   params->version, SAFETY_PARAMS_VERSION);
-#endif
-        /* Version mismatch is warning, not error for now */
-    }
+    param_check_t check = Params_Schema_CheckHeader(params);
 
-    /* Check size */
-    if (params->size != sizeof(safety_params_t))
+    if (check != PARAM_CHECK_OK)
     {
 #if DIAG_RTT_ENABLED
-        DEBUG_ERROR("Params: Size mismatch %u (expected %u)",
-                    params->size, sizeof(safety_params_t));
+        DEBUG_ERROR("Params: Header invalid (magic=0x%08lX, version=0x%04X, size=%u)",
+                    params->magic, params->version, params->size);
 #endif
-        return PARAMS_ERR_SIZE;
+        return header_results[check];
     }
 
     return PARAMS_VALID;
@@ -333,133 +353,66 @@ static params_result_t Params_ValidateCRC(const safety_params_t *params)
     return PARAMS_VALID;
 }
 
-static params_result_t Params_ValidateHallParams(const safety_params_t *params)
+static params_result_t Params_ValidateFields(const safety_params_t *params)
 {
-    /* Validate HALL offset values */
-    for (int i = 0; i < 3; i++)
-    {
-        if (!Params_FloatInRange(params->hall_offset[i],
-                                 HALL_OFFSET_MIN, HALL_OFFSET_MAX))
-        {
-            s_params_stats.last_fail_index = i;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: HALL offset[%d] out of range: %f", i,
-                        (double)params->hall_offset[i]);
-#endif
-            return PARAMS_ERR_HALL_RANGE;
-        }
+    static const params_result_t range_results[] = {
+        PARAMS_ERR_HALL_RANGE,      /* PARAM_GROUP_HALL */
+        PARAMS_ERR_ADC_RANGE,       /* PARAM_GROUP_ADC */
+        PARAMS_ERR_THRESHOLD        /* PARAM_GROUP_THRESHOLD */
+    };
 
-        if (!Params_FloatInRange(params->hall_gain[i],
-                                 HALL_GAIN_MIN, HALL_GAIN_MAX))
-        {
-            s_params_stats.last_fail_index = i + 3;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: HALL gain[%d] out of range: %f", i,
-                        (double)params->hall_gain[i]);
-#endif
-            return PARAMS_ERR_HALL_RANGE;
-        }
-    }
+    param_fail_t fail;
+    param_check_t check = Params_Schema_CheckFields(params, PARAMS_CHECK_ALL, &fail);
 
-    return PARAMS_VALID;
-}
-
-static params_result_t Params_ValidateAdcParams(const safety_params_t *params)
-{
-    /* Validate ADC gain and offset values */
-    for (int i = 0; i < 8; i++)
+    if (check == PARAM_CHECK_OK)
     {
-        if (!Params_FloatInRange(params->adc_gain[i],
-                                 ADC_GAIN_MIN, ADC_GAIN_MAX))
-        {
-            s_params_stats.last_fail_index = i;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: ADC gain[%d] out of range: %f", i,
-                        (double)params->adc_gain[i]);
-#endif
-            return PARAMS_ERR_ADC_RANGE;
-        }
-
-        if (!Params_FloatInRange(params->adc_offset[i],
-                                 ADC_OFFSET_MIN, ADC_OFFSET_MAX))
-        {
-            s_params_stats.last_fail_index = i + 8;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: ADC offset[%d] out of range: %f", i,
-                        (double)params->adc_offset[i]);
-#endif
-            return PARAMS_ERR_ADC_RANGE;
-        }
+        return PARAMS_VALID;
     }
 
-    return PARAMS_VALID;
-}
+    s_params_stats.last_fail_index = fail.index;
 
-static params_result_t Params_ValidateThresholds(const safety_params_t *params)
-{
-    /* Validate safety threshold values */
-    for (int i = 0; i < 4; i++)
-    {
-        if (!Params_FloatInRange(params->safety_threshold[i],
-                                 SAFETY_THRESHOLD_MIN, SAFETY_THRESHOLD_MAX))
-        {
-            s_params_stats.last_fail_index = i;
 #if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: Threshold[%d] out of range: %f", i,
-                        (double)params->safety_threshold[i]);
+    DEBUG_ERROR("Params: Field %u[%u] %s", fail.field, fail.index,
+                (check == PARAM_CHECK_RANGE) ? "out of range" : "redundancy check failed");
 #endif
-            return PARAMS_ERR_THRESHOLD;
-        }
-    }
 
-    return PARAMS_VALID;
+    return (check == PARAM_CHECK_RANGE) ? range_results[fail.group] : PARAMS_ERR_REDUNDANCY;
 }
 
-static params_result_t Params_ValidateRedundancy(const safety_params_t *params)
+static void Params_LoadShadow(const void *image, bool track_source)
 {
-    /* Validate inverted copies of HALL parameters */
-    for (int i = 0; i < 3; i++)
-    {
-        if (!Params_CheckFloatInverted(params->hall_offset[i],
-                                       params->hall_offset_inv[i]))
-        {
-            s_params_stats.last_fail_index = i;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: HALL offset[%d] redundancy check failed", i);
-#endif
-            return PARAMS_ERR_REDUNDANCY;
-        }
-
-        if (!Params_CheckFloatInverted(params->hall_gain[i],
-                                       params->hall_gain_inv[i]))
-        {
-            s_params_stats.last_fail_index = i + 3;
-#if DIAG_RTT_ENABLED
-            DEBUG_ERROR("Params: HALL gain[%d] redundancy check failed", i);
-#endif
-            return PARAMS_ERR_REDUNDANCY;
-        }
-    }
+    /* Images are word aligned (Flash or params_image_t) */
+    const uint32_t *src = (const uint32_t *)image;
 
-    return PARAMS_VALID;
-}
+    /* Readers and the periodic check never see a half-written pair */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-static bool Params_FloatInRange(float value, float min, float max)
-{
-    /* Check for NaN or Inf */
-    if (isnan(value) || isinf(value))
+    for (uint32_t i = 0; i < PARAMS_SHADOW_WORDS; i++)
     {
-        return false;
+        s_shadow.words[i] = src[i];
+        s_shadow_inv[i] = ~src[i];
     }
+    s_shadow_source = track_source ? src : NULL;
+    s_shadow_cursor = 0U;
 
-    return (value >= min) && (value <= max);
+    __set_PRIMASK(primask);
 }
 
-static bool Params_CheckFloatInverted(float val, float inv)
+static void Params_LoadDefaults(void)
 {
-    /* Check if inv is bit-inverted copy of val */
-    uint32_t val_bits = *(uint32_t *)&val;
-    uint32_t inv_bits = *(uint32_t *)&inv;
+    /* Neutral calibration: zero offsets, unity gains, zero thresholds */
+    params_image_t defaults;
+
+    memset(&defaults, 0, sizeof(params_image_t));
+    for (uint32_t i = 0; i < 3U; i++)
+    {
+        defaults.params.hall_gain[i] = 1.0f;
+    }
+    for (uint32_t i = 0; i < 8U; i++)
+    {
+        defaults.params.adc_gain[i] = 1.0f;
+    }
 
-    return IS_INVERTED_32(val_bits, inv_bits);
+    Params_LoadShadow(defaults.words, false);
 }
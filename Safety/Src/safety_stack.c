@@ -10,11 +10,13 @@
 /* Includes ------------------------------------------------------------------*/
 #include "safety_stack.h"
 #include "safety_core.h"
+#include "safety_time.h"
 #include <string.h>
 
 /* Private variables ---------------------------------------------------------*/
 static TX_THREAD *s_monitored_threads[MAX_MONITORED_THREADS];
 static uint32_t s_monitored_count = 0;
+static stack_stats_t s_stack_stats;
 static bool s_initialized = false;
 
 /* ============================================================================
@@ -30,6 +32,7 @@ safety_status_t Safety_Stack_Init(void)
 {
     /* Clear monitored thread list */
     memset(s_monitored_threads, 0, sizeof(s_monitored_threads));
+    memset(&s_stack_stats, 0, sizeof(s_stack_stats));
     s_monitored_count = 0;
     s_initialized = true;
 
@@ -98,6 +101,7 @@ safety_status_t Safety_Stack_CheckAll(void)
 
     safety_status_t overall_status = SAFETY_OK;
     stack_info_t info;
+    uint64_t start_time = Safety_Time_GetUs();
 
     for (uint32_t i = 0; i < s_monitored_count; i++)
     {
@@ -107,6 +111,11 @@ safety_status_t Safety_Stack_CheckAll(void)
             safety_status_t status = Safety_Stack_GetInfo(thread, &info);
             if (status == SAFETY_OK)
             {
+                if (info.usage_percent > s_stack_stats.peak_usage_percent)
+                {
+                    s_stack_stats.peak_usage_percent = info.usage_percent;
+                }
+
                 if (info.critical)
                 {
                     Safety_ReportError(SAFETY_ERR_STACK_OVERFLOW,
@@ -122,6 +131,15 @@ safety_status_t Safety_Stack_CheckAll(void)
         }
     }
 
+    uint32_t duration = (uint32_t)(Safety_Time_GetUs() - start_time);
+    s_stack_stats.check_count++;
+    s_stack_stats.last_check_time = start_time;
+    s_stack_stats.last_duration_us = duration;
+    if (duration > s_stack_stats.max_duration_us)
+    {
+        s_stack_stats.max_duration_us = duration;
+    }
+
     return overall_status;
 }
 
@@ -199,6 +217,11 @@ safety_status_t Safety_Stack_GetInfoByIndex(uint32_t index, stack_info_t *info)
     return Safety_Stack_GetInfo(s_monitored_threads[index], info);
 }
 
+const stack_stats_t* Safety_Stack_GetStats(void)
+{
+    return &s_stack_stats;
+}
+
 void Safety_Stack_ErrorCallback(TX_THREAD *thread_ptr)
 {
     /* Called by ThreadX when stack error detected */
@@ -0,0 +1,129 @@
+/**
+ ******************************************************************************
+ * @file    safety_time.c
+ * @brief   Monotonic Safety Time Base Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * The upper 32 bits count CYCCNT wraps. A wrap is detected whenever the
+ * counter reads lower than the previous read, so any read (or the periodic
+ * Safety_Time_Update) within one CYCCNT period keeps the count exact.
+ *
+ * CYCCNT is shared with SystemView and RTT timestamps; it must not be
+ * reset after Safety_Time_Init.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "safety_time.h"
+#include "stm32f4xx_hal.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TIME_HZ_PER_MHZ             1000000UL
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t s_wrap_count = 0;       /* Upper 32 bits of the cycle count */
+static uint32_t s_last_cyccnt = 0;      /* CYCCNT at previous read */
+static uint64_t s_base_cycles = 0;      /* Cycle count at last calibration */
+static uint64_t s_base_us = 0;          /* Time at last calibration */
+static uint32_t s_cycles_per_us = 1U;   /* Conversion rate since calibration */
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static uint32_t Time_ReadCyclesPerUs(void);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+void Safety_Time_Init(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    s_wrap_count = 0U;
+    s_last_cyccnt = DWT->CYCCNT;
+    s_base_cycles = s_last_cyccnt;
+    s_base_us = 0U;
+    s_cycles_per_us = Time_ReadCyclesPerUs();
+
+    __set_PRIMASK(primask);
+}
+
+void Safety_Time_Calibrate(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* Close the interval measured at the old rate, continue at the new one */
+    uint64_t now = Safety_Time_GetCycles();
+    s_base_us += (now - s_base_cycles) / s_cycles_per_us;
+    s_base_cycles = now;
+    s_cycles_per_us = Time_ReadCyclesPerUs();
+
+    __set_PRIMASK(primask);
+}
+
+void Safety_Time_Update(void)
+{
+    (void)Safety_Time_GetCycles();
+}
+
+uint64_t Safety_Time_GetCycles(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t cyccnt = DWT->CYCCNT;
+    if (cyccnt < s_last_cyccnt)
+    {
+        s_wrap_count++;
+    }
+    s_last_cyccnt = cyccnt;
+
+    uint64_t cycles = ((uint64_t)s_wrap_count << 32) | cyccnt;
+
+    __set_PRIMASK(primask);
+
+    return cycles;
+}
+
+uint64_t Safety_Time_GetUs(void)
+{
+    uint64_t now = Safety_Time_GetCycles();
+
+    return s_base_us + ((now - s_base_cycles) / s_cycles_per_us);
+}
+
+uint64_t Safety_Time_GetMs(void)
+{
+    return SAFETY_TIME_US_TO_MS(Safety_Time_GetUs());
+}
+
+uint64_t Safety_Time_CyclesToUs(uint64_t cycles)
+{
+    return cycles / s_cycles_per_us;
+}
+
+uint32_t Safety_Time_GetCyclesPerUs(void)
+{
+    return s_cycles_per_us;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static uint32_t Time_ReadCyclesPerUs(void)
+{
+    uint32_t rate = SystemCoreClock / TIME_HZ_PER_MHZ;
+
+    return (rate > 0U) ? rate : 1U;
+}
@@ -10,6 +10,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "safety_watchdog.h"
 #include "safety_core.h"
+#include "safety_time.h"
 #include "stm32f4xx_hal.h"
 #include "iwdg.h"
 
@@ -23,7 +24,7 @@
 
 /* Private variables ---------------------------------------------------------*/
 static wdg_status_t s_wdg_status;
-static uint32_t s_token_timestamp[8]; /* Timestamp per token bit */
+static uint64_t s_token_timestamp[8]; /* Timestamp per token bit (us) */
 static bool s_initialized = false;
 
 /* ============================================================================
@@ -67,7 +68,7 @@ safety_status_t Safety_Watchdog_Start(void)
     /* IWDG is initialized by CubeMX in MX_IWDG_Init() */
     /* Just mark as enabled */
     s_wdg_status.enabled = true;
-    s_wdg_status.last_feed_time = HAL_GetTick();
+    s_wdg_status.last_feed_time = Safety_Time_GetUs();
 
     return SAFETY_OK;
 }
@@ -79,7 +80,7 @@ void Safety_Watchdog_ReportToken(wdg_token_t token)
         return;
     }
 
-    uint32_t current_time = HAL_GetTick();
+    uint64_t current_time = Safety_Time_GetUs();
 
     /* Record token */
     s_wdg_status.tokens_received |= token;
@@ -101,7 +102,7 @@ bool Safety_Watchdog_CheckAllTokens(void)
         return true; /* In degraded mode, always allow feeding */
     }
 
-    uint32_t current_time = HAL_GetTick();
+    uint64_t current_time = Safety_Time_GetUs();
 
     /* Check if all required tokens received within timeout */
     for (int i = 0; i < 8; i++)
@@ -116,7 +117,7 @@ bool Safety_Watchdog_CheckAllTokens(void)
             }
 
             /* Check token freshness */
-            if ((current_time - s_token_timestamp[i]) > WDG_TOKEN_TIMEOUT_MS)
+            if ((current_time - s_token_timestamp[i]) > SAFETY_TIME_MS_TO_US(WDG_TOKEN_TIMEOUT_MS))
             {
                 /* Token too old */
                 return false;
@@ -138,7 +139,7 @@ void Safety_Watchdog_FeedIWDG(void)
     HAL_IWDG_Refresh(&hiwdg);
 
     /* Update status */
-    s_wdg_status.last_feed_time = HAL_GetTick();
+    s_wdg_status.last_feed_time = Safety_Time_GetUs();
     s_wdg_status.feed_count++;
 
     /* Reset tokens for next cycle */
@@ -153,10 +154,9 @@ void Safety_Watchdog_Process(void)
     }
 
     /* Check if it's time to feed */
-    uint32_t current_time = HAL_GetTick();
-    uint32_t elapsed = current_time - s_wdg_status.last_feed_time;
+    uint64_t elapsed = Safety_Time_GetUs() - s_wdg_status.last_feed_time;
 
-    if (elapsed >= WDG_FEED_PERIOD_MS)
+    if (elapsed >= SAFETY_TIME_MS_TO_US(WDG_FEED_PERIOD_MS))
     {
         if (s_wdg_status.degraded_mode)
         {
@@ -230,7 +230,7 @@ safety_status_t Safety_Watchdog_StartWWDG(void)
     /* WWDG is initialized by CubeMX in MX_WWDG_Init() */
     /* Enable WWDG */
     s_wdg_status.wwdg_enabled = true;
-    s_wdg_status.wwdg_last_feed = HAL_GetTick();
+    s_wdg_status.wwdg_last_feed = Safety_Time_GetUs();
     s_wdg_status.wwdg_feed_count = 0;
 
 #if DIAG_RTT_ENABLED
@@ -250,7 +250,7 @@ void Safety_Watchdog_FeedWWDG(void)
     /* Refresh WWDG counter */
     HAL_WWDG_Refresh(&hwwdg);
 
-    s_wdg_status.wwdg_last_feed = HAL_GetTick();
+    s_wdg_status.wwdg_last_feed = Safety_Time_GetUs();
     s_wdg_status.wwdg_feed_count++;
 }
 
@@ -0,0 +1,205 @@
+/**
+ ******************************************************************************
+ * @file    svc_flashio.h
+ * @brief   W25Q128 I/O Queue Service Interface
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Requests to the external Flash are queued and served by two driver-owned
+ * threads: a read thread above the application threads and a write thread
+ * below them. A read is therefore never queued behind a program or erase;
+ * while an erase is running it is served by suspending it (see
+ * BSP_W25QXX_EnableSuspend).
+ *
+ * Request ordering:
+ *   - Writes, updates and erases are served in submission order.
+ *   - A read overlapping a queued or running write is queued behind it
+ *     (on the write thread), a write overlapping a queued read is queued
+ *     behind the read, so a read always returns the data of the requests
+ *     submitted before it.
+ *   - Adjacent small requests of the same kind, consecutive in their queue,
+ *     are served by one transfer of up to SVC_FLASHIO_MERGE_SIZE bytes.
+ *
+ * Completion: the request status is set, the callback is called (in the
+ * I/O thread), done is set, then the event flags are set; callback and
+ * event flags are optional. The service does not touch a request once done
+ * is set, so it may then be reused or go out of scope. The
+ * Svc_FlashIO_Read/Write/... functions submit and wait (synchronous);
+ * before the threads run they call the driver directly.
+ *
+ * Target: STM32F407VGT6
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SVC_FLASHIO_H
+#define __SVC_FLASHIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "tx_api.h"
+#include "shared_config.h"
+#include "bsp_w25qxx.h"
+
+/* ============================================================================
+ * Service Configuration
+ * ============================================================================*/
+
+/* Read thread above the application threads, write thread below them */
+#define SVC_FLASHIO_READ_STACK_SIZE     1024U
+#define SVC_FLASHIO_READ_PRIORITY       4U
+#define SVC_FLASHIO_READ_PREEMPT_THRESH 4U
+
+#define SVC_FLASHIO_WRITE_STACK_SIZE    1024U
+#define SVC_FLASHIO_WRITE_PRIORITY      12U
+#define SVC_FLASHIO_WRITE_PREEMPT_THRESH 12U
+
+/* Largest merged transfer (staging buffer of each thread) */
+#define SVC_FLASHIO_MERGE_SIZE          W25Q128_PAGE_SIZE
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Request operation
+ */
+typedef enum {
+    SVC_FLASHIO_OP_READ         = 0x00U,    /* BSP_W25QXX_Read */
+    SVC_FLASHIO_OP_WRITE        = 0x01U,    /* BSP_W25QXX_Write (erased area) */
+    SVC_FLASHIO_OP_UPDATE       = 0x02U,    /* BSP_W25QXX_WriteWithErase */
+    SVC_FLASHIO_OP_ERASE        = 0x03U     /* Sectors covering address..size */
+} svc_flashio_op_t;
+
+/**
+ * @brief Queue priority
+ */
+typedef enum {
+    SVC_FLASHIO_PRIO_READ       = 0x00U,    /* Reads (read thread) */
+    SVC_FLASHIO_PRIO_WRITE      = 0x01U,    /* Writes, updates, erases, ordered reads */
+    SVC_FLASHIO_PRIO_COUNT      = 0x02U
+} svc_flashio_prio_t;
+
+struct svc_flashio_request;
+
+/**
+ * @brief Completion callback (called from an I/O thread, must not block)
+ */
+typedef void (*svc_flashio_callback_t)(struct svc_flashio_request *request);
+
+/**
+ * @brief I/O request
+ */
+typedef struct svc_flashio_request {
+    /* Set by the caller */
+    svc_flashio_op_t op;
+    uint8_t *buffer;                            /* Data, NULL for an erase */
+    uint32_t address;                           /* Flash address */
+    uint32_t size;                              /* Bytes */
+    svc_flashio_callback_t callback;            /* May be NULL */
+    TX_EVENT_FLAGS_GROUP *event_flags;          /* May be NULL */
+    ULONG event_mask;                           /* Flags set (TX_OR) on completion */
+    void *context;                              /* For the caller */
+
+    /* Set by the service */
+    volatile w25qxx_status_t status;            /* Valid once done */
+    volatile bool done;
+    uint64_t submit_us;
+    struct svc_flashio_request *next;
+} svc_flashio_request_t;
+
+/**
+ * @brief Statistics of one queue
+ */
+typedef struct {
+    uint32_t requests;              /* Completed */
+    uint32_t merged;                /* Served by the transfer of another request */
+    uint32_t errors;                /* Completed with a driver error */
+    uint64_t bytes;                 /* Transferred (erases not counted) */
+    uint64_t busy_us;               /* Time spent in the driver */
+    uint32_t latency_avg_us;        /* Submission to completion */
+    uint32_t latency_max_us;
+    uint32_t depth_max;             /* Most requests queued */
+} svc_flashio_queue_stats_t;
+
+/**
+ * @brief Service statistics
+ */
+typedef struct {
+    svc_flashio_queue_stats_t queue[SVC_FLASHIO_PRIO_COUNT];
+    uint32_t reordered;             /* Reads queued behind an overlapping write */
+} svc_flashio_stats_t;
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Create the I/O threads
+ * @param byte_pool ThreadX byte pool for the thread stacks
+ * @retval UINT ThreadX status
+ * @note  Call after BSP_W25QXX_Init, with the driver lock enabled
+ *        (BSP_W25QXX_EnableSuspend) so direct callers stay safe
+ */
+UINT Svc_FlashIO_Init(TX_BYTE_POOL *byte_pool);
+
+/**
+ * @brief Queue a request
+ * @param request Request (op, buffer, address, size and completion set)
+ * @retval shared_status_t STATUS_OK if queued, STATUS_ERROR_INVALID if the
+ *         service is not running, STATUS_ERROR_RANGE for a bad request
+ * @note  Thread context; the request must not be modified until done
+ */
+shared_status_t Svc_FlashIO_Submit(svc_flashio_request_t *request);
+
+/**
+ * @brief Read and wait
+ * @param pBuffer Destination
+ * @param addr Flash address
+ * @param size Bytes
+ * @retval w25qxx_status_t Driver status
+ */
+w25qxx_status_t Svc_FlashIO_Read(uint8_t *pBuffer, uint32_t addr, uint32_t size);
+
+/**
+ * @brief Program an erased area and wait
+ * @param pBuffer Data
+ * @param addr Flash address
+ * @param size Bytes
+ * @retval w25qxx_status_t Driver status
+ */
+w25qxx_status_t Svc_FlashIO_Write(const uint8_t *pBuffer, uint32_t addr, uint32_t size);
+
+/**
+ * @brief Write with erase and wait
+ * @param pBuffer Data
+ * @param addr Flash address
+ * @param size Bytes
+ * @retval w25qxx_status_t Driver status
+ */
+w25qxx_status_t Svc_FlashIO_Update(const uint8_t *pBuffer, uint32_t addr, uint32_t size);
+
+/**
+ * @brief Erase a sector and wait
+ * @param sectorAddr Any address in the sector
+ * @retval w25qxx_status_t Driver status
+ */
+w25qxx_status_t Svc_FlashIO_EraseSector(uint32_t sectorAddr);
+
+/**
+ * @brief Get the service statistics
+ * @param stats Statistics (output)
+ * @note  Throughput of a queue: bytes / busy_us (MB/s)
+ */
+void Svc_FlashIO_GetStats(svc_flashio_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SVC_FLASHIO_H */
@@ -0,0 +1,244 @@
+/**
+ ******************************************************************************
+ * @file    svc_kvstore.h
+ * @brief   Key-Value Store Service Interface (External SPI Flash)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Log-structured store for non-safety parameters. Every update appends a
+ * record to the active sector; the latest record of a key wins. At mount
+ * the sectors are scanned once, oldest first, into a RAM hash index
+ * (key -> record address), so a get is one index probe and one Flash
+ * read, and a set is one index probe and one Flash program.
+ *
+ * When the active sector is full the next free sector is opened. When no
+ * free sector is left, the live records of the oldest sector are copied
+ * to the active one and the oldest sector is retired (garbage collection,
+ * one sector at a time). One sector is always kept free for this.
+ *
+ * Sector layout:
+ *   svc_kv_sector_header_t  magic, sequence (higher = newer)
+ *   records...
+ *
+ * Record layout (word aligned):
+ *   svc_kv_record_header_t  key, value length (0 = deleted), magic
+ *   value                   padded with 0xFF to a word
+ *   uint16_t, uint16_t      CRC16 over header and value, ~CRC16
+ *
+ * Safety parameters stay in internal Flash (config journal); this store
+ * is for parameters whose loss only means falling back to defaults.
+ *
+ * Target: STM32F407VGT6
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SVC_KVSTORE_H
+#define __SVC_KVSTORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "shared_config.h"
+
+/* ============================================================================
+ * Store Configuration
+ * ============================================================================*/
+
+/* Store area on the W25Q128 (last 32KB, the rest is left for file data) */
+#define SVC_KV_W25Q_SECTOR_SIZE     4096U
+#define SVC_KV_W25Q_SECTOR_COUNT    8U
+#define SVC_KV_W25Q_BASE            ((16U * 1024U * 1024U) - \
+                                     (SVC_KV_W25Q_SECTOR_COUNT * SVC_KV_W25Q_SECTOR_SIZE))
+
+#define SVC_KV_MAX_SECTORS          16U     /* Largest sector count of a backend */
+#define SVC_KV_MAX_VALUE            64U     /* Largest value (bytes) */
+#define SVC_KV_INDEX_BITS           6U
+#define SVC_KV_INDEX_SIZE           (1U << SVC_KV_INDEX_BITS)
+#define SVC_KV_MAX_KEYS             ((SVC_KV_INDEX_SIZE * 3U) / 4U)  /* Short probe chains */
+
+#define SVC_KV_SECTOR_MAGIC         0x4B565331UL    /* "KVS1" */
+#define SVC_KV_RECORD_MAGIC         0xA5U
+#define SVC_KV_KEY_NONE             0xFFFFU /* Erased Flash, not a valid key */
+#define SVC_KV_ADDR_NONE            0xFFFFFFFFUL
+
+/* Benchmark of mount and get/set latency on a RAM-simulated Flash */
+#define SVC_KV_BENCHMARK_ENABLED    0
+#define SVC_KV_SIM_SECTOR_COUNT     4U      /* 16KB of RAM when enabled */
+#define SVC_KV_BENCH_KEYS           32U
+#define SVC_KV_BENCH_UPDATES        1024U   /* Enough to garbage collect every sector */
+
+/* ============================================================================
+ * Non-Safety Parameter Keys
+ * ============================================================================*/
+
+#define SVC_KV_KEY_CAN_BAUDRATE     0x0101U /* uint32_t */
+#define SVC_KV_KEY_CAN_ID_BASE      0x0102U /* uint32_t */
+#define SVC_KV_KEY_COMM_TIMEOUT     0x0103U /* uint16_t */
+
+#define SVC_KV_CAN_BAUDRATE_MIN     125000U
+#define SVC_KV_CAN_BAUDRATE_MAX     1000000U
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Flash backend (addresses relative to the store start)
+ * @note  program only clears bits (NOR semantics), erase sets a sector to 0xFF
+ */
+typedef struct {
+    shared_status_t (*read)(uint32_t address, void *data, uint32_t size);
+    shared_status_t (*program)(uint32_t address, const void *data, uint32_t size);
+    shared_status_t (*erase)(uint32_t address);
+    uint32_t sector_size;                       /* Erase unit (bytes) */
+    uint32_t sector_count;                      /* 3 to SVC_KV_MAX_SECTORS */
+} svc_kv_flash_t;
+
+/**
+ * @brief Sector header (first word of a used sector)
+ */
+typedef struct {
+    uint32_t magic;                 /* SVC_KV_SECTOR_MAGIC, 0 when retired */
+    uint32_t sequence;              /* Allocation order, never 0 */
+} svc_kv_sector_header_t;
+
+/**
+ * @brief Record header
+ */
+typedef struct {
+    uint16_t key;                   /* Key, SVC_KV_KEY_NONE in erased Flash */
+    uint8_t  length;                /* Value bytes, 0 = key deleted */
+    uint8_t  magic;                 /* SVC_KV_RECORD_MAGIC */
+} svc_kv_record_header_t;
+
+/**
+ * @brief Hash index entry
+ */
+typedef struct {
+    uint16_t key;                   /* SVC_KV_KEY_NONE = free slot */
+    uint8_t  length;                /* Value bytes, 0 = deleted */
+    uint8_t  reserved;
+    uint32_t address;               /* Latest record, SVC_KV_ADDR_NONE if deleted */
+} svc_kv_entry_t;
+
+/**
+ * @brief Store instance
+ */
+typedef struct {
+    const svc_kv_flash_t *flash;                /* Backend */
+    svc_kv_entry_t index[SVC_KV_INDEX_SIZE];    /* Open addressing, linear probing */
+    uint32_t sequence[SVC_KV_MAX_SECTORS];      /* Sector sequence, 0 = free */
+    uint32_t next_sequence;                     /* Sequence of the next sector opened */
+    uint32_t active;                            /* Sector receiving records */
+    uint32_t write_offset;                      /* Free space start in the active sector */
+    uint32_t keys;                              /* Index slots in use */
+    uint32_t gc_count;                          /* Sectors garbage collected */
+    bool     mounted;
+} svc_kv_store_t;
+
+/**
+ * @brief Benchmark result (CPU cycles)
+ */
+typedef struct {
+    uint32_t mount_cycles;          /* Mount of a full store */
+    uint32_t get_avg_cycles;
+    uint32_t get_max_cycles;
+    uint32_t set_avg_cycles;
+    uint32_t set_max_cycles;        /* Includes garbage collection */
+    uint32_t gc_count;              /* Sectors collected during the run */
+    uint32_t cycles_per_us;         /* For conversion to time */
+} svc_kv_benchmark_t;
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Mount a store: build the hash index, format if empty
+ * @param store Store instance
+ * @param flash Backend
+ * @retval shared_status_t Status
+ */
+shared_status_t Svc_KV_Mount(svc_kv_store_t *store, const svc_kv_flash_t *flash);
+
+/**
+ * @brief Read the latest value of a key
+ * @param store Store instance
+ * @param key Key
+ * @param value Value buffer (output)
+ * @param size Buffer size
+ * @param length Value bytes (output, may be NULL)
+ * @retval shared_status_t STATUS_OK, STATUS_ERROR_INVALID if the key is not
+ *         present, STATUS_ERROR_CRC if the record no longer verifies
+ */
+shared_status_t Svc_KV_Get(svc_kv_store_t *store, uint16_t key,
+                           void *value, uint32_t size, uint32_t *length);
+
+/**
+ * @brief Write a value (skipped if unchanged)
+ * @param store Store instance
+ * @param key Key
+ * @param value Value
+ * @param length Value bytes (1 to SVC_KV_MAX_VALUE)
+ * @retval shared_status_t Status
+ * @note  Not reentrant: one thread per store, or locked by the caller
+ */
+shared_status_t Svc_KV_Set(svc_kv_store_t *store, uint16_t key,
+                           const void *value, uint32_t length);
+
+/**
+ * @brief Delete a key
+ * @param store Store instance
+ * @param key Key
+ * @retval shared_status_t Status
+ */
+shared_status_t Svc_KV_Delete(svc_kv_store_t *store, uint16_t key);
+
+/**
+ * @brief Get the W25Q128 backend (requires BSP_W25QXX_Init)
+ * @retval const svc_kv_flash_t* Backend
+ */
+const svc_kv_flash_t* Svc_KV_GetW25qFlash(void);
+
+/**
+ * @brief Mount the parameter store on the W25Q128 and load the
+ *        non-safety parameters (defaults for missing keys)
+ * @retval shared_status_t Status of the mount, defaults are loaded on failure
+ * @note  Call after BSP_W25QXX_Init
+ */
+shared_status_t Svc_KV_Init(void);
+
+/**
+ * @brief Get the non-safety parameters (read-only)
+ * @retval const nonsafety_params_t* Parameters, defaults if not stored
+ */
+const nonsafety_params_t* Svc_KV_GetNonSafety(void);
+
+/**
+ * @brief Store the non-safety parameters (unchanged keys are not written)
+ * @param params Parameters
+ * @retval shared_status_t Status
+ */
+shared_status_t Svc_KV_SaveNonSafety(const nonsafety_params_t *params);
+
+#if SVC_KV_BENCHMARK_ENABLED
+/**
+ * @brief Benchmark mount and get/set latency on a RAM-simulated Flash
+ * @param result Result (output)
+ * @retval shared_status_t Status
+ * @note  Measures the store itself; add the SPI transfer times of the
+ *        W25Q128 for the device figures
+ */
+shared_status_t Svc_KV_Benchmark(svc_kv_benchmark_t *result);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SVC_KVSTORE_H */
@@ -0,0 +1,191 @@
+/**
+ ******************************************************************************
+ * @file    svc_logger.h
+ * @brief   Sensor Data Logger Service Interface (SD card)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Continuous capture of ADC and HALL samples to a file. The acquisition
+ * thread pushes fixed-size records into a single-producer ring; a writer
+ * thread below the application threads writes the ring to the file in
+ * whole chunks:
+ *   - Push never blocks: it copies the record and publishes it with one
+ *     index store (no lock shared with the writer). When the ring is full
+ *     the record is dropped and counted; its sequence number is skipped,
+ *     so the gaps show in the file.
+ *   - A chunk is SVC_LOGGER_CHUNK_SIZE bytes at a chunk-aligned file
+ *     offset (whole sectors), written straight from the ring: FileX
+ *     transfers it between the card and the ring without the media cache.
+ *   - The file is allocated at start (SVC_LOGGER_FILE_SIZE, contiguous on
+ *     a card with free space), so a chunk write never touches the FAT.
+ *     The directory entry (file size) and the FAT are written only at the
+ *     checkpoints: every SVC_LOGGER_CHECKPOINT_SIZE bytes and at stop.
+ *     After a power loss the file holds the data up to the last
+ *     checkpoint.
+ *
+ * Record layout (little-endian, svc_logger_sample_t): time, sequence,
+ * 8 ADC channels, 3 HALL channels, flags.
+ *
+ * Target: STM32F407VGT6
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SVC_LOGGER_H
+#define __SVC_LOGGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "tx_api.h"
+#include "fx_api.h"
+#include "shared_config.h"
+
+/* ============================================================================
+ * Service Configuration
+ * ============================================================================*/
+
+/* Writer thread below the application threads */
+#define SVC_LOGGER_STACK_SIZE           1024U
+#define SVC_LOGGER_PRIORITY             11U
+#define SVC_LOGGER_PREEMPT_THRESH       11U
+
+#define SVC_LOGGER_ADC_CHANNELS         8U
+#define SVC_LOGGER_HALL_CHANNELS        3U
+
+/* Ring of SVC_LOGGER_CHUNKS chunks (16KB, not CCM: the SDIO DMA reads it) */
+#define SVC_LOGGER_CHUNK_SIZE           4096U   /* 8 sectors, one driver request */
+#define SVC_LOGGER_CHUNKS               4U      /* Power of 2 */
+
+#define SVC_LOGGER_FILE_SIZE            (64UL * 1024UL * 1024UL)   /* Allocated at start */
+#define SVC_LOGGER_CHECKPOINT_SIZE      (1024UL * 1024UL)          /* Metadata commit interval */
+
+/* Benchmark at start-up on the SD media (see Svc_Logger_Benchmark) */
+#define SVC_LOGGER_BENCHMARK_ENABLED    0
+#define SVC_LOGGER_BENCH_FILE           "LOGBENCH.BIN"
+#define SVC_LOGGER_BENCH_SIZE           (8UL * 1024UL * 1024UL)
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Logged record (32 bytes, a whole number per sector)
+ */
+typedef struct {
+    uint32_t time_us;                               /* Acquisition time (set by the caller) */
+    uint32_t sequence;                              /* Set by Svc_Logger_Push, dropped ones skipped */
+    uint16_t adc[SVC_LOGGER_ADC_CHANNELS];          /* Raw ADC counts */
+    int16_t hall[SVC_LOGGER_HALL_CHANNELS];         /* Raw HALL readings */
+    uint16_t flags;                                 /* For the caller */
+} svc_logger_sample_t;
+
+/**
+ * @brief Logger state
+ */
+typedef enum {
+    SVC_LOGGER_IDLE             = 0x00U,    /* No file open */
+    SVC_LOGGER_RUNNING          = 0x01U,    /* Pushed records are written */
+    SVC_LOGGER_FULL             = 0x02U,    /* File size reached, records dropped */
+    SVC_LOGGER_FAILED           = 0x03U     /* FileX error (last_error), records dropped */
+} svc_logger_state_t;
+
+/**
+ * @brief Service statistics (since Svc_Logger_Start)
+ */
+typedef struct {
+    svc_logger_state_t state;
+    uint32_t pushed;                /* Records accepted */
+    uint32_t dropped;               /* Records rejected (ring full or not running) */
+    uint32_t ring_max;              /* Most records in the ring */
+    uint32_t push_max_cycles;       /* Longest Svc_Logger_Push (producer stall) */
+    uint32_t full_max_us;           /* Longest time the ring stayed full */
+    uint64_t bytes;                 /* Written to the file */
+    uint32_t chunks;                /* Chunk writes */
+    uint32_t write_max_us;          /* Longest chunk write */
+    uint32_t checkpoints;
+    uint32_t checkpoint_max_us;     /* Longest metadata commit */
+    UINT last_error;                /* FileX status of the failure */
+} svc_logger_stats_t;
+
+/**
+ * @brief Benchmark result
+ */
+typedef struct {
+    uint32_t rate_kbs;              /* Sustained kB/s, first record to stop */
+    uint32_t elapsed_ms;
+    uint32_t stop_ms;               /* Last records, unused clusters released, close */
+    uint32_t push_max_ns;           /* Longest Svc_Logger_Push */
+    uint32_t stall_max_us;          /* Longest wait of the producer for room */
+    uint32_t write_max_us;
+    uint32_t checkpoint_max_us;
+    uint32_t write_requests;        /* Driver write requests, first record to stop */
+} svc_logger_benchmark_t;
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Create the writer thread
+ * @param byte_pool ThreadX byte pool for the thread stack
+ * @retval UINT ThreadX status
+ */
+UINT Svc_Logger_Init(TX_BYTE_POOL *byte_pool);
+
+/**
+ * @brief Create (or replace) the log file, allocate it and start logging
+ * @param media Opened FileX media
+ * @param file_name File name
+ * @retval shared_status_t STATUS_OK, STATUS_ERROR_INVALID if not idle or
+ *         the service is not running, STATUS_ERROR on a FileX error
+ *         (stats.last_error)
+ * @note  Thread context; clears the statistics
+ */
+shared_status_t Svc_Logger_Start(FX_MEDIA *media, const CHAR *file_name);
+
+/**
+ * @brief Write the records pushed so far, close the file and wait
+ * @retval shared_status_t STATUS_OK, STATUS_ERROR_INVALID if idle,
+ *         STATUS_ERROR if logging failed or the close failed
+ * @note  Thread context, not the producer's if it cannot wait
+ */
+shared_status_t Svc_Logger_Stop(void);
+
+/**
+ * @brief Queue a record (single producer)
+ * @param sample Record, sequence is set by the service
+ * @retval shared_status_t STATUS_OK, STATUS_ERROR_TIMEOUT if dropped
+ *         (ring full), STATUS_ERROR_INVALID if not running
+ * @note  One producer thread only; never blocks. Wakes the writer when a
+ *        chunk is complete, so the producer must run above
+ *        SVC_LOGGER_PRIORITY (the wake-up would otherwise run the write).
+ */
+shared_status_t Svc_Logger_Push(const svc_logger_sample_t *sample);
+
+/**
+ * @brief Get the service statistics
+ * @param stats Statistics (output)
+ */
+void Svc_Logger_GetStats(svc_logger_stats_t *stats);
+
+/**
+ * @brief Log SVC_LOGGER_BENCH_SIZE bytes at the producer's full speed
+ * @param media Opened FileX media
+ * @param result Result (output)
+ * @retval shared_status_t As Svc_Logger_Start/Stop
+ * @note  The calling thread is the producer: when the ring is full it
+ *        sleeps a tick and retries (stall_max_us), so nothing is dropped.
+ *        Deletes SVC_LOGGER_BENCH_FILE afterwards. Logging must be idle.
+ */
+shared_status_t Svc_Logger_Benchmark(FX_MEDIA *media, svc_logger_benchmark_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SVC_LOGGER_H */
@@ -8,6 +8,17 @@
  * @attention
  *
  * Service for reading and validating safety parameters from Flash
+ *
+ * Calibration is also provided as one precomputed batch (float, Q15 and
+ * Q31 gains, integer offsets) and applied to whole DMA blocks in integer
+ * arithmetic, so sample conversion needs no FPU in interrupt context.
+ *
+ * Parameters and coefficients are published as one set through a pointer
+ * (read-copy-update): a reload builds and validates the next set in the
+ * spare buffer, then swaps the pointer. Readers bracket their use with
+ * Svc_Params_ReadBegin/End, which only store a word each; the spare buffer
+ * is reused only after every reader has left the set it was holding.
+ *
  * Target: STM32F407VGT6
  * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
  *
@@ -24,6 +35,67 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "shared_config.h"
 
+/* ============================================================================
+ * Calibration Definitions
+ * ============================================================================*/
+
+#define SVC_CAL_ADC_CHANNELS        8U
+#define SVC_CAL_HALL_CHANNELS       3U
+
+/*
+ * Fixed-point gain = fraction * 2^shift (CMSIS-DSP arm_scale convention).
+ * The shift keeps the largest allowed gain below 1.0 as a fraction.
+ */
+#define SVC_CAL_ADC_GAIN_SHIFT      1U      /* ADC_GAIN_MAX 1.2 < 2^1 */
+#define SVC_CAL_HALL_GAIN_SHIFT     2U      /* HALL_GAIN_MAX 2.0 < 2^2 */
+
+/* ============================================================================
+ * Publication Definitions
+ * ============================================================================*/
+
+#define SVC_PARAMS_MAX_READERS      4U      /* Registered reader contexts */
+#define SVC_PARAMS_READER_NONE      0xFFFFFFFFUL
+#define SVC_PARAMS_GRACE_TICKS      100U    /* Longest wait for readers to leave a set */
+#define SVC_PARAMS_RELOAD_TICKS     1000U   /* Poll period for a new calibration record */
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Calibration coefficients of one sensor group
+ * @note  calibrated = raw * gain + offset. Arrays are word aligned; Q15
+ *        arrays hold an even number of entries for paired access.
+ */
+typedef struct {
+    float    gain[SVC_CAL_ADC_CHANNELS];        /* Gain */
+    float    offset[SVC_CAL_ADC_CHANNELS];      /* Offset (raw counts) */
+    int32_t  gain_q31[SVC_CAL_ADC_CHANNELS];    /* Gain fraction, Q31 */
+    int32_t  offset_q31[SVC_CAL_ADC_CHANNELS];  /* Offset, rounded counts */
+    int16_t  gain_q15[SVC_CAL_ADC_CHANNELS];    /* Gain fraction, Q15 */
+    int16_t  offset_q15[SVC_CAL_ADC_CHANNELS];  /* Offset, rounded counts */
+    uint32_t gain_shift;                        /* Gain = fraction * 2^shift */
+    uint32_t channels;                          /* Channels in use */
+} svc_cal_group_t;
+
+/**
+ * @brief Calibration batch (all ADC and HALL channels)
+ */
+typedef struct {
+    svc_cal_group_t adc;            /* ADC channels 0-7 */
+    svc_cal_group_t hall;           /* HALL channels 0-2 */
+    bool            valid;          /* false: neutral gain 1, offset 0 */
+} svc_calibration_t;
+
+/**
+ * @brief Published parameter set (never written while published)
+ */
+typedef struct {
+    svc_calibration_t calibration;  /* Coefficients of params */
+    safety_params_t   params;       /* Validated parameters */
+    uint32_t          generation;   /* Publication count, 0 = none yet */
+} svc_params_set_t;
+
 /* ============================================================================
  * Function Prototypes
  * ============================================================================*/
@@ -47,10 +119,39 @@ shared_status_t Svc_Params_Validate(void);
 bool Svc_Params_IsValid(void);
 
 /**
- * @brief Get safety parameters pointer (read-only)
- * @retval const safety_params_t* Parameters pointer
+ * @brief Reload the safety parameters from Flash at runtime
+ * @retval shared_status_t STATUS_OK if the new set is published (or
+ *         unchanged); on a validation failure the current set stays
+ *         published, STATUS_ERROR_TIMEOUT if a reader held the spare set
+ *         for longer than SVC_PARAMS_GRACE_TICKS
+ * @note  Thread context, polled every SVC_PARAMS_RELOAD_TICKS by the comm
+ *        thread. Returns at once while the latest journal record is the
+ *        one already loaded; a new record is checked off to the side
+ *        before the safety shadow is moved to it. The application never
+ *        writes the journal: a new record at runtime comes only from the
+ *        calibration tool over the debug port.
+ */
+shared_status_t Svc_Params_Reload(void);
+
+/**
+ * @brief Register a reader context (thread or interrupt)
+ * @retval uint32_t Reader ID, SVC_PARAMS_READER_NONE if all slots are taken
  */
-const safety_params_t* Svc_Params_GetSafety(void);
+uint32_t Svc_Params_RegisterReader(void);
+
+/**
+ * @brief Enter a read-side section
+ * @param reader Reader ID
+ * @retval const svc_params_set_t* Current set, unchanged until ReadEnd
+ * @note  Lock-free, callable from interrupt context. Not nestable per reader.
+ */
+const svc_params_set_t* Svc_Params_ReadBegin(uint32_t reader);
+
+/**
+ * @brief Leave a read-side section
+ * @param reader Reader ID
+ */
+void Svc_Params_ReadEnd(uint32_t reader);
 
 /**
  * @brief Get boot configuration pointer (read-only)
@@ -93,6 +194,40 @@ float Svc_Params_GetAdcOffset(uint8_t channel);
  */
 float Svc_Params_GetSafetyThreshold(uint8_t index);
 
+/**
+ * @brief Get the calibration batch of a set
+ * @param set Set returned by Svc_Params_ReadBegin
+ * @retval const svc_calibration_t* Coefficients, neutral ones if the
+ *         parameters are not valid (never NULL), valid until ReadEnd
+ * @note  No FPU use, callable from interrupt context. The block functions
+ *        below hold the set of their reader themselves.
+ */
+const svc_calibration_t* Svc_Params_GetCalibration(const svc_params_set_t *set);
+
+/**
+ * @brief Calibrate a block of ADC samples (Q15 path)
+ * @param reader Reader ID of the calling context (thread or interrupt)
+ * @param raw Interleaved samples, SVC_CAL_ADC_CHANNELS per frame (DMA scan order)
+ * @param out Calibrated samples, saturated to int16 (may equal raw)
+ * @param frames Number of frames
+ * @note  No FPU use, callable from interrupt context. Enters and leaves a
+ *        read-side section of reader: not callable inside one of its own.
+ */
+void Svc_Params_CalibrateAdcBlock(uint32_t reader, const uint16_t *raw, int16_t *out,
+                                  uint32_t frames);
+
+/**
+ * @brief Calibrate a block of HALL samples (Q15 path)
+ * @param reader Reader ID of the calling context (thread or interrupt)
+ * @param raw Interleaved samples, SVC_CAL_HALL_CHANNELS per frame
+ * @param out Calibrated samples, saturated to int16 (may equal raw)
+ * @param frames Number of frames
+ * @note  No FPU use, callable from interrupt context. Enters and leaves a
+ *        read-side section of reader: not callable inside one of its own.
+ */
+void Svc_Params_CalibrateHallBlock(uint32_t reader, const uint16_t *raw, int16_t *out,
+                                   uint32_t frames);
+
 #ifdef __cplusplus
 }
 #endif
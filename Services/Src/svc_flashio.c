@@ -0,0 +1,642 @@
+/**
+ ******************************************************************************
+ * @file    svc_flashio.c
+ * @brief   W25Q128 I/O Queue Service Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Each queue is an intrusive FIFO of caller-owned requests, linked and
+ * unlinked with interrupts masked; no memory is allocated per request.
+ * The overlap checks walk the queues, which stay short (one request per
+ * waiting thread unless callers queue asynchronously).
+ *
+ * A thread takes a batch (a request, plus the adjacent requests merged
+ * with it) and calls the driver with the lock taken by the driver itself,
+ * so the queue and direct driver callers can be mixed.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "svc_flashio.h"
+#include "safety_stack.h"
+#include "safety_time.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define FLASHIO_SECTOR_MASK         (W25Q128_SECTOR_SIZE - 1U)
+#define FLASHIO_SYNC_FLAG           0x01UL
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    svc_flashio_request_t *head;
+    svc_flashio_request_t *tail;
+    uint32_t depth;                             /* Requests queued */
+    uint32_t active_start;                      /* Flash range of the batch in */
+    uint32_t active_end;                        /* progress (start == end: none) */
+    uint64_t latency_total_us;
+    svc_flashio_queue_stats_t stats;
+    TX_SEMAPHORE work;                          /* Put once per submission */
+    TX_THREAD thread;
+    UCHAR *stack;
+} flashio_queue_t;
+
+typedef struct {
+    const CHAR *name;
+    ULONG stack_size;
+    UINT priority;
+    UINT preempt_threshold;
+} flashio_thread_config_t;
+
+/* Private variables ---------------------------------------------------------*/
+static flashio_queue_t s_queues[SVC_FLASHIO_PRIO_COUNT];
+static bool s_running = false;
+static uint32_t s_reordered = 0U;
+
+/* Merged transfers of each thread, updates of the write thread (not CCM: DMA) */
+static uint8_t s_stage[SVC_FLASHIO_PRIO_COUNT][SVC_FLASHIO_MERGE_SIZE];
+static uint8_t s_work[W25Q128_SECTOR_SIZE];
+
+static const flashio_thread_config_t s_thread_config[SVC_FLASHIO_PRIO_COUNT] = {
+    { (const CHAR *)"Flash Read",  SVC_FLASHIO_READ_STACK_SIZE,
+      SVC_FLASHIO_READ_PRIORITY,  SVC_FLASHIO_READ_PREEMPT_THRESH },
+    { (const CHAR *)"Flash Write", SVC_FLASHIO_WRITE_STACK_SIZE,
+      SVC_FLASHIO_WRITE_PRIORITY, SVC_FLASHIO_WRITE_PREEMPT_THRESH }
+};
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static VOID FlashIO_ThreadEntry(ULONG thread_input);
+static bool FlashIO_Serve(svc_flashio_prio_t prio);
+static svc_flashio_request_t* FlashIO_TakeBatch(flashio_queue_t *queue,
+                                                uint32_t *start, uint32_t *end);
+static w25qxx_status_t FlashIO_Execute(svc_flashio_prio_t prio, svc_flashio_request_t *batch,
+                                       uint32_t start, uint32_t end);
+static w25qxx_status_t FlashIO_Transfer(const svc_flashio_request_t *request);
+static void FlashIO_Complete(flashio_queue_t *queue, svc_flashio_request_t *request,
+                             w25qxx_status_t status, uint64_t now_us);
+static void FlashIO_Append(flashio_queue_t *queue, svc_flashio_request_t *request);
+static bool FlashIO_OverlapsWrites(uint32_t start, uint32_t end);
+static bool FlashIO_IsActive(svc_flashio_prio_t prio, uint32_t start, uint32_t end);
+static void FlashIO_OrderReads(uint32_t start, uint32_t end);
+static void FlashIO_GetRange(const svc_flashio_request_t *request,
+                             uint32_t *start, uint32_t *end);
+static bool FlashIO_IsMergeable(const svc_flashio_request_t *request);
+static w25qxx_status_t FlashIO_Sync(svc_flashio_op_t op, uint8_t *pBuffer,
+                                    uint32_t addr, uint32_t size);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+UINT Svc_FlashIO_Init(TX_BYTE_POOL *byte_pool)
+{
+    UINT status;
+
+    if (byte_pool == NULL)
+    {
+        return TX_PTR_ERROR;
+    }
+
+    for (uint32_t prio = 0U; prio < SVC_FLASHIO_PRIO_COUNT; prio++)
+    {
+        flashio_queue_t *queue = &s_queues[prio];
+        const flashio_thread_config_t *config = &s_thread_config[prio];
+
+        status = tx_semaphore_create(&queue->work, (CHAR *)config->name, 0U);
+        if (status != TX_SUCCESS)
+        {
+            return status;
+        }
+
+        status = tx_byte_allocate(byte_pool, (VOID **)&queue->stack,
+                                  config->stack_size, TX_NO_WAIT);
+        if (status != TX_SUCCESS)
+        {
+            return status;
+        }
+
+        status = tx_thread_create(&queue->thread,
+                                  (CHAR *)config->name,
+                                  FlashIO_ThreadEntry,
+                                  prio,
+                                  queue->stack,
+                                  config->stack_size,
+                                  config->priority,
+                                  config->preempt_threshold,
+                                  TX_NO_TIME_SLICE,
+                                  TX_AUTO_START);
+        if (status != TX_SUCCESS)
+        {
+            return status;
+        }
+
+        /* Register for stack monitoring */
+        Safety_Stack_RegisterThread(&queue->thread);
+    }
+
+    s_running = true;
+
+    return TX_SUCCESS;
+}
+
+shared_status_t Svc_FlashIO_Submit(svc_flashio_request_t *request)
+{
+    svc_flashio_prio_t prio = SVC_FLASHIO_PRIO_WRITE;
+    uint32_t start;
+    uint32_t end;
+    uint32_t primask;
+
+    if (!s_running)
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    if ((request == NULL) || (request->op > SVC_FLASHIO_OP_ERASE) || (request->size == 0U) ||
+        (request->address >= W25Q128_FLASH_SIZE) ||
+        (request->size > (W25Q128_FLASH_SIZE - request->address)) ||
+        ((request->buffer == NULL) && (request->op != SVC_FLASHIO_OP_ERASE)))
+    {
+        return STATUS_ERROR_RANGE;
+    }
+
+    request->status = W25QXX_BUSY;
+    request->done = false;
+    request->submit_us = Safety_Time_GetUs();
+    request->next = NULL;
+
+    FlashIO_GetRange(request, &start, &end);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (request->op == SVC_FLASHIO_OP_READ)
+    {
+        if (FlashIO_OverlapsWrites(start, end))
+        {
+            s_reordered++;
+        }
+        else
+        {
+            prio = SVC_FLASHIO_PRIO_READ;
+        }
+    }
+    else
+    {
+        /* Earlier reads of the range must see the data from before this write */
+        FlashIO_OrderReads(start, end);
+    }
+
+    FlashIO_Append(&s_queues[prio], request);
+
+    __set_PRIMASK(primask);
+
+    (void)tx_semaphore_put(&s_queues[prio].work);
+
+    return STATUS_OK;
+}
+
+w25qxx_status_t Svc_FlashIO_Read(uint8_t *pBuffer, uint32_t addr, uint32_t size)
+{
+    return FlashIO_Sync(SVC_FLASHIO_OP_READ, pBuffer, addr, size);
+}
+
+w25qxx_status_t Svc_FlashIO_Write(const uint8_t *pBuffer, uint32_t addr, uint32_t size)
+{
+    return FlashIO_Sync(SVC_FLASHIO_OP_WRITE, (uint8_t *)pBuffer, addr, size);
+}
+
+w25qxx_status_t Svc_FlashIO_Update(const uint8_t *pBuffer, uint32_t addr, uint32_t size)
+{
+    return FlashIO_Sync(SVC_FLASHIO_OP_UPDATE, (uint8_t *)pBuffer, addr, size);
+}
+
+w25qxx_status_t Svc_FlashIO_EraseSector(uint32_t sectorAddr)
+{
+    return FlashIO_Sync(SVC_FLASHIO_OP_ERASE, NULL,
+                        sectorAddr & ~FLASHIO_SECTOR_MASK, W25Q128_SECTOR_SIZE);
+}
+
+void Svc_FlashIO_GetStats(svc_flashio_stats_t *stats)
+{
+    uint32_t primask;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint32_t prio = 0U; prio < SVC_FLASHIO_PRIO_COUNT; prio++)
+    {
+        const flashio_queue_t *queue = &s_queues[prio];
+
+        stats->queue[prio] = queue->stats;
+        stats->queue[prio].latency_avg_us = (queue->stats.requests != 0U) ?
+            (uint32_t)(queue->latency_total_us / queue->stats.requests) : 0U;
+    }
+    stats->reordered = s_reordered;
+
+    __set_PRIMASK(primask);
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static VOID FlashIO_ThreadEntry(ULONG thread_input)
+{
+    svc_flashio_prio_t prio = (svc_flashio_prio_t)thread_input;
+
+    for (;;)
+    {
+        (void)tx_semaphore_get(&s_queues[prio].work, TX_WAIT_FOREVER);
+
+        /* A batch takes several requests: serve until empty, extra puts
+           only cause an empty pass */
+        while (FlashIO_Serve(prio))
+        {
+        }
+    }
+}
+
+static bool FlashIO_Serve(svc_flashio_prio_t prio)
+{
+    flashio_queue_t *queue = &s_queues[prio];
+    svc_flashio_request_t *batch;
+    svc_flashio_request_t *next;
+    w25qxx_status_t status;
+    uint32_t start = 0U;
+    uint32_t end = 0U;
+    uint64_t begin_us;
+    uint64_t now_us;
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    batch = FlashIO_TakeBatch(queue, &start, &end);
+    if (batch != NULL)
+    {
+        /* Requests submitted from now on are ordered against this range */
+        queue->active_start = start;
+        queue->active_end = end;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (batch == NULL)
+    {
+        return false;
+    }
+
+    if (prio == SVC_FLASHIO_PRIO_WRITE)
+    {
+        /* A read of the range taken before this write was queued goes first */
+        while (FlashIO_IsActive(SVC_FLASHIO_PRIO_READ, start, end))
+        {
+            tx_thread_sleep(1U);
+        }
+    }
+
+    begin_us = Safety_Time_GetUs();
+    status = FlashIO_Execute(prio, batch, start, end);
+    now_us = Safety_Time_GetUs();
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    queue->active_end = queue->active_start;
+    __set_PRIMASK(primask);
+
+    queue->stats.busy_us += now_us - begin_us;
+    if (batch->next != NULL)
+    {
+        queue->stats.bytes += end - start;
+    }
+    else if (batch->op != SVC_FLASHIO_OP_ERASE)
+    {
+        queue->stats.bytes += batch->size;
+    }
+
+    while (batch != NULL)
+    {
+        next = batch->next;
+        if (next != NULL)
+        {
+            queue->stats.merged++;
+        }
+        FlashIO_Complete(queue, batch, status, now_us);
+        batch = next;
+    }
+
+    return true;
+}
+
+static svc_flashio_request_t* FlashIO_TakeBatch(flashio_queue_t *queue,
+                                                uint32_t *start, uint32_t *end)
+{
+    svc_flashio_request_t *batch = queue->head;
+    svc_flashio_request_t *last = batch;
+
+    if (batch == NULL)
+    {
+        return NULL;
+    }
+
+    FlashIO_GetRange(batch, start, end);
+
+    /* Requests that continue the batch in Flash, same operation */
+    if (FlashIO_IsMergeable(batch))
+    {
+        while ((last->next != NULL) && (last->next->op == batch->op) &&
+               FlashIO_IsMergeable(last->next) && (last->next->address == *end) &&
+               (last->next->size <= (SVC_FLASHIO_MERGE_SIZE - (*end - *start))))
+        {
+            last = last->next;
+            *end += last->size;
+            queue->depth--;
+        }
+    }
+
+    queue->head = last->next;
+    if (queue->head == NULL)
+    {
+        queue->tail = NULL;
+    }
+    queue->depth--;
+    last->next = NULL;
+
+    return batch;
+}
+
+static w25qxx_status_t FlashIO_Execute(svc_flashio_prio_t prio, svc_flashio_request_t *batch,
+                                       uint32_t start, uint32_t end)
+{
+    uint8_t *stage = s_stage[prio];
+    w25qxx_status_t status;
+
+    if (batch->next == NULL)
+    {
+        return FlashIO_Transfer(batch);
+    }
+
+    /* Merged: one transfer through the staging buffer */
+    if (batch->op == SVC_FLASHIO_OP_READ)
+    {
+        status = BSP_W25QXX_Read(stage, start, end - start);
+        if (status == W25QXX_OK)
+        {
+            for (const svc_flashio_request_t *request = batch; request != NULL;
+                 request = request->next)
+            {
+                memcpy(request->buffer, &stage[request->address - start], request->size);
+            }
+        }
+    }
+    else
+    {
+        for (const svc_flashio_request_t *request = batch; request != NULL;
+             request = request->next)
+        {
+            memcpy(&stage[request->address - start], request->buffer, request->size);
+        }
+        status = BSP_W25QXX_Write(stage, start, end - start);
+    }
+
+    return status;
+}
+
+static w25qxx_status_t FlashIO_Transfer(const svc_flashio_request_t *request)
+{
+    w25qxx_status_t status = W25QXX_OK;
+    uint32_t start;
+    uint32_t end;
+
+    switch (request->op)
+    {
+        case SVC_FLASHIO_OP_READ:
+            status = BSP_W25QXX_Read(request->buffer, request->address, request->size);
+            break;
+
+        case SVC_FLASHIO_OP_WRITE:
+            status = BSP_W25QXX_Write(request->buffer, request->address, request->size);
+            break;
+
+        case SVC_FLASHIO_OP_UPDATE:
+            status = BSP_W25QXX_WriteWithErase(request->buffer, request->address,
+                                               request->size, s_work);
+            break;
+
+        default:
+            FlashIO_GetRange(request, &start, &end);
+            for (uint32_t addr = start; (addr < end) && (status == W25QXX_OK);
+                 addr += W25Q128_SECTOR_SIZE)
+            {
+                status = BSP_W25QXX_EraseSector(addr);
+            }
+            break;
+    }
+
+    return status;
+}
+
+static void FlashIO_Complete(flashio_queue_t *queue, svc_flashio_request_t *request,
+                             w25qxx_status_t status, uint64_t now_us)
+{
+    TX_EVENT_FLAGS_GROUP *event_flags = request->event_flags;
+    ULONG event_mask = request->event_mask;
+    uint32_t latency_us = (uint32_t)(now_us - request->submit_us);
+
+    queue->stats.requests++;
+    if (status != W25QXX_OK)
+    {
+        queue->stats.errors++;
+    }
+    queue->latency_total_us += latency_us;
+    if (latency_us > queue->stats.latency_max_us)
+    {
+        queue->stats.latency_max_us = latency_us;
+    }
+
+    request->status = status;
+    if (request->callback != NULL)
+    {
+        request->callback(request);
+    }
+
+    /* Last access: the owner may reuse the request from here on */
+    request->done = true;
+
+    if (event_flags != NULL)
+    {
+        (void)tx_event_flags_set(event_flags, event_mask, TX_OR);
+    }
+}
+
+static void FlashIO_Append(flashio_queue_t *queue, svc_flashio_request_t *request)
+{
+    request->next = NULL;
+    if (queue->tail != NULL)
+    {
+        queue->tail->next = request;
+    }
+    else
+    {
+        queue->head = request;
+    }
+    queue->tail = request;
+
+    queue->depth++;
+    if (queue->depth > queue->stats.depth_max)
+    {
+        queue->stats.depth_max = queue->depth;
+    }
+}
+
+static bool FlashIO_OverlapsWrites(uint32_t start, uint32_t end)
+{
+    uint32_t write_start;
+    uint32_t write_end;
+
+    if (FlashIO_IsActive(SVC_FLASHIO_PRIO_WRITE, start, end))
+    {
+        return true;
+    }
+
+    for (const svc_flashio_request_t *request = s_queues[SVC_FLASHIO_PRIO_WRITE].head;
+         request != NULL; request = request->next)
+    {
+        if (request->op != SVC_FLASHIO_OP_READ)
+        {
+            FlashIO_GetRange(request, &write_start, &write_end);
+            if ((start < write_end) && (write_start < end))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool FlashIO_IsActive(svc_flashio_prio_t prio, uint32_t start, uint32_t end)
+{
+    const flashio_queue_t *queue = &s_queues[prio];
+    uint32_t primask = __get_PRIMASK();
+    bool active;
+
+    __disable_irq();
+    active = (start < queue->active_end) && (queue->active_start < end);
+    __set_PRIMASK(primask);
+
+    return active;
+}
+
+static void FlashIO_OrderReads(uint32_t start, uint32_t end)
+{
+    flashio_queue_t *reads = &s_queues[SVC_FLASHIO_PRIO_READ];
+    svc_flashio_request_t *previous = NULL;
+    svc_flashio_request_t *request = reads->head;
+
+    /* Overlapping queued reads move to the write queue, in their order */
+    while (request != NULL)
+    {
+        svc_flashio_request_t *next = request->next;
+
+        if ((request->address < end) && (start < (request->address + request->size)))
+        {
+            if (previous != NULL)
+            {
+                previous->next = next;
+            }
+            else
+            {
+                reads->head = next;
+            }
+            if (reads->tail == request)
+            {
+                reads->tail = previous;
+            }
+            reads->depth--;
+
+            FlashIO_Append(&s_queues[SVC_FLASHIO_PRIO_WRITE], request);
+            s_reordered++;
+        }
+        else
+        {
+            previous = request;
+        }
+
+        request = next;
+    }
+}
+
+static void FlashIO_GetRange(const svc_flashio_request_t *request,
+                             uint32_t *start, uint32_t *end)
+{
+    *start = request->address;
+    *end = request->address + request->size;
+
+    /* Erases and updates rewrite whole sectors */
+    if ((request->op == SVC_FLASHIO_OP_ERASE) || (request->op == SVC_FLASHIO_OP_UPDATE))
+    {
+        *start &= ~FLASHIO_SECTOR_MASK;
+        *end = (*end + FLASHIO_SECTOR_MASK) & ~FLASHIO_SECTOR_MASK;
+    }
+}
+
+static bool FlashIO_IsMergeable(const svc_flashio_request_t *request)
+{
+    return ((request->op == SVC_FLASHIO_OP_READ) || (request->op == SVC_FLASHIO_OP_WRITE)) &&
+           (request->size < SVC_FLASHIO_MERGE_SIZE);
+}
+
+static w25qxx_status_t FlashIO_Sync(svc_flashio_op_t op, uint8_t *pBuffer,
+                                    uint32_t addr, uint32_t size)
+{
+    svc_flashio_request_t request;
+    TX_EVENT_FLAGS_GROUP done;
+    ULONG actual;
+
+    /* Before the threads run, or from an I/O callback: straight to the driver */
+    if (!s_running || (tx_thread_identify() == NULL) ||
+        (tx_thread_identify() == &s_queues[SVC_FLASHIO_PRIO_READ].thread) ||
+        (tx_thread_identify() == &s_queues[SVC_FLASHIO_PRIO_WRITE].thread))
+    {
+        request.op = op;
+        request.buffer = pBuffer;
+        request.address = addr;
+        request.size = size;
+        return FlashIO_Transfer(&request);
+    }
+
+    if (tx_event_flags_create(&done, (CHAR *)"FlashIO Sync") != TX_SUCCESS)
+    {
+        return W25QXX_ERROR;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    request.buffer = pBuffer;
+    request.address = addr;
+    request.size = size;
+    request.event_flags = &done;
+    request.event_mask = FLASHIO_SYNC_FLAG;
+
+    if (Svc_FlashIO_Submit(&request) != STATUS_OK)
+    {
+        (void)tx_event_flags_delete(&done);
+        return W25QXX_INVALID_PARAM;
+    }
+
+    (void)tx_event_flags_get(&done, FLASHIO_SYNC_FLAG, TX_OR_CLEAR, &actual, TX_WAIT_FOREVER);
+    (void)tx_event_flags_delete(&done);
+
+    return request.status;
+}
@@ -0,0 +1,958 @@
+/**
+ ******************************************************************************
+ * @file    svc_kvstore.c
+ * @brief   Key-Value Store Service Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Records are verified by CRC16 when indexed at mount and again on every
+ * read. A record torn by a power loss fails its CRC and is skipped; a
+ * header that cannot be parsed ends the sector (it is not appended to
+ * again). A collection interrupted by a power loss leaves copies of live
+ * records in the active sector and the oldest sector still valid; the
+ * copies are newer, and the collection is finished at the next mount.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "svc_kvstore.h"
+#include "svc_flashio.h"
+#include "safety_time.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define KV_CRC16_INIT               0xFFFFU
+#define KV_CRC16_POLYNOMIAL         0x1021U     /* CCITT, as Boot_CRC16_Calculate */
+
+#define KV_ALIGN4(n)                (((uint32_t)(n) + 3U) & ~3U)
+#define KV_RECORD_SIZE(length)      (sizeof(svc_kv_record_header_t) + KV_ALIGN4(length) + \
+                                     sizeof(uint32_t))
+#define KV_RECORD_MAX               KV_RECORD_SIZE(SVC_KV_MAX_VALUE)
+#define KV_FIRST_RECORD             sizeof(svc_kv_sector_header_t)
+#define KV_NO_SECTOR                0xFFFFFFFFUL
+#define KV_ERASED_HEADER            0xFFFFFFFFUL
+
+/* Fibonacci hashing of the 16-bit key into the index */
+#define KV_HASH(key)                (((((uint32_t)(key)) * 40503U) & 0xFFFFU) >> \
+                                     (16U - SVC_KV_INDEX_BITS))
+
+#define KV_CAN_ID_MAX               0x1FFFFFFFUL    /* 29-bit identifier */
+
+#if SVC_KV_BENCHMARK_ENABLED
+#define KV_BENCH_VALUE              16U
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef union {
+    svc_kv_record_header_t header;
+    uint8_t bytes[KV_RECORD_MAX];
+} kv_record_t;
+
+typedef enum {
+    KV_RECORD_VALID             = 0x00U,    /* CRC ok */
+    KV_RECORD_TORN              = 0x01U,    /* Parsable, CRC failed: skip */
+    KV_RECORD_END               = 0x02U,    /* Erased: end of the sector log */
+    KV_RECORD_BROKEN            = 0x03U     /* Unparsable: rest of the sector untrusted */
+} kv_record_state_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static shared_status_t W25q_Read(uint32_t address, void *data, uint32_t size);
+static shared_status_t W25q_Program(uint32_t address, const void *data, uint32_t size);
+static shared_status_t W25q_Erase(uint32_t address);
+
+#if SVC_KV_BENCHMARK_ENABLED
+static shared_status_t Sim_Read(uint32_t address, void *data, uint32_t size);
+static shared_status_t Sim_Program(uint32_t address, const void *data, uint32_t size);
+static shared_status_t Sim_Erase(uint32_t address);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static svc_kv_store_t s_store;
+static nonsafety_params_t s_nonsafety;
+
+static const svc_kv_flash_t s_w25q_flash = {
+    .read         = W25q_Read,
+    .program      = W25q_Program,
+    .erase        = W25q_Erase,
+    .sector_size  = SVC_KV_W25Q_SECTOR_SIZE,
+    .sector_count = SVC_KV_W25Q_SECTOR_COUNT
+};
+
+#if SVC_KV_BENCHMARK_ENABLED
+static uint8_t s_sim_flash[SVC_KV_SIM_SECTOR_COUNT * SVC_KV_W25Q_SECTOR_SIZE];
+static svc_kv_store_t s_sim_store;
+
+static const svc_kv_flash_t s_sim_backend = {
+    .read         = Sim_Read,
+    .program      = Sim_Program,
+    .erase        = Sim_Erase,
+    .sector_size  = SVC_KV_W25Q_SECTOR_SIZE,
+    .sector_count = SVC_KV_SIM_SECTOR_COUNT
+};
+#endif
+
+/* Store area must be whole sectors at the end of the device */
+typedef char kv_w25q_area_fits[
+    ((SVC_KV_W25Q_SECTOR_SIZE == W25Q128_SECTOR_SIZE) &&
+     ((SVC_KV_W25Q_BASE + (SVC_KV_W25Q_SECTOR_COUNT * SVC_KV_W25Q_SECTOR_SIZE)) ==
+      W25Q128_FLASH_SIZE) &&
+     (SVC_KV_W25Q_SECTOR_COUNT <= SVC_KV_MAX_SECTORS)) ? 1 : -1];
+
+/* Value length must fit the record header */
+typedef char kv_value_fits[(SVC_KV_MAX_VALUE <= 0xFFU) ? 1 : -1];
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static svc_kv_entry_t* KV_Lookup(svc_kv_store_t *store, uint16_t key, bool insert);
+static shared_status_t KV_Write(svc_kv_store_t *store, uint16_t key,
+                                const void *value, uint32_t length);
+static shared_status_t KV_Reserve(svc_kv_store_t *store, uint32_t size);
+static shared_status_t KV_Append(svc_kv_store_t *store, const kv_record_t *record,
+                                 svc_kv_entry_t *entry);
+static shared_status_t KV_OpenSector(svc_kv_store_t *store);
+static shared_status_t KV_Collect(svc_kv_store_t *store);
+static uint32_t KV_IndexSector(svc_kv_store_t *store, uint32_t sector);
+static uint32_t KV_NextSector(const svc_kv_store_t *store, uint32_t after);
+static uint32_t KV_CountFree(const svc_kv_store_t *store);
+static kv_record_state_t KV_ReadRecord(svc_kv_store_t *store, uint32_t address,
+                                       kv_record_t *record, uint32_t *size);
+static bool KV_CheckRecord(const kv_record_t *record);
+static uint32_t KV_BuildRecord(kv_record_t *record, uint16_t key,
+                               const void *value, uint32_t length);
+static uint16_t KV_Crc16(const uint8_t *data, uint32_t length);
+static void KV_LoadNonSafety(nonsafety_params_t *params);
+static void KV_UpdateNonSafetyCrc(nonsafety_params_t *params);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+shared_status_t Svc_KV_Mount(svc_kv_store_t *store, const svc_kv_flash_t *flash)
+{
+    svc_kv_sector_header_t header;
+    uint32_t sector;
+    uint32_t sequence = 0U;
+    uint32_t newest = KV_NO_SECTOR;
+    uint32_t free_offset = KV_FIRST_RECORD;
+    shared_status_t status;
+
+    if ((store == NULL) || (flash == NULL) ||
+        (flash->sector_count < 3U) || (flash->sector_count > SVC_KV_MAX_SECTORS) ||
+        (flash->sector_size < (KV_FIRST_RECORD + KV_RECORD_MAX)))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    memset(store, 0, sizeof(svc_kv_store_t));
+    store->flash = flash;
+    store->next_sequence = 1U;
+    for (uint32_t i = 0U; i < SVC_KV_INDEX_SIZE; i++)
+    {
+        store->index[i].key = SVC_KV_KEY_NONE;
+        store->index[i].address = SVC_KV_ADDR_NONE;
+    }
+
+    /* Sector headers: anything not a valid header is free (erased before use) */
+    for (sector = 0U; sector < flash->sector_count; sector++)
+    {
+        status = flash->read(sector * flash->sector_size, &header, sizeof(header));
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        if ((header.magic == SVC_KV_SECTOR_MAGIC) &&
+            (header.sequence != 0U) && (header.sequence != KV_ERASED_HEADER))
+        {
+            store->sequence[sector] = header.sequence;
+            if (header.sequence >= store->next_sequence)
+            {
+                store->next_sequence = header.sequence + 1U;
+            }
+        }
+    }
+
+    /* Oldest first, so newer records replace older ones in the index */
+    for (sector = KV_NextSector(store, 0U); sector != KV_NO_SECTOR;
+         sector = KV_NextSector(store, sequence))
+    {
+        sequence = store->sequence[sector];
+        free_offset = KV_IndexSector(store, sector);
+        newest = sector;
+    }
+
+    if (newest == KV_NO_SECTOR)
+    {
+        /* Empty or unformatted */
+        status = KV_OpenSector(store);
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+    }
+    else
+    {
+        store->active = newest;
+        store->write_offset = free_offset;
+    }
+
+    /* A collection was interrupted after opening the last free sector */
+    if (KV_CountFree(store) == 0U)
+    {
+        (void)KV_Collect(store);
+    }
+
+    store->mounted = true;
+
+    return STATUS_OK;
+}
+
+shared_status_t Svc_KV_Get(svc_kv_store_t *store, uint16_t key,
+                           void *value, uint32_t size, uint32_t *length)
+{
+    kv_record_t record;
+    const svc_kv_entry_t *entry;
+    shared_status_t status;
+
+    if ((store == NULL) || (!store->mounted) || (value == NULL))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    entry = KV_Lookup(store, key, false);
+    if ((entry == NULL) || (entry->address == SVC_KV_ADDR_NONE) || (entry->length > size))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    /* The index knows the length: one read of the whole record */
+    status = store->flash->read(entry->address, record.bytes, KV_RECORD_SIZE(entry->length));
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    if ((!KV_CheckRecord(&record)) || (record.header.key != key))
+    {
+        return STATUS_ERROR_CRC;
+    }
+
+    memcpy(value, &record.bytes[sizeof(svc_kv_record_header_t)], entry->length);
+    if (length != NULL)
+    {
+        *length = entry->length;
+    }
+
+    return STATUS_OK;
+}
+
+shared_status_t Svc_KV_Set(svc_kv_store_t *store, uint16_t key,
+                           const void *value, uint32_t length)
+{
+    if ((store == NULL) || (!store->mounted) || (value == NULL) ||
+        (key == SVC_KV_KEY_NONE) || (length == 0U) || (length > SVC_KV_MAX_VALUE))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    return KV_Write(store, key, value, length);
+}
+
+shared_status_t Svc_KV_Delete(svc_kv_store_t *store, uint16_t key)
+{
+    const svc_kv_entry_t *entry;
+
+    if ((store == NULL) || (!store->mounted) || (key == SVC_KV_KEY_NONE))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    entry = KV_Lookup(store, key, false);
+    if ((entry == NULL) || (entry->address == SVC_KV_ADDR_NONE))
+    {
+        return STATUS_OK;
+    }
+
+    return KV_Write(store, key, NULL, 0U);
+}
+
+const svc_kv_flash_t* Svc_KV_GetW25qFlash(void)
+{
+    return &s_w25q_flash;
+}
+
+shared_status_t Svc_KV_Init(void)
+{
+    shared_status_t status;
+
+    s_nonsafety.magic = NONSAFETY_PARAMS_MAGIC;
+    s_nonsafety.can_baudrate = DEFAULT_CAN_BAUDRATE;
+    s_nonsafety.can_id_base = DEFAULT_CAN_ID_BASE;
+    s_nonsafety.comm_timeout_ms = DEFAULT_COMM_TIMEOUT;
+    s_nonsafety.reserved = 0U;
+    s_nonsafety.padding = 0U;
+
+    /* Defaults stay in place if the device did not initialize */
+    status = BSP_W25QXX_GetInfo()->initialized ? Svc_KV_Mount(&s_store, &s_w25q_flash) :
+                                                 STATUS_ERROR;
+    if (status == STATUS_OK)
+    {
+        KV_LoadNonSafety(&s_nonsafety);
+    }
+
+    KV_UpdateNonSafetyCrc(&s_nonsafety);
+
+    return status;
+}
+
+const nonsafety_params_t* Svc_KV_GetNonSafety(void)
+{
+    return &s_nonsafety;
+}
+
+shared_status_t Svc_KV_SaveNonSafety(const nonsafety_params_t *params)
+{
+    shared_status_t status;
+    uint32_t can_baudrate;
+    uint32_t can_id_base;
+    uint16_t comm_timeout_ms;
+
+    if (params == NULL)
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    can_baudrate = params->can_baudrate;
+    can_id_base = params->can_id_base;
+    comm_timeout_ms = params->comm_timeout_ms;
+
+    if ((can_baudrate < SVC_KV_CAN_BAUDRATE_MIN) || (can_baudrate > SVC_KV_CAN_BAUDRATE_MAX) ||
+        (can_id_base > KV_CAN_ID_MAX) || (comm_timeout_ms == 0U))
+    {
+        return STATUS_ERROR_RANGE;
+    }
+
+    status = Svc_KV_Set(&s_store, SVC_KV_KEY_CAN_BAUDRATE, &can_baudrate, sizeof(can_baudrate));
+    if (status == STATUS_OK)
+    {
+        status = Svc_KV_Set(&s_store, SVC_KV_KEY_CAN_ID_BASE, &can_id_base, sizeof(can_id_base));
+    }
+    if (status == STATUS_OK)
+    {
+        status = Svc_KV_Set(&s_store, SVC_KV_KEY_COMM_TIMEOUT, &comm_timeout_ms,
+                            sizeof(comm_timeout_ms));
+    }
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    s_nonsafety.can_baudrate = can_baudrate;
+    s_nonsafety.can_id_base = can_id_base;
+    s_nonsafety.comm_timeout_ms = comm_timeout_ms;
+    KV_UpdateNonSafetyCrc(&s_nonsafety);
+
+    return STATUS_OK;
+}
+
+#if SVC_KV_BENCHMARK_ENABLED
+shared_status_t Svc_KV_Benchmark(svc_kv_benchmark_t *result)
+{
+    uint8_t value[KV_BENCH_VALUE];
+    uint64_t get_total = 0U;
+    uint64_t set_total = 0U;
+    uint64_t start;
+    uint32_t cycles;
+    shared_status_t status;
+
+    if (result == NULL)
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    memset(result, 0, sizeof(svc_kv_benchmark_t));
+    memset(s_sim_flash, 0xFF, sizeof(s_sim_flash));
+
+    status = Svc_KV_Mount(&s_sim_store, &s_sim_backend);
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    /* Updates rotate over the keys, filling and collecting every sector */
+    for (uint32_t i = 0U; i < SVC_KV_BENCH_UPDATES; i++)
+    {
+        memset(value, (int)(i & 0xFFU), sizeof(value));
+        memcpy(value, &i, sizeof(i));
+
+        start = Safety_Time_GetCycles();
+        status = Svc_KV_Set(&s_sim_store, (uint16_t)(i % SVC_KV_BENCH_KEYS), value, sizeof(value));
+        cycles = (uint32_t)(Safety_Time_GetCycles() - start);
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        set_total += cycles;
+        if (cycles > result->set_max_cycles)
+        {
+            result->set_max_cycles = cycles;
+        }
+    }
+
+    for (uint32_t i = 0U; i < SVC_KV_BENCH_UPDATES; i++)
+    {
+        start = Safety_Time_GetCycles();
+        status = Svc_KV_Get(&s_sim_store, (uint16_t)(i % SVC_KV_BENCH_KEYS),
+                            value, sizeof(value), NULL);
+        cycles = (uint32_t)(Safety_Time_GetCycles() - start);
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        get_total += cycles;
+        if (cycles > result->get_max_cycles)
+        {
+            result->get_max_cycles = cycles;
+        }
+    }
+
+    result->gc_count = s_sim_store.gc_count;
+
+    start = Safety_Time_GetCycles();
+    status = Svc_KV_Mount(&s_sim_store, &s_sim_backend);
+    result->mount_cycles = (uint32_t)(Safety_Time_GetCycles() - start);
+
+    result->get_avg_cycles = (uint32_t)(get_total / SVC_KV_BENCH_UPDATES);
+    result->set_avg_cycles = (uint32_t)(set_total / SVC_KV_BENCH_UPDATES);
+    result->cycles_per_us = Safety_Time_GetCyclesPerUs();
+
+    return status;
+}
+#endif
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static svc_kv_entry_t* KV_Lookup(svc_kv_store_t *store, uint16_t key, bool insert)
+{
+    uint32_t slot = KV_HASH(key);
+
+    for (uint32_t probe = 0U; probe < SVC_KV_INDEX_SIZE; probe++)
+    {
+        svc_kv_entry_t *entry = &store->index[slot];
+
+        if (entry->key == key)
+        {
+            return entry;
+        }
+
+        if (entry->key == SVC_KV_KEY_NONE)
+        {
+            /* Slots are never freed (a deleted key keeps its slot) */
+            if ((!insert) || (store->keys >= SVC_KV_MAX_KEYS))
+            {
+                return NULL;
+            }
+
+            entry->key = key;
+            entry->length = 0U;
+            entry->address = SVC_KV_ADDR_NONE;
+            store->keys++;
+            return entry;
+        }
+
+        slot = (slot + 1U) & (SVC_KV_INDEX_SIZE - 1U);
+    }
+
+    return NULL;
+}
+
+static shared_status_t KV_Write(svc_kv_store_t *store, uint16_t key,
+                                const void *value, uint32_t length)
+{
+    kv_record_t record;
+    svc_kv_entry_t *entry;
+    uint32_t size;
+    shared_status_t status;
+
+    entry = KV_Lookup(store, key, (length != 0U));
+    if (entry == NULL)
+    {
+        return STATUS_ERROR;        /* Index full */
+    }
+
+    /* Unchanged value: no Flash write */
+    if ((length != 0U) && (entry->length == length) && (entry->address != SVC_KV_ADDR_NONE) &&
+        (store->flash->read(entry->address, record.bytes, KV_RECORD_SIZE(length)) == STATUS_OK) &&
+        KV_CheckRecord(&record) &&
+        (memcmp(&record.bytes[sizeof(svc_kv_record_header_t)], value, length) == 0))
+    {
+        return STATUS_OK;
+    }
+
+    size = KV_BuildRecord(&record, key, value, length);
+
+    status = KV_Reserve(store, size);
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    return KV_Append(store, &record, entry);
+}
+
+static shared_status_t KV_Reserve(svc_kv_store_t *store, uint32_t size)
+{
+    shared_status_t status;
+
+    for (uint32_t attempt = 0U; attempt < store->flash->sector_count; attempt++)
+    {
+        if ((store->write_offset + size) <= store->flash->sector_size)
+        {
+            return STATUS_OK;
+        }
+
+        status = KV_OpenSector(store);
+        if (status != STATUS_OK)
+        {
+            return status;
+        }
+
+        /* Keep one sector free for the next collection */
+        if (KV_CountFree(store) == 0U)
+        {
+            status = KV_Collect(store);
+            if (status != STATUS_OK)
+            {
+                return status;
+            }
+        }
+    }
+
+    return STATUS_ERROR;            /* Live records fill the store */
+}
+
+static shared_status_t KV_Append(svc_kv_store_t *store, const kv_record_t *record,
+                                 svc_kv_entry_t *entry)
+{
+    kv_record_t verify;
+    uint32_t size = KV_RECORD_SIZE(record->header.length);
+    uint32_t address = (store->active * store->flash->sector_size) + store->write_offset;
+    shared_status_t status;
+
+    /* Space is consumed even on failure: it may be partly programmed */
+    store->write_offset += size;
+
+    status = store->flash->program(address, record->bytes, size);
+    if (status == STATUS_OK)
+    {
+        status = store->flash->read(address, verify.bytes, size);
+    }
+    if ((status == STATUS_OK) && (memcmp(verify.bytes, record->bytes, size) != 0))
+    {
+        status = STATUS_ERROR;
+    }
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    entry->length = record->header.length;
+    entry->address = (record->header.length != 0U) ? address : SVC_KV_ADDR_NONE;
+
+    return STATUS_OK;
+}
+
+static shared_status_t KV_OpenSector(svc_kv_store_t *store)
+{
+    const svc_kv_flash_t *flash = store->flash;
+    svc_kv_sector_header_t header;
+    uint32_t sector = KV_NO_SECTOR;
+    shared_status_t status;
+
+    /* Next free sector after the active one (spreads the erase cycles) */
+    for (uint32_t i = 1U; i <= flash->sector_count; i++)
+    {
+        uint32_t candidate = (store->active + i) % flash->sector_count;
+
+        if (store->sequence[candidate] == 0U)
+        {
+            sector = candidate;
+            break;
+        }
+    }
+
+    if (sector == KV_NO_SECTOR)
+    {
+        return STATUS_ERROR;
+    }
+
+    status = flash->erase(sector * flash->sector_size);
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    header.magic = SVC_KV_SECTOR_MAGIC;
+    header.sequence = store->next_sequence;
+    status = flash->program(sector * flash->sector_size, &header, sizeof(header));
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    store->sequence[sector] = store->next_sequence;
+    store->next_sequence++;
+    store->active = sector;
+    store->write_offset = KV_FIRST_RECORD;
+
+    return STATUS_OK;
+}
+
+static shared_status_t KV_Collect(svc_kv_store_t *store)
+{
+    const svc_kv_flash_t *flash = store->flash;
+    kv_record_t record;
+    uint32_t oldest = KV_NextSector(store, 0U);
+    uint32_t start;
+    uint32_t offset = KV_FIRST_RECORD;
+    uint32_t retired = 0U;
+    shared_status_t status;
+
+    if ((oldest == KV_NO_SECTOR) || (oldest == store->active))
+    {
+        return STATUS_OK;
+    }
+
+    start = oldest * flash->sector_size;
+
+    /* Copy the records the index still points to */
+    while (offset < flash->sector_size)
+    {
+        uint32_t size;
+        kv_record_state_t state = KV_ReadRecord(store, start + offset, &record, &size);
+
+        if ((state == KV_RECORD_END) || (state == KV_RECORD_BROKEN))
+        {
+            break;
+        }
+
+        if (state == KV_RECORD_VALID)
+        {
+            svc_kv_entry_t *entry = KV_Lookup(store, record.header.key, false);
+
+            if ((entry != NULL) && (entry->address == (start + offset)))
+            {
+                if ((store->write_offset + size) > flash->sector_size)
+                {
+                    return STATUS_ERROR;
+                }
+
+                status = KV_Append(store, &record, entry);
+                if (status != STATUS_OK)
+                {
+                    return status;
+                }
+            }
+        }
+
+        offset += size;
+    }
+
+    /* Retire: clearing the magic needs no erase, the sector is erased when reused */
+    status = flash->program(start, &retired, sizeof(retired));
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    store->sequence[oldest] = 0U;
+    store->gc_count++;
+
+    return STATUS_OK;
+}
+
+static uint32_t KV_IndexSector(svc_kv_store_t *store, uint32_t sector)
+{
+    kv_record_t record;
+    uint32_t start = sector * store->flash->sector_size;
+    uint32_t offset = KV_FIRST_RECORD;
+
+    while (offset < store->flash->sector_size)
+    {
+        uint32_t size;
+        kv_record_state_t state = KV_ReadRecord(store, start + offset, &record, &size);
+
+        if (state == KV_RECORD_END)
+        {
+            return offset;
+        }
+
+        if (state == KV_RECORD_BROKEN)
+        {
+            return store->flash->sector_size;
+        }
+
+        if (state == KV_RECORD_VALID)
+        {
+            /* A deletion of a key not seen before needs no slot */
+            uint32_t length = record.header.length;
+            svc_kv_entry_t *entry = KV_Lookup(store, record.header.key, (length != 0U));
+
+            if (entry != NULL)
+            {
+                entry->length = (uint8_t)length;
+                entry->address = (length != 0U) ? (start + offset) : SVC_KV_ADDR_NONE;
+            }
+        }
+
+        offset += size;
+    }
+
+    return store->flash->sector_size;
+}
+
+static uint32_t KV_NextSector(const svc_kv_store_t *store, uint32_t after)
+{
+    uint32_t next = KV_NO_SECTOR;
+
+    /* Used sector with the lowest sequence above 'after' */
+    for (uint32_t sector = 0U; sector < store->flash->sector_count; sector++)
+    {
+        uint32_t sequence = store->sequence[sector];
+
+        if ((sequence > after) &&
+            ((next == KV_NO_SECTOR) || (sequence < store->sequence[next])))
+        {
+            next = sector;
+        }
+    }
+
+    return next;
+}
+
+static uint32_t KV_CountFree(const svc_kv_store_t *store)
+{
+    uint32_t count = 0U;
+
+    for (uint32_t sector = 0U; sector < store->flash->sector_count; sector++)
+    {
+        count += (store->sequence[sector] == 0U) ? 1U : 0U;
+    }
+
+    return count;
+}
+
+static kv_record_state_t KV_ReadRecord(svc_kv_store_t *store, uint32_t address,
+                                       kv_record_t *record, uint32_t *size)
+{
+    const svc_kv_record_header_t *header = &record->header;
+    uint32_t limit = ((address / store->flash->sector_size) + 1U) * store->flash->sector_size;
+    uint32_t word;
+
+    if ((address + sizeof(svc_kv_record_header_t)) > limit)
+    {
+        return KV_RECORD_END;
+    }
+
+    if (store->flash->read(address, record->bytes, sizeof(svc_kv_record_header_t)) != STATUS_OK)
+    {
+        return KV_RECORD_BROKEN;
+    }
+
+    memcpy(&word, record->bytes, sizeof(word));
+    if (word == KV_ERASED_HEADER)
+    {
+        return KV_RECORD_END;
+    }
+
+    if ((header->magic != SVC_KV_RECORD_MAGIC) || (header->key == SVC_KV_KEY_NONE) ||
+        (header->length > SVC_KV_MAX_VALUE))
+    {
+        return KV_RECORD_BROKEN;
+    }
+
+    *size = KV_RECORD_SIZE(header->length);
+    if (((address + *size) > limit) ||
+        (store->flash->read(address + sizeof(svc_kv_record_header_t),
+                            &record->bytes[sizeof(svc_kv_record_header_t)],
+                            *size - sizeof(svc_kv_record_header_t)) != STATUS_OK))
+    {
+        return KV_RECORD_BROKEN;
+    }
+
+    return KV_CheckRecord(record) ? KV_RECORD_VALID : KV_RECORD_TORN;
+}
+
+static bool KV_CheckRecord(const kv_record_t *record)
+{
+    const svc_kv_record_header_t *header = &record->header;
+    uint32_t data_size;
+    uint16_t crc;
+    uint16_t crc_inv;
+
+    if ((header->magic != SVC_KV_RECORD_MAGIC) || (header->length > SVC_KV_MAX_VALUE))
+    {
+        return false;
+    }
+
+    data_size = sizeof(svc_kv_record_header_t) + header->length;
+    memcpy(&crc, &record->bytes[sizeof(svc_kv_record_header_t) + KV_ALIGN4(header->length)],
+           sizeof(crc));
+    memcpy(&crc_inv, &record->bytes[sizeof(svc_kv_record_header_t) + KV_ALIGN4(header->length) +
+                                    sizeof(crc)], sizeof(crc_inv));
+
+    return ((uint16_t)(crc ^ crc_inv) == 0xFFFFU) && (crc == KV_Crc16(record->bytes, data_size));
+}
+
+static uint32_t KV_BuildRecord(kv_record_t *record, uint16_t key,
+                               const void *value, uint32_t length)
+{
+    svc_kv_record_header_t header;
+    uint32_t trailer_offset = sizeof(svc_kv_record_header_t) + KV_ALIGN4(length);
+    uint16_t crc;
+    uint16_t crc_inv;
+
+    header.key = key;
+    header.length = (uint8_t)length;
+    header.magic = SVC_KV_RECORD_MAGIC;
+
+    memset(record->bytes, 0xFF, KV_RECORD_SIZE(length));
+    record->header = header;
+    if (length != 0U)
+    {
+        memcpy(&record->bytes[sizeof(header)], value, length);
+    }
+
+    crc = KV_Crc16(record->bytes, sizeof(header) + length);
+    crc_inv = (uint16_t)~crc;
+    memcpy(&record->bytes[trailer_offset], &crc, sizeof(crc));
+    memcpy(&record->bytes[trailer_offset + sizeof(crc)], &crc_inv, sizeof(crc_inv));
+
+    return KV_RECORD_SIZE(length);
+}
+
+static uint16_t KV_Crc16(const uint8_t *data, uint32_t length)
+{
+    uint16_t crc = KV_CRC16_INIT;
+
+    for (uint32_t i = 0U; i < length; i++)
+    {
+        crc ^= (uint16_t)((uint16_t)data[i] << 8);
+        for (uint32_t bit = 0U; bit < 8U; bit++)
+        {
+            crc = ((crc & 0x8000U) != 0U) ? (uint16_t)((crc << 1) ^ KV_CRC16_POLYNOMIAL) :
+                                            (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static void KV_LoadNonSafety(nonsafety_params_t *params)
+{
+    uint32_t value32;
+    uint16_t value16;
+    uint32_t length;
+
+    /* Missing or out-of-range keys keep their default */
+    if ((Svc_KV_Get(&s_store, SVC_KV_KEY_CAN_BAUDRATE, &value32, sizeof(value32), &length) ==
+         STATUS_OK) && (length == sizeof(value32)) &&
+        (value32 >= SVC_KV_CAN_BAUDRATE_MIN) && (value32 <= SVC_KV_CAN_BAUDRATE_MAX))
+    {
+        params->can_baudrate = value32;
+    }
+
+    if ((Svc_KV_Get(&s_store, SVC_KV_KEY_CAN_ID_BASE, &value32, sizeof(value32), &length) ==
+         STATUS_OK) && (length == sizeof(value32)) && (value32 <= KV_CAN_ID_MAX))
+    {
+        params->can_id_base = value32;
+    }
+
+    if ((Svc_KV_Get(&s_store, SVC_KV_KEY_COMM_TIMEOUT, &value16, sizeof(value16), &length) ==
+         STATUS_OK) && (length == sizeof(value16)) && (value16 != 0U))
+    {
+        params->comm_timeout_ms = value16;
+    }
+}
+
+static void KV_UpdateNonSafetyCrc(nonsafety_params_t *params)
+{
+    /* Same coverage as the bootloader: everything before crc16 and padding */
+    params->crc16 = KV_Crc16((const uint8_t *)params,
+                             sizeof(nonsafety_params_t) - sizeof(uint32_t));
+}
+
+/* ============================================================================
+ * Flash Backends
+ * ============================================================================*/
+
+static shared_status_t W25q_Read(uint32_t address, void *data, uint32_t size)
+{
+    return (Svc_FlashIO_Read((uint8_t *)data, SVC_KV_W25Q_BASE + address, size) == W25QXX_OK) ?
+           STATUS_OK : STATUS_ERROR;
+}
+
+static shared_status_t W25q_Program(uint32_t address, const void *data, uint32_t size)
+{
+    return (Svc_FlashIO_Write((const uint8_t *)data, SVC_KV_W25Q_BASE + address, size) ==
+            W25QXX_OK) ?
+           STATUS_OK : STATUS_ERROR;
+}
+
+static shared_status_t W25q_Erase(uint32_t address)
+{
+    return (Svc_FlashIO_EraseSector(SVC_KV_W25Q_BASE + address) == W25QXX_OK) ?
+           STATUS_OK : STATUS_ERROR;
+}
+
+#if SVC_KV_BENCHMARK_ENABLED
+static shared_status_t Sim_Read(uint32_t address, void *data, uint32_t size)
+{
+    if ((address + size) > sizeof(s_sim_flash))
+    {
+        return STATUS_ERROR;
+    }
+
+    memcpy(data, &s_sim_flash[address], size);
+
+    return STATUS_OK;
+}
+
+static shared_status_t Sim_Program(uint32_t address, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    if ((address + size) > sizeof(s_sim_flash))
+    {
+        return STATUS_ERROR;
+    }
+
+    /* NOR Flash: programming only clears bits */
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        s_sim_flash[address + i] &= bytes[i];
+    }
+
+    return STATUS_OK;
+}
+
+static shared_status_t Sim_Erase(uint32_t address)
+{
+    if (((address % SVC_KV_W25Q_SECTOR_SIZE) != 0U) || (address >= sizeof(s_sim_flash)))
+    {
+        return STATUS_ERROR;
+    }
+
+    memset(&s_sim_flash[address], 0xFF, SVC_KV_W25Q_SECTOR_SIZE);
+
+    return STATUS_OK;
+}
+#endif
@@ -0,0 +1,499 @@
+/**
+ ******************************************************************************
+ * @file    svc_logger.c
+ * @brief   Sensor Data Logger Service Implementation
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * The ring is indexed by free-running record counts: s_head is written by
+ * the producer only, s_tail by the writer thread only, and head - tail is
+ * the fill level. A record is published by the store to s_head after its
+ * copy (barrier in between); a chunk is released by the store to s_tail
+ * after fx_file_write returned, since the DMA reads it from the ring.
+ * Chunks start at a multiple of the chunk size and the ring holds a whole
+ * number of chunks, so a chunk never wraps.
+ *
+ * Start runs in the caller's thread before the writer is woken; stop is
+ * done by the writer thread, which owns the file while logging.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "svc_logger.h"
+#include "safety_stack.h"
+#include "safety_time.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define LOGGER_THREAD_NAME          "Logger"
+#define LOGGER_CHUNK_RECORDS        (SVC_LOGGER_CHUNK_SIZE / sizeof(svc_logger_sample_t))
+#define LOGGER_RING_RECORDS         (LOGGER_CHUNK_RECORDS * SVC_LOGGER_CHUNKS)
+#define LOGGER_RING_MASK            (LOGGER_RING_RECORDS - 1U)
+
+/* Private types -------------------------------------------------------------*/
+typedef char logger_record_size[(sizeof(svc_logger_sample_t) == 32U) ? 1 : -1];
+typedef char logger_chunk_whole_sectors[((SVC_LOGGER_CHUNK_SIZE % 512U) == 0U) ? 1 : -1];
+typedef char logger_ring_power_of_2[((SVC_LOGGER_CHUNKS & (SVC_LOGGER_CHUNKS - 1U)) == 0U) ? 1 : -1];
+typedef char logger_file_whole_chunks[((SVC_LOGGER_FILE_SIZE % SVC_LOGGER_CHUNK_SIZE) == 0U) ? 1 : -1];
+
+/* Private variables ---------------------------------------------------------*/
+static svc_logger_sample_t s_ring[LOGGER_RING_RECORDS];     /* Not CCM: DMA */
+static volatile uint32_t s_head = 0U;                       /* Records pushed */
+static volatile uint32_t s_tail = 0U;                       /* Records written */
+static uint32_t s_sequence = 0U;
+static bool s_full = false;                                 /* Producer saw the ring full */
+static uint32_t s_full_start = 0U;                          /* DWT cycles */
+
+static volatile svc_logger_state_t s_state = SVC_LOGGER_IDLE;
+static volatile bool s_stopping = false;
+static shared_status_t s_stop_status = STATUS_OK;
+static FX_MEDIA *s_media = NULL;
+static FX_FILE s_file;
+static uint32_t s_since_checkpoint = 0U;
+static svc_logger_stats_t s_stats;
+
+static bool s_running = false;
+static TX_SEMAPHORE s_work;                                 /* Put per chunk and by stop */
+static TX_SEMAPHORE s_stopped;
+static TX_THREAD s_thread;
+static UCHAR *s_stack = NULL;
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static VOID Logger_ThreadEntry(ULONG thread_input);
+static void Logger_WriteChunks(void);
+static void Logger_Write(uint32_t records);
+static void Logger_Checkpoint(void);
+static void Logger_Finish(void);
+static void Logger_Fail(UINT status);
+static uint32_t Logger_ElapsedUs(uint64_t start_us);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+UINT Svc_Logger_Init(TX_BYTE_POOL *byte_pool)
+{
+    UINT status;
+
+    if (byte_pool == NULL)
+    {
+        return TX_PTR_ERROR;
+    }
+
+    status = tx_semaphore_create(&s_work, (CHAR *)LOGGER_THREAD_NAME, 0U);
+    if (status != TX_SUCCESS)
+    {
+        return status;
+    }
+
+    status = tx_semaphore_create(&s_stopped, (CHAR *)LOGGER_THREAD_NAME, 0U);
+    if (status != TX_SUCCESS)
+    {
+        return status;
+    }
+
+    status = tx_byte_allocate(byte_pool, (VOID **)&s_stack,
+                              SVC_LOGGER_STACK_SIZE, TX_NO_WAIT);
+    if (status != TX_SUCCESS)
+    {
+        return status;
+    }
+
+    status = tx_thread_create(&s_thread,
+                              (CHAR *)LOGGER_THREAD_NAME,
+                              Logger_ThreadEntry,
+                              0U,
+                              s_stack,
+                              SVC_LOGGER_STACK_SIZE,
+                              SVC_LOGGER_PRIORITY,
+                              SVC_LOGGER_PREEMPT_THRESH,
+                              TX_NO_TIME_SLICE,
+                              TX_AUTO_START);
+    if (status != TX_SUCCESS)
+    {
+        return status;
+    }
+
+    /* Register for stack monitoring */
+    Safety_Stack_RegisterThread(&s_thread);
+
+    s_running = true;
+
+    return TX_SUCCESS;
+}
+
+shared_status_t Svc_Logger_Start(FX_MEDIA *media, const CHAR *file_name)
+{
+    UINT status;
+
+    if (!s_running || (media == NULL) || (file_name == NULL) ||
+        (s_state != SVC_LOGGER_IDLE))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    (void)memset(&s_stats, 0, sizeof(s_stats));
+
+    /* Clusters allocated and committed once, before the first record */
+    (void)fx_file_delete(media, (CHAR *)file_name);
+    status = fx_file_create(media, (CHAR *)file_name);
+    if (status == FX_SUCCESS)
+    {
+        status = fx_file_open(media, &s_file, (CHAR *)file_name, FX_OPEN_FOR_WRITE);
+        if (status == FX_SUCCESS)
+        {
+            status = fx_file_allocate(&s_file, SVC_LOGGER_FILE_SIZE);
+            if (status == FX_SUCCESS)
+            {
+                status = fx_media_flush(media);
+            }
+            if (status != FX_SUCCESS)
+            {
+                (void)fx_file_close(&s_file);
+            }
+        }
+    }
+
+    if (status != FX_SUCCESS)
+    {
+        s_stats.last_error = status;
+        return STATUS_ERROR;
+    }
+
+    s_media = media;
+    s_head = 0U;
+    s_tail = 0U;
+    s_sequence = 0U;
+    s_full = false;
+    s_since_checkpoint = 0U;
+    s_stopping = false;
+    __DMB();
+    s_state = SVC_LOGGER_RUNNING;
+
+    return STATUS_OK;
+}
+
+shared_status_t Svc_Logger_Stop(void)
+{
+    if (!s_running || (s_state == SVC_LOGGER_IDLE) || s_stopping)
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    s_stopping = true;
+    (void)tx_semaphore_put(&s_work);
+    (void)tx_semaphore_get(&s_stopped, TX_WAIT_FOREVER);
+
+    return s_stop_status;
+}
+
+shared_status_t Svc_Logger_Push(const svc_logger_sample_t *sample)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t head = s_head;
+    uint32_t sequence;
+    uint32_t count;
+    uint32_t elapsed;
+    svc_logger_sample_t *record;
+
+    if (sample == NULL)
+    {
+        return STATUS_ERROR_RANGE;
+    }
+
+    sequence = s_sequence++;
+
+    if ((s_state != SVC_LOGGER_RUNNING) || s_stopping)
+    {
+        s_stats.dropped++;
+        return STATUS_ERROR_INVALID;
+    }
+
+    count = head - s_tail;
+    if (count >= LOGGER_RING_RECORDS)
+    {
+        if (!s_full)
+        {
+            s_full = true;
+            s_full_start = start;
+        }
+        s_stats.dropped++;
+        return STATUS_ERROR_TIMEOUT;
+    }
+
+    if (s_full)
+    {
+        s_full = false;
+        elapsed = (start - s_full_start) / Safety_Time_GetCyclesPerUs();
+        if (elapsed > s_stats.full_max_us)
+        {
+            s_stats.full_max_us = elapsed;
+        }
+    }
+
+    record = &s_ring[head & LOGGER_RING_MASK];
+    *record = *sample;
+    record->sequence = sequence;
+
+    /* Record complete before it is published */
+    __DMB();
+    s_head = head + 1U;
+
+    s_stats.pushed++;
+    if ((count + 1U) > s_stats.ring_max)
+    {
+        s_stats.ring_max = count + 1U;
+    }
+
+    if (((head + 1U) % LOGGER_CHUNK_RECORDS) == 0U)
+    {
+        (void)tx_semaphore_put(&s_work);
+    }
+
+    elapsed = DWT->CYCCNT - start;
+    if (elapsed > s_stats.push_max_cycles)
+    {
+        s_stats.push_max_cycles = elapsed;
+    }
+
+    return STATUS_OK;
+}
+
+void Svc_Logger_GetStats(svc_logger_stats_t *stats)
+{
+    uint32_t primask;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    *stats = s_stats;
+    stats->state = s_state;
+
+    __set_PRIMASK(primask);
+}
+
+shared_status_t Svc_Logger_Benchmark(FX_MEDIA *media, svc_logger_benchmark_t *result)
+{
+    svc_logger_sample_t sample;
+    svc_logger_stats_t stats;
+    shared_status_t status;
+    uint64_t start_us;
+    uint64_t wait_us;
+    uint32_t waited;
+    ULONG requests;
+
+    if ((media == NULL) || (result == NULL))
+    {
+        return STATUS_ERROR_INVALID;
+    }
+
+    (void)memset(result, 0, sizeof(*result));
+    (void)memset(&sample, 0, sizeof(sample));
+
+    status = Svc_Logger_Start(media, (const CHAR *)SVC_LOGGER_BENCH_FILE);
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    requests = media->fx_media_driver_write_requests;
+    start_us = Safety_Time_GetUs();
+
+    for (uint32_t n = 0U; (n < (SVC_LOGGER_BENCH_SIZE / sizeof(sample))) &&
+                          (s_state == SVC_LOGGER_RUNNING); n++)
+    {
+        /* Wait for room instead of dropping */
+        if ((s_head - s_tail) >= LOGGER_RING_RECORDS)
+        {
+            wait_us = Safety_Time_GetUs();
+            while (((s_head - s_tail) >= LOGGER_RING_RECORDS) && (s_state == SVC_LOGGER_RUNNING))
+            {
+                tx_thread_sleep(1U);
+            }
+            waited = Logger_ElapsedUs(wait_us);
+            if (waited > result->stall_max_us)
+            {
+                result->stall_max_us = waited;
+            }
+        }
+
+        sample.time_us = n;
+        for (uint32_t i = 0U; i < SVC_LOGGER_ADC_CHANNELS; i++)
+        {
+            sample.adc[i] = (uint16_t)(n + i);
+        }
+        (void)Svc_Logger_Push(&sample);
+    }
+
+    result->elapsed_ms = Logger_ElapsedUs(start_us) / 1000U;
+    result->write_requests = media->fx_media_driver_write_requests - requests;
+
+    start_us = Safety_Time_GetUs();
+    status = Svc_Logger_Stop();
+    result->stop_ms = Logger_ElapsedUs(start_us) / 1000U;
+
+    Svc_Logger_GetStats(&stats);
+    result->rate_kbs = (result->elapsed_ms != 0U) ?
+        (uint32_t)(stats.bytes / result->elapsed_ms) : 0U;
+    result->push_max_ns = (uint32_t)(((uint64_t)stats.push_max_cycles * 1000U) /
+                                     Safety_Time_GetCyclesPerUs());
+    result->write_max_us = stats.write_max_us;
+    result->checkpoint_max_us = stats.checkpoint_max_us;
+
+    (void)fx_file_delete(media, (CHAR *)SVC_LOGGER_BENCH_FILE);
+    (void)fx_media_flush(media);
+
+    return status;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static VOID Logger_ThreadEntry(ULONG thread_input)
+{
+    (void)thread_input;
+
+    for (;;)
+    {
+        (void)tx_semaphore_get(&s_work, TX_WAIT_FOREVER);
+
+        Logger_WriteChunks();
+
+        if (s_stopping && (s_state != SVC_LOGGER_IDLE))
+        {
+            Logger_Finish();
+            (void)tx_semaphore_put(&s_stopped);
+        }
+    }
+}
+
+static void Logger_WriteChunks(void)
+{
+    while ((s_state == SVC_LOGGER_RUNNING) && ((s_head - s_tail) >= LOGGER_CHUNK_RECORDS))
+    {
+        Logger_Write(LOGGER_CHUNK_RECORDS);
+    }
+}
+
+static void Logger_Write(uint32_t records)
+{
+    uint32_t size = records * sizeof(svc_logger_sample_t);
+    uint64_t start_us;
+    uint32_t elapsed;
+    UINT status;
+
+    if ((s_stats.bytes + size) > SVC_LOGGER_FILE_SIZE)
+    {
+        s_state = SVC_LOGGER_FULL;
+        return;
+    }
+
+    start_us = Safety_Time_GetUs();
+    status = fx_file_write(&s_file, &s_ring[s_tail & LOGGER_RING_MASK], size);
+    elapsed = Logger_ElapsedUs(start_us);
+
+    if (status != FX_SUCCESS)
+    {
+        Logger_Fail(status);
+        return;
+    }
+
+    /* The records left the ring */
+    __DMB();
+    s_tail += records;
+
+    s_stats.bytes += size;
+    s_stats.chunks++;
+    if (elapsed > s_stats.write_max_us)
+    {
+        s_stats.write_max_us = elapsed;
+    }
+
+    s_since_checkpoint += size;
+    if (s_since_checkpoint >= SVC_LOGGER_CHECKPOINT_SIZE)
+    {
+        Logger_Checkpoint();
+    }
+}
+
+static void Logger_Checkpoint(void)
+{
+    uint64_t start_us = Safety_Time_GetUs();
+    uint32_t elapsed;
+    UINT status;
+
+    /* File size to the directory entry, caches and card written out */
+    status = fx_media_flush(s_media);
+    elapsed = Logger_ElapsedUs(start_us);
+
+    s_since_checkpoint = 0U;
+    s_stats.checkpoints++;
+    if (elapsed > s_stats.checkpoint_max_us)
+    {
+        s_stats.checkpoint_max_us = elapsed;
+    }
+
+    if (status != FX_SUCCESS)
+    {
+        Logger_Fail(status);
+    }
+}
+
+static void Logger_Finish(void)
+{
+    UINT status;
+
+    /* Whole chunks, then the records of the last one */
+    Logger_WriteChunks();
+    if ((s_state == SVC_LOGGER_RUNNING) && (s_head != s_tail))
+    {
+        Logger_Write(s_head - s_tail);
+    }
+
+    /* Unused clusters released; the close writes the directory entry */
+    status = fx_file_truncate_release(&s_file, s_file.fx_file_current_file_size);
+    if (status == FX_SUCCESS)
+    {
+        status = fx_file_close(&s_file);
+    }
+    else
+    {
+        (void)fx_file_close(&s_file);
+    }
+    if (status == FX_SUCCESS)
+    {
+        s_stats.checkpoints++;
+        status = fx_media_flush(s_media);
+    }
+
+    if (status != FX_SUCCESS)
+    {
+        Logger_Fail(status);
+    }
+
+    s_stop_status = (s_state == SVC_LOGGER_FAILED) ? STATUS_ERROR : STATUS_OK;
+    s_state = SVC_LOGGER_IDLE;
+}
+
+static void Logger_Fail(UINT status)
+{
+    s_stats.last_error = status;
+    s_state = SVC_LOGGER_FAILED;
+}
+
+static uint32_t Logger_ElapsedUs(uint64_t start_us)
+{
+    return (uint32_t)(Safety_Time_GetUs() - start_us);
+}
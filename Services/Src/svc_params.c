@@ -9,24 +9,75 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "svc_params.h"
+#include "safety_params.h"
+#include "config_journal.h"
+#include "params_schema.h"
+#include "tx_api.h"
 #include "stm32f4xx_hal.h"
-#include "crc.h"
 #include <string.h>
-#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CAL_Q15_ONE                 32768.0f
+#define CAL_Q31_ONE                 2147483648.0f
+
+/* Neutral coefficients: gain 1.0 as fraction * 2^shift, offset 0 */
+#define CAL_NEUTRAL_Q15(shift)      ((int16_t)(0x8000UL >> (shift)))
+#define CAL_NEUTRAL_Q31(shift)      ((int32_t)(0x80000000UL >> (shift)))
+#define CAL_REPEAT8(x)              { x, x, x, x, x, x, x, x }
+
+#define CAL_NEUTRAL_GROUP(shift, count)                     \
+    {                                                       \
+        .gain       = CAL_REPEAT8(1.0f),                    \
+        .offset     = CAL_REPEAT8(0.0f),                    \
+        .gain_q31   = CAL_REPEAT8(CAL_NEUTRAL_Q31(shift)),  \
+        .offset_q31 = CAL_REPEAT8(0),                       \
+        .gain_q15   = CAL_REPEAT8(CAL_NEUTRAL_Q15(shift)),  \
+        .offset_q15 = CAL_REPEAT8(0),                       \
+        .gain_shift = (shift),                              \
+        .channels   = (count)                               \
+    }
 
 /* Private variables ---------------------------------------------------------*/
-static safety_params_t s_safety_params;
 static boot_config_t s_boot_config;
 static bool s_params_valid = false;
 static bool s_initialized = false;
 
+/*
+ * Published set and spare. Generation 1 is the empty initial set; a reader
+ * slot holds the generation current when the reader entered, 0 when idle.
+ */
+static svc_params_set_t s_sets[2] = { { .generation = 1U }, { .generation = 0U } };
+static svc_params_set_t * volatile s_published = &s_sets[0];
+static const void *s_loaded_record = NULL;      /* Journal record of s_published */
+static volatile uint32_t s_generation = 1U;
+static volatile uint32_t s_reader_epoch[SVC_PARAMS_MAX_READERS];
+static uint32_t s_reader_count = 0U;
+
+/* Used whenever the parameters are not valid (matches the shadow defaults) */
+static const svc_calibration_t s_calibration_neutral = {
+    .adc   = CAL_NEUTRAL_GROUP(SVC_CAL_ADC_GAIN_SHIFT, SVC_CAL_ADC_CHANNELS),
+    .hall  = CAL_NEUTRAL_GROUP(SVC_CAL_HALL_GAIN_SHIFT, SVC_CAL_HALL_CHANNELS),
+    .valid = false
+};
+
 /* ============================================================================
  * Private Function Prototypes
  * ============================================================================*/
 static shared_status_t ValidateMagicNumber(void);
-static shared_status_t ValidateCRC(void);
-static shared_status_t ValidateRedundancy(void);
-static shared_status_t ValidateRanges(void);
+static shared_status_t ValidateSafetyParams(void);
+static shared_status_t CheckImage(const safety_params_t *image);
+static shared_status_t WaitForReaders(void);
+static bool ReadersLeftSpare(void);
+static svc_params_set_t* GetSpareSet(void);
+static void PublishSet(svc_params_set_t *set);
+static const svc_params_set_t* ReadBegin(uint32_t slot);
+static const svc_calibration_t* SelectCalibration(const svc_params_set_t *set);
+static void BuildCalibration(svc_calibration_t *calibration, const safety_params_t *params);
+static void BuildCalibrationGroup(svc_cal_group_t *cal, const svc_cal_group_t *neutral,
+                                  const float *gain, const float *offset);
+static int32_t CalRound(float value);
+static void CalibrateBlock(const svc_cal_group_t *cal, const uint16_t *raw,
+                           int16_t *out, uint32_t frames);
 
 /* ============================================================================
  * Implementation
@@ -34,15 +85,19 @@ static shared_status_t ValidateRanges(void);
 
 shared_status_t Svc_Params_Init(void)
 {
-    /* Read boot configuration from Flash */
-    memcpy(&s_boot_config,
-           (const void *)BOOT_CONFIG_ADDR,
-           sizeof(boot_config_t));
+    /* Read latest boot configuration record from the config journal */
+    const void *record = Config_Journal_Find(JOURNAL_TYPE_BOOT_CONFIG);
+    if (record != NULL)
+    {
+        memcpy(&s_boot_config, record, sizeof(boot_config_t));
+    }
+    else
+    {
+        memset(&s_boot_config, 0, sizeof(boot_config_t));
+    }
 
-    /* Read safety parameters from Flash */
-    memcpy(&s_safety_params,
-           (const void *)SAFETY_PARAMS_ADDR,
-           sizeof(safety_params_t));
+    /* Safety parameters are shadowed in RAM by the safety module */
+    (void)Safety_Params_Init();
 
     s_initialized = true;
 
@@ -52,6 +107,7 @@ shared_status_t Svc_Params_Init(void)
 
 shared_status_t Svc_Params_Validate(void)
 {
+    svc_params_set_t *spare;
     shared_status_t status;
 
     if (!s_initialized)
@@ -59,48 +115,148 @@ shared_status_t Svc_Params_Validate(void)
         return STATUS_ERROR;
     }
 
+    /* The spare set is written below */
+    status = WaitForReaders();
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
     s_params_valid = false;
 
-    /* Step 1: Validate magic numbers */
+    /* Step 1: Validate boot configuration magic */
     status = ValidateMagicNumber();
     if (status != STATUS_OK)
     {
         return status;
     }
 
-    /* Step 2: Validate CRC */
-    status = ValidateCRC();
+    /* Step 2: Validate safety parameters in Flash and load the shadow */
+    status = ValidateSafetyParams();
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    /* Step 3: Copy, precompute calibration coefficients (FPU) and publish */
+    spare = GetSpareSet();
+    memcpy(&spare->params, Safety_Params_GetShadow(), sizeof(safety_params_t));
+    PublishSet(spare);
+    s_loaded_record = Config_Journal_Find(JOURNAL_TYPE_SAFETY_PARAMS);
+
+    s_params_valid = true;
+    return STATUS_OK;
+}
+
+shared_status_t Svc_Params_Reload(void)
+{
+    const void *record;
+    svc_params_set_t *spare;
+    shared_status_t status;
+
+    if (!s_initialized)
+    {
+        return STATUS_ERROR;
+    }
+
+    /* Records are never rewritten in place: the same record is the same set */
+    record = Config_Journal_Find(JOURNAL_TYPE_SAFETY_PARAMS);
+    if (record == s_loaded_record)
+    {
+        return STATUS_OK;
+    }
+
+    if (record == NULL)
+    {
+        return STATUS_ERROR_MAGIC;
+    }
+
+    status = WaitForReaders();
+    if (status != STATUS_OK)
+    {
+        return status;
+    }
+
+    status = ValidateMagicNumber();
     if (status != STATUS_OK)
     {
         return status;
     }
 
-    /* Step 3: Validate redundancy fields */
-    status = ValidateRedundancy();
+    /* Build and check off to the side: a bad image leaves everything as is */
+    spare = GetSpareSet();
+    memcpy(&spare->params, record, sizeof(safety_params_t));
+
+    status = CheckImage(&spare->params);
     if (status != STATUS_OK)
     {
         return status;
     }
 
-    /* Step 4: Validate parameter ranges */
-    status = ValidateRanges();
+    if (s_params_valid && Safety_Params_IsValid() &&
+        (memcmp(&spare->params, &s_published->params, sizeof(safety_params_t)) == 0))
+    {
+        /* Same content in a new place (compaction) */
+        s_loaded_record = record;
+        return STATUS_OK;
+    }
+
+    /* Move the verified shadow to the new image (reports its own failures) */
+    status = ValidateSafetyParams();
     if (status != STATUS_OK)
     {
+        s_params_valid = false;
         return status;
     }
 
+    PublishSet(spare);
+    s_loaded_record = record;
     s_params_valid = true;
+
     return STATUS_OK;
 }
 
-bool Svc_Params_IsValid(void)
+uint32_t Svc_Params_RegisterReader(void)
+{
+    uint32_t reader = SVC_PARAMS_READER_NONE;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (s_reader_count < SVC_PARAMS_MAX_READERS)
+    {
+        reader = s_reader_count;
+        s_reader_count++;
+    }
+
+    __set_PRIMASK(primask);
+
+    return reader;
+}
+
+const svc_params_set_t* Svc_Params_ReadBegin(uint32_t reader)
+{
+    if (reader >= SVC_PARAMS_MAX_READERS)
+    {
+        /* Unregistered: current set, not protected against reuse */
+        return s_published;
+    }
+
+    return ReadBegin(reader);
+}
+
+void Svc_Params_ReadEnd(uint32_t reader)
 {
-    return s_params_valid;
+    if (reader < SVC_PARAMS_MAX_READERS)
+    {
+        __DMB();
+        s_reader_epoch[reader] = 0U;
+    }
 }
 
-const safety_params_t* Svc_Params_GetSafety(void)
+bool Svc_Params_IsValid(void)
 {
-    return s_params_valid ? &s_safety_params : NULL;
+    /* The periodic shadow check may have invalidated the parameters */
+    return s_params_valid && Safety_Params_IsValid();
 }
 
 const boot_config_t* Svc_Params_GetBootConfig(void)
@@ -108,71 +264,94 @@ const boot_config_t* Svc_Params_GetBootConfig(void)
     return s_initialized ? &s_boot_config : NULL;
 }
 
+/*
+ * Calibration getters read the RAM shadow directly. It holds neutral
+ * defaults whenever the parameters are not valid, so no validity check
+ * is needed here.
+ */
+
 float Svc_Params_GetHallOffset(uint8_t channel)
 {
-    if (!s_params_valid || channel >= 3)
+    if (channel >= 3)
     {
         return 0.0f;
     }
-    return s_safety_params.hall_offset[channel];
+    return Safety_Params_GetShadow()->hall_offset[channel];
 }
 
 float Svc_Params_GetHallGain(uint8_t channel)
 {
-    if (!s_params_valid || channel >= 3)
+    if (channel >= 3)
     {
         return 1.0f;
     }
-    return s_safety_params.hall_gain[channel];
+    return Safety_Params_GetShadow()->hall_gain[channel];
 }
 
 float Svc_Params_GetAdcGain(uint8_t channel)
 {
-    if (!s_params_valid || channel >= 8)
+    if (channel >= 8)
     {
         return 1.0f;
     }
-    return s_safety_params.adc_gain[channel];
+    return Safety_Params_GetShadow()->adc_gain[channel];
 }
 
 float Svc_Params_GetAdcOffset(uint8_t channel)
 {
-    if (!s_params_valid || channel >= 8)
+    if (channel >= 8)
     {
         return 0.0f;
     }
-    return s_safety_params.adc_offset[channel];
+    return Safety_Params_GetShadow()->adc_offset[channel];
 }
 
 float Svc_Params_GetSafetyThreshold(uint8_t index)
 {
-    if (!s_params_valid || index >= 4)
+    if (index >= 4)
     {
         return 0.0f;
     }
-    return s_safety_params.safety_threshold[index];
+    return Safety_Params_GetShadow()->safety_threshold[index];
 }
 
-/* ============================================================================
- * Private Functions
- * ============================================================================*/
+const svc_calibration_t* Svc_Params_GetCalibration(const svc_params_set_t *set)
+{
+    return SelectCalibration((set != NULL) ? set : s_published);
+}
 
-static shared_status_t ValidateMagicNumber(void)
+void Svc_Params_CalibrateAdcBlock(uint32_t reader, const uint16_t *raw, int16_t *out,
+                                  uint32_t frames)
 {
-    /* Check boot config magic */
-    if (s_boot_config.magic != BOOT_CONFIG_MAGIC)
+    if ((raw == NULL) || (out == NULL))
     {
-        return STATUS_ERROR_MAGIC;
+        return;
     }
 
-    /* Check safety params magic */
-    if (s_safety_params.magic != SAFETY_PARAMS_MAGIC)
+    CalibrateBlock(&SelectCalibration(Svc_Params_ReadBegin(reader))->adc, raw, out, frames);
+    Svc_Params_ReadEnd(reader);
+}
+
+void Svc_Params_CalibrateHallBlock(uint32_t reader, const uint16_t *raw, int16_t *out,
+                                   uint32_t frames)
+{
+    if ((raw == NULL) || (out == NULL))
     {
-        return STATUS_ERROR_MAGIC;
+        return;
     }
 
-    /* Check version */
-    if (s_safety_params.version != SAFETY_PARAMS_VERSION)
+    CalibrateBlock(&SelectCalibration(Svc_Params_ReadBegin(reader))->hall, raw, out, frames);
+    Svc_Params_ReadEnd(reader);
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static shared_status_t ValidateMagicNumber(void)
+{
+    /* Check boot config magic */
+    if (s_boot_config.magic != BOOT_CONFIG_MAGIC)
     {
         return STATUS_ERROR_MAGIC;
     }
@@ -180,106 +359,183 @@ static shared_status_t ValidateMagicNumber(void)
     return STATUS_OK;
 }
 
-static shared_status_t ValidateCRC(void)
+static shared_status_t ValidateSafetyParams(void)
 {
-    /* Calculate CRC32 of safety parameters (excluding CRC field) */
-    __HAL_CRC_DR_RESET(&hcrc);
+    switch (Safety_Params_ValidateFlash())
+    {
+        case PARAMS_VALID:
+            return STATUS_OK;
 
-    uint32_t calc_crc = HAL_CRC_Calculate(&hcrc,
-                                          (uint32_t *)&s_safety_params,
-                                          (sizeof(safety_params_t) - 4) / 4);
+        case PARAMS_ERR_MAGIC:
+        case PARAMS_ERR_VERSION:
+        case PARAMS_ERR_SIZE:
+            return STATUS_ERROR_MAGIC;
 
-    if (calc_crc != s_safety_params.crc32)
-    {
-        return STATUS_ERROR_CRC;
-    }
+        case PARAMS_ERR_CRC:
+            return STATUS_ERROR_CRC;
 
-    return STATUS_OK;
+        case PARAMS_ERR_REDUNDANCY:
+            return STATUS_ERROR_REDUNDANCY;
+
+        default:
+            return STATUS_ERROR_RANGE;
+    }
 }
 
-static shared_status_t ValidateRedundancy(void)
+static shared_status_t CheckImage(const safety_params_t *image)
 {
-    uint32_t val, val_inv;
-    const uint8_t *base = (const uint8_t *)&s_safety_params;
+    param_check_t check = Params_Schema_CheckHeader(image);
 
-    /* Verify HALL offset redundancy */
-    for (int i = 0; i < 3; i++)
+    if (check != PARAM_CHECK_OK)
     {
-        memcpy(&val, base + offsetof(safety_params_t, hall_offset) + i * sizeof(float), sizeof(uint32_t));
-        memcpy(&val_inv, base + offsetof(safety_params_t, hall_offset_inv) + i * sizeof(float), sizeof(uint32_t));
-
-        if (val != ~val_inv)
-        {
-            return STATUS_ERROR_REDUNDANCY;
-        }
+        return STATUS_ERROR_MAGIC;
     }
 
-    /* Verify HALL gain redundancy */
-    for (int i = 0; i < 3; i++)
+    if (Safety_Params_CalculateCRC(image, sizeof(safety_params_t) - sizeof(uint32_t)) !=
+        image->crc32)
     {
-        memcpy(&val, base + offsetof(safety_params_t, hall_gain) + i * sizeof(float), sizeof(uint32_t));
-        memcpy(&val_inv, base + offsetof(safety_params_t, hall_gain_inv) + i * sizeof(float), sizeof(uint32_t));
+        return STATUS_ERROR_CRC;
+    }
 
-        if (val != ~val_inv)
-        {
-            return STATUS_ERROR_REDUNDANCY;
-        }
+    check = Params_Schema_CheckFields(image, PARAMS_CHECK_ALL, NULL);
+    if (check != PARAM_CHECK_OK)
+    {
+        return (check == PARAM_CHECK_RANGE) ? STATUS_ERROR_RANGE : STATUS_ERROR_REDUNDANCY;
     }
 
     return STATUS_OK;
 }
 
-static shared_status_t ValidateRanges(void)
+static shared_status_t WaitForReaders(void)
 {
-    /* Validate HALL offsets */
-    for (int i = 0; i < 3; i++)
+    /* No reader is registered before the kernel runs, so no sleep there */
+    for (uint32_t tick = 0U; !ReadersLeftSpare(); tick++)
     {
-        if (!IN_RANGE(s_safety_params.hall_offset[i],
-                     HALL_OFFSET_MIN, HALL_OFFSET_MAX))
+        if (tick >= SVC_PARAMS_GRACE_TICKS)
         {
-            return STATUS_ERROR_RANGE;
+            return STATUS_ERROR_TIMEOUT;
         }
+        tx_thread_sleep(1);
     }
 
-    /* Validate HALL gains */
-    for (int i = 0; i < 3; i++)
+    return STATUS_OK;
+}
+
+static bool ReadersLeftSpare(void)
+{
+    uint32_t generation = s_generation;
+
+    /* A reader that entered before the last swap may still hold the spare */
+    for (uint32_t slot = 0U; slot < SVC_PARAMS_MAX_READERS; slot++)
     {
-        if (!IN_RANGE(s_safety_params.hall_gain[i],
-                     HALL_GAIN_MIN, HALL_GAIN_MAX))
+        uint32_t epoch = s_reader_epoch[slot];
+
+        if ((epoch != 0U) && (epoch < generation))
         {
-            return STATUS_ERROR_RANGE;
+            return false;
         }
     }
 
-    /* Validate ADC gains */
-    for (int i = 0; i < 8; i++)
+    return true;
+}
+
+static svc_params_set_t* GetSpareSet(void)
+{
+    return (s_published == &s_sets[0]) ? &s_sets[1] : &s_sets[0];
+}
+
+static void PublishSet(svc_params_set_t *set)
+{
+    BuildCalibration(&set->calibration, &set->params);
+    set->generation = s_generation + 1U;
+
+    /* Set complete before the pointer, pointer before the generation */
+    __DMB();
+    s_published = set;
+    __DMB();
+    s_generation = set->generation;
+}
+
+static const svc_params_set_t* ReadBegin(uint32_t slot)
+{
+    /* Announce first: a swap after this point waits for ReadEnd */
+    s_reader_epoch[slot] = s_generation;
+    __DMB();
+
+    return s_published;
+}
+
+static const svc_calibration_t* SelectCalibration(const svc_params_set_t *set)
+{
+    /* The periodic shadow check may have fallen back to defaults */
+    if (set->calibration.valid && Safety_Params_IsValid())
     {
-        if (!IN_RANGE(s_safety_params.adc_gain[i],
-                     ADC_GAIN_MIN, ADC_GAIN_MAX))
-        {
-            return STATUS_ERROR_RANGE;
-        }
+        return &set->calibration;
     }
 
-    /* Validate ADC offsets */
-    for (int i = 0; i < 8; i++)
+    return &s_calibration_neutral;
+}
+
+static void BuildCalibration(svc_calibration_t *calibration, const safety_params_t *params)
+{
+    float gain[SVC_CAL_ADC_CHANNELS];
+    float offset[SVC_CAL_ADC_CHANNELS];
+
+    /* safety_params_t is packed: copy to aligned arrays first */
+    memcpy(gain, params->adc_gain, sizeof(params->adc_gain));
+    memcpy(offset, params->adc_offset, sizeof(params->adc_offset));
+    BuildCalibrationGroup(&calibration->adc, &s_calibration_neutral.adc, gain, offset);
+
+    memcpy(gain, params->hall_gain, sizeof(params->hall_gain));
+    memcpy(offset, params->hall_offset, sizeof(params->hall_offset));
+    BuildCalibrationGroup(&calibration->hall, &s_calibration_neutral.hall, gain, offset);
+
+    calibration->valid = true;
+}
+
+static void BuildCalibrationGroup(svc_cal_group_t *cal, const svc_cal_group_t *neutral,
+                                  const float *gain, const float *offset)
+{
+    /* Shift, channel count and unused entries come from the neutral set */
+    *cal = *neutral;
+
+    for (uint32_t ch = 0; ch < cal->channels; ch++)
     {
-        if (!IN_RANGE(s_safety_params.adc_offset[i],
-                     ADC_OFFSET_MIN, ADC_OFFSET_MAX))
-        {
-            return STATUS_ERROR_RANGE;
-        }
+        float fraction = gain[ch] / (float)(1UL << cal->gain_shift);
+        int32_t gain_q15 = CalRound(fraction * CAL_Q15_ONE);
+        int32_t offset_counts = CalRound(offset[ch]);
+
+        cal->gain[ch] = gain[ch];
+        cal->offset[ch] = offset[ch];
+
+        /* Validated gains are below 2^shift; saturate rounding up to 1.0 */
+        cal->gain_q31[ch] = ((fraction * CAL_Q31_ONE) >= CAL_Q31_ONE) ?
+                            INT32_MAX : CalRound(fraction * CAL_Q31_ONE);
+        cal->gain_q15[ch] = (int16_t)((gain_q15 > INT16_MAX) ? INT16_MAX : gain_q15);
+        cal->offset_q31[ch] = offset_counts;
+        cal->offset_q15[ch] = (int16_t)__SSAT(offset_counts, 16);
     }
+}
 
-    /* Validate safety thresholds */
-    for (int i = 0; i < 4; i++)
+static int32_t CalRound(float value)
+{
+    return (int32_t)((value >= 0.0f) ? (value + 0.5f) : (value - 0.5f));
+}
+
+static void CalibrateBlock(const svc_cal_group_t *cal, const uint16_t *raw,
+                           int16_t *out, uint32_t frames)
+{
+    /* raw * fraction * 2^shift, rounded: one multiply, add, shift, saturate */
+    uint32_t rshift = 15U - cal->gain_shift;
+    int32_t rounding = (int32_t)(1UL << (rshift - 1U));
+
+    for (uint32_t frame = 0; frame < frames; frame++)
     {
-        if (!IN_RANGE(s_safety_params.safety_threshold[i],
-                     SAFETY_THRESHOLD_MIN, SAFETY_THRESHOLD_MAX))
+        for (uint32_t ch = 0; ch < cal->channels; ch++)
         {
-            return STATUS_ERROR_RANGE;
+            int32_t scaled = (((int32_t)*raw++ * cal->gain_q15[ch]) + rounding) >> rshift;
+
+            *out++ = (int16_t)__SSAT(scaled + cal->offset_q15[ch], 16);
         }
     }
-
-    return STATUS_OK;
 }
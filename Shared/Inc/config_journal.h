@@ -0,0 +1,205 @@
+/**
+ ******************************************************************************
+ * @file    config_journal.h
+ * @brief   Append-Only Configuration Journal (Config Flash Areas A/B)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * The journal uses two areas (A: Sector 3, B: first 16KB of Sector 8),
+ * each holding a sequence of records instead of structures at fixed
+ * addresses. An update appends a new record to the active area (a few word
+ * programs); the latest record of a type with a valid CRC wins.
+ *
+ * When the active area is full, the live records and the new one are
+ * written to the other area (compaction), and its area header is programmed
+ * last. The area header carries a generation number: the valid area with
+ * the highest generation is active, so selection at boot reads two headers.
+ * The old area is erased only by the compaction after next, so at any point
+ * of an update one complete parameter set remains valid.
+ *
+ * Area layout (word aligned):
+ *   journal_area_header_t  magic, generation, ~generation (committed last)
+ *   records...
+ *
+ * Record layout (word aligned):
+ *   journal_header_t  magic, type, payload length in words
+ *   payload           boot_config_t, safety_params_t, ...
+ *   uint32_t          CRC32 over header and payload
+ *
+ * Without a valid area, Sector 3 still in the fixed layout (boot_config_t at
+ * BOOT_CONFIG_ADDR, safety_params_t at SAFETY_PARAMS_ADDR) is read as is and
+ * converted to records by the first compaction (into area B).
+ *
+ * Reading is shared by the bootloader and the application, writing is done
+ * by the bootloader (storage_flash.c).
+ *
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+#ifndef __CONFIG_JOURNAL_H
+#define __CONFIG_JOURNAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+/* Record payload types come from the image configuration */
+#ifdef BOOTLOADER
+#include "boot_config.h"
+#else
+#include "shared_config.h"
+#endif
+#include <stddef.h>
+
+/* ============================================================================
+ * Journal Definitions
+ * ============================================================================*/
+
+#define JOURNAL_AREA_SIZE           CONFIG_AREA_SIZE
+#define JOURNAL_AREA_COUNT          2U
+#define JOURNAL_AREA_NONE           0xFFU           /* No valid area */
+#define JOURNAL_AREA_MAGIC          0x4A524E41UL    /* "JRNA" */
+#define JOURNAL_RECORD_MAGIC        0x4A52U         /* "JR" */
+#define JOURNAL_ERASED_WORD         0xFFFFFFFFUL
+#define JOURNAL_MAX_PAYLOAD         256U            /* Largest record payload (bytes) */
+
+/* Start address of an area (0 = A, 1 = B) */
+#define JOURNAL_AREA_START(area)    (((area) == 0U) ? CONFIG_AREA_A_START : CONFIG_AREA_B_START)
+
+/* Offset of the first record in an area */
+#define JOURNAL_FIRST_RECORD        sizeof(journal_area_header_t)
+
+/* Flash bytes used by a record with the given payload size */
+#define JOURNAL_RECORD_SIZE(payload) \
+    (sizeof(journal_header_t) + (uint32_t)(payload) + sizeof(uint32_t))
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Record type
+ */
+typedef enum {
+    JOURNAL_TYPE_BOOT_CONFIG    = 0x01U,    /* boot_config_t */
+    JOURNAL_TYPE_SAFETY_PARAMS  = 0x02U     /* safety_params_t */
+} journal_type_t;
+
+#define JOURNAL_TYPE_COUNT          2U
+
+/**
+ * @brief Record header (one word, programmed first)
+ */
+typedef struct {
+    uint16_t magic;                 /* JOURNAL_RECORD_MAGIC */
+    uint8_t  type;                  /* journal_type_t */
+    uint8_t  words;                 /* Payload length in words */
+} journal_header_t;
+
+/**
+ * @brief Area header (programmed last, commits the area)
+ */
+typedef struct {
+    uint32_t magic;                 /* JOURNAL_AREA_MAGIC */
+    uint32_t generation;            /* Incremented by every compaction */
+    uint32_t generation_inv;        /* ~generation */
+} journal_area_header_t;
+
+/**
+ * @brief Config region layout
+ */
+typedef enum {
+    JOURNAL_LAYOUT_EMPTY        = 0x00U,    /* No valid area, no legacy data */
+    JOURNAL_LAYOUT_RECORDS      = 0x01U,    /* Record journal in a valid area */
+    JOURNAL_LAYOUT_LEGACY       = 0x02U     /* Fixed-address structures */
+} journal_layout_t;
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Get the layout of the config region
+ * @retval journal_layout_t Layout
+ */
+journal_layout_t Config_Journal_GetLayout(void);
+
+/**
+ * @brief Get the active area (valid header, highest generation)
+ * @retval uint32_t Area index, JOURNAL_AREA_NONE if no area is valid
+ */
+uint32_t Config_Journal_GetActiveArea(void);
+
+/**
+ * @brief Get the generation of an area
+ * @param area Area index
+ * @retval uint32_t Generation, 0 if the area header is not valid
+ */
+uint32_t Config_Journal_GetGeneration(uint32_t area);
+
+/**
+ * @brief Find the latest valid record of a type
+ * @param type Record type
+ * @retval const void* Payload in Flash (word aligned), NULL if none
+ * @note  Payload contents (magic, CRC, ranges) are checked by the caller
+ */
+const void* Config_Journal_Find(journal_type_t type);
+
+/**
+ * @brief Find the latest valid record of a type, whatever its payload size
+ * @param type Record type
+ * @param size Payload bytes of the record found (output)
+ * @retval const void* Payload in Flash (word aligned), NULL if none
+ * @note  Finds records written with an older structure layout (migration)
+ */
+const void* Config_Journal_FindLatest(journal_type_t type, uint32_t *size);
+
+/**
+ * @brief Get the payload size of a record type
+ * @param type Record type
+ * @retval uint32_t Payload bytes, 0 for an unknown type
+ */
+uint32_t Config_Journal_GetPayloadSize(journal_type_t type);
+
+/**
+ * @brief Get offset of the first free word in the active area
+ * @retval uint32_t Offset from the area start, JOURNAL_AREA_SIZE if the area
+ *         is full or corrupted, or no area is valid (compaction required)
+ */
+uint32_t Config_Journal_GetFreeOffset(void);
+
+/**
+ * @brief Build the header of an area
+ * @param generation Area generation (non-zero)
+ * @param header Header (output)
+ */
+void Config_Journal_MakeAreaHeader(uint32_t generation, journal_area_header_t *header);
+
+/**
+ * @brief Build the header word of a record
+ * @param type Record type
+ * @param size Payload bytes (multiple of 4)
+ * @retval uint32_t Header word
+ */
+uint32_t Config_Journal_MakeHeader(journal_type_t type, uint32_t size);
+
+/**
+ * @brief Calculate the CRC32 of a record
+ * @param header Header word
+ * @param payload Payload
+ * @param size Payload bytes (multiple of 4)
+ * @retval uint32_t CRC32 (STM32 CRC unit polynomial and word order)
+ */
+uint32_t Config_Journal_CalculateCRC(uint32_t header, const void *payload, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONFIG_JOURNAL_H */
@@ -0,0 +1,100 @@
+/**
+ ******************************************************************************
+ * @file    params_migrate.h
+ * @brief   Safety Parameter Layout Migration
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Upgrades a safety_params_t written with an older SAFETY_PARAMS_VERSION to
+ * the current layout in RAM, so a layout change does not need a new factory
+ * calibration. Every released layout is described once by a frozen
+ * descriptor (version, size, position of each schema field); fields are
+ * matched by schema row, fields the old layout lacks get the schema default
+ * and the inverted copies are regenerated.
+ *
+ * The header (magic, version, size) and the trailing crc32 keep their place
+ * in every layout. The bootloader writes the upgraded parameters back once
+ * through the config journal.
+ *
+ * When changing safety_params_t: add a descriptor for the layout being
+ * replaced to params_migrate.c, then bump SAFETY_PARAMS_VERSION.
+ *
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PARAMS_MIGRATE_H
+#define __PARAMS_MIGRATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "params_schema.h"
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Position of one schema field in a released layout
+ */
+typedef struct {
+    uint16_t id;                    /* param_field_id_t */
+    uint16_t offset;                /* Byte offset in that layout */
+    uint16_t count;                 /* Array elements in that layout */
+} params_layout_field_t;
+
+/**
+ * @brief Released safety_params_t layout
+ */
+typedef struct {
+    uint16_t version;               /* SAFETY_PARAMS_VERSION of the layout */
+    uint16_t size;                  /* sizeof(safety_params_t) of the layout */
+    const params_layout_field_t *fields;
+    uint16_t field_count;
+} params_layout_t;
+
+/**
+ * @brief Migration result
+ */
+typedef enum {
+    PARAM_MIGRATE_OK            = 0x00U,    /* Upgraded to the current layout */
+    PARAM_MIGRATE_CURRENT       = 0x01U,    /* Already the current layout */
+    PARAM_MIGRATE_MAGIC         = 0x02U,    /* Not a safety_params_t image */
+    PARAM_MIGRATE_UNKNOWN       = 0x03U,    /* No descriptor for the version */
+    PARAM_MIGRATE_SIZE          = 0x04U     /* Size does not match the descriptor */
+} param_migrate_t;
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Get the descriptor of a released layout
+ * @param version SAFETY_PARAMS_VERSION of the layout
+ * @retval const params_layout_t* Descriptor, NULL if unknown
+ */
+const params_layout_t* Params_Migrate_FindLayout(uint16_t version);
+
+/**
+ * @brief Upgrade an older parameter image to the current layout
+ * @param image Stored image (word aligned)
+ * @param size Bytes available at image
+ * @param params Current layout (output), header set, crc32 left 0
+ * @retval param_migrate_t PARAM_MIGRATE_OK or reason for not migrating
+ * @note  The caller checks the image crc32 before and the ranges after
+ */
+param_migrate_t Params_Migrate_Upgrade(const void *image, uint32_t size,
+                                       safety_params_t *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PARAMS_MIGRATE_H */
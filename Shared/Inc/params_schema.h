@@ -0,0 +1,176 @@
+/**
+ ******************************************************************************
+ * @file    params_schema.h
+ * @brief   Safety Parameter Schema and Table-Driven Validator
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Single source for the layout checks of safety_params_t. Range, NaN/Inf and
+ * redundancy rules for every calibration field are declared once in
+ * SAFETY_PARAMS_SCHEMA and checked by one table-driven pass, shared by the
+ * bootloader and the application.
+ *
+ * Target: STM32F407VGT6
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PARAMS_SCHEMA_H
+#define __PARAMS_SCHEMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+/* safety_params_t comes from the image configuration */
+#ifdef BOOTLOADER
+#include "boot_config.h"
+#else
+#include "shared_config.h"
+#endif
+#include <stddef.h>
+
+/* ============================================================================
+ * Parameter Validation Ranges (bootloader and application)
+ * ============================================================================*/
+#define HALL_OFFSET_MIN         (-1000.0f)
+#define HALL_OFFSET_MAX         (1000.0f)
+#define HALL_GAIN_MIN           (0.5f)
+#define HALL_GAIN_MAX           (2.0f)
+#define ADC_GAIN_MIN            (0.8f)
+#define ADC_GAIN_MAX            (1.2f)
+#define ADC_OFFSET_MIN          (-500.0f)
+#define ADC_OFFSET_MAX          (500.0f)
+#define SAFETY_THRESHOLD_MIN    (0.0f)
+#define SAFETY_THRESHOLD_MAX    (10000.0f)
+
+/* ============================================================================
+ * Schema Definition
+ * ============================================================================*/
+
+/* Redundancy column values */
+#define PARAM_INV(field)            offsetof(safety_params_t, field)
+#define PARAM_NO_INV                0U
+
+/*
+ * Safety parameter schema: X(field, inv, min, max, def, group)
+ *   field - float array in safety_params_t
+ *   inv   - PARAM_INV(<bit-inverted copy>) or PARAM_NO_INV
+ *   min   - lower limit (inclusive)
+ *   max   - upper limit (inclusive)
+ *   def   - value for a field missing in an older layout (params_migrate.c)
+ *   group - param_group_t reported on failure
+ * Every float between the header and reserved[] must be listed here
+ * (checked at build time in params_schema.c).
+ */
+#define SAFETY_PARAMS_SCHEMA(X)                                                                                    \
+    X(hall_offset,      PARAM_INV(hall_offset_inv), HALL_OFFSET_MIN,      HALL_OFFSET_MAX,      0.0f, PARAM_GROUP_HALL)      \
+    X(hall_gain,        PARAM_INV(hall_gain_inv),   HALL_GAIN_MIN,        HALL_GAIN_MAX,        1.0f, PARAM_GROUP_HALL)      \
+    X(adc_gain,         PARAM_NO_INV,               ADC_GAIN_MIN,         ADC_GAIN_MAX,         1.0f, PARAM_GROUP_ADC)       \
+    X(adc_offset,       PARAM_NO_INV,               ADC_OFFSET_MIN,       ADC_OFFSET_MAX,       0.0f, PARAM_GROUP_ADC)       \
+    X(safety_threshold, PARAM_NO_INV,               SAFETY_THRESHOLD_MIN, SAFETY_THRESHOLD_MAX, 0.0f, PARAM_GROUP_THRESHOLD)
+
+/* Schema row index of each field (PARAM_FIELD_hall_offset, ...) */
+#define PARAM_FIELD_ID(field, inv, min, max, def, group)    PARAM_FIELD_##field,
+
+typedef enum {
+    SAFETY_PARAMS_SCHEMA(PARAM_FIELD_ID)
+    PARAM_FIELD_ID_COUNT
+} param_field_id_t;
+
+/* ============================================================================
+ * Types
+ * ============================================================================*/
+
+/**
+ * @brief Parameter group, mapped to each image's error codes
+ */
+typedef enum {
+    PARAM_GROUP_HALL            = 0x00U,    /* HALL sensor calibration */
+    PARAM_GROUP_ADC             = 0x01U,    /* ADC calibration */
+    PARAM_GROUP_THRESHOLD       = 0x02U     /* Safety thresholds */
+} param_group_t;
+
+/**
+ * @brief Schema check result
+ */
+typedef enum {
+    PARAM_CHECK_OK              = 0x00U,    /* All checks passed */
+    PARAM_CHECK_MAGIC           = 0x01U,    /* Magic number invalid */
+    PARAM_CHECK_VERSION         = 0x02U,    /* Version mismatch */
+    PARAM_CHECK_SIZE            = 0x03U,    /* Size mismatch */
+    PARAM_CHECK_RANGE           = 0x04U,    /* Out of range, NaN or Inf */
+    PARAM_CHECK_REDUNDANCY      = 0x05U     /* Inverted copy mismatch */
+} param_check_t;
+
+/**
+ * @brief Location of the first failing value
+ */
+typedef struct {
+    uint16_t field;                 /* Schema row */
+    uint16_t index;                 /* Array element */
+    param_group_t group;            /* Group of the schema row */
+} param_fail_t;
+
+/**
+ * @brief Schema row (built from SAFETY_PARAMS_SCHEMA)
+ */
+typedef struct {
+    uint16_t offset;                /* Field offset in safety_params_t */
+    uint16_t inv_offset;            /* Inverted copy offset, 0 if none */
+    uint16_t count;                 /* Array elements */
+    uint16_t group;                 /* param_group_t */
+    float    min;                   /* Lower limit (inclusive) */
+    float    max;                   /* Upper limit (inclusive) */
+    float    def;                   /* Default for migration */
+} param_field_t;
+
+/* Check selection for Params_Schema_CheckFields */
+#define PARAMS_CHECK_RANGE          0x01U   /* Range, NaN and Inf */
+#define PARAMS_CHECK_REDUNDANCY     0x02U   /* Inverted copies */
+#define PARAMS_CHECK_ALL            (PARAMS_CHECK_RANGE | PARAMS_CHECK_REDUNDANCY)
+
+/* ============================================================================
+ * Function Prototypes
+ * ============================================================================*/
+
+/**
+ * @brief Check header (magic, version, size)
+ * @param params Parameters to check
+ * @retval param_check_t PARAM_CHECK_OK or first failing header check
+ */
+param_check_t Params_Schema_CheckHeader(const safety_params_t *params);
+
+/**
+ * @brief Check all schema fields in one pass
+ * @param params Parameters to check
+ * @param checks PARAMS_CHECK_xxx selection
+ * @param fail Location of the first failure (may be NULL)
+ * @retval param_check_t PARAM_CHECK_OK, RANGE or REDUNDANCY
+ */
+param_check_t Params_Schema_CheckFields(const safety_params_t *params,
+                                        uint32_t checks,
+                                        param_fail_t *fail);
+
+/**
+ * @brief Write the inverted copy of every redundant field
+ * @param params Parameters to update
+ */
+void Params_Schema_PrepareRedundancy(safety_params_t *params);
+
+/**
+ * @brief Get schema table
+ * @param count Number of rows (output)
+ * @retval const param_field_t* Schema rows
+ */
+const param_field_t* Params_Schema_GetFields(uint32_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PARAMS_SCHEMA_H */
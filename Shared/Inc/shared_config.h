@@ -36,11 +36,17 @@ extern "C" {
 #define BOOT_FLASH_SIZE         0x0000C000UL    /* 48KB */
 #define BOOT_CRC_ADDR           0x0800BFFCUL    /* Last 4 bytes for CRC */
 
-/* Config/Calibration Region (16KB, Sector 3) */
+/* Config/Calibration Region (16KB, Sector 3: journal area A) */
 #define CONFIG_FLASH_START      0x0800C000UL
 #define CONFIG_FLASH_END        0x0800FFFFUL
 #define CONFIG_FLASH_SIZE       0x00004000UL    /* 16KB */
-#define CONFIG_FLASH_SECTOR     3U
+#define CONFIG_AREA_SIZE        0x00004000UL    /* 16KB per journal area */
+#define CONFIG_AREA_A_START     CONFIG_FLASH_START
+#define CONFIG_AREA_A_SECTOR    3U
+
+/* Journal area B: first 16KB of Sector 8 (128KB, parameter region) */
+#define CONFIG_AREA_B_START     0x08080000UL
+#define CONFIG_AREA_B_SECTOR    8U
 
 /* Application Region (448KB, Sectors 4-7) */
 #define APP_FLASH_START         0x08010000UL
@@ -57,6 +63,10 @@ extern "C" {
 #define CCMRAM_END              0x1000FFFFUL
 #define CCMRAM_SIZE             0x00010000UL    /* 64KB */
 
+/* Crash Record (top 1KB of CCM RAM, not used by bootloader, kept across reset) */
+#define CRASH_RECORD_START      0x1000FC00UL
+#define CRASH_RECORD_SIZE       0x00000400UL    /* 1KB */
+
 /* RAM Test Configuration (subset of RAM for startup test) */
 #define RAM_TEST_START          0x20018000UL    /* Last 32KB of RAM for test */
 #define RAM_TEST_SIZE           0x00008000UL    /* 32KB test area */
@@ -110,6 +120,7 @@ typedef struct __attribute__((packed)) {
     uint32_t crc;               /* Structure CRC32 */
 } boot_config_t;
 
+/* Fixed-layout addresses (pre-journal, area A), records: Config_Journal_Find() */
 #define BOOT_CONFIG_ADDR        (CONFIG_FLASH_START)
 #define BOOT_CONFIG_SIZE        sizeof(boot_config_t)
 
@@ -142,7 +153,7 @@ typedef struct __attribute__((packed)) {
     uint32_t crc32;             /* CRC32 of entire structure */
 } safety_params_t;
 
-#define SAFETY_PARAMS_ADDR      (CONFIG_FLASH_START + sizeof(boot_config_t))
+#define SAFETY_PARAMS_ADDR      (BOOT_CONFIG_ADDR + sizeof(boot_config_t))
 #define SAFETY_PARAMS_SIZE      sizeof(safety_params_t)
 
 /* ============================================================================
@@ -163,20 +174,6 @@ typedef struct __attribute__((packed)) {
 #define DEFAULT_CAN_ID_BASE     0x100U
 #define DEFAULT_COMM_TIMEOUT    1000U
 
-/* ============================================================================
- * Parameter Validation Ranges
- * ============================================================================*/
-#define HALL_OFFSET_MIN         (-1000.0f)
-#define HALL_OFFSET_MAX         (1000.0f)
-#define HALL_GAIN_MIN           (0.5f)
-#define HALL_GAIN_MAX           (2.0f)
-#define ADC_GAIN_MIN            (0.8f)
-#define ADC_GAIN_MAX            (1.2f)
-#define ADC_OFFSET_MIN          (-500.0f)
-#define ADC_OFFSET_MAX          (500.0f)
-#define SAFETY_THRESHOLD_MIN    (0.0f)
-#define SAFETY_THRESHOLD_MAX    (10000.0f)
-
 /* ============================================================================
  * Program Flow Monitor Configuration
  * ============================================================================*/
@@ -0,0 +1,302 @@
+/**
+ ******************************************************************************
+ * @file    config_journal.c
+ * @brief   Append-Only Configuration Journal (Config Flash Areas A/B)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Built into both images. Records are written header first, so a record
+ * torn by a power loss keeps a valid length and is skipped by its CRC.
+ * An area whose compaction was torn has no area header and is ignored.
+ *
+ * The CRC is calculated in software: the application and the bootloader
+ * drive the CRC unit differently and lookups may run before either has
+ * initialized it.
+ *
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "config_journal.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define JOURNAL_CRC_INIT            0xFFFFFFFFUL
+#define JOURNAL_CRC_POLYNOMIAL      0x04C11DB7UL
+
+#define JOURNAL_HEADER_MAGIC(h)     ((h) & 0xFFFFU)
+#define JOURNAL_HEADER_TYPE(h)      (((h) >> 16) & 0xFFU)
+#define JOURNAL_HEADER_WORDS(h)     (((h) >> 24) & 0xFFU)
+
+#define JOURNAL_WORD(address)       (*(const uint32_t *)(address))
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint8_t  type;                  /* journal_type_t */
+    uint32_t size;                  /* Payload bytes */
+    uint32_t legacy_addr;           /* Address in the fixed layout */
+    uint32_t legacy_magic;          /* First payload word in the fixed layout */
+} journal_record_type_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const journal_record_type_t s_record_types[JOURNAL_TYPE_COUNT] = {
+    { JOURNAL_TYPE_BOOT_CONFIG,   sizeof(boot_config_t),   BOOT_CONFIG_ADDR,   BOOT_CONFIG_MAGIC },
+    { JOURNAL_TYPE_SAFETY_PARAMS, sizeof(safety_params_t), SAFETY_PARAMS_ADDR, SAFETY_PARAMS_MAGIC }
+};
+
+/* Area A is the whole config sector (area B uses the same size in Sector 8) */
+typedef char journal_areas_fit[(JOURNAL_AREA_SIZE == CONFIG_FLASH_SIZE) ? 1 : -1];
+
+/* Payloads must fit the header length field and the compaction buffers */
+typedef char journal_payload_fits[
+    ((sizeof(boot_config_t) <= JOURNAL_MAX_PAYLOAD) &&
+     (sizeof(safety_params_t) <= JOURNAL_MAX_PAYLOAD) &&
+     ((JOURNAL_MAX_PAYLOAD / 4U) <= 0xFFU)) ? 1 : -1];
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static const journal_record_type_t* Journal_GetRecordType(journal_type_t type);
+static const void* Journal_FindRecord(const journal_record_type_t *record_type,
+                                      uint32_t any_size, uint32_t *size);
+static uint32_t Journal_NextRecord(uint32_t area_start, uint32_t offset);
+static uint32_t Journal_CrcWord(uint32_t crc, uint32_t word);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+journal_layout_t Config_Journal_GetLayout(void)
+{
+    if (Config_Journal_GetActiveArea() != JOURNAL_AREA_NONE)
+    {
+        return JOURNAL_LAYOUT_RECORDS;
+    }
+
+    return (JOURNAL_WORD(BOOT_CONFIG_ADDR) != JOURNAL_ERASED_WORD) ?
+           JOURNAL_LAYOUT_LEGACY : JOURNAL_LAYOUT_EMPTY;
+}
+
+uint32_t Config_Journal_GetActiveArea(void)
+{
+    uint32_t active = JOURNAL_AREA_NONE;
+    uint32_t active_generation = 0U;
+
+    for (uint32_t area = 0U; area < JOURNAL_AREA_COUNT; area++)
+    {
+        uint32_t generation = Config_Journal_GetGeneration(area);
+
+        if (generation > active_generation)
+        {
+            active = area;
+            active_generation = generation;
+        }
+    }
+
+    return active;
+}
+
+uint32_t Config_Journal_GetGeneration(uint32_t area)
+{
+    const journal_area_header_t *header;
+
+    if (area >= JOURNAL_AREA_COUNT)
+    {
+        return 0U;
+    }
+
+    header = (const journal_area_header_t *)JOURNAL_AREA_START(area);
+    if ((header->magic != JOURNAL_AREA_MAGIC) ||
+        (header->generation != ~header->generation_inv))
+    {
+        return 0U;
+    }
+
+    return header->generation;
+}
+
+const void* Config_Journal_Find(journal_type_t type)
+{
+    const journal_record_type_t *record_type = Journal_GetRecordType(type);
+    uint32_t size;
+
+    return (record_type != NULL) ? Journal_FindRecord(record_type, 0U, &size) : NULL;
+}
+
+const void* Config_Journal_FindLatest(journal_type_t type, uint32_t *size)
+{
+    const journal_record_type_t *record_type = Journal_GetRecordType(type);
+
+    if ((record_type == NULL) || (size == NULL))
+    {
+        return NULL;
+    }
+
+    return Journal_FindRecord(record_type, 1U, size);
+}
+
+uint32_t Config_Journal_GetPayloadSize(journal_type_t type)
+{
+    const journal_record_type_t *record_type = Journal_GetRecordType(type);
+
+    return (record_type != NULL) ? record_type->size : 0U;
+}
+
+uint32_t Config_Journal_GetFreeOffset(void)
+{
+    uint32_t area = Config_Journal_GetActiveArea();
+    uint32_t area_start;
+    uint32_t offset = JOURNAL_FIRST_RECORD;
+
+    if (area == JOURNAL_AREA_NONE)
+    {
+        return JOURNAL_AREA_SIZE;
+    }
+
+    area_start = JOURNAL_AREA_START(area);
+
+    while (offset < JOURNAL_AREA_SIZE)
+    {
+        uint32_t header = JOURNAL_WORD(area_start + offset);
+
+        if (header == JOURNAL_ERASED_WORD)
+        {
+            return offset;
+        }
+
+        if (JOURNAL_HEADER_MAGIC(header) != JOURNAL_RECORD_MAGIC)
+        {
+            /* Not a record: the rest of the area cannot be trusted */
+            return JOURNAL_AREA_SIZE;
+        }
+
+        offset = Journal_NextRecord(area_start, offset);
+    }
+
+    return JOURNAL_AREA_SIZE;
+}
+
+void Config_Journal_MakeAreaHeader(uint32_t generation, journal_area_header_t *header)
+{
+    header->magic = JOURNAL_AREA_MAGIC;
+    header->generation = generation;
+    header->generation_inv = ~generation;
+}
+
+uint32_t Config_Journal_MakeHeader(journal_type_t type, uint32_t size)
+{
+    return ((size / 4U) << 24) | ((uint32_t)type << 16) | JOURNAL_RECORD_MAGIC;
+}
+
+uint32_t Config_Journal_CalculateCRC(uint32_t header, const void *payload, uint32_t size)
+{
+    const uint32_t *data = (const uint32_t *)payload;
+    uint32_t crc = Journal_CrcWord(JOURNAL_CRC_INIT, header);
+
+    for (uint32_t i = 0U; i < (size / 4U); i++)
+    {
+        crc = Journal_CrcWord(crc, data[i]);
+    }
+
+    return crc;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static const journal_record_type_t* Journal_GetRecordType(journal_type_t type)
+{
+    for (uint32_t i = 0U; i < JOURNAL_TYPE_COUNT; i++)
+    {
+        if (s_record_types[i].type == (uint8_t)type)
+        {
+            return &s_record_types[i];
+        }
+    }
+
+    return NULL;
+}
+
+static const void* Journal_FindRecord(const journal_record_type_t *record_type,
+                                      uint32_t any_size, uint32_t *size)
+{
+    uint32_t area = Config_Journal_GetActiveArea();
+    uint32_t area_start;
+    uint32_t limit = JOURNAL_AREA_SIZE;
+
+    if (area == JOURNAL_AREA_NONE)
+    {
+        /* The fixed layout has one record per type at a known address */
+        *size = record_type->size;
+        return (JOURNAL_WORD(record_type->legacy_addr) == record_type->legacy_magic) ?
+               (const void *)record_type->legacy_addr : NULL;
+    }
+
+    area_start = JOURNAL_AREA_START(area);
+
+    /* Latest record of the type, falling back to older ones on CRC failure */
+    while (limit > JOURNAL_FIRST_RECORD)
+    {
+        uint32_t found = JOURNAL_AREA_SIZE;
+
+        for (uint32_t offset = JOURNAL_FIRST_RECORD; offset < limit;
+             offset = Journal_NextRecord(area_start, offset))
+        {
+            uint32_t header = JOURNAL_WORD(area_start + offset);
+
+            if ((JOURNAL_HEADER_MAGIC(header) != JOURNAL_RECORD_MAGIC) ||
+                (Journal_NextRecord(area_start, offset) > JOURNAL_AREA_SIZE))
+            {
+                break;
+            }
+
+            if ((JOURNAL_HEADER_TYPE(header) == record_type->type) &&
+                ((any_size != 0U) || ((JOURNAL_HEADER_WORDS(header) * 4U) == record_type->size)))
+            {
+                found = offset;
+            }
+        }
+
+        if (found == JOURNAL_AREA_SIZE)
+        {
+            return NULL;
+        }
+
+        uint32_t record = area_start + found;
+        uint32_t payload_size = JOURNAL_HEADER_WORDS(JOURNAL_WORD(record)) * 4U;
+        const void *payload = (const void *)(record + sizeof(journal_header_t));
+        uint32_t stored_crc = JOURNAL_WORD(record + sizeof(journal_header_t) + payload_size);
+
+        if (Config_Journal_CalculateCRC(JOURNAL_WORD(record), payload, payload_size) == stored_crc)
+        {
+            *size = payload_size;
+            return payload;
+        }
+
+        limit = found;
+    }
+
+    return NULL;
+}
+
+static uint32_t Journal_NextRecord(uint32_t area_start, uint32_t offset)
+{
+    uint32_t words = JOURNAL_HEADER_WORDS(JOURNAL_WORD(area_start + offset));
+
+    return offset + JOURNAL_RECORD_SIZE(words * 4U);
+}
+
+static uint32_t Journal_CrcWord(uint32_t crc, uint32_t word)
+{
+    crc ^= word;
+    for (uint32_t bit = 0U; bit < 32U; bit++)
+    {
+        crc = ((crc & 0x80000000UL) != 0U) ? ((crc << 1) ^ JOURNAL_CRC_POLYNOMIAL) : (crc << 1);
+    }
+
+    return crc;
+}
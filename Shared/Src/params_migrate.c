@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file    params_migrate.c
+ * @brief   Safety Parameter Layout Migration
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Built into both images, called by the bootloader. Descriptors are frozen:
+ * offsets are literal values of the released layout, never offsetof() of
+ * the current safety_params_t.
+ *
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "params_migrate.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+/* Header layout shared by every version */
+#define MIGRATE_MAGIC_OFFSET        0U
+#define MIGRATE_VERSION_OFFSET      4U
+#define MIGRATE_SIZE_OFFSET         6U
+#define MIGRATE_HEADER_SIZE         8U
+
+#define MIGRATE_LAYOUT(fields)      (fields), (uint16_t)(sizeof(fields) / sizeof((fields)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+/* V1.0: 168 bytes */
+static const params_layout_field_t s_fields_v0100[] = {
+    { PARAM_FIELD_hall_offset,        8U, 3U },
+    { PARAM_FIELD_hall_gain,         20U, 3U },
+    { PARAM_FIELD_adc_gain,          56U, 8U },
+    { PARAM_FIELD_adc_offset,        88U, 8U },
+    { PARAM_FIELD_safety_threshold, 120U, 4U }
+};
+
+static const params_layout_t s_layouts[] = {
+    { 0x0100U, 168U, MIGRATE_LAYOUT(s_fields_v0100) }
+};
+
+#define MIGRATE_LAYOUT_COUNT        (sizeof(s_layouts) / sizeof(s_layouts[0]))
+
+/* Layout changed without a version bump: V1.0 is frozen at 168 bytes */
+typedef char params_v0100_frozen[
+    ((SAFETY_PARAMS_VERSION != 0x0100U) || (sizeof(safety_params_t) == 168U)) ? 1 : -1];
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static void Migrate_LoadDefaults(safety_params_t *params);
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+const params_layout_t* Params_Migrate_FindLayout(uint16_t version)
+{
+    for (uint32_t i = 0; i < MIGRATE_LAYOUT_COUNT; i++)
+    {
+        if (s_layouts[i].version == version)
+        {
+            return &s_layouts[i];
+        }
+    }
+
+    return NULL;
+}
+
+param_migrate_t Params_Migrate_Upgrade(const void *image, uint32_t size,
+                                       safety_params_t *params)
+{
+    const uint8_t *src = (const uint8_t *)image;
+    const params_layout_t *layout;
+    const param_field_t *rows;
+    uint32_t row_count;
+    uint32_t magic;
+    uint16_t version;
+    uint16_t stored_size;
+
+    if ((image == NULL) || (params == NULL) || (size < MIGRATE_HEADER_SIZE))
+    {
+        return PARAM_MIGRATE_MAGIC;
+    }
+
+    memcpy(&magic, src + MIGRATE_MAGIC_OFFSET, sizeof(magic));
+    memcpy(&version, src + MIGRATE_VERSION_OFFSET, sizeof(version));
+    memcpy(&stored_size, src + MIGRATE_SIZE_OFFSET, sizeof(stored_size));
+
+    if (magic != SAFETY_PARAMS_MAGIC)
+    {
+        return PARAM_MIGRATE_MAGIC;
+    }
+
+    if (version == SAFETY_PARAMS_VERSION)
+    {
+        return PARAM_MIGRATE_CURRENT;
+    }
+
+    layout = Params_Migrate_FindLayout(version);
+    if (layout == NULL)
+    {
+        return PARAM_MIGRATE_UNKNOWN;
+    }
+
+    if ((stored_size != layout->size) || (size < layout->size))
+    {
+        return PARAM_MIGRATE_SIZE;
+    }
+
+    /* Defaults first: fields the old layout lacks keep them */
+    Migrate_LoadDefaults(params);
+
+    rows = Params_Schema_GetFields(&row_count);
+    for (uint32_t f = 0; f < layout->field_count; f++)
+    {
+        const params_layout_field_t *field = &layout->fields[f];
+
+        if (field->id >= row_count)
+        {
+            continue;
+        }
+
+        /* Arrays that changed length keep the common elements */
+        uint32_t count = (field->count < rows[field->id].count) ?
+                         field->count : rows[field->id].count;
+
+        memcpy((uint8_t *)params + rows[field->id].offset, src + field->offset,
+               count * sizeof(float));
+    }
+
+    Params_Schema_PrepareRedundancy(params);
+
+    params->magic = SAFETY_PARAMS_MAGIC;
+    params->version = SAFETY_PARAMS_VERSION;
+    params->size = sizeof(safety_params_t);
+    params->crc32 = 0U;
+
+    return PARAM_MIGRATE_OK;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static void Migrate_LoadDefaults(safety_params_t *params)
+{
+    uint32_t row_count;
+    const param_field_t *rows = Params_Schema_GetFields(&row_count);
+
+    memset(params, 0, sizeof(safety_params_t));
+
+    for (uint32_t f = 0; f < row_count; f++)
+    {
+        for (uint32_t i = 0; i < rows[f].count; i++)
+        {
+            memcpy((uint8_t *)params + rows[f].offset + (i * sizeof(float)),
+                   &rows[f].def, sizeof(float));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file    params_schema.c
+ * @brief   Safety Parameter Schema and Table-Driven Validator
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Built into both images. The bootloader defines BOOTLOADER so the schema
+ * uses the types from boot_config.h instead of shared_config.h.
+ *
+ * Compliance: IEC 61508 SIL 2 / ISO 13849 PL d
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "params_schema.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define PARAM_FIELD_ELEMENTS(field) \
+    (sizeof(((safety_params_t *)0)->field) / sizeof(float))
+
+#define PARAM_FIELD_ENTRY(field, inv, min, max, def, group)                 \
+    { (uint16_t)offsetof(safety_params_t, field), (uint16_t)(inv),          \
+      (uint16_t)PARAM_FIELD_ELEMENTS(field), (uint16_t)(group),             \
+      (min), (max), (def) },
+
+#define PARAM_FIELD_BYTES(field, inv, min, max, def, group)                 \
+    + (sizeof(((safety_params_t *)0)->field) * (((inv) != PARAM_NO_INV) ? 2U : 1U))
+
+/* Calibration area between header and reserved[] */
+#define PARAM_CAL_AREA_BYTES \
+    (offsetof(safety_params_t, reserved) - offsetof(safety_params_t, hall_offset))
+
+/* Build fails if a calibration field is added without a schema row */
+typedef char params_schema_covers_cal_area[
+    ((0U SAFETY_PARAMS_SCHEMA(PARAM_FIELD_BYTES)) == PARAM_CAL_AREA_BYTES) ? 1 : -1];
+
+/* Private variables ---------------------------------------------------------*/
+static const param_field_t s_param_fields[] = {
+    SAFETY_PARAMS_SCHEMA(PARAM_FIELD_ENTRY)
+};
+
+#define PARAM_FIELD_COUNT   (sizeof(s_param_fields) / sizeof(s_param_fields[0]))
+
+/* ============================================================================
+ * Implementation
+ * ============================================================================*/
+
+param_check_t Params_Schema_CheckHeader(const safety_params_t *params)
+{
+    if (params->magic != SAFETY_PARAMS_MAGIC)
+    {
+        return PARAM_CHECK_MAGIC;
+    }
+
+    if (params->version != SAFETY_PARAMS_VERSION)
+    {
+        return PARAM_CHECK_VERSION;
+    }
+
+    if (params->size != sizeof(safety_params_t))
+    {
+        return PARAM_CHECK_SIZE;
+    }
+
+    return PARAM_CHECK_OK;
+}
+
+param_check_t Params_Schema_CheckFields(const safety_params_t *params,
+                                        uint32_t checks,
+                                        param_fail_t *fail)
+{
+    const uint8_t *base = (const uint8_t *)params;
+    uint32_t range_mask = ((checks & PARAMS_CHECK_RANGE) != 0U) ? 0U : 1U;
+    uint32_t inv_mask = ((checks & PARAMS_CHECK_REDUNDANCY) != 0U) ? 0U : 1U;
+
+    for (uint32_t f = 0; f < PARAM_FIELD_COUNT; f++)
+    {
+        const param_field_t *field = &s_param_fields[f];
+        const uint8_t *value_ptr = base + field->offset;
+        const uint8_t *inv_ptr = base + field->inv_offset;
+        uint32_t skip_inv = inv_mask | (uint32_t)(field->inv_offset == PARAM_NO_INV);
+
+        for (uint32_t i = 0; i < field->count; i++)
+        {
+            uint32_t bits;
+            uint32_t inv_bits;
+            float value;
+
+            memcpy(&bits, value_ptr + (i * sizeof(float)), sizeof(uint32_t));
+            memcpy(&inv_bits, inv_ptr + (i * sizeof(float)), sizeof(uint32_t));
+            memcpy(&value, &bits, sizeof(float));
+
+            /* NaN fails both comparisons, Inf fails one of the finite limits */
+            uint32_t range_ok = range_mask |
+                                ((uint32_t)(value >= field->min) & (uint32_t)(value <= field->max));
+            uint32_t inv_ok = skip_inv | (uint32_t)(bits == ~inv_bits);
+
+            if ((range_ok & inv_ok) == 0U)
+            {
+                if (fail != NULL)
+                {
+                    fail->field = (uint16_t)f;
+                    fail->index = (uint16_t)i;
+                    fail->group = (param_group_t)field->group;
+                }
+                return (range_ok == 0U) ? PARAM_CHECK_RANGE : PARAM_CHECK_REDUNDANCY;
+            }
+        }
+    }
+
+    return PARAM_CHECK_OK;
+}
+
+void Params_Schema_PrepareRedundancy(safety_params_t *params)
+{
+    uint8_t *base = (uint8_t *)params;
+
+    for (uint32_t f = 0; f < PARAM_FIELD_COUNT; f++)
+    {
+        const param_field_t *field = &s_param_fields[f];
+
+        if (field->inv_offset == PARAM_NO_INV)
+        {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < field->count; i++)
+        {
+            uint32_t bits;
+
+            memcpy(&bits, base + field->offset + (i * sizeof(float)), sizeof(uint32_t));
+            bits = ~bits;
+            memcpy(base + field->inv_offset + (i * sizeof(float)), &bits, sizeof(uint32_t));
+        }
+    }
+}
+
+const param_field_t* Params_Schema_GetFields(uint32_t *count)
+{
+    if (count != NULL)
+    {
+        *count = PARAM_FIELD_COUNT;
+    }
+
+    return s_param_fields;
+}
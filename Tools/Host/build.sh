@@ -0,0 +1,110 @@
+#!/bin/sh
+#==============================================================================
+# build.sh - 主机测试程序构建 / Host Harness Build
+# TKX_ThreadX 功能安全项目 / Functional Safety Project
+#==============================================================================
+# Builds the host harnesses with gcc (Linux, POSIX threads) into
+# Tools/Host/_build and runs them with --run.
+#
+# 用法 / Usage:
+#   Tools/Host/build.sh [--run] [harness...]     (default: all harnesses)
+#
+# Harnesses:
+#   reaction    Fault reaction times per error code (safety_core)
+#   w25qxx      Read latency with erase suspend (bsp_w25qxx on the model)
+#   filex       SD media rates and requests (app_filex on a host file)
+#   sdcard      SD block cache on a card model (glue and vendor driver)
+#   sdcard_nocache  The same without the block cache
+#   logger      Sensor data logger on a card model (svc_logger, app_filex)
+#   levelx      LevelX NOR backend on the W25Q128 model (not in the default
+#               list: needs LevelX from LEVELX_DIR or a clone of LEVELX_TAG)
+#==============================================================================
+
+set -e
+
+HOST_DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HOST_DIR/../.." && pwd)
+OUT="$HOST_DIR/_build"
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O2 -g -Wall -Wno-unused-function"}
+
+RUN=0
+if [ "$1" = "--run" ]; then
+    RUN=1
+    shift
+fi
+
+HARNESSES=${*:-"reaction w25qxx filex sdcard sdcard_nocache logger"}
+
+# ThreadX and HAL subsets first: they replace the target headers
+COMMON_INC="-I$HOST_DIR/inc -I$ROOT/Shared/Inc -I$ROOT/Safety/Inc -I$ROOT/Core/Inc -I$ROOT/BSP/Inc"
+COMMON_SRC="$HOST_DIR/host_tx.c $HOST_DIR/host_hal.c"
+
+# FileX as configured by FileX/App/fx_user.h, without its ThreadX timer
+FILEX_INC="-I$ROOT/FileX/App -I$ROOT/FileX/Target -I$ROOT/AZURE_RTOS/App \
+    -I$ROOT/Middlewares/ST/filex/common/inc -I$ROOT/Middlewares/ST/filex/ports/generic/inc \
+    -DFX_INCLUDE_USER_DEFINE_FILE -DFX_NO_TIMER"
+FILEX_SRC="$ROOT/Middlewares/ST/filex/common/src/*.c"
+# SD glue and vendor driver (which casts its buffer pointer to UINT)
+SD_SRC="$ROOT/FileX/Target/fx_stm32_sd_driver_glue.c $ROOT/Middlewares/ST/filex/common/drivers/fx_stm32_sd_driver.c"
+SD_INC="$FILEX_INC -Wno-pointer-to-int-cast"
+
+# LevelX is not in the tree: the release matching FileX/ThreadX 6.1.10
+LEVELX_REPO=${LEVELX_REPO:-"https://github.com/eclipse-threadx/levelx.git"}
+LEVELX_TAG=${LEVELX_TAG:-"v6.1.10_rel"}
+LEVELX_DIR=${LEVELX_DIR:-"$OUT/levelx-$LEVELX_TAG"}
+# NOR backend (Flash offsets in LevelX word pointers)
+LX_INC="$FILEX_INC -I$LEVELX_DIR/common/inc -I$ROOT/Services/Inc -Wno-pointer-to-int-cast \
+    -Wno-int-to-pointer-cast -DFX_W25Q_BENCHMARK_ENABLED=1"
+
+mkdir -p "$OUT"
+
+for h in $HARNESSES; do
+    case "$h" in
+        reaction)
+            SRC="$HOST_DIR/host_reaction.c $ROOT/Safety/Src/safety_core.c $ROOT/Safety/Src/safety_time.c"
+            INC=""
+            ;;
+        w25qxx)
+            SRC="$HOST_DIR/host_w25qxx.c $ROOT/BSP/Src/bsp_w25qxx.c $ROOT/BSP/Src/bsp_w25qxx_sim.c"
+            INC=""
+            ;;
+        filex)
+            SRC="$HOST_DIR/host_filex.c $ROOT/FileX/App/app_filex.c $FILEX_SRC"
+            INC="$FILEX_INC"
+            ;;
+        sdcard)
+            SRC="$HOST_DIR/host_sdcard.c $SD_SRC $FILEX_SRC"
+            INC="$SD_INC"
+            ;;
+        sdcard_nocache)
+            SRC="$HOST_DIR/host_sdcard.c $SD_SRC $FILEX_SRC"
+            INC="$SD_INC -DFX_STM32_SD_BLOCK_CACHE=0"
+            ;;
+        logger)
+            SRC="$HOST_DIR/host_logger.c $ROOT/Services/Src/svc_logger.c $ROOT/Safety/Src/safety_time.c \
+                $ROOT/FileX/App/app_filex.c $FILEX_SRC"
+            INC="$FILEX_INC -I$ROOT/Services/Inc"
+            ;;
+        levelx)
+            if [ ! -f "$LEVELX_DIR/common/inc/lx_api.h" ]; then
+                git clone --quiet --depth 1 --branch "$LEVELX_TAG" "$LEVELX_REPO" "$LEVELX_DIR"
+            fi
+            SRC="$HOST_DIR/host_levelx.c $ROOT/FileX/Target/lx_stm32_nor_custom_driver.c \
+                $ROOT/BSP/Src/bsp_w25qxx.c $ROOT/BSP/Src/bsp_w25qxx_sim.c $ROOT/Safety/Src/safety_time.c \
+                $LEVELX_DIR/common/src/lx_nor_flash_*.c"
+            INC="$LX_INC"
+            ;;
+        *)
+            echo "unknown harness: $h" >&2
+            exit 1
+            ;;
+    esac
+
+    echo "== $h"
+    # shellcheck disable=SC2086
+    $CC $CFLAGS $COMMON_INC $INC $COMMON_SRC $SRC -lpthread -o "$OUT/host_$h"
+    if [ "$RUN" = "1" ]; then
+        (cd "$OUT" && "./host_$h")
+    fi
+done
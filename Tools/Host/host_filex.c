@@ -0,0 +1,249 @@
+/**
+ ******************************************************************************
+ * @file    host_filex.c
+ * @brief   FileX SD Media Harness (app_filex over a file-backed device)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * MX_FileX_Init carves the SD sector cache from a FileX pool of
+ * FX_APP_MEM_POOL_SIZE, MX_FileX_SdMount opens a FAT32 image (4KB
+ * clusters, as formatted by a PC) through a driver that reads and writes
+ * a host file, and HOST_FILEX_SIZE bytes are written and read back in
+ * FX_SD_IO_SIZE units from an MX_FileX_SdAllocate buffer:
+ *   - preallocated with fx_file_allocate, as FX_SD_BENCHMARK_ENABLED does;
+ *   - appended without preallocation (FX_FAULT_TOLERANT FAT updates).
+ *
+ * It prints the rates (MB/s of the host file, bound by the page cache, not
+ * the card) and the driver requests, and checks: no driver request to an
+ * unaligned buffer, data read back intact, fewer write requests with
+ * preallocation. Exit status 0 if all checks pass.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "app_filex.h"
+#include "app_azure_rtos_config.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_FILEX_IMAGE            "host_filex.img"
+#define HOST_FILEX_SECTORS          (512U * 1024U * 2U)     /* 512MB image, sparse */
+#define HOST_FILEX_SIZE             (64U * 1024U * 1024U)
+#define HOST_FILEX_FILE             "HOST.BIN"
+
+#define HOST_PATTERN(offset)        ((UCHAR)(((offset) >> 9) ^ (offset)))
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    ULONG requests;
+    ULONG sectors;
+    ULONG unaligned;
+} host_io_t;
+
+/* Private variables ---------------------------------------------------------*/
+static int s_fd = -1;
+static host_io_t s_reads;
+static host_io_t s_writes;
+
+static UCHAR s_pool_memory[FX_APP_MEM_POOL_SIZE];
+static TX_BYTE_POOL s_pool;
+static FX_MEDIA s_format_media;
+static ULONG s_format_buffer[FX_SD_SECTOR_SIZE / sizeof(ULONG)];
+
+/* ============================================================================
+ * File-backed Driver
+ * ============================================================================*/
+
+static VOID Host_Driver(FX_MEDIA *media_ptr)
+{
+    UCHAR *buffer = media_ptr->fx_media_driver_buffer;
+    UINT request = media_ptr->fx_media_driver_request;
+    ULONG sector = 0U;
+    ULONG sectors = 1U;
+    host_io_t *io = &s_reads;
+    ssize_t done;
+
+    media_ptr->fx_media_driver_status = FX_SUCCESS;
+
+    switch (request)
+    {
+        case FX_DRIVER_READ:
+        case FX_DRIVER_WRITE:
+            sector = media_ptr->fx_media_driver_logical_sector + media_ptr->fx_media_hidden_sectors;
+            sectors = media_ptr->fx_media_driver_sectors;
+            /* fall through */
+        case FX_DRIVER_BOOT_READ:
+        case FX_DRIVER_BOOT_WRITE:
+            if ((request == FX_DRIVER_WRITE) || (request == FX_DRIVER_BOOT_WRITE))
+            {
+                io = &s_writes;
+                done = pwrite(s_fd, buffer, sectors * FX_SD_SECTOR_SIZE, (off_t)sector * FX_SD_SECTOR_SIZE);
+            }
+            else
+            {
+                done = pread(s_fd, buffer, sectors * FX_SD_SECTOR_SIZE, (off_t)sector * FX_SD_SECTOR_SIZE);
+            }
+
+            io->requests++;
+            io->sectors += sectors;
+            if (((uintptr_t)buffer & 3U) != 0U)
+            {
+                io->unaligned++;
+            }
+            if (done != (ssize_t)(sectors * FX_SD_SECTOR_SIZE))
+            {
+                media_ptr->fx_media_driver_status = FX_IO_ERROR;
+            }
+            break;
+
+        case FX_DRIVER_INIT:
+        case FX_DRIVER_UNINIT:
+        case FX_DRIVER_FLUSH:
+        case FX_DRIVER_ABORT:
+        case FX_DRIVER_RELEASE_SECTORS:
+            break;
+
+        default:
+            media_ptr->fx_media_driver_status = FX_IO_ERROR;
+            break;
+    }
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static double Host_Rate(ULONG bytes, uint64_t us)
+{
+    /* MB/s (10^6 bytes per second) */
+    return (us > 0U) ? ((double)bytes / (double)us) : 0.0;
+}
+
+static ULONG Host_Write(FX_MEDIA *media, UCHAR *buffer, bool allocate)
+{
+    FX_FILE file;
+    host_io_t before = s_writes;
+    uint64_t start;
+
+    (void)fx_file_delete(media, HOST_FILEX_FILE);
+    CHECK(fx_file_create(media, HOST_FILEX_FILE) == FX_SUCCESS);
+    CHECK(fx_file_open(media, &file, HOST_FILEX_FILE, FX_OPEN_FOR_WRITE) == FX_SUCCESS);
+
+    start = host_tx_now_us();
+    if (allocate)
+    {
+        CHECK(fx_file_allocate(&file, HOST_FILEX_SIZE) == FX_SUCCESS);
+    }
+    for (ULONG offset = 0U; offset < HOST_FILEX_SIZE; offset += FX_SD_IO_SIZE)
+    {
+        for (ULONG i = 0U; i < FX_SD_IO_SIZE; i++)
+        {
+            buffer[i] = HOST_PATTERN(offset + i);
+        }
+        CHECK(fx_file_write(&file, buffer, FX_SD_IO_SIZE) == FX_SUCCESS);
+    }
+    CHECK(fx_media_flush(media) == FX_SUCCESS);
+    CHECK(fdatasync(s_fd) == 0);
+    uint64_t elapsed = host_tx_now_us() - start;
+
+    CHECK(fx_file_close(&file) == FX_SUCCESS);
+
+    printf("write %-12s %7.1f MB/s  %6u requests  %7u sectors  unaligned %u\n",
+           allocate ? "preallocated" : "appended", Host_Rate(HOST_FILEX_SIZE, elapsed),
+           s_writes.requests - before.requests, s_writes.sectors - before.sectors,
+           s_writes.unaligned - before.unaligned);
+
+    return s_writes.requests - before.requests;
+}
+
+static void Host_Read(FX_MEDIA *media, UCHAR *buffer)
+{
+    FX_FILE file;
+    host_io_t before = s_reads;
+    ULONG actual;
+    ULONG bad = 0U;
+    uint64_t start;
+
+    CHECK(fx_file_open(media, &file, HOST_FILEX_FILE, FX_OPEN_FOR_READ) == FX_SUCCESS);
+
+    start = host_tx_now_us();
+    for (ULONG offset = 0U; offset < HOST_FILEX_SIZE; offset += FX_SD_IO_SIZE)
+    {
+        CHECK(fx_file_read(&file, buffer, FX_SD_IO_SIZE, &actual) == FX_SUCCESS);
+        CHECK(actual == FX_SD_IO_SIZE);
+        for (ULONG i = 0U; i < FX_SD_IO_SIZE; i++)
+        {
+            bad += (buffer[i] != HOST_PATTERN(offset + i)) ? 1U : 0U;
+        }
+    }
+    uint64_t elapsed = host_tx_now_us() - start;
+
+    CHECK(fx_file_close(&file) == FX_SUCCESS);
+
+    printf("read  %-12s %7.1f MB/s  %6u requests  %7u sectors  unaligned %u\n",
+           "", Host_Rate(HOST_FILEX_SIZE, elapsed), s_reads.requests - before.requests,
+           s_reads.sectors - before.sectors, s_reads.unaligned - before.unaligned);
+    CHECK(bad == 0U);
+}
+
+int main(void)
+{
+    FX_MEDIA *media;
+    UCHAR *buffer;
+    ULONG preallocated;
+    ULONG appended;
+
+    host_tx_init(0U);
+
+    s_fd = open(HOST_FILEX_IMAGE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(s_fd >= 0);
+    CHECK(ftruncate(s_fd, (off_t)HOST_FILEX_SECTORS * FX_SD_SECTOR_SIZE) == 0);
+
+    CHECK(tx_byte_pool_create(&s_pool, "Fx App memory pool", s_pool_memory, sizeof(s_pool_memory)) == TX_SUCCESS);
+    CHECK(MX_FileX_Init(&s_pool) == FX_SUCCESS);
+
+    /* FAT32, 4KB clusters */
+    CHECK(fx_media_format(&s_format_media, Host_Driver, FX_NULL, (UCHAR *)s_format_buffer,
+                          sizeof(s_format_buffer), "SD", 2, 0, 0, HOST_FILEX_SECTORS,
+                          FX_SD_SECTOR_SIZE, 8, 1, 1) == FX_SUCCESS);
+
+    CHECK(MX_FileX_SdMount(Host_Driver) == FX_SUCCESS);
+    media = MX_FileX_SdMedia();
+    buffer = (UCHAR *)MX_FileX_SdAllocate(FX_SD_IO_SIZE);
+    CHECK(buffer != FX_NULL);
+
+    printf("%u MB in %u-byte units, cache %u sectors (hashed %u), pool %u bytes\n",
+           HOST_FILEX_SIZE / (1024U * 1024U), FX_SD_IO_SIZE, media->fx_media_sector_cache_size,
+           media->fx_media_sector_cache_hashed, FX_APP_MEM_POOL_SIZE);
+
+    preallocated = Host_Write(media, buffer, true);
+    Host_Read(media, buffer);
+
+    appended = Host_Write(media, buffer, false);
+    Host_Read(media, buffer);
+
+    CHECK(fx_file_delete(media, HOST_FILEX_FILE) == FX_SUCCESS);
+    CHECK(fx_media_close(media) == FX_SUCCESS);
+    (void)close(s_fd);
+    (void)unlink(HOST_FILEX_IMAGE);
+
+    CHECK((s_reads.unaligned == 0U) && (s_writes.unaligned == 0U));
+    CHECK(preallocated < appended);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ ******************************************************************************
+ * @file    host_hal.c
+ * @brief   STM32F4 HAL and CMSIS Subset for Host Builds
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f4xx_hal.h"
+#include "SEGGER_RTT.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Private variables ---------------------------------------------------------*/
+static DWT_Type s_dwt;
+
+uint32_t SystemCoreClock = 168000000U;
+CoreDebug_Type host_core_debug;
+SCB_Type host_scb;
+GPIO_TypeDef host_gpio[5];
+
+/* ============================================================================
+ * Core
+ * ============================================================================*/
+
+DWT_Type *host_dwt(void)
+{
+    if ((s_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0U)
+    {
+        s_dwt.CYCCNT = (uint32_t)((host_tx_now_ns() * (SystemCoreClock / 1000000U)) / 1000U);
+    }
+    return &s_dwt;
+}
+
+void NVIC_SystemReset(void)
+{
+    fprintf(stderr, "NVIC_SystemReset\n");
+    exit(3);
+}
+
+/* ============================================================================
+ * GPIO, RCC and Tick
+ * ============================================================================*/
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    GPIOx->BSRR = (PinState == GPIO_PIN_SET) ? GPIO_Pin : ((uint32_t)GPIO_Pin << 16U);
+    GPIOx->ODR = (PinState == GPIO_PIN_SET) ? (GPIOx->ODR | GPIO_Pin) : (GPIOx->ODR & ~(uint32_t)GPIO_Pin);
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void)
+{
+    return SystemCoreClock;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return tx_time_get();
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    host_tx_busy((uint64_t)Delay * 1000U);
+}
+
+/* ============================================================================
+ * RTT (formatted as on target, printed with HOST_RTT=1)
+ * ============================================================================*/
+
+int SEGGER_RTT_printf(unsigned BufferIndex, const char *sFormat, ...)
+{
+    static char buffer[256];
+    static int print = -1;
+    va_list args;
+
+    (void)BufferIndex;
+    if (print < 0)
+    {
+        const char *env = getenv("HOST_RTT");
+        print = ((env != NULL) && (env[0] == '1')) ? 1 : 0;
+    }
+
+    va_start(args, sFormat);
+    int n = vsnprintf(buffer, sizeof(buffer), sFormat, args);
+    va_end(args);
+
+    if (print != 0)
+    {
+        fputs(buffer, stdout);
+    }
+    return n;
+}
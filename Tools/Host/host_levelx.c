@@ -0,0 +1,285 @@
+/**
+ ******************************************************************************
+ * @file    host_levelx.c
+ * @brief   LevelX NOR Backend Harness (lx_stm32_nor_custom_driver on bsp_w25qxx_sim)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Runs LevelX over lx_stm32_nor_custom_driver, the W25QXX driver and the
+ * device model in virtual time, as in host_w25qxx: bus time is spent on
+ * the calling thread and the driver sleeps through busy programs and
+ * erases. The whole LevelX area of the W25Q128 is modelled.
+ *
+ * The erased device is checked blank and opened (LevelX formats it).
+ * HOST_LX_SECTORS logical sectors are then written in order and at random,
+ * HOST_LX_WRITES sector writes each: more than the free physical sectors,
+ * so both runs include block reclaim. The device is closed and opened
+ * again (mount). It prints the open times and the write rates (kB/s of
+ * virtual time) with the erases and page programs of each run, and checks:
+ * every sector reads back its last contents before and after the mount,
+ * no LevelX system error, no driver error and no program that would set
+ * a bit. Then lx_stm32_nor_custom_driver_benchmark runs on the RAM NOR
+ * (FX_W25Q_BENCHMARK_ENABLED), which must succeed and reclaim blocks.
+ * Exit status 0 if all checks pass.
+ *
+ * LevelX is not part of the tree: build.sh takes it from LEVELX_DIR or
+ * clones the release matching the FileX/ThreadX middleware (6.1.10).
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "lx_api.h"
+#include "lx_stm32_nor_custom_driver.h"
+#include "bsp_w25qxx.h"
+#include "bsp_w25qxx_sim.h"
+#include "safety_time.h"
+#include "tx_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_SCK_HZ                 42000000U
+#define HOST_LX_SECTORS             1024U       /* Logical sectors in use (512KB) */
+#define HOST_LX_SECTOR_BYTES        (LX_NOR_SECTOR_SIZE * sizeof(ULONG))
+
+/* One pass over every free physical sector, plus the sectors in use */
+#define HOST_LX_WRITES              ((LX_NOR_W25Q_BLOCKS * LX_NOR_W25Q_SECTORS_PER_BLOCK) + HOST_LX_SECTORS)
+
+#define HOST_LX_WORD(sector, tag, i) ((ULONG)((((ULONG)(tag) << 16) | (ULONG)(sector)) ^ ((ULONG)(i) * 0x9E3779B1U)))
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t us;
+    uint32_t erases;
+    uint32_t programs;
+} host_lx_run_t;
+
+/* Private variables ---------------------------------------------------------*/
+static w25qxx_sim_t s_sim;
+static w25qxx_transport_t s_transport;
+static uint8_t s_memory[W25Q128_FLASH_SIZE];
+static uint64_t s_carry_ns;
+
+static LX_NOR_FLASH s_nor;
+static ULONG s_sector[LX_NOR_SECTOR_SIZE];
+static uint32_t s_tag[HOST_LX_SECTORS];     /* Last write of each sector, 0 = none */
+
+/* ============================================================================
+ * Transport (model clock on the scheduler clock)
+ * ============================================================================*/
+
+static uint64_t Host_BusBegin(void)
+{
+    uint64_t start = host_tx_now_ns();
+
+    s_sim.time_ns = start + s_carry_ns;
+    return start;
+}
+
+static void Host_BusEnd(uint64_t start)
+{
+    uint64_t spent = s_sim.time_ns - start;
+
+    s_carry_ns = spent % 1000U;
+    host_tx_busy(spent / 1000U);
+}
+
+static void Host_Select(void *context, bool selected)
+{
+    uint64_t start = Host_BusBegin();
+
+    s_sim.transport.select(context, selected);
+    Host_BusEnd(start);
+}
+
+static w25qxx_status_t Host_Transmit(void *context, const uint8_t *pData, uint32_t size)
+{
+    uint64_t start = Host_BusBegin();
+    w25qxx_status_t status = s_sim.transport.transmit(context, pData, size);
+
+    Host_BusEnd(start);
+    return status;
+}
+
+static w25qxx_status_t Host_Receive(void *context, uint8_t *pData, uint32_t size)
+{
+    uint64_t start = Host_BusBegin();
+    w25qxx_status_t status = s_sim.transport.receive(context, pData, size);
+
+    Host_BusEnd(start);
+    return status;
+}
+
+static w25qxx_status_t Host_ReceiveWait(void *context)
+{
+    (void)context;
+    return W25QXX_OK;
+}
+
+static void Host_Delay(void *context, uint32_t ms)
+{
+    (void)context;
+    (void)tx_thread_sleep(ms);
+}
+
+static uint32_t Host_GetTick(void *context)
+{
+    (void)context;
+    return (uint32_t)tx_time_get();
+}
+
+static bool Host_InThread(void *context)
+{
+    (void)context;
+    return true;
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static void Host_Write(ULONG sector, uint32_t tag)
+{
+    for (ULONG i = 0U; i < LX_NOR_SECTOR_SIZE; i++)
+    {
+        s_sector[i] = HOST_LX_WORD(sector, tag, i);
+    }
+
+    CHECK(lx_nor_flash_sector_write(&s_nor, sector, s_sector) == LX_SUCCESS);
+    s_tag[sector] = tag;
+}
+
+static void Host_Verify(void)
+{
+    for (ULONG sector = 0U; sector < HOST_LX_SECTORS; sector++)
+    {
+        CHECK(lx_nor_flash_sector_read(&s_nor, sector, s_sector) == LX_SUCCESS);
+
+        for (ULONG i = 0U; i < LX_NOR_SECTOR_SIZE; i++)
+        {
+            CHECK(s_sector[i] == HOST_LX_WORD(sector, s_tag[sector], i));
+        }
+    }
+}
+
+static uint64_t Host_Open(void)
+{
+    uint64_t start = host_tx_now_us();
+
+    CHECK(lx_nor_flash_open(&s_nor, "W25Q", lx_stm32_nor_custom_driver_initialize) == LX_SUCCESS);
+    return host_tx_now_us() - start;
+}
+
+static void Host_Run(const char *name, bool random, uint32_t *tag, host_lx_run_t *run)
+{
+    uint32_t seed = 12345U;
+    uint32_t erases = s_sim.stats.sector_erases;
+    uint32_t programs = s_sim.stats.page_programs;
+    uint64_t start = host_tx_now_us();
+
+    for (ULONG i = 0U; i < HOST_LX_WRITES; i++)
+    {
+        ULONG sector = i % HOST_LX_SECTORS;
+
+        if (random)
+        {
+            seed = (seed * 1103515245U) + 12345U;
+            sector = (seed >> 8) % HOST_LX_SECTORS;
+        }
+
+        (*tag)++;
+        Host_Write(sector, *tag);
+    }
+
+    run->us = host_tx_now_us() - start;
+    run->erases = s_sim.stats.sector_erases - erases;
+    run->programs = s_sim.stats.page_programs - programs;
+
+    printf("%-10s %6u x %u B  %5u kB/s  %5u erases  %6u page programs\n", name,
+           (unsigned)HOST_LX_WRITES, (unsigned)HOST_LX_SECTOR_BYTES,
+           (unsigned)(((uint64_t)HOST_LX_WRITES * HOST_LX_SECTOR_BYTES * 1000000U) / 1024U / run->us),
+           run->erases, run->programs);
+}
+
+int main(void)
+{
+    host_lx_run_t sequential;
+    host_lx_run_t random;
+    lx_nor_w25q_benchmark_t bench;
+    uint64_t format_us;
+    uint64_t mount_us;
+    uint32_t tag = 0U;
+    UINT errors;
+    UINT last_error;
+
+    host_tx_init(0U);
+    host_tx_use_virtual_time();
+    Safety_Time_Init();
+
+    memset(s_memory, 0xFF, sizeof(s_memory));
+    BSP_W25QXX_Sim_Init(&s_sim, s_memory, sizeof(s_memory), HOST_SCK_HZ);
+    s_sim.time_ns = host_tx_now_ns();
+    s_transport = s_sim.transport;
+    s_transport.select = Host_Select;
+    s_transport.transmit = Host_Transmit;
+    s_transport.receive = Host_Receive;
+    s_transport.receive_start = Host_Receive;
+    s_transport.receive_wait = Host_ReceiveWait;
+    s_transport.delay = Host_Delay;
+    s_transport.get_tick = Host_GetTick;
+    s_transport.in_thread = Host_InThread;
+    CHECK(BSP_W25QXX_InitTransport(&s_transport) == W25QXX_OK);
+
+    printf("LevelX on the W25Q128 model at %u Hz: %u blocks of %u B, %u sectors in use\n",
+           HOST_SCK_HZ, (unsigned)LX_NOR_W25Q_BLOCKS, (unsigned)LX_NOR_W25Q_BLOCK_SIZE,
+           HOST_LX_SECTORS);
+
+    CHECK(lx_nor_flash_initialize() == LX_SUCCESS);
+    CHECK(lx_stm32_nor_custom_driver_check_blank() == LX_SUCCESS);
+
+    /* Erased device: the first open formats it */
+    format_us = Host_Open();
+    CHECK(lx_stm32_nor_custom_driver_check_blank() == LX_ERROR);
+    printf("format     %8u ms\n", (unsigned)(format_us / 1000U));
+
+    Host_Run("sequential", false, &tag, &sequential);
+    Host_Run("random", true, &tag, &random);
+    Host_Verify();
+
+    /* Device holding data: mount scans every block */
+    CHECK(lx_nor_flash_close(&s_nor) == LX_SUCCESS);
+    mount_us = Host_Open();
+    printf("mount      %8u ms\n", (unsigned)(mount_us / 1000U));
+    Host_Verify();
+    CHECK(lx_nor_flash_close(&s_nor) == LX_SUCCESS);
+
+    errors = lx_stm32_nor_custom_driver_get_errors(&last_error);
+    printf("system errors %u (last %u), overwrites %u, rejected %u\n", errors, last_error,
+           s_sim.stats.overwrites, s_sim.stats.rejected);
+
+    CHECK(errors == 0U);
+    CHECK(s_sim.stats.overwrites == 0U);
+    CHECK((sequential.erases > 0U) && (random.erases > 0U));
+
+    /* Same driver file, RAM NOR: counts only, no device time */
+    CHECK(lx_stm32_nor_custom_driver_benchmark(&bench) == LX_SUCCESS);
+    printf("RAM NOR    %u writes: %u/%u erases (sequential/random), %u words\n",
+           LX_NOR_W25Q_BENCH_WRITES, bench.seq_erases, bench.rand_erases, bench.words_written);
+    CHECK((bench.seq_erases > 0U) && (bench.rand_erases > 0U));
+    CHECK(lx_stm32_nor_custom_driver_get_errors(NULL) == 0U);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,313 @@
+/**
+ ******************************************************************************
+ * @file    host_logger.c
+ * @brief   Sensor Data Logger Harness (svc_logger on a file-backed card)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Runs svc_logger and app_filex in virtual time over a FAT32 image in a
+ * host file. Each driver request costs the writer the card time of the
+ * host_sdcard model, without overlap: HOST_SD_CMD_US plus
+ * HOST_SD_BLOCK_US per sector, and for a write HOST_SD_PROG_US plus
+ * HOST_SD_PROG_BLOCK_US per sector of programming. Records cost no time.
+ *
+ * Svc_Logger_Benchmark logs SVC_LOGGER_BENCH_SIZE bytes at the producer's
+ * full speed and its result is printed. Then HOST_LOGGER_RECORDS records
+ * are pushed at HOST_LOGGER_RECORDS_PER_TICK per tick, logging is stopped
+ * and the file read back. It checks: nothing dropped, every record intact
+ * in sequence, no FAT write and only directory writes at the checkpoints
+ * while logging, all chunks written from word aligned buffers, and the
+ * unused preallocation released at stop. Exit status 0 if all checks
+ * pass.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "svc_logger.h"
+#include "app_filex.h"
+#include "app_azure_rtos_config.h"
+#include "safety_stack.h"
+#include "safety_time.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_LOGGER_IMAGE               "host_logger.img"
+#define HOST_LOGGER_SECTORS             (512U * 1024U * 2U)     /* 512MB image, sparse */
+#define HOST_LOGGER_FILE                "LOG.BIN"
+#define HOST_LOGGER_RECORDS             100000U
+#define HOST_LOGGER_RECORDS_PER_TICK    32U                     /* 1MB/s */
+#define HOST_LOGGER_PRIORITY            10U                     /* Producer, above the writer */
+
+/* Card time per request (host_sdcard model) */
+#define HOST_SD_CMD_US                  150U
+#define HOST_SD_BLOCK_US                43U
+#define HOST_SD_PROG_US                 1200U
+#define HOST_SD_PROG_BLOCK_US           15U
+
+#define HOST_CHUNK_SECTORS              (SVC_LOGGER_CHUNK_SIZE / FX_SD_SECTOR_SIZE)
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    ULONG requests;
+    ULONG chunks;                   /* Whole chunks (HOST_CHUNK_SECTORS) */
+    ULONG fat;                      /* Requests to the FAT area */
+    ULONG unaligned;
+} host_io_t;
+
+/* Private variables ---------------------------------------------------------*/
+static int s_fd = -1;
+static host_io_t s_writes;
+static ULONG s_reads;
+
+static UCHAR s_fx_pool_memory[FX_APP_MEM_POOL_SIZE];
+static UCHAR s_tx_pool_memory[TX_APP_MEM_POOL_SIZE];
+static TX_BYTE_POOL s_fx_pool;
+static TX_BYTE_POOL s_tx_pool;
+static FX_MEDIA s_format_media;
+static ULONG s_format_buffer[FX_SD_SECTOR_SIZE / sizeof(ULONG)];
+static svc_logger_sample_t s_readback[SVC_LOGGER_CHUNK_SIZE / sizeof(svc_logger_sample_t)];
+
+/* ============================================================================
+ * Stack Monitoring (not exercised here)
+ * ============================================================================*/
+
+safety_status_t Safety_Stack_RegisterThread(TX_THREAD *thread)
+{
+    (void)thread;
+    return SAFETY_OK;
+}
+
+/* ============================================================================
+ * File-backed Driver
+ * ============================================================================*/
+
+static VOID Host_Driver(FX_MEDIA *media_ptr)
+{
+    UCHAR *buffer = media_ptr->fx_media_driver_buffer;
+    UINT request = media_ptr->fx_media_driver_request;
+    ULONG logical = 0U;
+    ULONG sector = 0U;
+    ULONG sectors = 1U;
+    ssize_t done;
+
+    media_ptr->fx_media_driver_status = FX_SUCCESS;
+
+    switch (request)
+    {
+        case FX_DRIVER_READ:
+        case FX_DRIVER_WRITE:
+            logical = media_ptr->fx_media_driver_logical_sector;
+            sector = logical + media_ptr->fx_media_hidden_sectors;
+            sectors = media_ptr->fx_media_driver_sectors;
+            /* fall through */
+        case FX_DRIVER_BOOT_READ:
+        case FX_DRIVER_BOOT_WRITE:
+            if ((request == FX_DRIVER_WRITE) || (request == FX_DRIVER_BOOT_WRITE))
+            {
+                host_tx_busy(HOST_SD_CMD_US + HOST_SD_PROG_US +
+                             ((uint64_t)sectors * (HOST_SD_BLOCK_US + HOST_SD_PROG_BLOCK_US)));
+                done = pwrite(s_fd, buffer, sectors * FX_SD_SECTOR_SIZE, (off_t)sector * FX_SD_SECTOR_SIZE);
+
+                s_writes.requests++;
+                s_writes.chunks += (sectors == HOST_CHUNK_SECTORS) ? 1U : 0U;
+                if ((request == FX_DRIVER_WRITE) && (logical >= media_ptr->fx_media_reserved_sectors) &&
+                    (logical < (media_ptr->fx_media_reserved_sectors +
+                                (media_ptr->fx_media_number_of_FATs * media_ptr->fx_media_sectors_per_FAT))))
+                {
+                    s_writes.fat++;
+                }
+                s_writes.unaligned += (((uintptr_t)buffer & 3U) != 0U) ? 1U : 0U;
+            }
+            else
+            {
+                host_tx_busy(HOST_SD_CMD_US + ((uint64_t)sectors * HOST_SD_BLOCK_US));
+                done = pread(s_fd, buffer, sectors * FX_SD_SECTOR_SIZE, (off_t)sector * FX_SD_SECTOR_SIZE);
+                s_reads++;
+            }
+
+            if (done != (ssize_t)(sectors * FX_SD_SECTOR_SIZE))
+            {
+                media_ptr->fx_media_driver_status = FX_IO_ERROR;
+            }
+            break;
+
+        case FX_DRIVER_INIT:
+        case FX_DRIVER_UNINIT:
+        case FX_DRIVER_FLUSH:
+        case FX_DRIVER_ABORT:
+        case FX_DRIVER_RELEASE_SECTORS:
+            break;
+
+        default:
+            media_ptr->fx_media_driver_status = FX_IO_ERROR;
+            break;
+    }
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static void Host_Benchmark(FX_MEDIA *media)
+{
+    svc_logger_benchmark_t result;
+    host_io_t before = s_writes;
+
+    CHECK(Svc_Logger_Benchmark(media, &result) == STATUS_OK);
+
+    printf("benchmark %u MB: %u kB/s, %u ms, stop %u ms, %u write requests "
+           "(%u chunks), stall max %u us, write max %u us, checkpoint max %u us\n",
+           (unsigned)(SVC_LOGGER_BENCH_SIZE / (1024U * 1024U)), result.rate_kbs, result.elapsed_ms,
+           result.stop_ms, result.write_requests, s_writes.chunks - before.chunks,
+           result.stall_max_us, result.write_max_us, result.checkpoint_max_us);
+}
+
+static void Host_Log(FX_MEDIA *media)
+{
+    svc_logger_sample_t sample = { 0 };
+    svc_logger_stats_t stats;
+    host_io_t before;
+    ULONG free_before;
+    ULONG free_after;
+    uint64_t start;
+
+    CHECK(fx_media_space_available(media, &free_before) == FX_SUCCESS);
+    CHECK(Svc_Logger_Start(media, HOST_LOGGER_FILE) == STATUS_OK);
+
+    /* Requests of the logging itself, not of the allocation */
+    before = s_writes;
+    for (uint32_t n = 0U; n < HOST_LOGGER_RECORDS; n++)
+    {
+        sample.time_us = n;
+        for (uint32_t i = 0U; i < SVC_LOGGER_ADC_CHANNELS; i++)
+        {
+            sample.adc[i] = (uint16_t)(n + i);
+        }
+        sample.hall[0] = (int16_t)n;
+        CHECK(Svc_Logger_Push(&sample) == STATUS_OK);
+
+        if ((n % HOST_LOGGER_RECORDS_PER_TICK) == (HOST_LOGGER_RECORDS_PER_TICK - 1U))
+        {
+            tx_thread_sleep(1U);
+        }
+    }
+
+    Svc_Logger_GetStats(&stats);
+    ULONG checkpoints = stats.checkpoints;
+    ULONG chunks = s_writes.chunks - before.chunks;
+    ULONG other = (s_writes.requests - before.requests) - chunks;
+    ULONG fat = s_writes.fat - before.fat;
+
+    before = s_writes;
+    start = host_tx_now_us();
+    CHECK(Svc_Logger_Stop() == STATUS_OK);
+    uint64_t stop_us = host_tx_now_us() - start;
+
+    Svc_Logger_GetStats(&stats);
+    CHECK(fx_media_space_available(media, &free_after) == FX_SUCCESS);
+
+    printf("logged %u records: %u chunks, %u checkpoints, %u other writes (%u FAT), "
+           "ring max %u, dropped %u, write max %u us\n",
+           stats.pushed, chunks, checkpoints, other, fat, stats.ring_max, stats.dropped,
+           stats.write_max_us);
+    printf("stop: %u ms, %u write requests (%u FAT), %u MB released\n",
+           (unsigned)(stop_us / 1000U), s_writes.requests - before.requests, s_writes.fat - before.fat,
+           (unsigned)((SVC_LOGGER_FILE_SIZE - (free_before - free_after)) / (1024U * 1024U)));
+
+    CHECK(stats.pushed == HOST_LOGGER_RECORDS);
+    CHECK(stats.dropped == 0U);
+    CHECK(stats.bytes == ((uint64_t)HOST_LOGGER_RECORDS * sizeof(svc_logger_sample_t)));
+
+    /* While logging: whole chunks, and the directory entry at each checkpoint */
+    CHECK(chunks == (ULONG)(stats.bytes / SVC_LOGGER_CHUNK_SIZE));
+    CHECK(fat == 0U);
+    CHECK(other <= checkpoints);
+    CHECK(s_writes.unaligned == 0U);
+
+    /* The unused preallocation was released */
+    CHECK((free_before - free_after) <= (stats.bytes + media->fx_media_bytes_per_sector *
+                                         media->fx_media_sectors_per_cluster));
+}
+
+static void Host_ReadBack(FX_MEDIA *media)
+{
+    FX_FILE file;
+    ULONG actual;
+    ULONG bad = 0U;
+    uint32_t n = 0U;
+
+    CHECK(fx_file_open(media, &file, HOST_LOGGER_FILE, FX_OPEN_FOR_READ) == FX_SUCCESS);
+    CHECK(file.fx_file_current_file_size == ((ULONG64)HOST_LOGGER_RECORDS * sizeof(svc_logger_sample_t)));
+
+    while ((fx_file_read(&file, s_readback, sizeof(s_readback), &actual) == FX_SUCCESS) && (actual > 0U))
+    {
+        for (ULONG r = 0U; r < (actual / sizeof(svc_logger_sample_t)); r++, n++)
+        {
+            const svc_logger_sample_t *sample = &s_readback[r];
+
+            bad += ((sample->sequence != n) || (sample->time_us != n) ||
+                    (sample->adc[SVC_LOGGER_ADC_CHANNELS - 1U] != (uint16_t)(n + SVC_LOGGER_ADC_CHANNELS - 1U)) ||
+                    (sample->hall[0] != (int16_t)n)) ? 1U : 0U;
+        }
+    }
+    CHECK(fx_file_close(&file) == FX_SUCCESS);
+
+    printf("read back %u records, bad %u\n", n, bad);
+    CHECK(n == HOST_LOGGER_RECORDS);
+    CHECK(bad == 0U);
+}
+
+int main(void)
+{
+    FX_MEDIA *media;
+
+    host_tx_init(HOST_LOGGER_PRIORITY);
+    host_tx_use_virtual_time();
+    Safety_Time_Init();
+
+    s_fd = open(HOST_LOGGER_IMAGE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(s_fd >= 0);
+    CHECK(ftruncate(s_fd, (off_t)HOST_LOGGER_SECTORS * FX_SD_SECTOR_SIZE) == 0);
+
+    CHECK(tx_byte_pool_create(&s_fx_pool, "Fx App memory pool", s_fx_pool_memory, sizeof(s_fx_pool_memory)) == TX_SUCCESS);
+    CHECK(tx_byte_pool_create(&s_tx_pool, "Tx App memory pool", s_tx_pool_memory, sizeof(s_tx_pool_memory)) == TX_SUCCESS);
+    CHECK(MX_FileX_Init(&s_fx_pool) == FX_SUCCESS);
+
+    /* FAT32, 4KB clusters */
+    CHECK(fx_media_format(&s_format_media, Host_Driver, FX_NULL, (UCHAR *)s_format_buffer,
+                          sizeof(s_format_buffer), "SD", 2, 0, 0, HOST_LOGGER_SECTORS,
+                          FX_SD_SECTOR_SIZE, 8, 1, 1) == FX_SUCCESS);
+
+    CHECK(MX_FileX_SdMount(Host_Driver) == FX_SUCCESS);
+    media = MX_FileX_SdMedia();
+    CHECK(Svc_Logger_Init(&s_tx_pool) == TX_SUCCESS);
+
+    printf("card: command %u us + %u us/sector, programming %u us + %u us/sector, no overlap\n",
+           HOST_SD_CMD_US, HOST_SD_BLOCK_US, HOST_SD_PROG_US, HOST_SD_PROG_BLOCK_US);
+
+    Host_Benchmark(media);
+    Host_Log(media);
+    Host_ReadBack(media);
+
+    CHECK(fx_file_delete(media, HOST_LOGGER_FILE) == FX_SUCCESS);
+    CHECK(fx_media_close(media) == FX_SUCCESS);
+    (void)close(s_fd);
+    (void)unlink(HOST_LOGGER_IMAGE);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ ******************************************************************************
+ * @file    host_reaction.c
+ * @brief   Fault Reaction Time Harness (safety_core on the host)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Injects every safety_error_t through Safety_ReportError, from NORMAL and
+ * (for the errors that degrade) again from DEGRADED, and every fault
+ * handler through Safety_EnterSafeState. Each injection starts from a
+ * fresh Safety_EarlyInit, is repeated HOST_REACTION_RUNS times and checks:
+ *   - the resulting state and, for SAFE, the BSRR values of
+ *     SAFE_OUTPUT_TABLE on every port;
+ *   - the reaction is measured once (count), with safe outputs applied
+ *     no later than the state transition;
+ *   - no reaction above REACTION_BUDGET_US (over_budget, maximum).
+ *
+ * DWT cycles are host time at SystemCoreClock, so the figures bound the
+ * code path, not the target timing. Exit status 0 if all checks pass.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "safety_core.h"
+#include "safety_crash.h"
+#include "main.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_REACTION_RUNS          1000U
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Expected BSRR bits per port, from the safe output table */
+#define HOST_EXPECT_SET(pin)        ((uint32_t)(pin))
+#define HOST_EXPECT_RESET(pin)      ((uint32_t)(pin) << 16U)
+#define HOST_EXPECT(name, port, level, arg)                                 \
+    s_expected[(GPIO##port) - GPIOA] |= HOST_EXPECT_##level(name##_Pin);
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    INJECT_REPORT = 0,              /* Safety_ReportError from NORMAL */
+    INJECT_REPORT_DEGRADED,         /* Safety_ReportError from DEGRADED */
+    INJECT_HANDLER                  /* Fault handler (Safety_EnterSafeState) */
+} inject_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t transition_max;
+    uint32_t outputs_max;
+    uint32_t total_max;
+    uint32_t over_budget;
+} host_result_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t s_expected[5];
+
+static const safety_error_t s_errors[] = {
+    SAFETY_ERR_NONE, SAFETY_ERR_CPU_TEST, SAFETY_ERR_RAM_TEST, SAFETY_ERR_FLASH_CRC,
+    SAFETY_ERR_CLOCK, SAFETY_ERR_WATCHDOG, SAFETY_ERR_STACK_OVERFLOW,
+    SAFETY_ERR_FLOW_MONITOR, SAFETY_ERR_PARAM_INVALID, SAFETY_ERR_RUNTIME_TEST,
+    SAFETY_ERR_MPU_FAULT, SAFETY_ERR_HARDFAULT, SAFETY_ERR_BUSFAULT,
+    SAFETY_ERR_USAGEFAULT, SAFETY_ERR_NMI, SAFETY_ERR_INTERNAL
+};
+
+static const char *const s_states[] = {
+    "INIT", "STARTUP_TEST", "NORMAL", "DEGRADED", "SAFE"
+};
+
+/* ============================================================================
+ * Crash Capture (not exercised here)
+ * ============================================================================*/
+
+bool Safety_Crash_Init(void)
+{
+    return false;
+}
+
+void Safety_Crash_Capture(const uint32_t *frame, uint32_t exc_return, uint32_t error)
+{
+    (void)frame;
+    (void)exc_return;
+    (void)error;
+}
+
+const safety_crash_record_t* Safety_Crash_GetLast(void)
+{
+    return NULL;
+}
+
+void Safety_Crash_Report(void)
+{
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static void Host_StartNormal(void)
+{
+    CHECK(Safety_EarlyInit() == SAFETY_OK);
+    CHECK(Safety_PostClockInit() == SAFETY_OK);
+    CHECK(Safety_PeripheralInit() == SAFETY_OK);
+    CHECK(Safety_StartupTest() == SAFETY_OK);
+    CHECK(Safety_PreKernelInit() == SAFETY_OK);
+    CHECK(Safety_GetState() == SAFETY_STATE_NORMAL);
+
+    for (uint32_t i = 0; i < 5U; i++)
+    {
+        host_gpio[i].BSRR = 0U;
+    }
+}
+
+static safety_state_t Host_Expected(safety_error_t error, inject_t inject)
+{
+    if (inject == INJECT_HANDLER)
+    {
+        return SAFETY_STATE_SAFE;
+    }
+
+    switch (error)
+    {
+        case SAFETY_ERR_CPU_TEST:
+        case SAFETY_ERR_RAM_TEST:
+        case SAFETY_ERR_HARDFAULT:
+        case SAFETY_ERR_BUSFAULT:
+        case SAFETY_ERR_USAGEFAULT:
+        case SAFETY_ERR_NMI:
+            return SAFETY_STATE_SAFE;
+
+        case SAFETY_ERR_FLASH_CRC:
+        case SAFETY_ERR_CLOCK:
+        case SAFETY_ERR_FLOW_MONITOR:
+        case SAFETY_ERR_MPU_FAULT:
+            return (inject == INJECT_REPORT) ? SAFETY_STATE_DEGRADED : SAFETY_STATE_SAFE;
+
+        default:
+            return SAFETY_STATE_NORMAL;
+    }
+}
+
+static void Host_Handler(safety_error_t error)
+{
+    switch (error)
+    {
+        case SAFETY_ERR_MPU_FAULT:      Safety_MemManageHandler();      break;
+        case SAFETY_ERR_HARDFAULT:      Safety_HardFaultHandler();      break;
+        case SAFETY_ERR_BUSFAULT:       Safety_BusFaultHandler();       break;
+        case SAFETY_ERR_USAGEFAULT:     Safety_UsageFaultHandler();     break;
+        case SAFETY_ERR_NMI:            Safety_NMIHandler();            break;
+        default:                        Safety_EnterSafeState(error);   break;
+    }
+}
+
+static void Host_Inject(safety_error_t error, inject_t inject, host_result_t *result)
+{
+    safety_state_t expected = Host_Expected(error, inject);
+
+    Host_StartNormal();
+    if (inject == INJECT_REPORT_DEGRADED)
+    {
+        Safety_ReportError(error, 0U, 0U);
+        CHECK(Safety_GetState() == SAFETY_STATE_DEGRADED);
+    }
+
+    if (inject == INJECT_HANDLER)
+    {
+        Host_Handler(error);
+    }
+    else
+    {
+        Safety_ReportError(error, 0U, 0U);
+    }
+
+    const safety_reaction_stats_t *rs = Safety_GetReactionStats(error);
+    uint32_t measured = (inject == INJECT_REPORT_DEGRADED) ? 2U : 1U;
+
+    CHECK(Safety_GetState() == expected);
+    CHECK(rs->count == measured);
+
+    if (expected == SAFETY_STATE_SAFE)
+    {
+        for (uint32_t i = 0; i < 5U; i++)
+        {
+            CHECK(host_gpio[i].BSRR == s_expected[i]);
+        }
+        CHECK(rs->outputs_max != 0U);
+        CHECK(rs->outputs_max <= rs->transition_max);
+    }
+    if (expected != SAFETY_STATE_NORMAL)
+    {
+        CHECK(rs->transition_max != 0U);
+    }
+
+    uint32_t total = (rs->outputs_max > rs->transition_max) ? rs->outputs_max : rs->transition_max;
+    result->count++;
+    result->transition_max = (rs->transition_max > result->transition_max) ?
+                             rs->transition_max : result->transition_max;
+    result->outputs_max = (rs->outputs_max > result->outputs_max) ?
+                          rs->outputs_max : result->outputs_max;
+    result->total_max = (total > result->total_max) ? total : result->total_max;
+    result->over_budget += rs->over_budget;
+}
+
+static void Host_Run(safety_error_t error, inject_t inject, const char *path)
+{
+    host_result_t result = { 0 };
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+
+    for (uint32_t run = 0; run < HOST_REACTION_RUNS; run++)
+    {
+        Host_Inject(error, inject, &result);
+    }
+
+    printf("0x%02X %-9s %-8s %5u  trans_max %6u  out_max %6u  (%u us)  over_budget %u\n",
+           (unsigned)error, path, s_states[Host_Expected(error, inject)], result.count,
+           result.transition_max, result.outputs_max, result.total_max / cycles_per_us,
+           result.over_budget);
+
+    CHECK(result.over_budget == 0U);
+    CHECK((result.total_max / cycles_per_us) <= REACTION_BUDGET_US);
+}
+
+int main(void)
+{
+    host_tx_init(0U);
+
+    SAFE_OUTPUT_TABLE(HOST_EXPECT, 0)
+
+    printf("code path      state     runs  (DWT cycles at %u Hz, budget %u us)\n",
+           SystemCoreClock, REACTION_BUDGET_US);
+
+    for (uint32_t i = 0; i < (sizeof(s_errors) / sizeof(s_errors[0])); i++)
+    {
+        safety_error_t error = s_errors[i];
+
+        Host_Run(error, INJECT_REPORT, "report");
+        if (Host_Expected(error, INJECT_REPORT) == SAFETY_STATE_DEGRADED)
+        {
+            Host_Run(error, INJECT_REPORT_DEGRADED, "degraded");
+        }
+        Host_Run(error, INJECT_HANDLER, "handler");
+    }
+
+    printf("PASS\n");
+    return 0;
+}
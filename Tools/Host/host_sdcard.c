@@ -0,0 +1,415 @@
+/**
+ ******************************************************************************
+ * @file    host_sdcard.c
+ * @brief   SD Block Cache Harness (vendor driver and glue on a card model)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Runs FileX, fx_stm32_sd_driver and fx_stm32_sd_driver_glue over a model
+ * of the card in virtual time. A command costs HOST_SD_CMD_US plus
+ * HOST_SD_BLOCK_US per block, the DMA completes in a host_tx event (the
+ * HAL callback) and a write then programs for HOST_SD_PROG_US plus
+ * HOST_SD_PROG_BLOCK_US per block. A status poll (CMD13) costs
+ * HOST_SD_STATUS_US. The caller spends HOST_SD_APP_US per call producing
+ * or consuming the data.
+ *
+ * Files are written and read back in 512-byte and 4KB calls, then 3000
+ * random reads and writes over four files are checked against a shadow
+ * copy, also after reopening the media. It prints the rates (kB/s of
+ * virtual time), the write commands and the stalled write calls (no
+ * command sent, yet waiting for the card), and checks: data intact, no
+ * status poll during a DMA, no unaligned DMA buffer and, with the block
+ * cache, no command while the card programs and no stalled call (merged
+ * writes do not wait for the run in flight). Without the cache, the
+ * vendor driver writes the sectors of an unaligned request one after the
+ * other without a status poll; those commands are only counted.
+ *
+ * Built with (host_sdcard) and without (host_sdcard_nocache) the block
+ * cache. Exit status 0 if all checks pass.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "fx_api.h"
+#include "fx_stm32_sd_driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_SD_BLOCKS              (64U * 2048U)   /* 64MB card */
+#define HOST_SD_BLOCK_SIZE          512U
+#define HOST_SD_CMD_US              150U
+#define HOST_SD_BLOCK_US            43U
+#define HOST_SD_PROG_US             1200U
+#define HOST_SD_PROG_BLOCK_US       15U
+#define HOST_SD_STATUS_US           5U
+#define HOST_SD_APP_US              100U
+
+#define HOST_RANDOM_FILES           4U
+#define HOST_RANDOM_FILE_SIZE       (96U * 1024U)
+#define HOST_RANDOM_OPS             3000U
+
+#define HOST_PATTERN(offset, seed)  ((UCHAR)((((offset) * 2654435761UL) + (seed)) >> 13))
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint8_t *data;
+    bool busy;                      /* DMA in progress */
+    bool write;
+    uint8_t *buffer;
+    uint32_t block;
+    uint32_t count;
+    uint32_t generation;            /* Completions of aborted transfers are dropped */
+    uint64_t program_until;
+    ULONG reads;
+    ULONG writes;
+    ULONG status_in_dma;            /* CMD13 sent while a DMA was in progress */
+    ULONG command_in_program;       /* Data command while the card programmed */
+    ULONG unaligned;
+} host_card_t;
+
+/* Private variables ---------------------------------------------------------*/
+SD_HandleTypeDef hsd;
+
+static host_card_t s_card;
+static FX_MEDIA s_media;
+static ULONG s_media_memory[16U * HOST_SD_BLOCK_SIZE / sizeof(ULONG)];
+static ULONG s_buffer[4096U / sizeof(ULONG)];
+static UCHAR s_shadow[HOST_RANDOM_FILES][HOST_RANDOM_FILE_SIZE];
+
+/* ============================================================================
+ * Card Model (HAL SD subset)
+ * ============================================================================*/
+
+static void Host_Complete(void *context)
+{
+    uint8_t *card = &s_card.data[(size_t)s_card.block * HOST_SD_BLOCK_SIZE];
+    size_t size = (size_t)s_card.count * HOST_SD_BLOCK_SIZE;
+
+    if ((uint32_t)(uintptr_t)context != s_card.generation)
+    {
+        return;
+    }
+
+    /* Copied at the end: a buffer changed during the DMA shows up as bad data */
+    s_card.busy = false;
+    if (s_card.write)
+    {
+        memcpy(card, s_card.buffer, size);
+        HAL_SD_TxCpltCallback(&hsd);
+    }
+    else
+    {
+        memcpy(s_card.buffer, card, size);
+        HAL_SD_RxCpltCallback(&hsd);
+    }
+}
+
+static HAL_StatusTypeDef Host_Start(bool write, uint8_t *buffer, uint32_t block, uint32_t count)
+{
+    uint64_t now = host_tx_now_us();
+
+    if (s_card.busy)
+    {
+        return HAL_BUSY;
+    }
+    if ((block + count) > HOST_SD_BLOCKS)
+    {
+        return HAL_ERROR;
+    }
+    if (now < s_card.program_until)
+    {
+        s_card.command_in_program++;
+    }
+    if (((uintptr_t)buffer & 3U) != 0U)
+    {
+        s_card.unaligned++;
+    }
+
+    uint64_t done = now + HOST_SD_CMD_US + ((uint64_t)count * HOST_SD_BLOCK_US);
+
+    s_card.busy = true;
+    s_card.write = write;
+    s_card.buffer = buffer;
+    s_card.block = block;
+    s_card.count = count;
+    hsd.ErrorCode = HAL_SD_ERROR_NONE;
+    if (write)
+    {
+        s_card.program_until = done + HOST_SD_PROG_US + ((uint64_t)count * HOST_SD_PROG_BLOCK_US);
+        s_card.writes++;
+    }
+    else
+    {
+        s_card.reads++;
+    }
+
+    host_tx_event_at(done, Host_Complete, (void *)(uintptr_t)s_card.generation);
+    return HAL_OK;
+}
+
+void MX_SDIO_SD_Init(void)
+{
+    hsd.SdCard.BlockNbr = HOST_SD_BLOCKS;
+    hsd.SdCard.BlockSize = HOST_SD_BLOCK_SIZE;
+    hsd.SdCard.LogBlockNbr = HOST_SD_BLOCKS;
+    hsd.SdCard.LogBlockSize = HOST_SD_BLOCK_SIZE;
+}
+
+HAL_StatusTypeDef HAL_SD_DeInit(SD_HandleTypeDef *h)
+{
+    (void)h;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SD_Abort(SD_HandleTypeDef *h)
+{
+    (void)h;
+    s_card.busy = false;
+    s_card.generation++;
+    return HAL_OK;
+}
+
+HAL_SD_CardStateTypeDef HAL_SD_GetCardState(SD_HandleTypeDef *h)
+{
+    (void)h;
+
+    if (s_card.busy)
+    {
+        s_card.status_in_dma++;
+    }
+    host_tx_busy(HOST_SD_STATUS_US);
+
+    if (s_card.busy)
+    {
+        return s_card.write ? HAL_SD_CARD_RECEIVING : HAL_SD_CARD_SENDING;
+    }
+    return (host_tx_now_us() < s_card.program_until) ? HAL_SD_CARD_PROGRAMMING : HAL_SD_CARD_TRANSFER;
+}
+
+HAL_StatusTypeDef HAL_SD_ReadBlocks_DMA(SD_HandleTypeDef *h, uint8_t *pData, uint32_t BlockAdd,
+                                        uint32_t NumberOfBlocks)
+{
+    (void)h;
+    return Host_Start(false, pData, BlockAdd, NumberOfBlocks);
+}
+
+HAL_StatusTypeDef HAL_SD_WriteBlocks_DMA(SD_HandleTypeDef *h, uint8_t *pData, uint32_t BlockAdd,
+                                         uint32_t NumberOfBlocks)
+{
+    (void)h;
+    return Host_Start(true, pData, BlockAdd, NumberOfBlocks);
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static ULONG Host_Rate(ULONG bytes, uint64_t us)
+{
+    /* kB/s of virtual time */
+    return (us > 0U) ? (ULONG)(((uint64_t)bytes * 1000000U) / 1024U / us) : 0U;
+}
+
+static void Host_Stream(const CHAR *name, ULONG unit, ULONG total, bool allocate)
+{
+    UCHAR *buffer = (UCHAR *)s_buffer;
+    FX_FILE file;
+    ULONG actual;
+    ULONG bad = 0U;
+    ULONG stalled = 0U;
+    ULONG writes = s_card.writes;
+    uint64_t start;
+
+    (void)fx_file_delete(&s_media, (CHAR *)name);
+    CHECK(fx_file_create(&s_media, (CHAR *)name) == FX_SUCCESS);
+    CHECK(fx_file_open(&s_media, &file, (CHAR *)name, FX_OPEN_FOR_WRITE) == FX_SUCCESS);
+
+    start = host_tx_now_us();
+    if (allocate)
+    {
+        CHECK(fx_file_allocate(&file, total) == FX_SUCCESS);
+    }
+    for (ULONG offset = 0U; offset < total; offset += unit)
+    {
+        host_tx_busy(HOST_SD_APP_US);
+        for (ULONG i = 0U; i < unit; i++)
+        {
+            buffer[i] = HOST_PATTERN(offset + i, unit);
+        }
+        uint64_t call = host_tx_now_us();
+        ULONG commands = s_card.reads + s_card.writes;
+        CHECK(fx_file_write(&file, buffer, unit) == FX_SUCCESS);
+        if (((s_card.reads + s_card.writes) == commands) &&
+            ((host_tx_now_us() - call) > HOST_SD_STATUS_US))
+        {
+            stalled++;
+        }
+    }
+    CHECK(fx_file_close(&file) == FX_SUCCESS);
+    CHECK(fx_media_flush(&s_media) == FX_SUCCESS);
+    uint64_t write_us = host_tx_now_us() - start;
+    writes = s_card.writes - writes;
+
+    CHECK(fx_file_open(&s_media, &file, (CHAR *)name, FX_OPEN_FOR_READ) == FX_SUCCESS);
+    start = host_tx_now_us();
+    for (ULONG offset = 0U; offset < total; offset += unit)
+    {
+        host_tx_busy(HOST_SD_APP_US);
+        CHECK(fx_file_read(&file, buffer, unit, &actual) == FX_SUCCESS);
+        CHECK(actual == unit);
+        for (ULONG i = 0U; i < unit; i++)
+        {
+            bad += (buffer[i] != HOST_PATTERN(offset + i, unit)) ? 1U : 0U;
+        }
+    }
+    uint64_t read_us = host_tx_now_us() - start;
+    CHECK(fx_file_close(&file) == FX_SUCCESS);
+
+    printf("%4u B x %4u %-12s write %5u kB/s (%4u commands, %3u stalled)  read %5u kB/s\n",
+           unit, total / unit, allocate ? "preallocated" : "appended", Host_Rate(total, write_us),
+           writes, stalled, Host_Rate(total, read_us));
+
+    CHECK(bad == 0U);
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+    /* Merged writes do not wait for the run in flight */
+    CHECK(stalled == 0U);
+#endif
+}
+
+static void Host_Random(void)
+{
+    UCHAR *buffer = (UCHAR *)s_buffer;
+    CHAR names[HOST_RANDOM_FILES][8];
+    FX_FILE file;
+    ULONG actual;
+    ULONG bad = 0U;
+
+    srand(7);
+    for (UINT k = 0U; k < HOST_RANDOM_FILES; k++)
+    {
+        (void)snprintf(names[k], sizeof(names[k]), "R%u.BIN", k);
+        (void)fx_file_delete(&s_media, names[k]);
+        CHECK(fx_file_create(&s_media, names[k]) == FX_SUCCESS);
+        CHECK(fx_file_open(&s_media, &file, names[k], FX_OPEN_FOR_WRITE) == FX_SUCCESS);
+        memset(s_shadow[k], 0, HOST_RANDOM_FILE_SIZE);
+        memset(buffer, 0, sizeof(s_buffer));
+        for (ULONG offset = 0U; offset < HOST_RANDOM_FILE_SIZE; offset += sizeof(s_buffer))
+        {
+            CHECK(fx_file_write(&file, buffer, sizeof(s_buffer)) == FX_SUCCESS);
+        }
+        CHECK(fx_file_close(&file) == FX_SUCCESS);
+    }
+
+    for (UINT op = 0U; op < HOST_RANDOM_OPS; op++)
+    {
+        UINT k = (UINT)rand() % HOST_RANDOM_FILES;
+        ULONG offset = (ULONG)rand() % HOST_RANDOM_FILE_SIZE;
+        ULONG size = 1U + ((ULONG)rand() % 2048U);
+        UINT kind = (UINT)rand() % 10U;
+
+        size = ((offset + size) > HOST_RANDOM_FILE_SIZE) ? (HOST_RANDOM_FILE_SIZE - offset) : size;
+        if (kind < 5U)
+        {
+            CHECK(fx_file_open(&s_media, &file, names[k], FX_OPEN_FOR_WRITE) == FX_SUCCESS);
+            CHECK(fx_file_seek(&file, offset) == FX_SUCCESS);
+            for (ULONG i = 0U; i < size; i++)
+            {
+                buffer[i] = (UCHAR)rand();
+                s_shadow[k][offset + i] = buffer[i];
+            }
+            CHECK(fx_file_write(&file, buffer, size) == FX_SUCCESS);
+            CHECK(fx_file_close(&file) == FX_SUCCESS);
+        }
+        else if (kind < 9U)
+        {
+            CHECK(fx_file_open(&s_media, &file, names[k], FX_OPEN_FOR_READ) == FX_SUCCESS);
+            CHECK(fx_file_seek(&file, offset) == FX_SUCCESS);
+            CHECK(fx_file_read(&file, buffer, size, &actual) == FX_SUCCESS);
+            CHECK(actual == size);
+            bad += (memcmp(buffer, &s_shadow[k][offset], size) != 0) ? 1U : 0U;
+            CHECK(fx_file_close(&file) == FX_SUCCESS);
+        }
+        else
+        {
+            CHECK(fx_media_flush(&s_media) == FX_SUCCESS);
+        }
+    }
+
+    /* What reached the card, read back after reopening the media */
+    CHECK(fx_media_close(&s_media) == FX_SUCCESS);
+    CHECK(fx_media_open(&s_media, "SD", fx_stm32_sd_cache_driver, FX_NULL,
+                        s_media_memory, sizeof(s_media_memory)) == FX_SUCCESS);
+    for (UINT k = 0U; k < HOST_RANDOM_FILES; k++)
+    {
+        CHECK(fx_file_open(&s_media, &file, names[k], FX_OPEN_FOR_READ) == FX_SUCCESS);
+        for (ULONG offset = 0U; offset < HOST_RANDOM_FILE_SIZE; offset += sizeof(s_buffer))
+        {
+            CHECK(fx_file_read(&file, buffer, sizeof(s_buffer), &actual) == FX_SUCCESS);
+            bad += (memcmp(buffer, &s_shadow[k][offset], sizeof(s_buffer)) != 0) ? 1U : 0U;
+        }
+        CHECK(fx_file_close(&file) == FX_SUCCESS);
+    }
+
+    printf("random %u operations over %u files, reopened: %s\n", HOST_RANDOM_OPS, HOST_RANDOM_FILES,
+           (bad == 0U) ? "match" : "MISMATCH");
+    CHECK(bad == 0U);
+}
+
+int main(void)
+{
+    host_tx_init(0U);
+    host_tx_use_virtual_time();
+
+    s_card.data = calloc(HOST_SD_BLOCKS, HOST_SD_BLOCK_SIZE);
+    CHECK(s_card.data != NULL);
+
+    printf("block cache %s: command %u us + %u us/block, programming %u us + %u us/block, %u us per call\n",
+           (FX_STM32_SD_BLOCK_CACHE == 1) ? "on" : "off", HOST_SD_CMD_US, HOST_SD_BLOCK_US,
+           HOST_SD_PROG_US, HOST_SD_PROG_BLOCK_US, HOST_SD_APP_US);
+
+    fx_system_initialize();
+    CHECK(fx_media_format(&s_media, fx_stm32_sd_cache_driver, FX_NULL, (UCHAR *)s_media_memory,
+                          sizeof(s_media_memory), "SD", 2, 512, 0, HOST_SD_BLOCKS,
+                          HOST_SD_BLOCK_SIZE, 8, 1, 1) == FX_SUCCESS);
+    CHECK(fx_media_open(&s_media, "SD", fx_stm32_sd_cache_driver, FX_NULL,
+                        s_media_memory, sizeof(s_media_memory)) == FX_SUCCESS);
+
+    Host_Stream("S512.BIN", 512U, 1024U * 1024U, false);
+    Host_Stream("S512.BIN", 512U, 1024U * 1024U, true);
+    Host_Stream("S4K.BIN", 4096U, 1024U * 1024U, true);
+    Host_Random();
+    CHECK(fx_media_close(&s_media) == FX_SUCCESS);
+
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+    const fx_stm32_sd_cache_stats_t *stats = fx_stm32_sd_cache_get_stats();
+    printf("cache: hits %u prefetches %u direct reads %u merged %u runs %u direct writes %u flushes %u errors %u\n",
+           stats->read_hits, stats->read_prefetches, stats->read_direct, stats->write_merged,
+           stats->write_runs, stats->write_direct, stats->flushes, stats->errors);
+    CHECK(stats->errors == 0U);
+#endif
+    printf("card: %u reads %u writes, status during DMA %u, command while programming %u, unaligned %u\n",
+           s_card.reads, s_card.writes, s_card.status_in_dma, s_card.command_in_program, s_card.unaligned);
+
+    CHECK(s_card.status_in_dma == 0U);
+    CHECK(s_card.unaligned == 0U);
+#if (FX_STM32_SD_BLOCK_CACHE == 1)
+    CHECK(s_card.command_in_program == 0U);
+#endif
+
+    free(s_card.data);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,643 @@
+/**
+ ******************************************************************************
+ * @file    host_tx.c
+ * @brief   ThreadX API Subset for Host Builds (single core scheduler)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Every thread blocks on its own condition variable unless it is the
+ * running one; the services run under one host mutex and end in
+ * Host_Schedule, which hands the CPU to the highest priority ready thread
+ * (FIFO within a priority). When none is ready, time advances to the next
+ * wake-up or event: the virtual clock jumps, the host clock is slept on.
+ *
+ * Services called from an event (host_tx_event_at) make threads ready but
+ * do not switch; the switch happens when the event returns, as after an
+ * interrupt. No priority inheritance, time slicing or preemption
+ * threshold.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "tx_api.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_TX_MAX_EVENTS          64U
+#define HOST_TX_FOREVER             UINT64_MAX
+
+#define HOST_STATE_READY            0U
+#define HOST_STATE_SLEEP            1U
+#define HOST_STATE_WAIT_SEMAPHORE   2U
+#define HOST_STATE_WAIT_MUTEX       3U
+#define HOST_STATE_DONE             4U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t at_us;
+    host_tx_event_t function;
+    void *context;
+    bool used;
+} host_event_t;
+
+/* Private variables ---------------------------------------------------------*/
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static TX_THREAD s_main_thread;
+static TX_THREAD *s_threads = NULL;
+static TX_THREAD *s_running = NULL;
+static uint64_t s_seq = 0U;
+static bool s_virtual = false;
+static uint64_t s_virtual_us = 0U;
+static uint64_t s_host_base_us = 0U;
+static bool s_in_event = false;
+static UINT s_int_posture = TX_INT_ENABLE;
+static host_event_t s_events[HOST_TX_MAX_EVENTS];
+
+TX_THREAD *_tx_thread_current_ptr = TX_NULL;
+TX_THREAD _tx_timer_thread;
+volatile ULONG _tx_thread_system_state = 0U;
+
+/* ============================================================================
+ * Private Function Prototypes
+ * ============================================================================*/
+static uint64_t Host_MonotonicUs(void);
+static uint64_t Host_Now(void);
+static void Host_Enter(void);
+static void Host_Leave(void);
+static void Host_AddThread(TX_THREAD *thread, CHAR *name, UINT priority);
+static void Host_MakeReady(TX_THREAD *thread, UINT status);
+static void Host_Block(UINT state, void *object, ULONG wait_option, UINT timeout_status);
+static TX_THREAD *Host_FirstWaiter(UINT state, void *object);
+static bool Host_RunDue(void);
+static uint64_t Host_NextDue(void);
+static void Host_AdvanceTo(uint64_t us);
+static void Host_Schedule(void);
+static void *Host_ThreadEntry(void *arg);
+
+/* ============================================================================
+ * Host Scheduler
+ * ============================================================================*/
+
+void host_tx_init(UINT priority)
+{
+    s_host_base_us = Host_MonotonicUs();
+    Host_AddThread(&s_main_thread, "main", priority);
+    s_main_thread.handle = pthread_self();
+    s_running = &s_main_thread;
+    _tx_thread_current_ptr = s_running;
+}
+
+void host_tx_use_virtual_time(void)
+{
+    s_virtual = true;
+    s_virtual_us = 0U;
+}
+
+uint64_t host_tx_now_us(void)
+{
+    return Host_Now();
+}
+
+uint64_t host_tx_now_ns(void)
+{
+    struct timespec t;
+
+    if (s_virtual)
+    {
+        return s_virtual_us * 1000U;
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000U) + (uint64_t)t.tv_nsec) - (s_host_base_us * 1000U);
+}
+
+void host_tx_busy(uint64_t us)
+{
+    Host_Enter();
+    uint64_t target = Host_Now() + us;
+
+    if (!s_virtual)
+    {
+        Host_Leave();
+        struct timespec d = { (time_t)(us / 1000000U), (long)((us % 1000000U) * 1000U) };
+        (void)nanosleep(&d, NULL);
+        host_tx_poll();
+        return;
+    }
+
+    /* Events falling due inside the interval run at their time */
+    while (s_virtual_us < target)
+    {
+        uint64_t next = Host_NextDue();
+        s_virtual_us = (next < target) ? ((next > s_virtual_us) ? next : s_virtual_us) : target;
+        if (Host_RunDue() && !s_in_event)
+        {
+            Host_Schedule();
+        }
+    }
+    Host_Leave();
+}
+
+void host_tx_poll(void)
+{
+    Host_Enter();
+    if (Host_RunDue() && !s_in_event)
+    {
+        Host_Schedule();
+    }
+    Host_Leave();
+}
+
+void host_tx_event_at(uint64_t at_us, host_tx_event_t function, void *context)
+{
+    Host_Enter();
+    for (uint32_t i = 0; i < HOST_TX_MAX_EVENTS; i++)
+    {
+        if (!s_events[i].used)
+        {
+            s_events[i].at_us = at_us;
+            s_events[i].function = function;
+            s_events[i].context = context;
+            s_events[i].used = true;
+            Host_Leave();
+            return;
+        }
+    }
+    fprintf(stderr, "host_tx: too many events\n");
+    abort();
+}
+
+/* ============================================================================
+ * Threads
+ * ============================================================================*/
+
+UINT tx_thread_create(TX_THREAD *thread_ptr, CHAR *name_ptr, VOID (*entry_function)(ULONG),
+                      ULONG entry_input, VOID *stack_start, ULONG stack_size, UINT priority,
+                      UINT preempt_threshold, ULONG time_slice, UINT auto_start)
+{
+    (void)stack_start;
+    (void)stack_size;
+    (void)preempt_threshold;
+    (void)time_slice;
+
+    Host_Enter();
+    Host_AddThread(thread_ptr, name_ptr, priority);
+    thread_ptr->entry = entry_function;
+    thread_ptr->input = entry_input;
+    thread_ptr->state = (auto_start == TX_AUTO_START) ? HOST_STATE_READY : HOST_STATE_DONE;
+
+    if (pthread_create(&thread_ptr->handle, NULL, Host_ThreadEntry, thread_ptr) != 0)
+    {
+        Host_Leave();
+        return TX_THREAD_ERROR;
+    }
+
+    if (!s_in_event)
+    {
+        Host_Schedule();
+    }
+    Host_Leave();
+    return TX_SUCCESS;
+}
+
+UINT tx_thread_sleep(ULONG timer_ticks)
+{
+    if (timer_ticks == 0U)
+    {
+        return tx_thread_relinquish();
+    }
+
+    Host_Enter();
+    Host_Block(HOST_STATE_SLEEP, NULL, timer_ticks, TX_SUCCESS);
+    Host_Leave();
+    return TX_SUCCESS;
+}
+
+UINT tx_thread_relinquish(VOID)
+{
+    Host_Enter();
+    s_running->ready_seq = ++s_seq;
+    (void)Host_RunDue();
+    Host_Schedule();
+    Host_Leave();
+    return TX_SUCCESS;
+}
+
+TX_THREAD *tx_thread_identify(VOID)
+{
+    return s_running;
+}
+
+UINT tx_thread_preemption_change(TX_THREAD *thread_ptr, UINT new_threshold, UINT *old_threshold)
+{
+    (void)thread_ptr;
+    *old_threshold = new_threshold;
+    return TX_SUCCESS;
+}
+
+/* ============================================================================
+ * Semaphores
+ * ============================================================================*/
+
+UINT tx_semaphore_create(TX_SEMAPHORE *semaphore_ptr, CHAR *name_ptr, ULONG initial_count)
+{
+    semaphore_ptr->name = name_ptr;
+    semaphore_ptr->tx_semaphore_count = initial_count;
+    return TX_SUCCESS;
+}
+
+UINT tx_semaphore_delete(TX_SEMAPHORE *semaphore_ptr)
+{
+    semaphore_ptr->tx_semaphore_count = 0U;
+    return TX_SUCCESS;
+}
+
+UINT tx_semaphore_get(TX_SEMAPHORE *semaphore_ptr, ULONG wait_option)
+{
+    UINT status = TX_SUCCESS;
+
+    Host_Enter();
+    if (semaphore_ptr->tx_semaphore_count > 0U)
+    {
+        semaphore_ptr->tx_semaphore_count--;
+    }
+    else if ((wait_option == TX_NO_WAIT) || s_in_event)
+    {
+        status = TX_NO_INSTANCE;
+    }
+    else
+    {
+        Host_Block(HOST_STATE_WAIT_SEMAPHORE, semaphore_ptr, wait_option, TX_NO_INSTANCE);
+        status = s_running->wait_status;
+    }
+    Host_Leave();
+    return status;
+}
+
+UINT tx_semaphore_put(TX_SEMAPHORE *semaphore_ptr)
+{
+    Host_Enter();
+    TX_THREAD *waiter = Host_FirstWaiter(HOST_STATE_WAIT_SEMAPHORE, semaphore_ptr);
+    if (waiter != NULL)
+    {
+        Host_MakeReady(waiter, TX_SUCCESS);
+        if (!s_in_event)
+        {
+            Host_Schedule();
+        }
+    }
+    else
+    {
+        semaphore_ptr->tx_semaphore_count++;
+    }
+    Host_Leave();
+    return TX_SUCCESS;
+}
+
+/* ============================================================================
+ * Mutexes
+ * ============================================================================*/
+
+UINT tx_mutex_create(TX_MUTEX *mutex_ptr, CHAR *name_ptr, UINT inherit)
+{
+    (void)inherit;
+    mutex_ptr->name = name_ptr;
+    mutex_ptr->tx_mutex_owner = NULL;
+    mutex_ptr->tx_mutex_ownership_count = 0U;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_delete(TX_MUTEX *mutex_ptr)
+{
+    mutex_ptr->tx_mutex_owner = NULL;
+    mutex_ptr->tx_mutex_ownership_count = 0U;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option)
+{
+    UINT status = TX_SUCCESS;
+
+    Host_Enter();
+    if ((mutex_ptr->tx_mutex_owner == NULL) || (mutex_ptr->tx_mutex_owner == s_running))
+    {
+        mutex_ptr->tx_mutex_owner = s_running;
+        mutex_ptr->tx_mutex_ownership_count++;
+    }
+    else if (wait_option == TX_NO_WAIT)
+    {
+        status = TX_NOT_AVAILABLE;
+    }
+    else
+    {
+        /* Ownership is handed over by tx_mutex_put */
+        Host_Block(HOST_STATE_WAIT_MUTEX, mutex_ptr, wait_option, TX_NOT_AVAILABLE);
+        status = s_running->wait_status;
+    }
+    Host_Leave();
+    return status;
+}
+
+UINT tx_mutex_put(TX_MUTEX *mutex_ptr)
+{
+    Host_Enter();
+    if ((mutex_ptr->tx_mutex_owner != s_running) || (mutex_ptr->tx_mutex_ownership_count == 0U))
+    {
+        Host_Leave();
+        return TX_NOT_OWNED;
+    }
+
+    if (--mutex_ptr->tx_mutex_ownership_count == 0U)
+    {
+        TX_THREAD *waiter = Host_FirstWaiter(HOST_STATE_WAIT_MUTEX, mutex_ptr);
+        mutex_ptr->tx_mutex_owner = waiter;
+        if (waiter != NULL)
+        {
+            mutex_ptr->tx_mutex_ownership_count = 1U;
+            Host_MakeReady(waiter, TX_SUCCESS);
+            Host_Schedule();
+        }
+    }
+    Host_Leave();
+    return TX_SUCCESS;
+}
+
+/* ============================================================================
+ * Byte Pools (allocation in order, release of the latest block only)
+ * ============================================================================*/
+
+UINT tx_byte_pool_create(TX_BYTE_POOL *pool_ptr, CHAR *name_ptr, VOID *pool_start, ULONG pool_size)
+{
+    pool_ptr->name = name_ptr;
+    pool_ptr->start = (UCHAR *)pool_start;
+    pool_ptr->size = pool_size;
+    pool_ptr->used = 0U;
+    pool_ptr->tx_byte_pool_available = pool_size;
+    return TX_SUCCESS;
+}
+
+UINT tx_byte_allocate(TX_BYTE_POOL *pool_ptr, VOID **memory_ptr, ULONG memory_size, ULONG wait_option)
+{
+    /* Block header of the target pool: two pointers, blocks word aligned */
+    const ULONG header = (ULONG)(2U * sizeof(void *));
+    const uintptr_t mask = sizeof(ALIGN_TYPE) - 1U;
+    ULONG skip = (ULONG)((((uintptr_t)pool_ptr->start + mask) & ~mask) - (uintptr_t)pool_ptr->start);
+    ULONG offset = skip + pool_ptr->used;
+    ULONG size = (ULONG)((memory_size + mask) & ~mask);
+
+    (void)wait_option;
+    if ((offset + header + size) > pool_ptr->size)
+    {
+        return TX_NO_MEMORY;
+    }
+
+    *memory_ptr = pool_ptr->start + offset + header;
+    pool_ptr->used += header + size;
+    pool_ptr->tx_byte_pool_available = pool_ptr->size - (offset + header + size);
+    return TX_SUCCESS;
+}
+
+UINT tx_byte_release(VOID *memory_ptr)
+{
+    (void)memory_ptr;
+    return TX_SUCCESS;
+}
+
+/* ============================================================================
+ * Time and Interrupts
+ * ============================================================================*/
+
+ULONG tx_time_get(VOID)
+{
+    return (ULONG)(Host_Now() / 1000U);
+}
+
+UINT tx_interrupt_control(UINT new_posture)
+{
+    UINT old = s_int_posture;
+    s_int_posture = new_posture;
+    return old;
+}
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================*/
+
+static uint64_t Host_MonotonicUs(void)
+{
+    struct timespec t;
+    (void)clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000U) + ((uint64_t)t.tv_nsec / 1000U);
+}
+
+static uint64_t Host_Now(void)
+{
+    return s_virtual ? s_virtual_us : (Host_MonotonicUs() - s_host_base_us);
+}
+
+/* The lock is already held by the running thread inside an event */
+static void Host_Enter(void)
+{
+    if (!s_in_event)
+    {
+        (void)pthread_mutex_lock(&s_lock);
+    }
+}
+
+static void Host_Leave(void)
+{
+    if (!s_in_event)
+    {
+        (void)pthread_mutex_unlock(&s_lock);
+    }
+}
+
+static void Host_AddThread(TX_THREAD *thread, CHAR *name, UINT priority)
+{
+    memset(thread, 0, sizeof(*thread));
+    thread->tx_thread_name = name;
+    thread->tx_thread_priority = priority;
+    thread->state = HOST_STATE_READY;
+    thread->ready_seq = ++s_seq;
+    (void)pthread_cond_init(&thread->cond, NULL);
+    thread->next = s_threads;
+    s_threads = thread;
+}
+
+static void Host_MakeReady(TX_THREAD *thread, UINT status)
+{
+    thread->state = HOST_STATE_READY;
+    thread->waiting = NULL;
+    thread->wait_status = status;
+    thread->ready_seq = ++s_seq;
+}
+
+static void Host_Block(UINT state, void *object, ULONG wait_option, UINT timeout_status)
+{
+    TX_THREAD *self = s_running;
+
+    self->state = state;
+    self->waiting = object;
+    self->wait_status = timeout_status;
+    self->wait_seq = ++s_seq;
+    self->wake_us = (wait_option == TX_WAIT_FOREVER) ?
+                    HOST_TX_FOREVER : (Host_Now() + ((uint64_t)wait_option * 1000U));
+    Host_Schedule();
+}
+
+static TX_THREAD *Host_FirstWaiter(UINT state, void *object)
+{
+    TX_THREAD *first = NULL;
+
+    for (TX_THREAD *t = s_threads; t != NULL; t = t->next)
+    {
+        if ((t->state == state) && (t->waiting == object) &&
+            ((first == NULL) || (t->wait_seq < first->wait_seq)))
+        {
+            first = t;
+        }
+    }
+    return first;
+}
+
+/* Run due events and end due sleeps and timeouts; true if a thread got ready */
+static bool Host_RunDue(void)
+{
+    bool readied = false;
+    uint64_t now = Host_Now();
+
+    for (uint32_t i = 0; i < HOST_TX_MAX_EVENTS; i++)
+    {
+        if (s_events[i].used && (s_events[i].at_us <= now))
+        {
+            s_events[i].used = false;
+            s_in_event = true;
+            s_events[i].function(s_events[i].context);
+            s_in_event = false;
+            readied = true;
+        }
+    }
+
+    for (TX_THREAD *t = s_threads; t != NULL; t = t->next)
+    {
+        if ((t->state != HOST_STATE_READY) && (t->state != HOST_STATE_DONE) && (t->wake_us <= now))
+        {
+            Host_MakeReady(t, t->wait_status);
+            readied = true;
+        }
+    }
+    return readied;
+}
+
+static uint64_t Host_NextDue(void)
+{
+    uint64_t next = HOST_TX_FOREVER;
+
+    for (uint32_t i = 0; i < HOST_TX_MAX_EVENTS; i++)
+    {
+        if (s_events[i].used && (s_events[i].at_us < next))
+        {
+            next = s_events[i].at_us;
+        }
+    }
+    for (TX_THREAD *t = s_threads; t != NULL; t = t->next)
+    {
+        if ((t->state != HOST_STATE_READY) && (t->state != HOST_STATE_DONE) && (t->wake_us < next))
+        {
+            next = t->wake_us;
+        }
+    }
+    return next;
+}
+
+static void Host_AdvanceTo(uint64_t us)
+{
+    if (s_virtual)
+    {
+        if (us > s_virtual_us)
+        {
+            s_virtual_us = us;
+        }
+        return;
+    }
+
+    uint64_t now = Host_Now();
+    if (us > now)
+    {
+        struct timespec d = { (time_t)((us - now) / 1000000U), (long)(((us - now) % 1000000U) * 1000U) };
+        (void)pthread_mutex_unlock(&s_lock);
+        (void)nanosleep(&d, NULL);
+        (void)pthread_mutex_lock(&s_lock);
+    }
+}
+
+/* Give the CPU to the first ready thread; returns when the caller runs again */
+static void Host_Schedule(void)
+{
+    TX_THREAD *self = s_running;
+
+    for (;;)
+    {
+        (void)Host_RunDue();
+
+        TX_THREAD *next = NULL;
+        for (TX_THREAD *t = s_threads; t != NULL; t = t->next)
+        {
+            if ((t->state == HOST_STATE_READY) &&
+                ((next == NULL) || (t->tx_thread_priority < next->tx_thread_priority) ||
+                 ((t->tx_thread_priority == next->tx_thread_priority) && (t->ready_seq < next->ready_seq))))
+            {
+                next = t;
+            }
+        }
+
+        if (next != NULL)
+        {
+            if (next != self)
+            {
+                s_running = next;
+                _tx_thread_current_ptr = next;
+                (void)pthread_cond_signal(&next->cond);
+                while (s_running != self)
+                {
+                    (void)pthread_cond_wait(&self->cond, &s_lock);
+                }
+            }
+            return;
+        }
+
+        uint64_t due = Host_NextDue();
+        if (due == HOST_TX_FOREVER)
+        {
+            fprintf(stderr, "host_tx: all threads blocked forever\n");
+            abort();
+        }
+        Host_AdvanceTo(due);
+    }
+}
+
+static void *Host_ThreadEntry(void *arg)
+{
+    TX_THREAD *self = (TX_THREAD *)arg;
+
+    (void)pthread_mutex_lock(&s_lock);
+    while (s_running != self)
+    {
+        (void)pthread_cond_wait(&self->cond, &s_lock);
+    }
+    (void)pthread_mutex_unlock(&s_lock);
+
+    self->entry(self->input);
+
+    (void)pthread_mutex_lock(&s_lock);
+    self->state = HOST_STATE_DONE;
+    Host_Schedule();
+    (void)pthread_mutex_unlock(&s_lock);
+    return NULL;
+}
@@ -0,0 +1,379 @@
+/**
+ ******************************************************************************
+ * @file    host_w25qxx.c
+ * @brief   W25Q128 Erase Suspend Harness (driver on bsp_w25qxx_sim)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Runs the W25QXX driver on the device model in virtual time: the model
+ * clock follows the host scheduler, bus time is spent on the CPU of the
+ * calling thread and the driver sleeps through tx_thread_sleep. For
+ * HOST_RUN_US, three threads share the device:
+ *   - writer (priority 12): 64KB WriteWithErase (block erase), a 4KB
+ *     sector rewrite of HOST_REWRITE_SECTOR (sector erase, pages kept
+ *     locked), then a sector erase and a 16KB BSP_W25QXX_Write;
+ *   - reader (priority 4): HOST_READ_SIZE bytes every 1-9ms from a region
+ *     that is never written; the latency of each read is recorded and
+ *     the data checked;
+ *   - checker (priority 8): reads HOST_REWRITE_SECTOR every 2ms and counts
+ *     torn reads (data that is neither the old nor the new contents).
+ *
+ * The run is done twice: callers serialized by their own mutex (no
+ * suspend), then with BSP_W25QXX_EnableSuspend. It prints the read latency
+ * p50/p99/max of each and checks: no driver errors, no bad or torn reads,
+ * erases suspended, and a lower p99 with suspend. Exit status 0 if all
+ * checks pass.
+ *
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_w25qxx.h"
+#include "bsp_w25qxx_sim.h"
+#include "tx_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_RUN_US                 20000000U   /* Virtual time per run */
+#define HOST_SCK_HZ                 42000000U
+#define HOST_FLASH_SIZE             0x00200000U
+#define HOST_WRITE_BLOCKS           15U         /* 64KB blocks written from 0 */
+#define HOST_REWRITE_SECTOR         0x000FF000U
+#define HOST_READ_START             0x00100000U
+#define HOST_READ_SIZE              512U
+#define HOST_PAGE_WRITE_SIZE        0x4000U
+#define HOST_MAX_SAMPLES            8192U
+
+#define HOST_PATTERN(addr)          ((uint8_t)(((addr) >> 8) ^ (addr)))
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t reads;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t bad_reads;
+    uint32_t torn_reads;
+    uint32_t errors;
+    uint32_t suspends;
+} host_result_t;
+
+/* Private variables ---------------------------------------------------------*/
+static w25qxx_sim_t s_sim;
+static w25qxx_transport_t s_transport;
+static uint8_t s_memory[HOST_FLASH_SIZE];
+static uint64_t s_carry_ns;
+
+static TX_THREAD s_threads[2][3];
+static TX_MUTEX s_serial;
+static bool s_serialized;
+static uint64_t s_end_us;
+static uint32_t s_done;
+
+static uint8_t s_block[W25Q128_BLOCK_SIZE_64K];
+static uint8_t s_sector[W25Q128_SECTOR_SIZE];
+static uint8_t s_work[W25Q128_SECTOR_SIZE];
+static uint32_t s_samples[HOST_MAX_SAMPLES];
+static host_result_t s_result;
+
+/* ============================================================================
+ * Transport (model clock on the scheduler clock)
+ * ============================================================================*/
+
+static uint64_t Host_BusBegin(void)
+{
+    uint64_t start = host_tx_now_ns();
+
+    s_sim.time_ns = start + s_carry_ns;
+    return start;
+}
+
+static void Host_BusEnd(uint64_t start)
+{
+    uint64_t spent = s_sim.time_ns - start;
+
+    s_carry_ns = spent % 1000U;
+    host_tx_busy(spent / 1000U);
+}
+
+static void Host_Select(void *context, bool selected)
+{
+    uint64_t start = Host_BusBegin();
+
+    s_sim.transport.select(context, selected);
+    Host_BusEnd(start);
+}
+
+static w25qxx_status_t Host_Transmit(void *context, const uint8_t *pData, uint32_t size)
+{
+    uint64_t start = Host_BusBegin();
+    w25qxx_status_t status = s_sim.transport.transmit(context, pData, size);
+
+    Host_BusEnd(start);
+    return status;
+}
+
+static w25qxx_status_t Host_Receive(void *context, uint8_t *pData, uint32_t size)
+{
+    uint64_t start = Host_BusBegin();
+    w25qxx_status_t status = s_sim.transport.receive(context, pData, size);
+
+    Host_BusEnd(start);
+    return status;
+}
+
+static w25qxx_status_t Host_ReceiveWait(void *context)
+{
+    (void)context;
+    return W25QXX_OK;
+}
+
+static void Host_Delay(void *context, uint32_t ms)
+{
+    (void)context;
+    (void)tx_thread_sleep(ms);
+}
+
+static uint32_t Host_GetTick(void *context)
+{
+    (void)context;
+    return (uint32_t)tx_time_get();
+}
+
+static bool Host_InThread(void *context)
+{
+    (void)context;
+    return true;
+}
+
+/* ============================================================================
+ * Threads
+ * ============================================================================*/
+
+static void Host_Begin(void)
+{
+    if (s_serialized)
+    {
+        (void)tx_mutex_get(&s_serial, TX_WAIT_FOREVER);
+    }
+}
+
+static void Host_End(w25qxx_status_t status)
+{
+    if (s_serialized)
+    {
+        (void)tx_mutex_put(&s_serial);
+    }
+    if (status != W25QXX_OK)
+    {
+        s_result.errors++;
+    }
+}
+
+static void Host_Writer(ULONG input)
+{
+    (void)input;
+
+    for (uint32_t i = 0U; host_tx_now_us() < s_end_us; i++)
+    {
+        uint32_t block = (i % HOST_WRITE_BLOCKS) * W25Q128_BLOCK_SIZE_64K;
+
+        /* Whole block: one block erase, then programs */
+        memset(s_block, (int)(i & 0x7FU), sizeof(s_block));
+        Host_Begin();
+        Host_End(BSP_W25QXX_WriteWithErase(s_block, block, sizeof(s_block), s_work));
+
+        /* Sector rewrite: erase and 16 pages with the lock held */
+        memset(s_sector, ((i & 1U) != 0U) ? 0x55 : 0xAA, sizeof(s_sector));
+        Host_Begin();
+        Host_End(BSP_W25QXX_WriteWithErase(s_sector, HOST_REWRITE_SECTOR, sizeof(s_sector), s_work));
+
+        /* Long page write: the lock is handed over between pages */
+        Host_Begin();
+        Host_End(BSP_W25QXX_EraseSector(block));
+        Host_Begin();
+        Host_End(BSP_W25QXX_EraseSector(block + W25Q128_SECTOR_SIZE));
+        Host_Begin();
+        Host_End(BSP_W25QXX_EraseSector(block + (2U * W25Q128_SECTOR_SIZE)));
+        Host_Begin();
+        Host_End(BSP_W25QXX_EraseSector(block + (3U * W25Q128_SECTOR_SIZE)));
+        Host_Begin();
+        Host_End(BSP_W25QXX_Write(s_block, block, HOST_PAGE_WRITE_SIZE));
+    }
+
+    s_done++;
+}
+
+static void Host_Reader(ULONG input)
+{
+    uint8_t buffer[HOST_READ_SIZE];
+    uint32_t seed = 12345U;
+
+    (void)input;
+
+    while (host_tx_now_us() < s_end_us)
+    {
+        seed = (seed * 1103515245U) + 12345U;
+        (void)tx_thread_sleep(1U + ((seed >> 16) % 9U));
+
+        seed = (seed * 1103515245U) + 12345U;
+        uint32_t addr = HOST_READ_START + ((seed >> 8) % (HOST_FLASH_SIZE - HOST_READ_START - HOST_READ_SIZE));
+        uint64_t start = host_tx_now_us();
+
+        Host_Begin();
+        Host_End(BSP_W25QXX_Read(buffer, addr, sizeof(buffer)));
+
+        if (s_result.reads < HOST_MAX_SAMPLES)
+        {
+            s_samples[s_result.reads++] = (uint32_t)(host_tx_now_us() - start);
+        }
+
+        for (uint32_t i = 0U; i < sizeof(buffer); i++)
+        {
+            if (buffer[i] != HOST_PATTERN(addr + i))
+            {
+                s_result.bad_reads++;
+                break;
+            }
+        }
+    }
+
+    s_done++;
+}
+
+static void Host_Checker(ULONG input)
+{
+    uint8_t buffer[HOST_READ_SIZE];
+    uint32_t offset = 0U;
+
+    (void)input;
+
+    while (host_tx_now_us() < s_end_us)
+    {
+        (void)tx_thread_sleep(2U);
+
+        Host_Begin();
+        Host_End(BSP_W25QXX_Read(buffer, HOST_REWRITE_SECTOR + offset, sizeof(buffer)));
+        offset = (offset + HOST_READ_SIZE) % W25Q128_SECTOR_SIZE;
+
+        for (uint32_t i = 0U; i < sizeof(buffer); i++)
+        {
+            if ((buffer[i] != buffer[0]) || ((buffer[0] != 0x55U) && (buffer[0] != 0xAAU)))
+            {
+                s_result.torn_reads++;
+                break;
+            }
+        }
+    }
+
+    s_done++;
+}
+
+/* ============================================================================
+ * Harness
+ * ============================================================================*/
+
+static int Host_Compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void Host_Run(uint32_t run, bool suspend, host_result_t *result)
+{
+    memset(s_memory, 0xFF, HOST_READ_START);
+    memset(&s_memory[HOST_REWRITE_SECTOR], 0x55, W25Q128_SECTOR_SIZE);
+    for (uint32_t addr = HOST_READ_START; addr < HOST_FLASH_SIZE; addr++)
+    {
+        s_memory[addr] = HOST_PATTERN(addr);
+    }
+
+    BSP_W25QXX_Sim_Init(&s_sim, s_memory, HOST_FLASH_SIZE, HOST_SCK_HZ);
+    s_sim.time_ns = host_tx_now_ns();
+    s_transport = s_sim.transport;
+    s_transport.select = Host_Select;
+    s_transport.transmit = Host_Transmit;
+    s_transport.receive = Host_Receive;
+    s_transport.receive_start = Host_Receive;
+    s_transport.receive_wait = Host_ReceiveWait;
+    s_transport.delay = Host_Delay;
+    s_transport.get_tick = Host_GetTick;
+    s_transport.in_thread = Host_InThread;
+
+    (void)BSP_W25QXX_DeInit();
+    CHECK(BSP_W25QXX_InitTransport(&s_transport) == W25QXX_OK);
+    s_serialized = !suspend;
+    if (suspend)
+    {
+        CHECK(BSP_W25QXX_EnableSuspend() == W25QXX_OK);
+    }
+
+    memset(&s_result, 0, sizeof(s_result));
+    s_done = 0U;
+    s_end_us = host_tx_now_us() + HOST_RUN_US;
+
+    CHECK(tx_thread_create(&s_threads[run][0], "writer", Host_Writer, 0U, NULL, 0U,
+                           12U, 12U, TX_NO_TIME_SLICE, TX_AUTO_START) == TX_SUCCESS);
+    CHECK(tx_thread_create(&s_threads[run][1], "checker", Host_Checker, 0U, NULL, 0U,
+                           8U, 8U, TX_NO_TIME_SLICE, TX_AUTO_START) == TX_SUCCESS);
+    CHECK(tx_thread_create(&s_threads[run][2], "reader", Host_Reader, 0U, NULL, 0U,
+                           4U, 4U, TX_NO_TIME_SLICE, TX_AUTO_START) == TX_SUCCESS);
+
+    while (s_done < 3U)
+    {
+        (void)tx_thread_sleep(10U);
+    }
+
+    *result = s_result;
+    result->suspends = BSP_W25QXX_GetInfo()->erase_suspends;
+
+    qsort(s_samples, result->reads, sizeof(s_samples[0]), Host_Compare);
+    result->p50_us = s_samples[result->reads / 2U];
+    result->p99_us = s_samples[(result->reads * 99U) / 100U];
+    result->max_us = s_samples[result->reads - 1U];
+
+    printf("%-10s reads %5u  p50 %6u us  p99 %6u us  max %6u us  suspends %5u  "
+           "bad %u  torn %u  errors %u\n",
+           suspend ? "suspend" : "serialized", result->reads, result->p50_us,
+           result->p99_us, result->max_us, result->suspends, result->bad_reads,
+           result->torn_reads, result->errors);
+}
+
+int main(void)
+{
+    host_result_t serialized;
+    host_result_t suspended;
+
+    host_tx_init(0U);
+    host_tx_use_virtual_time();
+    (void)tx_mutex_create(&s_serial, "serial", TX_NO_INHERIT);
+
+    printf("W25Q128 model at %u Hz, %u s per run, %u-byte reads every 1-9 ms\n",
+           HOST_SCK_HZ, HOST_RUN_US / 1000000U, HOST_READ_SIZE);
+
+    Host_Run(0U, false, &serialized);
+    Host_Run(1U, true, &suspended);
+
+    CHECK((serialized.errors == 0U) && (suspended.errors == 0U));
+    CHECK((serialized.bad_reads == 0U) && (suspended.bad_reads == 0U));
+    CHECK((serialized.torn_reads == 0U) && (suspended.torn_reads == 0U));
+    CHECK(suspended.suspends > 0U);
+    CHECK(suspended.p99_us < serialized.p99_us);
+
+    printf("PASS\n");
+    return 0;
+}
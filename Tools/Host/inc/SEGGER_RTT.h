@@ -0,0 +1,32 @@
+/**
+ ******************************************************************************
+ * @file    SEGGER_RTT.h
+ * @brief   SEGGER RTT Subset for Host Builds (host_hal.c)
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ */
+
+#ifndef SEGGER_RTT_H
+#define SEGGER_RTT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTT_CTRL_RESET                  ""
+#define RTT_CTRL_TEXT_BRIGHT_RED        ""
+#define RTT_CTRL_TEXT_BRIGHT_GREEN      ""
+#define RTT_CTRL_TEXT_BRIGHT_YELLOW     ""
+#define RTT_CTRL_TEXT_BRIGHT_CYAN       ""
+#define RTT_CTRL_TEXT_BRIGHT_WHITE      ""
+
+#define SEGGER_RTT_Init()               do { } while (0)
+
+int SEGGER_RTT_printf(unsigned BufferIndex, const char *sFormat, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEGGER_RTT_H */
@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file    stm32f4xx_hal.h
+ * @brief   STM32F4 HAL and CMSIS Subset for Host Builds
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Registers are plain memory (host_hal.c). DWT->CYCCNT follows the host
+ * scheduler clock at SystemCoreClock: every access to DWT refreshes it.
+ * Interrupt masking is a no-op, as only one host thread runs at a time.
+ * The SD card functions are implemented by the harness that needs them.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tx_api.h"
+
+#define UNUSED(X)                       (void)(X)
+#define __IO                            volatile
+
+/* ============================================================================
+ * HAL Status
+ * ============================================================================*/
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+/* ============================================================================
+ * Core Registers
+ * ============================================================================*/
+
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    __IO uint32_t CFSR;
+    __IO uint32_t HFSR;
+    __IO uint32_t MMFAR;
+    __IO uint32_t BFAR;
+    __IO uint32_t AIRCR;
+} SCB_Type;
+
+extern CoreDebug_Type host_core_debug;
+extern SCB_Type host_scb;
+DWT_Type *host_dwt(void);
+
+#define DWT                             (host_dwt())
+#define CoreDebug                       (&host_core_debug)
+#define SCB                             (&host_scb)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+
+static inline uint32_t __get_PRIMASK(void) { return 0U; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) { }
+static inline void __enable_irq(void) { }
+static inline uint32_t __get_IPSR(void) { return 0U; }
+static inline uint32_t __get_MSP(void) { return 0U; }
+static inline uint32_t __get_PSP(void) { return 0U; }
+#define __DMB()                         __sync_synchronize()
+#define __DSB()                         __sync_synchronize()
+#define __ISB()                         __sync_synchronize()
+#define __NOP()                         do { } while (0)
+
+void NVIC_SystemReset(void);
+
+/* ============================================================================
+ * GPIO
+ * ============================================================================*/
+
+typedef struct {
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef host_gpio[5];
+
+#define GPIOA                           (&host_gpio[0])
+#define GPIOB                           (&host_gpio[1])
+#define GPIOC                           (&host_gpio[2])
+#define GPIOD                           (&host_gpio[3])
+#define GPIOE                           (&host_gpio[4])
+
+#define GPIO_PIN_0                      ((uint16_t)0x0001)
+#define GPIO_PIN_1                      ((uint16_t)0x0002)
+#define GPIO_PIN_2                      ((uint16_t)0x0004)
+#define GPIO_PIN_3                      ((uint16_t)0x0008)
+#define GPIO_PIN_4                      ((uint16_t)0x0010)
+#define GPIO_PIN_5                      ((uint16_t)0x0020)
+#define GPIO_PIN_6                      ((uint16_t)0x0040)
+#define GPIO_PIN_7                      ((uint16_t)0x0080)
+#define GPIO_PIN_8                      ((uint16_t)0x0100)
+#define GPIO_PIN_9                      ((uint16_t)0x0200)
+#define GPIO_PIN_10                     ((uint16_t)0x0400)
+#define GPIO_PIN_11                     ((uint16_t)0x0800)
+#define GPIO_PIN_12                     ((uint16_t)0x1000)
+#define GPIO_PIN_13                     ((uint16_t)0x2000)
+#define GPIO_PIN_14                     ((uint16_t)0x4000)
+#define GPIO_PIN_15                     ((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+/* ============================================================================
+ * RCC and Tick
+ * ============================================================================*/
+
+uint32_t HAL_RCC_GetSysClockFreq(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+/* ============================================================================
+ * SD Card (implemented by the harness)
+ * ============================================================================*/
+
+typedef uint32_t HAL_SD_CardStateTypeDef;
+
+#define HAL_SD_CARD_READY               0x00000001U
+#define HAL_SD_CARD_TRANSFER            0x00000004U
+#define HAL_SD_CARD_SENDING             0x00000005U
+#define HAL_SD_CARD_RECEIVING           0x00000006U
+#define HAL_SD_CARD_PROGRAMMING         0x00000007U
+#define HAL_SD_CARD_ERROR               0x000000FFU
+#define HAL_SD_ERROR_NONE               0x00000000U
+
+typedef struct {
+    uint32_t BlockNbr;
+    uint32_t BlockSize;
+    uint32_t LogBlockNbr;
+    uint32_t LogBlockSize;
+} HAL_SD_CardInfoTypeDef;
+
+typedef struct {
+    HAL_SD_CardInfoTypeDef SdCard;
+    __IO uint32_t ErrorCode;
+} SD_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_SD_Init(SD_HandleTypeDef *hsd);
+HAL_StatusTypeDef HAL_SD_DeInit(SD_HandleTypeDef *hsd);
+HAL_SD_CardStateTypeDef HAL_SD_GetCardState(SD_HandleTypeDef *hsd);
+HAL_StatusTypeDef HAL_SD_GetCardInfo(SD_HandleTypeDef *hsd, HAL_SD_CardInfoTypeDef *pCardInfo);
+HAL_StatusTypeDef HAL_SD_ReadBlocks_DMA(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t BlockAdd,
+                                        uint32_t NumberOfBlocks);
+HAL_StatusTypeDef HAL_SD_WriteBlocks_DMA(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t BlockAdd,
+                                         uint32_t NumberOfBlocks);
+HAL_StatusTypeDef HAL_SD_Abort(SD_HandleTypeDef *hsd);
+void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd);
+void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd);
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4xx_HAL_H */
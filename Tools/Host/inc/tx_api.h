@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * @file    tx_api.h
+ * @brief   ThreadX API Subset for Host Builds
+ * @author  YCX81
+ * @version V1.0.0
+ ******************************************************************************
+ * @attention
+ *
+ * Replaces the ThreadX header in host harnesses (Tools/Host). Threads are
+ * POSIX threads, but only one runs at a time and the highest priority
+ * ready thread is chosen at every service call, as on the single core
+ * target. Preemption happens at service calls and at host_tx_poll() only.
+ *
+ * Time is either the host monotonic clock or a virtual clock
+ * (host_tx_use_virtual_time): when no thread is ready, virtual time jumps
+ * to the next wake-up or event, so a device model's busy times cost no
+ * host time. Events (host_tx_event_at) stand in for interrupts.
+ *
+ ******************************************************************************
+ */
+
+#ifndef TX_API_H
+#define TX_API_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/* ============================================================================
+ * Types (Cortex-M port sizes)
+ * ============================================================================*/
+
+#define VOID                            void
+typedef char                            CHAR;
+typedef unsigned char                   UCHAR;
+typedef int                             INT;
+typedef unsigned int                    UINT;
+typedef int                             LONG;
+typedef unsigned int                    ULONG;
+typedef unsigned long long              ULONG64;
+typedef short                           SHORT;
+typedef unsigned short                  USHORT;
+
+#define ALIGN_TYPE_DEFINED
+#define ALIGN_TYPE                      uintptr_t
+
+/* ============================================================================
+ * Constants
+ * ============================================================================*/
+
+#define TX_NULL                         ((void *)0)
+#define TX_SUCCESS                      0x00U
+#define TX_DELETED                      0x01U
+#define TX_POOL_ERROR                   0x02U
+#define TX_PTR_ERROR                    0x03U
+#define TX_WAIT_ERROR                   0x04U
+#define TX_NO_MEMORY                    0x10U
+#define TX_NO_INSTANCE                  0x0DU
+#define TX_NOT_AVAILABLE                0x1DU
+#define TX_NOT_OWNED                    0x1EU
+#define TX_THREAD_ERROR                 0x0EU
+
+#define TX_NO_WAIT                      0x00000000UL
+#define TX_WAIT_FOREVER                 0xFFFFFFFFUL
+#define TX_TIMER_TICKS_PER_SECOND       1000UL
+
+#define TX_AUTO_START                   1U
+#define TX_DONT_START                   0U
+#define TX_NO_TIME_SLICE                0UL
+#define TX_INHERIT                      1U
+#define TX_NO_INHERIT                   0U
+#define TX_INT_DISABLE                  1U
+#define TX_INT_ENABLE                   0U
+
+#define TX_INTERRUPT_SAVE_AREA          UINT interrupt_save;
+#define TX_DISABLE                      interrupt_save = tx_interrupt_control(TX_INT_DISABLE);
+#define TX_RESTORE                      (void)tx_interrupt_control(interrupt_save);
+
+/* ============================================================================
+ * Control Blocks
+ * ============================================================================*/
+
+typedef struct TX_THREAD_STRUCT {
+    CHAR *tx_thread_name;
+    UINT tx_thread_priority;
+    VOID *tx_thread_filex_ptr;                  /* FileX local path */
+    VOID (*entry)(ULONG);
+    ULONG input;
+    pthread_t handle;
+    pthread_cond_t cond;
+    UINT state;                                 /* Host scheduler state */
+    uint64_t ready_seq;                         /* FIFO order within a priority */
+    uint64_t wait_seq;                          /* FIFO order of waiters */
+    uint64_t wake_us;                           /* Sleep or wait timeout */
+    void *waiting;                              /* Object waited on */
+    UINT wait_status;
+    struct TX_THREAD_STRUCT *next;
+} TX_THREAD;
+
+typedef struct {
+    CHAR *name;
+    ULONG tx_semaphore_count;
+} TX_SEMAPHORE;
+
+typedef struct {
+    CHAR *name;
+    TX_THREAD *tx_mutex_owner;
+    UINT tx_mutex_ownership_count;
+} TX_MUTEX;
+
+typedef struct {
+    CHAR *name;
+    UCHAR *start;
+    ULONG size;
+    ULONG used;
+    ULONG tx_byte_pool_available;
+} TX_BYTE_POOL;
+
+typedef struct {
+    int unused;
+} TX_TIMER;
+
+/* ============================================================================
+ * ThreadX Services
+ * ============================================================================*/
+
+UINT tx_thread_create(TX_THREAD *thread_ptr, CHAR *name_ptr, VOID (*entry_function)(ULONG),
+                      ULONG entry_input, VOID *stack_start, ULONG stack_size, UINT priority,
+                      UINT preempt_threshold, ULONG time_slice, UINT auto_start);
+UINT tx_thread_sleep(ULONG timer_ticks);
+UINT tx_thread_relinquish(VOID);
+TX_THREAD *tx_thread_identify(VOID);
+UINT tx_thread_preemption_change(TX_THREAD *thread_ptr, UINT new_threshold, UINT *old_threshold);
+
+UINT tx_semaphore_create(TX_SEMAPHORE *semaphore_ptr, CHAR *name_ptr, ULONG initial_count);
+UINT tx_semaphore_delete(TX_SEMAPHORE *semaphore_ptr);
+UINT tx_semaphore_get(TX_SEMAPHORE *semaphore_ptr, ULONG wait_option);
+UINT tx_semaphore_put(TX_SEMAPHORE *semaphore_ptr);
+
+UINT tx_mutex_create(TX_MUTEX *mutex_ptr, CHAR *name_ptr, UINT inherit);
+UINT tx_mutex_delete(TX_MUTEX *mutex_ptr);
+UINT tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option);
+UINT tx_mutex_put(TX_MUTEX *mutex_ptr);
+
+UINT tx_byte_pool_create(TX_BYTE_POOL *pool_ptr, CHAR *name_ptr, VOID *pool_start, ULONG pool_size);
+UINT tx_byte_allocate(TX_BYTE_POOL *pool_ptr, VOID **memory_ptr, ULONG memory_size, ULONG wait_option);
+UINT tx_byte_release(VOID *memory_ptr);
+
+ULONG tx_time_get(VOID);
+UINT tx_interrupt_control(UINT new_posture);
+
+/* FileX caller checks */
+extern TX_THREAD *_tx_thread_current_ptr;
+extern TX_THREAD _tx_timer_thread;
+extern volatile ULONG _tx_thread_system_state;
+#define TX_THREAD_GET_SYSTEM_STATE()    _tx_thread_system_state
+
+/* ============================================================================
+ * Host Scheduler
+ * ============================================================================*/
+
+typedef void (*host_tx_event_t)(void *context);
+
+/**
+ * @brief Make the calling (main) thread a ThreadX thread
+ * @param priority Priority of the main thread
+ * @note  First call of a harness, before any other service
+ */
+void host_tx_init(UINT priority);
+
+/**
+ * @brief Run on a virtual clock from now on (starts at 0)
+ */
+void host_tx_use_virtual_time(void);
+
+/**
+ * @brief Get the current time
+ * @retval uint64_t Microseconds (host monotonic or virtual)
+ */
+uint64_t host_tx_now_us(void);
+
+/**
+ * @brief Get the current time with the host clock resolution
+ * @retval uint64_t Nanoseconds (virtual clock: microsecond steps)
+ */
+uint64_t host_tx_now_ns(void);
+
+/**
+ * @brief Spend time on the CPU (virtual clock: advance it)
+ * @param us Duration
+ * @note  Events falling due run and may preempt the caller
+ */
+void host_tx_busy(uint64_t us);
+
+/**
+ * @brief Run due events and switch to a higher priority thread now ready
+ */
+void host_tx_poll(void);
+
+/**
+ * @brief Call a function at a time, as an interrupt would
+ * @param at_us Time (host_tx_now_us base)
+ * @param function Called without a thread switch; may put semaphores
+ * @param context Passed to the function
+ */
+void host_tx_event_at(uint64_t at_us, host_tx_event_t function, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TX_API_H */